@@ -0,0 +1,120 @@
+/***************************************************************************
+*      Copyright (C) 2008 by Norwegian Computing Center and Statoil        *
+***************************************************************************/
+
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "lib/fft1d.h"
+
+std::map<int, rfftwnd_plan> FFT1D::forwardPlans_;
+std::map<int, rfftwnd_plan> FFT1D::inversePlans_;
+
+//------------------------------------------------------------
+rfftwnd_plan
+FFT1D::getPlan(int            n,
+               fftw_direction direction)
+{
+  rfftwnd_plan plan;
+
+  // FFTW planning is not thread safe, and the maps may be changed by another thread.
+#pragma omp critical(FFTWPlans)
+  {
+    std::map<int, rfftwnd_plan> & plans = (direction == FFTW_REAL_TO_COMPLEX ? forwardPlans_ : inversePlans_);
+    std::map<int, rfftwnd_plan>::iterator it = plans.find(n);
+    if(it == plans.end()) {
+      // FFTW_THREADSAFE: The plan has no work array, so it can be shared by threads.
+      int flag = FFTW_ESTIMATE | FFTW_IN_PLACE | FFTW_THREADSAFE;
+      it = plans.insert(std::make_pair(n, rfftwnd_create_plan(1, &n, direction, flag))).first;
+    }
+    plan = it->second;
+  }
+  return(plan);
+}
+
+//------------------------------------------------------------
+int
+FFT1D::getNumberOfThreads(int  nVectors,
+                          bool parallel)
+{
+  int nThreads = 1;
+#ifdef _OPENMP
+  if(parallel && !omp_in_parallel())
+    nThreads = std::min(omp_get_max_threads(), nVectors);
+#endif
+  return(std::max(nThreads, 1));
+}
+
+//------------------------------------------------------------
+void
+FFT1D::fft(fftw_real * rAmp,
+           int         n)
+{
+  rfftwnd_one_real_to_complex(getPlan(n, FFTW_REAL_TO_COMPLEX), rAmp, NULL);
+}
+
+//------------------------------------------------------------
+void
+FFT1D::fftInv(fftw_complex * cAmp,
+              int            n)
+{
+  rfftwnd_one_complex_to_real(getPlan(n, FFTW_COMPLEX_TO_REAL), cAmp, NULL);
+}
+
+//------------------------------------------------------------
+void
+FFT1D::fft(fftw_real * rAmp,
+           int         n,
+           int         nVectors,
+           bool        parallel)
+{
+  rfftwnd_plan plan     = getPlan(n, FFTW_REAL_TO_COMPLEX);
+  int          rn       = 2*(n/2 + 1);
+  int          nThreads = getNumberOfThreads(nVectors, parallel);
+  int          nChunk   = (nVectors + nThreads - 1)/nThreads;
+
+#pragma omp parallel for schedule(static, 1) num_threads(nThreads) if(nThreads > 1)
+  for(int t = 0 ; t < nThreads ; t++) {
+    int first = t*nChunk;
+    int nHere = std::min(nChunk, nVectors - first);
+    if(nHere > 0)
+      rfftwnd_real_to_complex(plan, nHere, rAmp + first*rn, 1, rn, NULL, 1, rn/2);
+  }
+}
+
+//------------------------------------------------------------
+void
+FFT1D::fftInv(fftw_complex * cAmp,
+              int            n,
+              int            nVectors,
+              bool           parallel)
+{
+  rfftwnd_plan plan     = getPlan(n, FFTW_COMPLEX_TO_REAL);
+  int          cn       = n/2 + 1;
+  int          nThreads = getNumberOfThreads(nVectors, parallel);
+  int          nChunk   = (nVectors + nThreads - 1)/nThreads;
+
+#pragma omp parallel for schedule(static, 1) num_threads(nThreads) if(nThreads > 1)
+  for(int t = 0 ; t < nThreads ; t++) {
+    int first = t*nChunk;
+    int nHere = std::min(nChunk, nVectors - first);
+    if(nHere > 0)
+      rfftwnd_complex_to_real(plan, nHere, cAmp + first*cn, 1, cn, NULL, 1, 2*cn);
+  }
+}
+
+//------------------------------------------------------------
+void
+FFT1D::clearPlans()
+{
+  std::map<int, rfftwnd_plan>::iterator it;
+  for(it = forwardPlans_.begin() ; it != forwardPlans_.end() ; it++)
+    rfftwnd_destroy_plan(it->second);
+  for(it = inversePlans_.begin() ; it != inversePlans_.end() ; it++)
+    rfftwnd_destroy_plan(it->second);
+  forwardPlans_.clear();
+  inversePlans_.clear();
+}
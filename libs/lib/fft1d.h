@@ -0,0 +1,55 @@
+/***************************************************************************
+*      Copyright (C) 2008 by Norwegian Computing Center and Statoil        *
+***************************************************************************/
+
+#ifndef FFT1D_H
+#define FFT1D_H
+
+#include <map>
+
+#include "fftw.h"
+#include "rfftw.h"
+
+// Real 1D Fourier transforms for traces, well logs and wavelets. The FFTW plans are created
+// the first time a length is used, and kept for the rest of the run, so that callers doing
+// many short transforms do not pay for planning each time. The plans are thread safe, and
+// the transforms may be called from parallel regions.
+//
+// A vector of length n is stored in place in 2*(n/2+1) reals, as rfftwnd with FFTW_IN_PLACE.
+// As in FFTW, the transforms are not normalized: fftInv(fft(x)) = n*x.
+class FFT1D
+{
+public:
+  static void          fft(fftw_real    * rAmp,
+                           int            n);
+
+  static void          fftInv(fftw_complex * cAmp,
+                              int            n);
+
+  // Transforms nVectors vectors stored contiguously, each in 2*(n/2+1) reals. If parallel is
+  // true, the vectors are split over the OpenMP threads.
+  static void          fft(fftw_real    * rAmp,
+                           int            n,
+                           int            nVectors,
+                           bool           parallel = false);
+
+  static void          fftInv(fftw_complex * cAmp,
+                              int            n,
+                              int            nVectors,
+                              bool           parallel = false);
+
+  // Destroys the cached plans. Must not be called while transforms are running.
+  static void          clearPlans();
+
+private:
+  static rfftwnd_plan  getPlan(int            n,
+                               fftw_direction direction);
+
+  static int           getNumberOfThreads(int nVectors,
+                                          bool parallel);
+
+  static std::map<int, rfftwnd_plan> forwardPlans_;
+  static std::map<int, rfftwnd_plan> inversePlans_;
+};
+
+#endif
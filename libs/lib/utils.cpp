@@ -6,6 +6,7 @@
 #include <string.h>
 
 #include "lib/utils.h"
+#include "lib/fft1d.h"
 #include "src/definitions.h"
 
 #include "fftw.h"
@@ -145,18 +146,15 @@ Utils::writeMatrix(double ** matrix,
 void
 Utils::fft(fftw_real* rAmp,fftw_complex* cAmp,int nt)
 {
-  rfftwnd_plan p1 = rfftwnd_create_plan(1, &nt, FFTW_REAL_TO_COMPLEX, FFTW_ESTIMATE | FFTW_IN_PLACE);
-  rfftwnd_one_real_to_complex(p1, rAmp, cAmp);
-  fftwnd_destroy_plan(p1);
+  // In place transform, cAmp is the output in rAmp.
+  FFT1D::fft(rAmp, nt);
 }
 
 //------------------------------------------------------------
 void
 Utils::fftInv(fftw_complex* cAmp,fftw_real* rAmp,int nt)
 {
-  rfftwnd_plan p2 = rfftwnd_create_plan(1, &nt, FFTW_COMPLEX_TO_REAL, FFTW_ESTIMATE | FFTW_IN_PLACE);
-  rfftwnd_one_complex_to_real(p2, cAmp, rAmp);
-  fftwnd_destroy_plan(p2);
+  FFT1D::fftInv(cAmp, nt);
   double sf = 1.0/double(nt);
   for(int i=0;i<nt;i++)
     rAmp[i]*=fftw_real(sf);
@@ -0,0 +1,139 @@
+// Copyright (c)  2011, Norwegian Computing Center
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//   Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//   Redistributions in binary form must reproduce the above copyright notice, this list of
+//    conditions and the following disclaimer in the documentation and/or other materials
+//    provided with the distribution.
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+// OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+// EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "asciifile.hpp"
+
+#include <fstream>
+
+#include "fileio.hpp"
+
+namespace NRLib {
+
+namespace {
+
+// Whitespace in the classic locale.
+inline bool IsWhitespace(char c)
+{
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+} // namespace
+
+
+AsciiFile::AsciiFile(const std::string& filename)
+  : pos_(0),
+    line_(0)
+{
+  std::ifstream file;
+  OpenRead(file, filename, std::ios::in | std::ios::binary);
+
+  file.seekg(0, std::ios_base::end);
+  std::streamoff size = file.tellg();
+  file.seekg(0, std::ios_base::beg);
+
+  buffer_.resize(static_cast<size_t>(size));
+  if (size > 0)
+    file.read(&buffer_[0], size);
+  if (!file)
+    throw IOError("Failed to read " + filename + ".");
+}
+
+
+void AsciiFile::Rewind()
+{
+  pos_  = 0;
+  line_ = 0;
+}
+
+
+bool AsciiFile::CheckEndOfFile()
+{
+  while (pos_ < buffer_.size() && IsWhitespace(buffer_[pos_])) {
+    if (buffer_[pos_] == '\n')
+      line_++;
+    pos_++;
+  }
+  return pos_ == buffer_.size();
+}
+
+
+bool AsciiFile::NextToken(const char*& begin, const char*& end)
+{
+  if (CheckEndOfFile())
+    return false;
+  size_t first = pos_;
+  while (pos_ < buffer_.size() && !IsWhitespace(buffer_[pos_]))
+    pos_++;
+  begin = &buffer_[0] + first;
+  end   = &buffer_[0] + pos_;
+  return true;
+}
+
+
+bool AsciiFile::ReadNextToken(std::string& s)
+{
+  const char* begin;
+  const char* end;
+  if (!NextToken(begin, end))
+    return false;
+  s.assign(begin, end);
+  return true;
+}
+
+
+void AsciiFile::GetRestOfLine(std::string& line)
+{
+  size_t first = pos_;
+  while (pos_ < buffer_.size() && buffer_[pos_] != '\n')
+    pos_++;
+  line.assign(buffer_.begin() + first, buffer_.begin() + pos_);
+  if (pos_ < buffer_.size()) {
+    pos_++;
+    line_++;
+  }
+}
+
+
+void AsciiFile::DiscardRestOfLine()
+{
+  while (pos_ < buffer_.size() && buffer_[pos_] != '\n')
+    pos_++;
+  if (pos_ < buffer_.size())
+    pos_++;
+  line_++;
+}
+
+
+int AsciiFile::CountTokensOnLine() const
+{
+  int  n_tokens = 0;
+  bool in_token = false;
+  for (size_t i = pos_; i < buffer_.size() && buffer_[i] != '\n'; ++i) {
+    if (IsWhitespace(buffer_[i]))
+      in_token = false;
+    else if (!in_token) {
+      in_token = true;
+      n_tokens++;
+    }
+  }
+  return n_tokens;
+}
+
+
+} // namespace NRLib
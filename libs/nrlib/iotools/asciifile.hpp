@@ -0,0 +1,93 @@
+// Copyright (c)  2011, Norwegian Computing Center
+// All rights reserved.
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//   Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//   Redistributions in binary form must reproduce the above copyright notice, this list of
+//    conditions and the following disclaimer in the documentation and/or other materials
+//    provided with the distribution.
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+// OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+// EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef NRLIB_IOTOOLS_ASCIIFILE_HPP
+#define NRLIB_IOTOOLS_ASCIIFILE_HPP
+
+#include <string>
+#include <vector>
+
+#include "stringtools.hpp"
+#include "../exception/exception.hpp"
+
+namespace NRLib {
+
+/// Class for reading ASCII files that are parsed token by token, such as well files.
+/// The whole file is read into memory with one read, and tokens and numbers are parsed
+/// directly from the buffer, without streams or locale. The functions work as their
+/// stream based counterparts in fileio.hpp, and give the same errors, so a reader can
+/// change from an std::ifstream to an AsciiFile without changing its error handling.
+class AsciiFile
+{
+public:
+  /// \throws IOError if the file can not be opened, as OpenRead.
+  explicit AsciiFile(const std::string& filename);
+
+  /// Moves back to the start of the file, and resets the line number.
+  void Rewind();
+
+  /// Skips whitespace. Returns true if the end of the file is reached.
+  bool CheckEndOfFile();
+
+  /// Reads the next whitespace separated token. Returns false, and leaves s
+  /// unchanged, if the end of the file is reached.
+  bool ReadNextToken(std::string& s);
+
+  /// Reads the next token and parses it as type T, as ReadNext in fileio.hpp.
+  /// \throws EndOfFile if the end of file is reached.
+  /// \throws Exception if the token could not be parsed as the given type.
+  template <typename T>
+  T ReadNext();
+
+  /// Reads the rest of the current line, without the newline, as std::getline.
+  void GetRestOfLine(std::string& line);
+
+  /// Discards the rest of the current line, including the newline.
+  void DiscardRestOfLine();
+
+  /// Number of tokens between the current position and the end of the line.
+  int CountTokensOnLine() const;
+
+  /// Number of newlines passed.
+  int GetLineNumber() const { return line_; }
+
+private:
+  /// Skips whitespace and finds the next token. Returns false at end of file.
+  bool NextToken(const char*& begin, const char*& end);
+
+  std::vector<char> buffer_;
+  size_t            pos_;
+  int               line_;
+};
+
+// ========== TEMPLATE FUNCTION DEFINITIONS =========
+
+template <typename T>
+T AsciiFile::ReadNext()
+{
+  const char* begin;
+  const char* end;
+  if (!NextToken(begin, end))
+    throw EndOfFile();
+  return ParseTypeFast<T>(begin, end);
+}
+
+} // namespace NRLib
+
+#endif // NRLIB_IOTOOLS_ASCIIFILE_HPP
@@ -36,6 +36,16 @@
 using namespace NRLib::NRLibPrivate;
 using namespace NRLib;
 
+namespace {
+
+// Whitespace in the classic locale.
+inline bool IsWhitespace(int c)
+{
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+} // namespace
+
 const std::string format_desc[5] = {"storm_petro_binary",
                                     "storm_petro_ascii",
                                     "storm_facies_binary",
@@ -203,29 +213,37 @@ void NRLib::CreateDirIfNotExists(const std::string & filename)
   }
 }
 
+// Reads directly from the stream buffer, without sentries or locale. The whitespace
+// after the token is left in the stream, so that line numbers are OK.
 std::istream& NRLib::ReadNextToken(std::istream & stream,
                                    std::string  & s,
                                    int          & line_num)
 {
-  std::locale loc = std::locale();
-  char c;
+  typedef std::char_traits<char> traits;
   if (!stream.good()) {
     stream.setstate(std::ifstream::failbit);
     s = "";
     return stream;
   }
-  while(stream.get(c) && std::isspace(c,loc) == true ) {
+  std::streambuf * buffer = stream.rdbuf();
+  traits::int_type c      = buffer->sbumpc();
+  while (!traits::eq_int_type(c, traits::eof()) && IsWhitespace(c)) {
     if (c == '\n')
       line_num++;
+    c = buffer->sbumpc();
   }
-  if (stream.good()) {
-    s = c;
-    while(stream.get(c) && std::isspace(c, loc) == false) {
-      s = s+c;
-    }
+  if (traits::eq_int_type(c, traits::eof())) {
+    stream.setstate(std::ifstream::eofbit | std::ifstream::failbit);
+    return stream;
+  }
+  s = traits::to_char_type(c);
+  c = buffer->sgetc();
+  while (!traits::eq_int_type(c, traits::eof()) && !IsWhitespace(c)) {
+    s += traits::to_char_type(c);
+    c = buffer->snextc();
   }
-  if (stream.good() == true) // Do not insert anything at eof.
-    stream.putback(c);       // Put back to make sure that line-numbers are OK.
+  if (traits::eq_int_type(c, traits::eof()))
+    stream.setstate(std::ifstream::eofbit | std::ifstream::failbit);
   return stream;
 }
 
@@ -125,8 +125,8 @@ namespace NRLib {
   std::istream& ReadNextToken(std::istream& stream, std::string& s, int& line);
 
   /// \brief Gets next token from file, and parses it as type T
-  ///        Might be relatively slow, due to typechecking, and counting line
-  ///        numbers.
+  ///        Plain decimal numbers are parsed with TryParseNumber, other tokens
+  ///        with ParseType.
   /// \throws EndOfFile if end of file is reached.
   /// \throws Exception if the token could not be parsed as the given type.
   template <typename T>
@@ -151,7 +151,8 @@ namespace NRLib {
   I ReadAsciiArray(std::istream& stream, I begin, size_t n, int& line);
 
   /// \brief Gets sequence with elements of type T from input stream.
-  ///        Does no type checking, and does not count line numbers.
+  ///        Reads the tokens directly from the stream buffer, parses them with
+  ///        TryParseNumber when possible, and does not count line numbers.
   /// \note  The container must already be big enough to read all n
   ///        elements.
   template <typename I>
@@ -353,6 +354,10 @@ bool IgnoreComment(std::ifstream& file,
   inline void ParseIBMFloatBE(const char* buffer, float& f);
 
 namespace NRLibPrivate {
+  /// Number of values converted at a time by the binary array functions. Large arrays
+  /// are written and read in blocks of this size, so no buffer for the full array is needed.
+  const size_t BinaryArrayChunk = 65536;
+
   /// \todo Use stdint.h if available.
   // typedef unsigned int uint32_t;
   // typedef unsigned long long uint64_t;
@@ -442,7 +447,7 @@ T ReadNext(std::istream& stream, int& line)
   ReadNextToken(stream, s, line);
   if (s == "")
     throw EndOfFile();
-  return ParseType<T>(s);
+  return ParseTypeFast<T>(s.data(), s.data() + s.size());
 }
 
 
@@ -481,19 +486,22 @@ template <typename I>
 I NRLib::ReadAsciiArrayFast(std::istream& stream, I begin, size_t n)
 {
   typedef typename std::iterator_traits<I>::value_type T;
+  std::string token;
+  int         line = 0;
   for (size_t i = 0; i < n; ++i) {
-    stream >> *begin;
-    ++begin;
-    if ( stream.eof() ) {
+    token.clear();
+    ReadNextToken(stream, token, line);
+    if (token.empty()) {
       throw EndOfFile();
     }
-    if ( stream.fail() ) {
-      stream.clear();
-      std::string nextToken;
-      stream >> nextToken;
+    try {
+      *begin = ParseTypeFast<T>(token.data(), token.data() + token.size());
+    }
+    catch (Exception& ) {
       throw Exception("Failure during reading element " + ToString(static_cast<unsigned int>(i)) + " of array. "
-        + "Next token is " + nextToken + "\n");
+        + "Next token is " + token + "\n");
     }
+    ++begin;
   }
   return begin;
 }
@@ -524,26 +532,29 @@ void NRLib::WriteBinaryShortArray(std::ostream& stream,
 {
   using namespace NRLib::NRLibPrivate;
 
-  typename I::difference_type n_char = 2*std::distance(begin, end);
-  std::vector<char> buffer(n_char);
+  if (number_representation != END_BIG_ENDIAN && number_representation != END_LITTLE_ENDIAN) {
+    throw Exception("Invalid number representation.");
+  }
+
+  size_t n_total = static_cast<size_t>(std::distance(begin, end));
+  std::vector<char> buffer(2*(n_total < BinaryArrayChunk ? n_total : BinaryArrayChunk));
 
-  switch (number_representation) {
-  case END_BIG_ENDIAN:
-    for (int i = 0; begin != end; ++begin, ++i) {
-      WriteUInt16BE(&buffer[2*i], static_cast<unsigned short>(*begin));
+  while (begin != end) {
+    size_t n = 0;
+    if (number_representation == END_BIG_ENDIAN) {
+      for (; begin != end && n < BinaryArrayChunk; ++begin, ++n) {
+        WriteUInt16BE(&buffer[2*n], static_cast<unsigned short>(*begin));
+      }
     }
-    break;
-  case END_LITTLE_ENDIAN:
-    for (int i = 0; begin != end; ++begin, ++i) {
-      WriteUInt16LE(&buffer[2*i], static_cast<unsigned short>(*begin));
+    else {
+      for (; begin != end && n < BinaryArrayChunk; ++begin, ++n) {
+        WriteUInt16LE(&buffer[2*n], static_cast<unsigned short>(*begin));
+      }
     }
-    break;
-  default:
-    throw Exception("Invalid number representation.");
-  }
 
-  if (!stream.write(&buffer[0], static_cast<std::streamsize>(n_char))) {
-    throw Exception("Error writing to stream.");
+    if (!stream.write(&buffer[0], static_cast<std::streamsize>(2*n))) {
+      throw Exception("Error writing to stream.");
+    }
   }
 }
 
@@ -556,30 +567,34 @@ I NRLib::ReadBinaryShortArray(std::istream& stream,
 {
   using namespace NRLib::NRLibPrivate;
 
-  std::vector<char> buffer(2*n);
+  if (number_representation != END_BIG_ENDIAN && number_representation != END_LITTLE_ENDIAN) {
+    throw Exception("Invalid number representation.");
+  }
+
+  std::vector<char> buffer(2*(n < BinaryArrayChunk ? n : BinaryArrayChunk));
   unsigned short us;
 
-  if (!stream.read(&buffer[0], static_cast<std::streamsize>(2*n))) {
-    throw Exception("Error reading from stream (f).");
-  }
+  while (n > 0) {
+    size_t n_chunk = (n < BinaryArrayChunk ? n : BinaryArrayChunk);
+    if (!stream.read(&buffer[0], static_cast<std::streamsize>(2*n_chunk))) {
+      throw Exception("Error reading from stream (f).");
+    }
 
-  switch (number_representation) {
-  case END_BIG_ENDIAN:
-    for (size_t i = 0; i < n; ++i) {
-      ParseUInt16BE(&buffer[2*i], us);
-      *begin = static_cast<typename std::iterator_traits<I>::value_type>(us);
-      ++begin;
+    if (number_representation == END_BIG_ENDIAN) {
+      for (size_t i = 0; i < n_chunk; ++i) {
+        ParseUInt16BE(&buffer[2*i], us);
+        *begin = static_cast<typename std::iterator_traits<I>::value_type>(us);
+        ++begin;
+      }
     }
-    break;
-  case END_LITTLE_ENDIAN:
-    for (size_t i = 0; i < n; ++i) {
-      ParseUInt16LE(&buffer[2*i], us);
-      *begin = static_cast<typename std::iterator_traits<I>::value_type>(us);
-      ++begin;
+    else {
+      for (size_t i = 0; i < n_chunk; ++i) {
+        ParseUInt16LE(&buffer[2*i], us);
+        *begin = static_cast<typename std::iterator_traits<I>::value_type>(us);
+        ++begin;
+      }
     }
-    break;
-  default:
-    throw Exception("Invalid number representation.");
+    n -= n_chunk;
   }
 
   return begin;
@@ -594,26 +609,29 @@ void NRLib::WriteBinaryIntArray(std::ostream& stream,
 {
   using namespace NRLib::NRLibPrivate;
 
-  typename I::difference_type n_char = 4*std::distance(begin, end);
-  std::vector<char> buffer(n_char);
+  if (number_representation != END_BIG_ENDIAN && number_representation != END_LITTLE_ENDIAN) {
+    throw Exception("Invalid number representation.");
+  }
 
-  switch (number_representation) {
-  case END_BIG_ENDIAN:
-    for (int i = 0; begin != end; ++begin, ++i) {
-      WriteUInt32BE(&buffer[4*i], static_cast<unsigned int>(*begin));
+  size_t n_total = static_cast<size_t>(std::distance(begin, end));
+  std::vector<char> buffer(4*(n_total < BinaryArrayChunk ? n_total : BinaryArrayChunk));
+
+  while (begin != end) {
+    size_t n = 0;
+    if (number_representation == END_BIG_ENDIAN) {
+      for (; begin != end && n < BinaryArrayChunk; ++begin, ++n) {
+        WriteUInt32BE(&buffer[4*n], static_cast<unsigned int>(*begin));
+      }
     }
-    break;
-  case END_LITTLE_ENDIAN:
-    for (int i = 0; begin != end; ++begin, ++i) {
-      WriteUInt32LE(&buffer[4*i], static_cast<unsigned int>(*begin));
+    else {
+      for (; begin != end && n < BinaryArrayChunk; ++begin, ++n) {
+        WriteUInt32LE(&buffer[4*n], static_cast<unsigned int>(*begin));
+      }
     }
-    break;
-  default:
-    throw Exception("Invalid number representation.");
-  }
 
-  if (!stream.write(&buffer[0], static_cast<std::streamsize>(n_char))) {
-    throw Exception("Error writing to stream.");
+    if (!stream.write(&buffer[0], static_cast<std::streamsize>(4*n))) {
+      throw Exception("Error writing to stream.");
+    }
   }
 }
 
@@ -626,30 +644,34 @@ I NRLib::ReadBinaryIntArray(std::istream& stream,
 {
   using namespace NRLib::NRLibPrivate;
 
-  std::vector<char> buffer(4*n);
+  if (number_representation != END_BIG_ENDIAN && number_representation != END_LITTLE_ENDIAN) {
+    throw Exception("Invalid number representation.");
+  }
+
+  std::vector<char> buffer(4*(n < BinaryArrayChunk ? n : BinaryArrayChunk));
   unsigned int ui;
 
-  if (!stream.read(&buffer[0], static_cast<std::streamsize>(4*n))) {
-    throw Exception("Error reading from stream (g).");
-  }
+  while (n > 0) {
+    size_t n_chunk = (n < BinaryArrayChunk ? n : BinaryArrayChunk);
+    if (!stream.read(&buffer[0], static_cast<std::streamsize>(4*n_chunk))) {
+      throw Exception("Error reading from stream (g).");
+    }
 
-  switch (number_representation) {
-  case END_BIG_ENDIAN:
-    for (size_t i = 0; i < n; ++i) {
-      ParseUInt32BE(&buffer[4*i], ui);
-      *begin = static_cast<typename std::iterator_traits<I>::value_type>(ui);
-      ++begin;
+    if (number_representation == END_BIG_ENDIAN) {
+      for (size_t i = 0; i < n_chunk; ++i) {
+        ParseUInt32BE(&buffer[4*i], ui);
+        *begin = static_cast<typename std::iterator_traits<I>::value_type>(ui);
+        ++begin;
+      }
     }
-    break;
-  case END_LITTLE_ENDIAN:
-    for (size_t i = 0; i < n; ++i) {
-      ParseUInt32LE(&buffer[4*i], ui);
-      *begin = static_cast<typename std::iterator_traits<I>::value_type>(ui);
-      ++begin;
+    else {
+      for (size_t i = 0; i < n_chunk; ++i) {
+        ParseUInt32LE(&buffer[4*i], ui);
+        *begin = static_cast<typename std::iterator_traits<I>::value_type>(ui);
+        ++begin;
+      }
     }
-    break;
-  default:
-    throw Exception("Invalid number representation.");
+    n -= n_chunk;
   }
 
   return begin;
@@ -664,26 +686,29 @@ void NRLib::WriteBinaryFloatArray(std::ostream& stream,
 {
   using namespace NRLib::NRLibPrivate;
 
-  typename I::difference_type n_char = 4*std::distance(begin, end);
-  std::vector<char> buffer(n_char);
+  if (number_representation != END_BIG_ENDIAN && number_representation != END_LITTLE_ENDIAN) {
+    throw Exception("Invalid number representation.");
+  }
 
-  switch (number_representation) {
-  case END_BIG_ENDIAN:
-    for (int i = 0; begin != end; ++begin, ++i) {
-      WriteIEEEFloatBE(&buffer[4*i], *begin);
+  size_t n_total = static_cast<size_t>(std::distance(begin, end));
+  std::vector<char> buffer(4*(n_total < BinaryArrayChunk ? n_total : BinaryArrayChunk));
+
+  while (begin != end) {
+    size_t n = 0;
+    if (number_representation == END_BIG_ENDIAN) {
+      for (; begin != end && n < BinaryArrayChunk; ++begin, ++n) {
+        WriteIEEEFloatBE(&buffer[4*n], *begin);
+      }
     }
-    break;
-  case END_LITTLE_ENDIAN:
-    for (int i = 0; begin != end; ++begin, ++i) {
-      WriteIEEEFloatLE(&buffer[4*i], *begin);
+    else {
+      for (; begin != end && n < BinaryArrayChunk; ++begin, ++n) {
+        WriteIEEEFloatLE(&buffer[4*n], *begin);
+      }
     }
-    break;
-  default:
-    throw Exception("Invalid number representation.");
-  }
 
-  if (!stream.write(&buffer[0], static_cast<std::streamsize>(n_char))) {
-    throw Exception("Error writing to stream.");
+    if (!stream.write(&buffer[0], static_cast<std::streamsize>(4*n))) {
+      throw Exception("Error writing to stream.");
+    }
   }
 }
 
@@ -695,30 +720,34 @@ I NRLib::ReadBinaryFloatArray(std::istream& stream,
 {
   using namespace NRLib::NRLibPrivate;
 
-  std::vector<char> buffer(4*n);
+  if (number_representation != END_BIG_ENDIAN && number_representation != END_LITTLE_ENDIAN) {
+    throw Exception("Invalid number representation.");
+  }
+
+  std::vector<char> buffer(4*(n < BinaryArrayChunk ? n : BinaryArrayChunk));
   float f;
 
-  if (!stream.read(&buffer[0], static_cast<std::streamsize>(4*n))) {
-    throw Exception("Error reading from stream (h).");
-  }
+  while (n > 0) {
+    size_t n_chunk = (n < BinaryArrayChunk ? n : BinaryArrayChunk);
+    if (!stream.read(&buffer[0], static_cast<std::streamsize>(4*n_chunk))) {
+      throw Exception("Error reading from stream (h).");
+    }
 
-  switch (number_representation) {
-  case END_BIG_ENDIAN:
-    for (size_t i = 0; i < n; ++i) {
-      ParseIEEEFloatBE(&buffer[4*i], f);
-      *begin = static_cast<typename std::iterator_traits<I>::value_type>(f);
-      ++begin;
+    if (number_representation == END_BIG_ENDIAN) {
+      for (size_t i = 0; i < n_chunk; ++i) {
+        ParseIEEEFloatBE(&buffer[4*i], f);
+        *begin = static_cast<typename std::iterator_traits<I>::value_type>(f);
+        ++begin;
+      }
     }
-    break;
-  case END_LITTLE_ENDIAN:
-    for (size_t i = 0; i < n; ++i) {
-      ParseIEEEFloatLE(&buffer[4*i], f);
-      *begin = static_cast<typename std::iterator_traits<I>::value_type>(f);
-      ++begin;
+    else {
+      for (size_t i = 0; i < n_chunk; ++i) {
+        ParseIEEEFloatLE(&buffer[4*i], f);
+        *begin = static_cast<typename std::iterator_traits<I>::value_type>(f);
+        ++begin;
+      }
     }
-    break;
-  default:
-    throw Exception("Invalid number representation.");
+    n -= n_chunk;
   }
 
   return begin;
@@ -733,26 +762,29 @@ void NRLib::WriteBinaryDoubleArray(std::ostream& stream,
 {
   using namespace NRLib::NRLibPrivate;
 
-  typename I::difference_type n_char = 8*std::distance(begin, end);
-  std::vector<char> buffer(n_char);
+  if (number_representation != END_BIG_ENDIAN && number_representation != END_LITTLE_ENDIAN) {
+    throw Exception("Invalid number representation.");
+  }
+
+  size_t n_total = static_cast<size_t>(std::distance(begin, end));
+  std::vector<char> buffer(8*(n_total < BinaryArrayChunk ? n_total : BinaryArrayChunk));
 
-  switch (number_representation) {
-  case END_BIG_ENDIAN:
-    for (int i = 0; begin != end; ++begin, ++i) {
-      WriteIEEEDoubleBE(&buffer[8*i], *begin);
+  while (begin != end) {
+    size_t n = 0;
+    if (number_representation == END_BIG_ENDIAN) {
+      for (; begin != end && n < BinaryArrayChunk; ++begin, ++n) {
+        WriteIEEEDoubleBE(&buffer[8*n], *begin);
+      }
     }
-    break;
-  case END_LITTLE_ENDIAN:
-    for (int i = 0; begin != end; ++begin, ++i) {
-      WriteIEEEDoubleLE(&buffer[8*i], *begin);
+    else {
+      for (; begin != end && n < BinaryArrayChunk; ++begin, ++n) {
+        WriteIEEEDoubleLE(&buffer[8*n], *begin);
+      }
     }
-    break;
-  default:
-    throw Exception("Invalid number representation.");
-  }
 
-  if (!stream.write(&buffer[0], static_cast<std::streamsize>(n_char))) {
-    throw Exception("Error writing to stream.");
+    if (!stream.write(&buffer[0], static_cast<std::streamsize>(8*n))) {
+      throw Exception("Error writing to stream.");
+    }
   }
 }
 
@@ -765,30 +797,34 @@ I NRLib::ReadBinaryDoubleArray(std::istream& stream,
 {
   using namespace NRLib::NRLibPrivate;
 
-  std::vector<char> buffer(8*n);
+  if (number_representation != END_BIG_ENDIAN && number_representation != END_LITTLE_ENDIAN) {
+    throw Exception("Invalid number representation.");
+  }
+
+  std::vector<char> buffer(8*(n < BinaryArrayChunk ? n : BinaryArrayChunk));
   double d;
 
-  if (!stream.read(&buffer[0], static_cast<std::streamsize>(8*n))) {
-    throw Exception("Error reading from stream (i).");
-  }
+  while (n > 0) {
+    size_t n_chunk = (n < BinaryArrayChunk ? n : BinaryArrayChunk);
+    if (!stream.read(&buffer[0], static_cast<std::streamsize>(8*n_chunk))) {
+      throw Exception("Error reading from stream (i).");
+    }
 
-  switch (number_representation) {
-  case END_BIG_ENDIAN:
-    for (size_t i = 0; i < n; ++i) {
-      ParseIEEEDoubleBE(&buffer[8*i], d);
-      *begin = static_cast<typename std::iterator_traits<I>::value_type>(d);
-      ++begin;
+    if (number_representation == END_BIG_ENDIAN) {
+      for (size_t i = 0; i < n_chunk; ++i) {
+        ParseIEEEDoubleBE(&buffer[8*i], d);
+        *begin = static_cast<typename std::iterator_traits<I>::value_type>(d);
+        ++begin;
+      }
     }
-    break;
-  case END_LITTLE_ENDIAN:
-    for (size_t i = 0; i < n; ++i) {
-      ParseIEEEDoubleLE(&buffer[8*i], d);
-      *begin = static_cast<typename std::iterator_traits<I>::value_type>(d);
-      ++begin;
+    else {
+      for (size_t i = 0; i < n_chunk; ++i) {
+        ParseIEEEDoubleLE(&buffer[8*i], d);
+        *begin = static_cast<typename std::iterator_traits<I>::value_type>(d);
+        ++begin;
+      }
     }
-    break;
-  default:
-    throw Exception("Invalid number representation.");
+    n -= n_chunk;
   }
 
   return begin;
@@ -803,26 +839,29 @@ void NRLib::WriteBinaryIbmFloatArray(std::ostream& stream,
 {
   using namespace NRLib::NRLibPrivate;
 
-  typename I::difference_type n_char = 4*std::distance(begin, end);
-  std::vector<char> buffer(n_char);
+  if (number_representation != END_BIG_ENDIAN && number_representation != END_LITTLE_ENDIAN) {
+    throw Exception("Invalid number representation.");
+  }
+
+  size_t n_total = static_cast<size_t>(std::distance(begin, end));
+  std::vector<char> buffer(4*(n_total < BinaryArrayChunk ? n_total : BinaryArrayChunk));
 
-  switch (number_representation) {
-  case END_BIG_ENDIAN:
-    for (int i = 0; begin != end; ++begin, ++i) {
-      WriteIBMFloatBE(&buffer[4*i], *begin);
+  while (begin != end) {
+    size_t n = 0;
+    if (number_representation == END_BIG_ENDIAN) {
+      for (; begin != end && n < BinaryArrayChunk; ++begin, ++n) {
+        WriteIBMFloatBE(&buffer[4*n], *begin);
+      }
     }
-    break;
-  case END_LITTLE_ENDIAN:
-    for (int i = 0; begin != end; ++begin, ++i) {
-      WriteIBMFloatLE(&buffer[4*i], *begin);
+    else {
+      for (; begin != end && n < BinaryArrayChunk; ++begin, ++n) {
+        WriteIBMFloatLE(&buffer[4*n], *begin);
+      }
     }
-    break;
-  default:
-    throw Exception("Invalid number representation.");
-  }
 
-  if (!stream.write(&buffer[0], static_cast<std::streamsize>(n_char))) {
-    throw Exception("Error writing to stream.");
+    if (!stream.write(&buffer[0], static_cast<std::streamsize>(4*n))) {
+      throw Exception("Error writing to stream.");
+    }
   }
 }
 
@@ -835,41 +874,43 @@ I NRLib::ReadBinaryIbmFloatArray(std::istream& stream,
 {
   using namespace NRLib::NRLibPrivate;
 
-  std::vector<char> buffer(4*n);
-  float f;
+  if (number_representation != END_BIG_ENDIAN && number_representation != END_LITTLE_ENDIAN) {
+    throw Exception("Invalid number representation. Cannot interpret bit stream as numbers");
+  }
 
-  std::string error;
-  if (!stream.read(&buffer[0], static_cast<std::streamsize>(4*n))) {
-    if (stream.eof())
-      error = "Error reading binary IBM float array. Trying to read 4*" + NRLib::ToString(n) + " elements when end-of-file was reached.\n";
-    else {
-      error = "Error reading binary IBM float array. Hardware error? Full disk?\n";
+  std::vector<char> buffer(4*(n < BinaryArrayChunk ? n : BinaryArrayChunk));
+  float f;
+  size_t n_total = n;
+
+  while (n > 0) {
+    size_t n_chunk = (n < BinaryArrayChunk ? n : BinaryArrayChunk);
+    if (!stream.read(&buffer[0], static_cast<std::streamsize>(4*n_chunk))) {
+      std::string error;
+      if (stream.eof())
+        error = "Error reading binary IBM float array. Trying to read 4*" + NRLib::ToString(n_total) + " elements when end-of-file was reached.\n";
+      else {
+        error = "Error reading binary IBM float array. Hardware error? Full disk?\n";
+      }
+      throw Exception(error);
     }
-  }
 
-  switch (number_representation) {
-  case END_BIG_ENDIAN:
-    for (size_t i = 0; i < n; ++i) {
-      ParseIBMFloatBE(&buffer[4*i], f);
-      *begin = f;
-      ++begin;
+    if (number_representation == END_BIG_ENDIAN) {
+      for (size_t i = 0; i < n_chunk; ++i) {
+        ParseIBMFloatBE(&buffer[4*i], f);
+        *begin = f;
+        ++begin;
+      }
     }
-    break;
-  case END_LITTLE_ENDIAN:
-    for (size_t i = 0; i < n; ++i) {
-      ParseIBMFloatLE(&buffer[4*i], f);
-      *begin = f;
-      ++begin;
+    else {
+      for (size_t i = 0; i < n_chunk; ++i) {
+        ParseIBMFloatLE(&buffer[4*i], f);
+        *begin = f;
+        ++begin;
+      }
     }
-    break;
-  default:
-    error += "Invalid number representation. Cannot interpret bit stream as numbers";
+    n -= n_chunk;
   }
 
-  if (error != "") {
-    throw Exception(error);
-   }
-
   return begin;
 }
 
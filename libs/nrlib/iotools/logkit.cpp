@@ -36,6 +36,10 @@ std::vector<BufferMessage *> * LogKit::buffer_ = NULL;
 std::vector<int> LogKit::n_messages_(65, 0);
 std::vector<std::string> LogKit::prefix_(65, "");
 
+// Messages held back for the calling thread. See StartThreadBuffering().
+static std::vector<BufferMessage *> * thread_buffer = NULL;
+#pragma omp threadprivate(thread_buffer)
+
 void
 LogKit::SetFileLog(const std::string & fileName, int levels,
                    bool includeNRLibLogging)
@@ -125,21 +129,44 @@ LogKit::SetScreenLog(const std::vector<int> & levels, bool ignore_general) {
 void
 LogKit::LogMessage(int level, const std::string & message) {
   unsigned int i;
-  n_messages_[level]++;
   std::string new_message = prefix_[level] + message;
-  for (i=0;i<logstreams_.size();i++)
-    logstreams_[i]->LogMessage(level, new_message);
-  SendToBuffer(level,-1,new_message);
+  if (thread_buffer != NULL) {
+    BufferMessage * bm = new BufferMessage;
+    bm->level_ = level;
+    bm->phase_ = -1;
+    bm->text_  = new_message;
+    thread_buffer->push_back(bm);
+    return;
+  }
+  // Messages may come from several threads, e.g. when output is written in the background.
+#pragma omp critical(LogKit)
+  {
+    n_messages_[level]++;
+    for (i=0;i<logstreams_.size();i++)
+      logstreams_[i]->LogMessage(level, new_message);
+    SendToBuffer(level,-1,new_message);
+  }
 }
 
 void
 LogKit::LogMessage(int level, int phase, const std::string & message) {
   unsigned int i;
-  n_messages_[level]++;
   std::string new_message = prefix_[level] + message;
-  for (i=0;i<logstreams_.size();i++)
-    logstreams_[i]->LogMessage(level, phase, new_message);
-  SendToBuffer(level,phase,new_message);
+  if (thread_buffer != NULL) {
+    BufferMessage * bm = new BufferMessage;
+    bm->level_ = level;
+    bm->phase_ = phase;
+    bm->text_  = new_message;
+    thread_buffer->push_back(bm);
+    return;
+  }
+#pragma omp critical(LogKit)
+  {
+    n_messages_[level]++;
+    for (i=0;i<logstreams_.size();i++)
+      logstreams_[i]->LogMessage(level, phase, new_message);
+    SendToBuffer(level,phase,new_message);
+  }
 }
 
 void
@@ -190,6 +217,45 @@ LogKit::EndBuffering() {
   }
 }
 
+void
+LogKit::StartThreadBuffering() {
+  thread_buffer = new std::vector<BufferMessage *>;
+}
+
+std::vector<BufferMessage *> *
+LogKit::EndThreadBuffering() {
+  std::vector<BufferMessage *> * buffer = thread_buffer;
+  thread_buffer = NULL;
+  return buffer;
+}
+
+bool
+LogKit::IsThreadBuffering() {
+  return thread_buffer != NULL;
+}
+
+void
+LogKit::LogBuffer(std::vector<BufferMessage *> * buffer) {
+  if (buffer == NULL)
+    return;
+#pragma omp critical(LogKit)
+  {
+    for (unsigned int i=0;i<buffer->size();i++) {
+      BufferMessage * bm = (*buffer)[i];
+      n_messages_[bm->level_]++;
+      for (unsigned int j=0;j<logstreams_.size();j++) {
+        if (bm->phase_ < 0)
+          logstreams_[j]->LogMessage(bm->level_, bm->text_);
+        else
+          logstreams_[j]->LogMessage(bm->level_, bm->phase_, bm->text_);
+      }
+      SendToBuffer(bm->level_, bm->phase_, bm->text_);
+      delete bm;
+    }
+  }
+  delete buffer;
+}
+
 void
 LogKit::SendToBuffer(int level, int phase, const std::string & message) {
   if (buffer_ != NULL) {
@@ -100,6 +100,14 @@ public:
   static void StartBuffering();
   static void EndBuffering();
 
+  ///Thread buffering holds back the messages from the calling thread, so that
+  ///messages from threads working concurrently are not mixed. EndThreadBuffering
+  ///returns the held messages, and LogBuffer logs and deletes them.
+  static void StartThreadBuffering();
+  static std::vector<BufferMessage *> * EndThreadBuffering();
+  static void LogBuffer(std::vector<BufferMessage *> * buffer);
+  static bool IsThreadBuffering();
+
   static void SetPrefix(const std::string & prefix, int level);
   static int GetNMessages(int level) { return n_messages_[level];}
   static void WriteHeader(const std::string & text, MessageLevels logLevel = Low);
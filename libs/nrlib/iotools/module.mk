@@ -1,4 +1,5 @@
-SRC += $(NRLIB_BASE_DIR)iotools/fileio.cpp \
+SRC += $(NRLIB_BASE_DIR)iotools/asciifile.cpp \
+       $(NRLIB_BASE_DIR)iotools/fileio.cpp \
        $(NRLIB_BASE_DIR)iotools/logkit.cpp \
        $(NRLIB_BASE_DIR)iotools/stringtools.cpp \
        $(NRLIB_BASE_DIR)iotools/tabularfile.cpp
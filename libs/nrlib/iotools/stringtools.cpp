@@ -39,6 +39,146 @@ std::string NRLib::ParseType<std::string>(const std::string& s)
 }
 
 
+namespace {
+
+// Splits [begin, end) in sign, significand and decimal exponent. Returns false if the
+// text is not a plain decimal number, or the significand has more than 19 digits.
+bool SplitDecimal(const char         * p,
+                  const char         * end,
+                  bool               & negative,
+                  unsigned long long & significand,
+                  int                & exponent)
+{
+  negative    = false;
+  significand = 0;
+  exponent    = 0;
+
+  if (p != end && (*p == '+' || *p == '-')) {
+    negative = (*p == '-');
+    ++p;
+  }
+
+  bool digits   = false;
+  int  n_digits = 0;
+  for (; p != end && *p >= '0' && *p <= '9'; ++p) {
+    digits = true;
+    if (significand == 0 && *p == '0')
+      continue;
+    if (n_digits == 19)
+      return false;
+    significand = 10*significand + (*p - '0');
+    ++n_digits;
+  }
+  if (p != end && *p == '.') {
+    ++p;
+    for (; p != end && *p >= '0' && *p <= '9'; ++p) {
+      digits = true;
+      --exponent;
+      if (significand == 0 && *p == '0')
+        continue;
+      if (n_digits == 19)
+        return false;
+      significand = 10*significand + (*p - '0');
+      ++n_digits;
+    }
+  }
+  if (!digits)
+    return false;
+
+  if (p != end && (*p == 'e' || *p == 'E')) {
+    ++p;
+    bool negative_exponent = false;
+    if (p != end && (*p == '+' || *p == '-')) {
+      negative_exponent = (*p == '-');
+      ++p;
+    }
+    if (p == end || *p < '0' || *p > '9')
+      return false;
+    int e = 0;
+    for (; p != end && *p >= '0' && *p <= '9'; ++p) {
+      if (e < 100000)
+        e = 10*e + (*p - '0');
+    }
+    exponent += (negative_exponent ? -e : e);
+  }
+
+  return p == end;
+}
+
+} // namespace
+
+
+bool
+NRLib::TryParseNumber(const char* begin, const char* end, int& value)
+{
+  const char* p = begin;
+  bool negative = false;
+  if (p != end && (*p == '+' || *p == '-')) {
+    negative = (*p == '-');
+    ++p;
+  }
+  if (p == end || end - p > 9)
+    return false;
+  int x = 0;
+  for (; p != end; ++p) {
+    if (*p < '0' || *p > '9')
+      return false;
+    x = 10*x + (*p - '0');
+  }
+  value = (negative ? -x : x);
+  return true;
+}
+
+
+// A significand and a power of ten that are both exact in the floating point type give a
+// correctly rounded result with one multiplication or division, as strtod.
+bool
+NRLib::TryParseNumber(const char* begin, const char* end, double& value)
+{
+  static const double powers[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                  1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                  1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+  bool               negative;
+  unsigned long long significand;
+  int                exponent;
+  if (!SplitDecimal(begin, end, negative, significand, exponent))
+    return false;
+  if (significand > (1ULL << 53) || exponent < -22 || exponent > 22)
+    return false;
+
+  double x = static_cast<double>(significand);
+  if (exponent < 0)
+    x /= powers[-exponent];
+  else
+    x *= powers[exponent];
+  value = (negative ? -x : x);
+  return true;
+}
+
+
+bool
+NRLib::TryParseNumber(const char* begin, const char* end, float& value)
+{
+  static const float powers[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f,
+                                 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+  bool               negative;
+  unsigned long long significand;
+  int                exponent;
+  if (!SplitDecimal(begin, end, negative, significand, exponent))
+    return false;
+  if (significand > (1ULL << 24) || exponent < -10 || exponent > 10)
+    return false;
+
+  float x = static_cast<float>(significand);
+  if (exponent < 0)
+    x /= powers[-exponent];
+  else
+    x *= powers[exponent];
+  value = (negative ? -x : x);
+  return true;
+}
+
+
 std::string
 NRLib::GetPath(const std::string& filename)
 {
@@ -23,6 +23,7 @@
 #define NRLIB_STRINGTOOLS_HPP
 
 #include <stdlib.h> // For atoi and atof
+#include <string.h> // For strlen
 
 #include <string>
 #include <iomanip>
@@ -52,6 +53,22 @@ namespace NRLib {
   template <>
   std::string ParseType<std::string>(const std::string& s);
 
+  /// Locale-free parsing of the number in [begin, end). Only plain decimal numbers,
+  /// [+-]digits[.digits][(e|E)[+-]digits], that can be converted exactly with double (float)
+  /// arithmetic are handled, giving the same value as ParseType. Returns false for all other
+  /// text, which must then be parsed with ParseType.
+  bool TryParseNumber(const char* begin, const char* end, int& value);
+  bool TryParseNumber(const char* begin, const char* end, float& value);
+  bool TryParseNumber(const char* begin, const char* end, double& value);
+
+  /// Types without a fast parser.
+  template <typename T>
+  bool TryParseNumber(const char* begin, const char* end, T& value);
+
+  /// As ParseType, but uses TryParseNumber when possible.
+  template <typename T>
+  T ParseTypeFast(const char* begin, const char* end);
+
   /// \todo Replace precision with a format object.
   template <typename T>
   std::string ToString(const T obj, int precision=-99999);
@@ -117,6 +134,9 @@ class UnsafeParser<int>
 {
 public:
   static int ParseType(const char* s) {
+    int value;
+    if (TryParseNumber(s, s + strlen(s), value))
+      return value;
     return atoi(s);
   }
 };
@@ -126,6 +146,9 @@ class UnsafeParser<double>
 {
 public:
   static double ParseType(const char* s) {
+    double value;
+    if (TryParseNumber(s, s + strlen(s), value))
+      return value;
     return atof(s);
   }
 };
@@ -135,7 +158,7 @@ class UnsafeParser<float>
 {
 public:
   static double ParseType(const char* s) {
-    return static_cast<float>(atof(s));
+    return static_cast<float>(UnsafeParser<double>::ParseType(s));
   }
 };
 
@@ -173,6 +196,23 @@ T NRLib::ParseType(const std::string& s)
 }
 
 
+template <typename T>
+bool NRLib::TryParseNumber(const char* , const char* , T& )
+{
+  return false;
+}
+
+
+template <typename T>
+T NRLib::ParseTypeFast(const char* begin, const char* end)
+{
+  T x;
+  if (TryParseNumber(begin, end, x))
+    return x;
+  return ParseType<T>(std::string(begin, end));
+}
+
+
 template <typename T>
 std::string NRLib::ToString(const T obj, int precision)
 {
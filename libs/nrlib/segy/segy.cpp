@@ -58,6 +58,9 @@ SegY::SegY(const std::string       & fileName,
   rmissing_    = segyRMISSING;
   file_name_    = fileName;
   single_trace_ = true;
+  headers_only_ = false;
+  window_start_ = 0;
+  last_pos_     = -1;
 
   /// \todo Replace with safe open function.
  // file_.open(fileName.c_str(), std::ios::in | std::ios::binary);
@@ -102,6 +105,9 @@ SegY::SegY(const std::string               & fileName,
   rmissing_     = segyRMISSING;
   file_name_    = fileName;
   single_trace_ = true;
+  headers_only_ = false;
+  window_start_ = 0;
+  last_pos_     = -1;
 
   /// \todo Replace with safe open function.
  // file_.open(fileName.c_str(), std::ios::in | std::ios::binary);
@@ -299,6 +305,9 @@ SegY::SegY(const std::string       & fileName,
   rmissing_ = segyRMISSING;
   geometry_ = NULL;
   binary_header_ = NULL;
+  headers_only_ = false;
+  window_start_ = 0;
+  last_pos_     = -1;
 
   /// \todo Replace with safe open function.
   //file_.open(fileName.c_str(), std::ios::out | std::ios::binary);
@@ -482,16 +491,24 @@ SegY::GetTraceData(std::streampos pos, std::vector<float> & result, float z_top,
     throw Exception("Failed to read from SEGY-file or unexpected end of file.");
 
   result.resize(nz_);
-  switch(binary_header_->GetFormat()) {
+  ParseSamples(buffer, binary_header_->GetFormat(), j0, j1, &result[j0]);
+  delete [] buffer;
+  fclose(seek_file);
+}
+
+void
+SegY::ParseSamples(const char * buffer, int format, size_t j0, size_t j1, float * values)
+{
+  switch(format) {
     case 1:
       for (size_t i = j0; i <= j1; ++i)
-        ParseIBMFloatBE(&buffer[4*i], result[i]);
+        ParseIBMFloatBE(&buffer[4*i], values[i-j0]);
       break;
     case 2: {
         int tmp;
         for (size_t i = j0; i <= j1; ++i) {
           ParseInt32BE(&buffer[4*i], tmp);
-          result[i] = static_cast<float>(tmp);
+          values[i-j0] = static_cast<float>(tmp);
         }
       }
       break;
@@ -499,19 +516,53 @@ SegY::GetTraceData(std::streampos pos, std::vector<float> & result, float z_top,
         short tmp;
         for (size_t i = j0; i <= j1; ++i) {
           ParseInt16BE(&buffer[2*i], tmp);
-          result[i] = static_cast<float>(tmp);
+          values[i-j0] = static_cast<float>(tmp);
         }
       }
       break;
     case 5:
       for (size_t i = j0; i <= j1; ++i)
-        ParseIEEEFloatBE(&buffer[4*i], result[i]);
+        ParseIEEEFloatBE(&buffer[4*i], values[i-j0]);
       break;
     default:
       assert(0); //We should catch this much earlier.
   }
-  delete [] buffer;
-  fclose(seek_file);
+}
+
+void
+SegY::ReadTraceData(const SegYTrace & trace, std::vector<float> & trace_data) const
+{
+  long long trace_size = static_cast<long long>(nz_*datasize_);
+  long long pos        = static_cast<long long>(static_cast<std::streamoff>(trace.GetFilePos()));
+
+  if (pos < window_start_ || pos + trace_size > window_start_ + static_cast<long long>(window_.size())) {
+    // When the traces are asked for in about the order they are stored, a window of
+    // consecutive traces is read at a time. When the distance from the previous trace is
+    // larger than the window, as when the file is sorted the other way from the grid, only
+    // the trace itself is read, so that no trace data are read that will not be used.
+    if (data_file_.is_open() == false) {
+      OpenRead(data_file_, file_name_, std::ios::in | std::ios::binary);
+      if (!data_file_)
+        throw IOError("Error opening " + file_name_);
+    }
+    long long window_size = std::max(trace_size, 64*(trace_size + 240));
+    long long stride      = (last_pos_ < 0 ? 0 : pos - last_pos_);
+    if (stride < 0 || stride >= window_size)
+      window_size = trace_size;
+    window_.resize(static_cast<size_t>(window_size));
+    data_file_.clear();
+    data_file_.seekg(static_cast<std::streamoff>(pos), std::ios_base::beg);
+    data_file_.read(&window_[0], static_cast<std::streamsize>(window_size));
+    window_.resize(static_cast<size_t>(data_file_.gcount()));
+    window_start_ = pos;
+    if (static_cast<long long>(window_.size()) < trace_size)
+      throw Exception("Failed to read from SEGY-file or unexpected end of file.");
+  }
+  last_pos_ = pos;
+
+  trace_data.resize(trace.GetEnd() - trace.GetStart() + 1);
+  ParseSamples(&window_[static_cast<size_t>(pos - window_start_)], binary_header_->GetFormat(),
+               trace.GetStart(), trace.GetEnd(), &trace_data[0]);
 }
 
 void
@@ -519,8 +570,28 @@ SegY::ReadAllTraces(const Volume * volume,
                     double         zPad,
                     bool           onlyVolume,
                     bool           relative_padding)
+{
+  ReadTraces(volume, zPad, onlyVolume, relative_padding, false);
+}
+
+void
+SegY::ReadAllTraceHeaders(const Volume * volume,
+                          double         zPad,
+                          bool           onlyVolume,
+                          bool           relative_padding)
+{
+  ReadTraces(volume, zPad, onlyVolume, relative_padding, true);
+}
+
+void
+SegY::ReadTraces(const Volume * volume,
+                 double         zPad,
+                 bool           onlyVolume,
+                 bool           relative_padding,
+                 bool           headersOnly)
 {
   single_trace_ = false;
+  headers_only_ = headersOnly;
   traces_.resize(n_traces_);
 
   LogKit::LogMessage(LogKit::Low,"\nReading SEGY file " );
@@ -539,7 +610,8 @@ SegY::ReadAllTraces(const Volume * volume,
                          outsideSurface,
                          true,
                          outsideTopBot,
-                         relative_padding);
+                         relative_padding,
+                         headersOnly);
   int k;
   for (k=0;k<6;k++) {
     outsideTopMax[k] = outsideTopBot[k];
@@ -570,7 +642,8 @@ SegY::ReadAllTraces(const Volume * volume,
                              outsideSurface,
                              false,
                              outsideTopBot,
-                             relative_padding);
+                             relative_padding,
+                             headersOnly);
     }
     catch (EndOfFile& ) {
       break;
@@ -643,7 +716,8 @@ SegY::ReadTrace(const Volume * volume,
                 bool         & outsideSurface,
                 bool           writevalues,
                 double       * outsideTopBot,
-                bool           relative_padding)
+                bool           relative_padding,
+                bool           headersOnly)
 {
   TraceHeader traceHeader(trace_header_format_);
 
@@ -769,10 +843,19 @@ SegY::ReadTrace(const Volume * volume,
   SegYTrace * trace = NULL;
   if (file_.eof() == false)
   {
-    // Copy elements from j0 til j1.
-    trace = new SegYTrace(file_, j0, j1,
-                          binary_header_->GetFormat(), nz_,
-                          &traceHeader);
+    if (headersOnly) {
+      // Keep where the data are, and skip them.
+      trace = new SegYTrace(traceHeader, false);
+      trace->SetDataRange(j0, j1);
+      trace->SetFilePos(file_.tellg());
+      file_.seekg(static_cast<std::streamoff>(nz_*datasize_), std::ios_base::cur);
+    }
+    else {
+      // Copy elements from j0 til j1.
+      trace = new SegYTrace(file_, j0, j1,
+                            binary_header_->GetFormat(), nz_,
+                            &traceHeader);
+    }
   }
   return trace;
 }
@@ -828,6 +911,8 @@ void SegY::CreateRegularGrid()
 std::vector<float>
 SegY::GetAllValues(void)
 {
+  if(headers_only_)
+    throw Exception("Can not get values when only the trace headers are read.\n");
   size_t i,nTot = 0;
   //int nTraces = nx_*ny_;
   for (i = 0; i < n_traces_; i++)
@@ -875,7 +960,10 @@ SegY::GetNearestTrace(std::vector<float> & trace_data,
   size_t i = geometry_->FindIndex(x, y);
 
   if (traces_[i] != NULL) {
-    trace_data = traces_[i]->GetTrace();
+    if (headers_only_)
+      ReadTraceData(*traces_[i], trace_data);
+    else
+      trace_data = traces_[i]->GetTrace();
     // NBNB: The 0.5f below is a shift we have introduced when reading
     // in seismic data to get data values in centre of grid cells rather
     // than on their borders. This choice and its implications need to
@@ -894,6 +982,8 @@ SegY::GetValue(double x, double y, double z, int outsideMode) const
 {
   if(geometry_ == NULL)
     throw Exception("Geometry is not defined.\n");
+  if(headers_only_)
+    throw Exception("Can not get values when only the trace headers are read.\n");
 
   int i, j;
   float xind,yind;
@@ -99,6 +99,16 @@ public:
   std::vector<float>        GetAllValues();                           ///< Return vector with all values.
 
   void                      CreateRegularGrid();
+
+  /// As ReadAllTraces, but only the trace headers, the file positions and the part of each
+  /// trace to use are kept. The data are read from file when asked for by GetNearestTrace, a
+  /// small window of traces at a time when they are asked for in file order, and one trace at
+  /// a time otherwise. The whole cube is never held in memory.
+  /// GetValue and GetAllValues can not be used in this mode.
+  void                      ReadAllTraceHeaders(const NRLib::Volume * volume,
+                                                double                zPad,
+                                                bool                  onlyVolume       = false,
+                                                bool                  relative_padding = true);
   const SegyGeometry      * GetGeometry(void) const { return geometry_ ;} //Only makes sense after command above, or FindAndSetGeometry below.
   //<<<End read all trace mode
 
@@ -188,11 +198,20 @@ private:
                                       bool                & outsideSurface,
                                       bool                  writevalues      = true,
                                       double              * outsideTopBot    = NULL,
-                                      bool                  relative_padding = true);  ///< Read single trace from file
+                                      bool                  relative_padding = true,
+                                      bool                  headersOnly      = false); ///< Read single trace from file
   //Note: If outsideTopBot == NULL, lack of data on top or bot will throw exception.
   //      Otherwise, outsideTopBot[0] will be top lack, [1] for bottom,
   //      [2] is x-coord, [3] is y-coord. Allocate outside.
 
+  void                      ReadTraces(const NRLib::Volume * volume,
+                                       double                zPad,
+                                       bool                  onlyVolume,
+                                       bool                  relative_padding,
+                                       bool                  headersOnly);
+  void                      ReadTraceData(const SegYTrace & trace, std::vector<float> & trace_data) const;
+  static void               ParseSamples(const char * buffer, int format, size_t j0, size_t j1, float * values);
+
   void                      WriteMainHeader(const TextualHeader& ebcdicHeader); ///< Quasi-dummy at the moment.
   void                      ReadDummyTrace(std::fstream & file, int format, size_t nz);
   /// Used to find correct trace header format.
@@ -228,6 +247,12 @@ private:
 
   float                     rmissing_;
 
+  bool                      headers_only_;         ///< Traces hold only headers, see ReadAllTraceHeaders
+  mutable std::ifstream     data_file_;            ///< File the trace data are read from in headers only mode
+  mutable std::vector<char> window_;               ///< Consecutive traces read from data_file_
+  mutable long long         window_start_;         ///< File position of window_
+  mutable long long         last_pos_;             ///< File position of the previous trace read, -1 if none
+
 };
 
 
@@ -84,6 +84,7 @@ public:
   std::streampos             GetFilePos()                const { return(file_position_);} ///< Get file position
 
   void SetFilePos(std::streampos pos) {file_position_ = pos;} /// Set file position
+  void SetDataRange(size_t jStart, size_t jEnd) { j_start_ = jStart; j_end_ = jEnd; } /// Set start and end index for a trace without data
 
 
   void RemoveXY() { /// Void invalid x and y coordinates
@@ -30,30 +30,30 @@
 #include "rmswell.hpp"
 #include "../iotools/stringtools.hpp"
 #include "../iotools/fileio.hpp"
+#include "../iotools/asciifile.hpp"
 
 using namespace NRLib;
 
 
 RMSWell::RMSWell(const std::string& filename)
 {
-  std::ifstream file;
-  OpenRead(file, filename);
+  AsciiFile file(filename);
 
   size_t nlog;
   std::string dummy;
-  getline(file,line1_);
-  getline(file,line2_);
+  file.GetRestOfLine(line1_);
+  file.GetRestOfLine(line2_);
   int line = 0;
   std::string token;
-  std::string wellName = ReadNext<std::string>(file, line);
+  std::string wellName = file.ReadNext<std::string>();
   SetWellName(wellName);
-  xpos0_ = ReadNext<double>(file, line);
-  ypos0_ = ReadNext<double>(file, line);      // read wellname and positions
+  xpos0_ = file.ReadNext<double>();
+  ypos0_ = file.ReadNext<double>();      // read wellname and positions
  // getline(file,dummy);// Line may contain a dummy number
   //-----line shift
-  DiscardRestOfLine(file, line, false);
-  nlog = ReadNext<int>(file, line);          // read number of logs
-  DiscardRestOfLine(file, line, false);
+  file.DiscardRestOfLine();
+  nlog = file.ReadNext<int>();          // read number of logs
+  file.DiscardRestOfLine();
   lognames_.resize(nlog+3);
   lognames_[0] = "x";
   lognames_[1] = "y";
@@ -70,7 +70,7 @@ RMSWell::RMSWell(const std::string& filename)
   isDiscrete_[1] = false;
   isDiscrete_[2] = false;
   for (size_t i = 0; i < nlog; i++) {
-    getline(file,dummy);
+    file.GetRestOfLine(dummy);
     std::istringstream ist(dummy);
     lognames_[i+3] = ReadNext<std::string>(ist, line);
     token = ReadNext<std::string>(ist, line);
@@ -98,23 +98,26 @@ RMSWell::RMSWell(const std::string& filename)
   std::vector<std::vector<int> > disclogs(ndisc);
   std::vector<std::vector<double> > contlogs(ncont);
 
-  while(getline(file,dummy)) {
-    std::istringstream ist(dummy);
-    contlogs[0].push_back(ReadNext<double>(ist, line)); //x
-    contlogs[1].push_back(ReadNext<double>(ist, line)); //y
-    contlogs[2].push_back(ReadNext<double>(ist, line)); //z
+  // The data are parsed directly from the file buffer. Each line must hold all logs.
+  while(!file.CheckEndOfFile()) {
+    if (file.CountTokensOnLine() < static_cast<int>(nlog + 3))
+      throw EndOfFile();
+    contlogs[0].push_back(file.ReadNext<double>()); //x
+    contlogs[1].push_back(file.ReadNext<double>()); //y
+    contlogs[2].push_back(file.ReadNext<double>()); //z
     j = 0;
     k = 3;
     for (size_t i = 0; i < nlog; i++) {
       if (isDiscrete_[i+3]) {
-        disclogs[j].push_back(ReadNext<int>(ist, line));
+        disclogs[j].push_back(file.ReadNext<int>());
         j++;
       }
       else {
-        contlogs[k].push_back(ReadNext<double>(ist, line));
+        contlogs[k].push_back(file.ReadNext<double>());
         k++;
       }
     }
+    file.DiscardRestOfLine();
   }
 
   AddContLog(lognames_[0], contlogs[0]);
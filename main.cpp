@@ -23,6 +23,7 @@
 
 #include "lib/timekit.hpp"
 #include "lib/utils.h"
+#include "lib/fft1d.h"
 
 #include "nrlib/segy/segy.hpp"
 #include "nrlib/iotools/logkit.hpp"
@@ -35,6 +36,7 @@
 #include "src/wavelet.h"
 #include "src/crava.h"
 #include "src/fftgrid.h"
+#include "src/fftfilegrid.h"
 #include "src/gridmapping.h"
 #include "src/simbox.h"
 #include "src/welldata.h"
@@ -52,6 +54,11 @@
 
 #include "src/seismicparametersholder.h"
 #include "src/doinversion.h"
+#include "src/timelapsecheckpoint.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #if defined(COMPILE_STORM_MODULES_FOR_RMS)
 
@@ -235,116 +242,154 @@ int main(int argc, char** argv)
         return(1);
     }
     else {
-      int        eventType;
-      int        vintage;
-      double     oldTime;
-      bool       failedFirst = false;
-      TimeLine * time_line   = modelGeneral->getTimeLine();
-
-      time_line->ReSet();
-      time_line->GetNextEvent(eventType, vintage, oldTime);
-
-      // First inversion
-      switch (eventType) {
-
-      case TimeLine::AVO :
-        if (modelSettings->getDo4DInversion()){ // In case of 4D inversion
-          failedFirst = doTimeLapseAVOInversion(modelSettings,
-                                                modelGeneral,
-                                                modelAVOstatic,
-                                                inputFiles,
-                                                seismicParameters,
-                                                vintage);
-        }
-        else  // In case of 3D inversion
-          failedFirst = doFirstAVOInversion(modelSettings,
-                                            modelGeneral,
-                                            modelAVOstatic,
-                                            seismicParameters,
-                                            inputFiles,
-                                            vintage,
-                                            timeBGSimbox);
-        break;
-
-      case TimeLine::TRAVEL_TIME :
-        failedFirst = doTimeLapseTravelTimeInversion(modelSettings,
-                                                     modelGeneral,
-                                                     modelTravelTimeStatic,
-                                                     inputFiles,
-                                                     vintage,
-                                                     seismicParameters);
-        break;
-
-      case TimeLine::GRAVITY :
-        failedFirst = doTimeLapseGravimetricInversion(modelSettings,
-                                                      modelGeneral,
-                                                      modelGravityStatic,
-                                                      inputFiles,
-                                                      vintage,
-                                                      seismicParameters);
-
-        errTxt += "Warning Gravimetric under construction\n";
-        break;
-
-      default :
-        errTxt += "Error: Unknown inverstion type.\n";
-        break;
+      int                   eventType;
+      int                   vintage;
+      double                oldTime;
+      bool                  failedFirst = false;
+      int                   nEventsDone = 0;
+      TimeLine            * time_line   = modelGeneral->getTimeLine();
+      TimeLapseCheckpoint * checkpoint  = NULL;
+
+      if (modelSettings->getTimeLapseResumeVintage() > 0) {
+        // Restore the state from the checkpoint, and continue with the remaining events
+        failedFirst = resumeTimeLapseInversion(modelSettings,
+                                               modelGeneral,
+                                               seismicParameters,
+                                               nEventsDone);
       }
+      else {
+        time_line->ReSet();
+        time_line->GetNextEvent(eventType, vintage, oldTime);
 
-      if(failedFirst == true || errTxt != "")
-        return(1);
-
-      delete timeBGSimbox;
-
-      double time;
-
-      // Time lapse inversions
-      while (time_line->GetNextEvent(eventType, vintage, time) == true) {
-
-        modelGeneral->advanceTime(vintage - 1,
-                                  time,
-                                  seismicParameters,
-                                  modelSettings);
-
-        bool failed;
-
-        switch(eventType) {
+        // First inversion
+        switch (eventType) {
 
         case TimeLine::AVO :
-          failed = doTimeLapseAVOInversion(modelSettings,
-                                           modelGeneral,
-                                           modelAVOstatic,
-                                           inputFiles,
-                                           seismicParameters,
-                                           vintage);
+          if (modelSettings->getDo4DInversion()){ // In case of 4D inversion
+            failedFirst = doTimeLapseAVOInversion(modelSettings,
+                                                  modelGeneral,
+                                                  modelAVOstatic,
+                                                  inputFiles,
+                                                  seismicParameters,
+                                                  vintage);
+          }
+          else  // In case of 3D inversion
+            failedFirst = doFirstAVOInversion(modelSettings,
+                                              modelGeneral,
+                                              modelAVOstatic,
+                                              seismicParameters,
+                                              inputFiles,
+                                              vintage,
+                                              timeBGSimbox);
           break;
 
         case TimeLine::TRAVEL_TIME :
-          failed = doTimeLapseTravelTimeInversion(modelSettings,
-                                                  modelGeneral,
-                                                  modelTravelTimeStatic,
-                                                  inputFiles,
-                                                  vintage,
-                                                  seismicParameters);
+          failedFirst = doTimeLapseTravelTimeInversion(modelSettings,
+                                                       modelGeneral,
+                                                       modelTravelTimeStatic,
+                                                       inputFiles,
+                                                       vintage,
+                                                       seismicParameters);
           break;
 
         case TimeLine::GRAVITY :
-          failed = doTimeLapseGravimetricInversion(modelSettings,
-                                                   modelGeneral,
-                                                   modelGravityStatic,
-                                                   inputFiles,
-                                                   vintage,
-                                                   seismicParameters);
+          failedFirst = doTimeLapseGravimetricInversion(modelSettings,
+                                                        modelGeneral,
+                                                        modelGravityStatic,
+                                                        inputFiles,
+                                                        vintage,
+                                                        seismicParameters);
+
+          errTxt += "Warning Gravimetric under construction\n";
           break;
 
         default :
-          failed = true;
+          errTxt += "Error: Unknown inverstion type.\n";
           break;
         }
 
+        nEventsDone = 1;
+
+        if (failedFirst == false && modelSettings->getWriteTimeLapseCheckpoints())
+          checkpoint = new TimeLapseCheckpoint(modelGeneral, seismicParameters, nEventsDone, vintage);
+      }
+
+      if(failedFirst == true || errTxt != "")
+        return(1);
+
+      delete timeBGSimbox;
+
+#ifdef _OPENMP
+      // The inversion should use all threads while the checkpoints are written.
+      if (modelSettings->getWriteTimeLapseCheckpoints()) {
+#if _OPENMP >= 200805
+        omp_set_max_active_levels(2);
+#else
+        omp_set_nested(1);
+#endif
+      }
+#endif
+
+      double time;
+
+      // Time lapse inversions
+      while (time_line->GetNextEvent(eventType, vintage, time) == true) {
+
+        bool failed = false;
+
+        if (checkpoint != NULL) {
+          // Write the checkpoint of the previous event while this event is processed.
+          std::string checkpointErrTxt;
+          LogKit::LogFormatted(LogKit::Low,"\nWriting time lapse checkpoint to file "+TimeLapseCheckpoint::makeFileName(checkpoint->getVintage())+"\n");
+
+#pragma omp parallel sections num_threads(2)
+          {
+#pragma omp section
+            checkpoint->writeFile(checkpointErrTxt);
+
+#pragma omp section
+            failed = doTimeLapseEvent(modelSettings,
+                                      modelGeneral,
+                                      modelAVOstatic,
+                                      modelTravelTimeStatic,
+                                      modelGravityStatic,
+                                      inputFiles,
+                                      seismicParameters,
+                                      eventType,
+                                      vintage,
+                                      time);
+          }
+
+          if (checkpointErrTxt != "")
+            LogKit::LogMessage(LogKit::Warning, "\nWARNING: Could not write time lapse checkpoint.\n         "+checkpointErrTxt);
+
+          delete checkpoint;
+          checkpoint = NULL;
+        }
+        else {
+          failed = doTimeLapseEvent(modelSettings,
+                                    modelGeneral,
+                                    modelAVOstatic,
+                                    modelTravelTimeStatic,
+                                    modelGravityStatic,
+                                    inputFiles,
+                                    seismicParameters,
+                                    eventType,
+                                    vintage,
+                                    time);
+        }
+
         if (failed)
           return(1);
+
+        nEventsDone++;
+
+        if (modelSettings->getWriteTimeLapseCheckpoints())
+          checkpoint = new TimeLapseCheckpoint(modelGeneral, seismicParameters, nEventsDone, vintage);
       }
+
+      // The last vintage cannot be resumed from, so its checkpoint is not written.
+      delete checkpoint;
     }
 
     if (modelSettings->getDo4DInversion()) {
@@ -367,6 +412,11 @@ int main(int argc, char** argv)
       //TaskList::addTask("The memory usage estimate failed. Please send your XML-model file and the logFile.txt\n    to the CRAVA developers.");
     }
 
+    LogKit::LogFormatted(LogKit::High,"\nLargest memory held by grids: %.2f MB (%d grids)\n",
+                         FFTGrid::getMaxFFTMemUse()/(1024.f*1024.f), FFTGrid::getMaxAllocatedGrids());
+
+    FFTFileGrid::reportPrecisionStudy();
+
     Timings::setTimeTotal(wall,cpu);
     Timings::reportAll(LogKit::Medium);
 
@@ -379,6 +429,8 @@ int main(int argc, char** argv)
     delete modelTravelTimeStatic;
     delete modelGravityStatic;
 
+    FFT1D::clearPlans();
+
     Timings::reportTotal();
     LogKit::LogFormatted(LogKit::Low,"\n*** CRAVA closing  ***\n");
     LogKit::LogFormatted(LogKit::Low,"\n*** CRAVA finished ***\n");
@@ -348,6 +348,105 @@ std::vector<double> DistributionsRock::GetLogExpectation(const std::vector<doubl
   return mean;
 }
 
+//--------------------------------------------------------------------------------
+void DistributionsRock::AddWeightedLogExpectation(float          weight,
+                                                  const double * s0,
+                                                  const double * s1,
+                                                  size_t         n,
+                                                  float        * vp,
+                                                  float        * vs,
+                                                  float        * rho,
+                                                  int          & n_truncated) const
+//--------------------------------------------------------------------------------
+{
+  // Batched version of GetLogExpectation() for use in loops over grid cells. The
+  // interpolation is identical, but nothing is allocated or logged per position.
+
+  size_t m  = tabulated_s0_.size();
+  size_t l  = tabulated_s1_.size();
+
+  if (m == 1 && l == 1) {
+    const std::vector<double> & e = expectation_(0,0);
+    const float e0 = static_cast<float>(e[0]*weight);
+    const float e1 = static_cast<float>(e[1]*weight);
+    const float e2 = static_cast<float>(e[2]*weight);
+    for (size_t c = 0 ; c < n ; c++) {
+      vp[c]  += e0;
+      vs[c]  += e1;
+      rho[c] += e2;
+    }
+    return;
+  }
+
+  for (size_t c = 0 ; c < n ; c++) {
+    double t0 = s0[c];
+    double t1 = s1[c];
+
+    if (TruncateS(t0, tabulated_s0_))
+      n_truncated++;
+    if (TruncateS(t1, tabulated_s1_))
+      n_truncated++;
+
+    double di  = FindInterpolationStartIndex(tabulated_s0_, t0);
+    double dj  = FindInterpolationStartIndex(tabulated_s1_, t1);
+    size_t i0  = static_cast<size_t>(floor(di));
+    size_t j0  = static_cast<size_t>(floor(dj));
+
+    double w00;
+    double w10;
+    double w01;
+    double w11;
+
+    FindInterpolationWeights(w00, w10, w01, w11, di, dj);
+
+    bool do10 = m > 1 && i0 < m - 1;
+    bool do01 = l > 1 && j0 < l - 1;
+    bool do11 = do10 && do01;
+
+    const double * e00 = &expectation_(i0, j0)[0];
+    const double * e10 = do10 ? &expectation_(i0 + 1, j0    )[0] : NULL;
+    const double * e01 = do01 ? &expectation_(i0    , j0 + 1)[0] : NULL;
+    const double * e11 = do11 ? &expectation_(i0 + 1, j0 + 1)[0] : NULL;
+
+    double mean[3];
+    for (int p = 0 ; p < 3 ; p++) {
+      double v10 = do10 ? e10[p] : 0.0;
+      double v01 = do01 ? e01[p] : 0.0;
+      double v11 = do11 ? e11[p] : 0.0;
+      mean[p] = w00*e00[p] + w10*v10 + w01*v01 + w11*v11;
+    }
+
+    vp[c]  += static_cast<float>(mean[0]*weight);
+    vs[c]  += static_cast<float>(mean[1]*weight);
+    rho[c] += static_cast<float>(mean[2]*weight);
+  }
+}
+
+//-----------------------------------------------------------------------------------
+bool DistributionsRock::TruncateS(double                    & s,
+                                  const std::vector<double> & tabulated_s) const
+//-----------------------------------------------------------------------------------
+{
+  // Silent version of CheckOrResetS(). Returns true if s had to be truncated.
+
+  size_t n = tabulated_s.size();
+
+  if (n > 1) {
+    if (s < tabulated_s[0]) {
+      s = tabulated_s[0];
+      return true;
+    }
+    if (s > tabulated_s[n-1]) {
+      s = tabulated_s[n-1];
+      return true;
+    }
+  }
+  else {
+    s = 0.0;
+  }
+  return false;
+}
+
 //-----------------------------------------------------------------------------------
 void DistributionsRock::CheckOrResetS(double                    & s,
                                       const std::vector<double> & tabulated_s) const
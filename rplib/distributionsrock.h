@@ -40,6 +40,17 @@ public:
 
   NRLib::Grid2D<double>                 GetLogCovariance(const std::vector<double> & trend_params)        const;
 
+  // Adds weight*GetLogExpectation() for n trend positions (s0[c],s1[c]) to (vp[c],vs[c],rho[c]).
+  // Trend values outside the tabulated range are truncated, and counted in n_truncated.
+  void                                  AddWeightedLogExpectation(float          weight,
+                                                                  const double * s0,
+                                                                  const double * s1,
+                                                                  size_t         n,
+                                                                  float        * vp,
+                                                                  float        * vs,
+                                                                  float        * rho,
+                                                                  int          & n_truncated)   const;
+
   const std::vector<double>           & GetMeanLogExpectation()                                           const { return mean_log_expectation_ ;}
 
   const NRLib::Grid2D<double>         & GetMeanLogCovariance()                                            const { return mean_log_covariance_  ;}
@@ -88,6 +99,9 @@ protected:
   void                                  CheckOrResetS(double                    & s,
                                                       const std::vector<double> & tabulated_s) const;
 
+  bool                                  TruncateS(double                    & s,
+                                                  const std::vector<double> & tabulated_s) const;
+
   double                                FindInterpolationStartIndex(const std::vector<double> & tabulated_s,
                                                                     const double                s) const;
 
@@ -4,6 +4,7 @@
 
 #include <math.h>
 #include <time.h>
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 
@@ -19,6 +20,8 @@
 #include "src/simbox.h"
 #include "src/io.h"
 
+#include "lib/fft1d.h"
+
 Analyzelog::Analyzelog(std::vector<WellData *> wells,
                        Background            * background,
                        const Simbox          * simbox,
@@ -111,6 +114,7 @@ Analyzelog::estimate(const ModelSettings * modelSettings,
                        lnDataAlpha, lnDataBeta, lnDataRho,
                        allVsLogsAreSynthetic, dt,
                        numberOfLags_, maxnd,
+                       modelSettings->getDebugFlag() > 0,
                        errTxt);
 
   if(estimateParamCov)
@@ -309,59 +313,46 @@ Analyzelog::estimatePointVar0(float      ** Var0,
   sum5 = 0.0;
   sum6 = 0.0;
 
+  // One pass over each well. Each sum is taken in the same order as by separate passes.
   for(i=0;i<nwells_;i++)
   {
     nd = wells_[i]->getNd();
+    const float * alpha = lnDataAlpha[i];
+    const float * beta  = lnDataBeta[i];
+    const float * rho   = lnDataRho[i];
     for(j=0;j<nd;j++)
     {
-      if(lnDataAlpha[i][j]!=RMISSING)
+      bool hasAlpha = (alpha[j]!=RMISSING);
+      bool hasBeta  = (beta[j] !=RMISSING);
+      bool hasRho   = (rho[j]  !=RMISSING);
+      if(hasAlpha)
       {
-        sum1 += lnDataAlpha[i][j]*lnDataAlpha[i][j];
+        sum1 += alpha[j]*alpha[j];
         tell1++;
       }
-    }
-
-    for(j=0;j<nd;j++)
-    {
-      if(lnDataBeta[i][j]!=RMISSING)
+      if(hasBeta)
       {
-        sum2 += lnDataBeta[i][j]*lnDataBeta[i][j];
+        sum2 += beta[j]*beta[j];
         tell2++;
       }
-    }
-
-    for(j=0;j<nd;j++)
-    {
-      if(lnDataRho[i][j]!=RMISSING)
+      if(hasRho)
       {
-        sum3 += lnDataRho[i][j]*lnDataRho[i][j];
+        sum3 += rho[j]*rho[j];
         tell3++;
       }
-    }
-
-    for(j=0;j<nd;j++)
-    {
-      if(lnDataAlpha[i][j]!=RMISSING && lnDataBeta[i][j]!=RMISSING)
+      if(hasAlpha && hasBeta)
       {
-        sum4 += lnDataAlpha[i][j]*lnDataBeta[i][j];
+        sum4 += alpha[j]*beta[j];
         tell4++;
       }
-    }
-
-    for(j=0;j<nd;j++)
-    {
-      if(lnDataAlpha[i][j]!=RMISSING && lnDataRho[i][j]!=RMISSING)
+      if(hasAlpha && hasRho)
       {
-        sum5 += lnDataAlpha[i][j]*lnDataRho[i][j];
+        sum5 += alpha[j]*rho[j];
         tell5++;
       }
-    }
-
-    for(j=0;j<nd;j++)
-    {
-      if(lnDataRho[i][j]!=RMISSING && lnDataBeta[i][j]!=RMISSING)
+      if(hasRho && hasBeta)
       {
-        sum6 = lnDataBeta[i][j]*lnDataRho[i][j];
+        sum6 = beta[j]*rho[j];
         tell6++;
       }
     }
@@ -409,6 +400,7 @@ Analyzelog::estimateCorrTAndVar0(float       * CorrT,
                                  float         dt,
                                  int           n,
                                  int           maxnd,
+                                 bool          debug,
                                  std::string & errTxt)
 {
   time_t timestart, timeend;
@@ -491,6 +483,11 @@ Analyzelog::estimateCorrTAndVar0(float       * CorrT,
     float * dLnAlpha = lnDataAlpha[i];
     float * dLnBeta  = lnDataBeta[i];
     float * dLnRho   = lnDataRho[i];
+    //
+    // Wells with all entries on the lag lattice get the lag sums from FFTs
+    //
+    std::vector<int> pos;
+    bool onLattice = findLagPositions(z, nd, pos);
     int na=0;
     int nb=0;
     int nr=0;
@@ -517,45 +514,60 @@ Analyzelog::estimateCorrTAndVar0(float       * CorrT,
     // ------------------------------------------------
     //
     int h;
-    for(j=0;j<na;j++)
+    if(onLattice)
     {
-      for(k=j;k<na;k++) // indA points to nonmissing entries of dLnAlpha[]
-      {
-        h = static_cast<int>(floor(z[indA[k]]-z[indA[j]]+0.5));
-        if(h >= 0) { //Guard against small upwards movements in transformed domain.
-          covAA[h] += dLnAlpha[indA[j]]*dLnAlpha[indA[k]];
-          varAj[h] += dLnAlpha[indA[j]]*dLnAlpha[indA[j]];
-          varAk[h] += dLnAlpha[indA[k]]*dLnAlpha[indA[k]];
-          nAA[h]++;
-        }
-      }
+      float * dLn[3]    = {dLnAlpha, dLnBeta, dLnRho};
+      bool    useLog[3] = {true, allVsLogsAreSynthetic || !wells_[i]->hasSyntheticVsLog(), true};
+      float * cov[3]    = {covAA, covBB, covRR};
+      float * varj[3]   = {varAj, varBj, varRj};
+      float * vark[3]   = {varAk, varBk, varRk};
+      int   * count[3]  = {nAA, nBB, nRR};
+      addLagSums(pos, dLn, useLog, n, cov, varj, vark, count);
+      if(debug)
+        checkLagSums(pos, dLn, useLog, n, wells_[i]->getWellname());
     }
-    if (allVsLogsAreSynthetic || !wells_[i]->hasSyntheticVsLog())
+    else
     {
-      for(j=0;j<nb;j++)
+      for(j=0;j<na;j++)
       {
-        for(k=j;k<nb;k++) // indB points to nonmissing entries of dLnBeta[]
+        for(k=j;k<na;k++) // indA points to nonmissing entries of dLnAlpha[]
         {
-          h = static_cast<int>(floor(z[indB[k]]-z[indB[j]]+0.5));
+          h = static_cast<int>(floor(z[indA[k]]-z[indA[j]]+0.5));
           if(h >= 0) { //Guard against small upwards movements in transformed domain.
-            covBB[h] += dLnBeta[indB[j]]*dLnBeta[indB[k]];
-            varBj[h] += dLnBeta[indB[j]]*dLnBeta[indB[j]];
-            varBk[h] += dLnBeta[indB[k]]*dLnBeta[indB[k]];
-            nBB[h]++;
+            covAA[h] += dLnAlpha[indA[j]]*dLnAlpha[indA[k]];
+            varAj[h] += dLnAlpha[indA[j]]*dLnAlpha[indA[j]];
+            varAk[h] += dLnAlpha[indA[k]]*dLnAlpha[indA[k]];
+            nAA[h]++;
           }
         }
       }
-    }
-    for(j=0;j<nr;j++)
-    {
-      for(k=j;k<nr;k++) // indR points to nonmissing entries of dLnRho[]
-      {
-        h = static_cast<int>(floor(z[indR[k]]-z[indR[j]]+0.5));
-        if(h >= 0) { //Guard against small upwards movements in transformed domain.
-          covRR[h] += dLnRho[indR[j]]*dLnRho[indR[k]];
-          varRj[h] += dLnRho[indR[j]]*dLnRho[indR[j]];
-          varRk[h] += dLnRho[indR[k]]*dLnRho[indR[k]];
-          nRR[h]++;
+      if (allVsLogsAreSynthetic || !wells_[i]->hasSyntheticVsLog())
+      {
+        for(j=0;j<nb;j++)
+        {
+          for(k=j;k<nb;k++) // indB points to nonmissing entries of dLnBeta[]
+          {
+            h = static_cast<int>(floor(z[indB[k]]-z[indB[j]]+0.5));
+            if(h >= 0) { //Guard against small upwards movements in transformed domain.
+              covBB[h] += dLnBeta[indB[j]]*dLnBeta[indB[k]];
+              varBj[h] += dLnBeta[indB[j]]*dLnBeta[indB[j]];
+              varBk[h] += dLnBeta[indB[k]]*dLnBeta[indB[k]];
+              nBB[h]++;
+            }
+          }
+        }
+      }
+      for(j=0;j<nr;j++)
+      {
+        for(k=j;k<nr;k++) // indR points to nonmissing entries of dLnRho[]
+        {
+          h = static_cast<int>(floor(z[indR[k]]-z[indR[j]]+0.5));
+          if(h >= 0) { //Guard against small upwards movements in transformed domain.
+            covRR[h] += dLnRho[indR[j]]*dLnRho[indR[k]];
+            varRj[h] += dLnRho[indR[j]]*dLnRho[indR[j]];
+            varRk[h] += dLnRho[indR[k]]*dLnRho[indR[k]];
+            nRR[h]++;
+          }
         }
       }
     }
@@ -565,11 +577,13 @@ Analyzelog::estimateCorrTAndVar0(float       * CorrT,
     //
     //  We cannot use the reduced loop structure involving indA, indB, and indC
     //  when we mix A, B, or R. This is not performance problem, however, since
-    //  most of the calculation time will go into calculating Cov_t
+    //  most of the calculation time will go into calculating Cov_t. On the
+    //  lag lattice, only pairs of an entry with itself have lag 0.
     //
     for(j=0;j<nd;j++)
     {
-      for(k=j;k<nd;k++)
+      int kEnd = (onLattice ? j+1 : nd);
+      for(k=j;k<kEnd;k++)
       {
         h = static_cast<int>(floor(z[k]-z[j]+0.5));
         if (h==0)
@@ -829,6 +843,256 @@ Analyzelog::estimateCorrTAndVar0(float       * CorrT,
   delete [] nTT;
 }
 
+//
+// Finds the lattice positions pos[j] = floor(z[j]-z[0]+0.5) of the log entries of a well, and
+// returns true if they are strictly increasing and each entry is within 0.2 of its position.
+// The lag floor(z[k]-z[j]+0.5) of every pair is then pos[k]-pos[j].
+//
+bool
+Analyzelog::findLagPositions(const float      * z,
+                             int                nd,
+                             std::vector<int> & pos)
+{
+  const float maxOffset = 0.2f;
+
+  pos.resize(nd);
+  for(int j=0;j<nd;j++)
+  {
+    float d = z[j] - z[0];
+    pos[j]  = static_cast<int>(floor(d+0.5));
+    if(std::abs(d - pos[j]) > maxOffset || (j > 0 && pos[j] <= pos[j-1]))
+      return(false);
+  }
+  return(nd > 0);
+}
+
+//
+// Adds the lag sums of the pair loops in estimateCorrTAndVar0 for a well on the lag lattice.
+// With the logs placed on the lattice, and zero where missing, the sums over pairs at lag h
+// are correlations, which are found with FFTs for the three logs together:
+//
+//   cov[h]   = sum_t x(t)  *x(t+h)      varj[h] = sum_t x(t)^2*w(t+h)
+//   count[h] = sum_t w(t)  *w(t+h)      vark[h] = sum_t w(t)  *x(t+h)^2
+//
+// where w is one for non-missing entries.
+//
+// The three sums are rounded differently by the FFTs, so a correlation found from them can
+// end up outside [-1,1] where it should be close to one, and the relative rounding grows where
+// there are few pairs. The first nDirectLags lags, where the correlations are closest to one,
+// and the lags with fewer than minFFTPairs pairs are therefore summed directly on the lattice,
+// in the order of the pair loops, and are as from the pair loops. So is any other lag where the
+// FFT sums break |cov| <= sqrt(varj*vark). The remaining lags differ from the pair loops by
+// float rounding only. checkLagSums() compares them with the pair loops in debug runs.
+//
+void
+Analyzelog::addLagSums(const std::vector<int> & pos,
+                       float                 ** dLn,
+                       const bool             * useLog,
+                       int                      n,
+                       float                 ** cov,
+                       float                 ** varj,
+                       float                 ** vark,
+                       int                   ** count)
+{
+  int nd     = static_cast<int>(pos.size());
+  int nPos   = pos[nd-1] + 1;
+  int maxLag = std::min(n, nPos-1);
+  int nfp    = 1;
+  while(nfp < nPos + maxLag)  // No wrap-around for lags up to maxLag
+    nfp *= 2;
+  int cnfp   = nfp/2 + 1;
+  int rnfp   = 2*cnfp;
+
+  const int minFFTPairs = 64;
+  const int nDirectLags = 4;
+
+  // The logs on the lattice
+  std::vector<float> xLat(3*nPos, 0.0f);
+  std::vector<char>  wLat(3*nPos, 0);
+  for(int l=0;l<3;l++)
+  {
+    for(int j=0;j<nd;j++)
+    {
+      if(dLn[l][j] != RMISSING)
+      {
+        xLat[l*nPos+pos[j]] = dLn[l][j];
+        wLat[l*nPos+pos[j]] = 1;
+      }
+    }
+  }
+
+  // The log, its square and the indicator for each log
+  fftw_real * rIn  = static_cast<fftw_real*>(fftw_malloc(sizeof(float)*rnfp*9));
+  fftw_real * rOut = static_cast<fftw_real*>(fftw_malloc(sizeof(float)*rnfp*12));
+  for(int i=0;i<rnfp*9;i++)
+    rIn[i] = 0.0f;
+  for(int l=0;l<3;l++)
+  {
+    fftw_real * x  = rIn + (3*l  )*rnfp;
+    fftw_real * x2 = rIn + (3*l+1)*rnfp;
+    fftw_real * w  = rIn + (3*l+2)*rnfp;
+    for(int t=0;t<nPos;t++)
+    {
+      if(wLat[l*nPos+t] == 1)
+      {
+        x[t]  = xLat[l*nPos+t];
+        x2[t] = x[t]*x[t];
+        w[t]  = 1.0f;
+      }
+    }
+  }
+  FFT1D::fft(rIn, nfp, 9, true);
+
+  // sum_t a(t)*b(t+h) has transform conj(A)*B
+  for(int l=0;l<3;l++)
+  {
+    if(!useLog[l])
+      continue;
+    fftw_complex * cIn[3];
+    for(int m=0;m<3;m++)
+      cIn[m] = reinterpret_cast<fftw_complex*>(rIn + (3*l+m)*rnfp);
+    int a[4] = {0, 1, 2, 2};
+    int b[4] = {0, 2, 1, 2};
+    for(int m=0;m<4;m++)
+    {
+      fftw_complex * cA   = cIn[a[m]];
+      fftw_complex * cB   = cIn[b[m]];
+      fftw_complex * cOut = reinterpret_cast<fftw_complex*>(rOut + (4*l+m)*rnfp);
+      for(int i=0;i<cnfp;i++)
+      {
+        cOut[i].re = cA[i].re*cB[i].re + cA[i].im*cB[i].im;
+        cOut[i].im = cA[i].re*cB[i].im - cA[i].im*cB[i].re;
+      }
+    }
+  }
+  FFT1D::fftInv(reinterpret_cast<fftw_complex*>(rOut), nfp, 12, true);
+
+  double scale = 1.0/static_cast<double>(nfp);
+  for(int l=0;l<3;l++)
+  {
+    if(!useLog[l])
+      continue;
+    fftw_real   * rCov   = rOut + (4*l  )*rnfp;
+    fftw_real   * rVarj  = rOut + (4*l+1)*rnfp;
+    fftw_real   * rVark  = rOut + (4*l+2)*rnfp;
+    fftw_real   * rCount = rOut + (4*l+3)*rnfp;
+    const float * x      = &xLat[l*nPos];
+    const char  * w      = &wLat[l*nPos];
+    for(int h=0;h<=maxLag;h++)
+    {
+      int nPairs = static_cast<int>(floor(rCount[h]*scale+0.5));
+      if(h > 0 && nPairs == 0)
+        continue;
+
+      double sumCov  = rCov[h]*scale;
+      double sumVarj = rVarj[h]*scale;
+      double sumVark = rVark[h]*scale;
+      if(h < nDirectLags || nPairs < minFFTPairs || sumCov*sumCov > sumVarj*sumVark)
+      {
+        for(int t=0;t+h<nPos;t++)
+        {
+          if(w[t] == 1 && w[t+h] == 1)
+          {
+            cov[l][h]  += x[t]*x[t+h];
+            varj[l][h] += x[t]*x[t];
+            vark[l][h] += x[t+h]*x[t+h];
+            count[l][h]++;
+          }
+        }
+      }
+      else
+      {
+        cov[l][h]   += static_cast<float>(sumCov);
+        varj[l][h]  += static_cast<float>(sumVarj);
+        vark[l][h]  += static_cast<float>(sumVark);
+        count[l][h] += nPairs;
+      }
+    }
+  }
+
+  fftw_free(rIn);
+  fftw_free(rOut);
+}
+
+//
+// Compares the lag sums of addLagSums() for one well with the pair loops, summed in double
+// precision, and logs the largest differences relative to the lag 0 sums, and the largest
+// difference in the correlation of a lag.
+//
+void
+Analyzelog::checkLagSums(const std::vector<int> & pos,
+                         float                 ** dLn,
+                         const bool             * useLog,
+                         int                      n,
+                         const std::string      & wellName)
+{
+  int nd     = static_cast<int>(pos.size());
+  int maxLag = std::min(n, pos[nd-1]);
+
+  const char * logNames[3] = {"Vp", "Vs", "Rho"};
+  for(int l=0;l<3;l++)
+  {
+    if(!useLog[l])
+      continue;
+
+    std::vector<float> cov(n+1, 0.0f);
+    std::vector<float> varj(n+1, 0.0f);
+    std::vector<float> vark(n+1, 0.0f);
+    std::vector<int>   count(n+1, 0);
+    float * dLnOne[3]    = {dLn[l], dLn[l], dLn[l]};
+    bool    useOne[3]    = {true, false, false};
+    float * covOne[3]    = {&cov[0], &cov[0], &cov[0]};
+    float * varjOne[3]   = {&varj[0], &varj[0], &varj[0]};
+    float * varkOne[3]   = {&vark[0], &vark[0], &vark[0]};
+    int   * countOne[3]  = {&count[0], &count[0], &count[0]};
+    addLagSums(pos, dLnOne, useOne, n, covOne, varjOne, varkOne, countOne);
+
+    std::vector<double> cov2(maxLag+1, 0.0);
+    std::vector<double> varj2(maxLag+1, 0.0);
+    std::vector<double> vark2(maxLag+1, 0.0);
+    std::vector<int>    count2(maxLag+1, 0);
+    for(int j=0;j<nd;j++)
+    {
+      if(dLn[l][j] == RMISSING)
+        continue;
+      for(int k=j;k<nd && pos[k]-pos[j]<=maxLag;k++)
+      {
+        if(dLn[l][k] == RMISSING)
+          continue;
+        int h = pos[k]-pos[j];
+        cov2[h]  += static_cast<double>(dLn[l][j])*dLn[l][k];
+        varj2[h] += static_cast<double>(dLn[l][j])*dLn[l][j];
+        vark2[h] += static_cast<double>(dLn[l][k])*dLn[l][k];
+        count2[h]++;
+      }
+    }
+
+    double maxSumError = 0.0;
+    double maxCorError = 0.0;
+    bool   countsAgree = true;
+    for(int h=0;h<=maxLag;h++)
+    {
+      if(count[h] != count2[h])
+        countsAgree = false;
+      if(varj2[0] > 0.0)
+      {
+        maxSumError = std::max(maxSumError, fabs(cov[h]-cov2[h])/varj2[0]);
+        maxSumError = std::max(maxSumError, fabs(varj[h]-varj2[h])/varj2[0]);
+        maxSumError = std::max(maxSumError, fabs(vark[h]-vark2[h])/varj2[0]);
+      }
+      if(varj[h] > 0.0f && vark[h] > 0.0f && varj2[h] > 0.0 && vark2[h] > 0.0)
+      {
+        double cor  = cov[h]/sqrt(static_cast<double>(varj[h])*vark[h]);
+        double cor2 = cov2[h]/sqrt(varj2[h]*vark2[h]);
+        maxCorError = std::max(maxCorError, fabs(cor-cor2));
+      }
+    }
+    LogKit::LogFormatted(LogKit::Low,"\nLag sums for %-3s in well %s: max rel sum error %.2e, max correlation error %.2e%s",
+                         logNames[l], wellName.c_str(), maxSumError, maxCorError,
+                         (countsAgree ? "" : ", PAIR COUNTS DIFFER"));
+  }
+}
+
 void
 Analyzelog::checkVariances(const ModelSettings  * modelSettings,
                            const float  * const * pointVar0,
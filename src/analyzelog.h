@@ -53,8 +53,28 @@ private:
                                        float         dt,
                                        int           n,
                                        int           maxnd,
+                                       bool          debug,
                                        std::string & errTxt);
 
+  static bool     findLagPositions(const float      * z,
+                                   int                nd,
+                                   std::vector<int> & pos);
+
+  static void     addLagSums(const std::vector<int> & pos,
+                             float                 ** dLn,
+                             const bool             * useLog,
+                             int                      n,
+                             float                 ** cov,
+                             float                 ** varj,
+                             float                 ** vark,
+                             int                   ** count);
+
+  static void     checkLagSums(const std::vector<int> & pos,
+                               float                 ** dLn,
+                               const bool             * useLog,
+                               int                      n,
+                               const std::string      & wellName);
+
   void            readMeanData(FFTGrid *cube, int nd, const double *xpos, const double *ypos,
                                const double *zpos, float *meanValue);
 
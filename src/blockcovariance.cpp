@@ -0,0 +1,141 @@
+/***************************************************************************
+*      Copyright (C) 2008 by Norwegian Computing Center and Statoil        *
+***************************************************************************/
+
+#include <assert.h>
+
+#include "src/blockcovariance.h"
+
+BlockCovariance::BlockCovariance()
+  : n_(0)
+{
+}
+
+//-----------------------------------------------------------------------------------------//
+
+BlockCovariance::~BlockCovariance()
+{
+}
+
+//-----------------------------------------------------------------------------------------//
+
+void
+BlockCovariance::clear()
+{
+  n_ = 0;
+  blocks_.clear();
+}
+
+//-----------------------------------------------------------------------------------------//
+
+void
+BlockCovariance::addToeplitzBlock(const std::vector<double> & first_row,
+                                  const std::vector<double> & scale)
+{
+  assert(first_row.size() == scale.size());
+
+  Block block;
+  block.first     = n_;
+  block.n         = static_cast<int>(first_row.size());
+  block.first_row = first_row;
+  block.scale     = scale;
+
+  blocks_.push_back(block);
+  n_ += block.n;
+}
+
+//-----------------------------------------------------------------------------------------//
+
+void
+BlockCovariance::addDenseBlock(const NRLib::Grid2D<double> & dense)
+{
+  assert(dense.GetNI() == dense.GetNJ());
+
+  Block block;
+  block.first = n_;
+  block.n     = static_cast<int>(dense.GetNI());
+  block.dense = dense;
+
+  blocks_.push_back(block);
+  n_ += block.n;
+}
+
+//-----------------------------------------------------------------------------------------//
+
+void
+BlockCovariance::multiplyLeft(const NRLib::Matrix & G,
+                              NRLib::Matrix       & B) const
+{
+  assert(G.numCols() == n_);
+
+  int m = G.numRows();
+
+  std::vector<double> v(n_);
+  std::vector<int>    nonzero(n_);
+
+  for (size_t b = 0; b < blocks_.size(); b++) {
+    const Block & block = blocks_[b];
+    int           first = block.first;
+    int           nb    = block.n;
+    bool          dense = block.first_row.empty();
+
+    for (int r = 0; r < m; r++) {
+      // Nonzero entries of this row of G within the block, scaled by D for Toeplitz blocks
+      int n_nonzero = 0;
+      for (int k = 0; k < nb; k++) {
+        double g = G(r, first + k);
+        if (g != 0) {
+          v[n_nonzero]       = (dense ? g : g * block.scale[k]);
+          nonzero[n_nonzero] = k;
+          n_nonzero++;
+        }
+      }
+
+      for (int l = 0; l < nb; l++) {
+        double sum = 0;
+        if (dense) {
+          for (int q = 0; q < n_nonzero; q++)
+            sum += v[q] * block.dense(nonzero[q], l);
+          B(r, first + l) = sum;
+        }
+        else {
+          for (int q = 0; q < n_nonzero; q++) {
+            int k = nonzero[q];
+            sum += v[q] * block.first_row[k > l ? k - l : l - k];
+          }
+          B(r, first + l) = sum * block.scale[l];
+        }
+      }
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------------------//
+
+void
+BlockCovariance::getDense(NRLib::Matrix & Sigma) const
+{
+  for (int i = 0; i < n_; i++) {
+    for (int j = 0; j < n_; j++)
+      Sigma(i, j) = 0;
+  }
+
+  for (size_t b = 0; b < blocks_.size(); b++) {
+    const Block & block = blocks_[b];
+    int           first = block.first;
+    int           nb    = block.n;
+
+    if (block.first_row.empty()) {
+      for (int k = 0; k < nb; k++) {
+        for (int l = 0; l < nb; l++)
+          Sigma(first + k, first + l) = block.dense(k, l);
+      }
+    }
+    else {
+      for (int k = 0; k < nb; k++) {
+        for (int l = 0; l < nb; l++)
+          Sigma(first + k, first + l) = block.scale[k] * block.scale[l] * block.first_row[k > l ? k - l : l - k];
+      }
+    }
+  }
+}
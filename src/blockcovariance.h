@@ -0,0 +1,53 @@
+/***************************************************************************
+*      Copyright (C) 2008 by Norwegian Computing Center and Statoil        *
+***************************************************************************/
+
+#ifndef BLOCK_COVARIANCE_H
+#define BLOCK_COVARIANCE_H
+
+#include <vector>
+
+#include "nrlib/flens/nrlib_flens.hpp"
+#include "nrlib/grid/grid2d.hpp"
+
+// Block diagonal covariance matrix, where each block is either dense or on the form D*T*D,
+// with D diagonal and T a symmetric Toeplitz matrix given by its first row. The log-normal
+// transforms of a stationary covariance are on this form, so the prior covariances used in
+// the 1D travel time inversions need not be stored or multiplied as dense matrices.
+class BlockCovariance
+{
+public:
+  BlockCovariance();
+  ~BlockCovariance();
+
+  void                 clear();
+
+  void                 addToeplitzBlock(const std::vector<double> & first_row,
+                                        const std::vector<double> & scale);
+
+  void                 addDenseBlock(const NRLib::Grid2D<double> & block);
+
+  int                  getN() const { return n_ ;}
+
+  // B = G*Sigma, where G is m x n. Zeros in G are skipped, as G is typically sparse.
+  void                 multiplyLeft(const NRLib::Matrix & G,
+                                    NRLib::Matrix       & B) const;
+
+  // Writes the full n x n matrix.
+  void                 getDense(NRLib::Matrix & Sigma) const;
+
+private:
+  struct Block
+  {
+    int                    first;
+    int                    n;
+    std::vector<double>    first_row;   // Toeplitz blocks only
+    std::vector<double>    scale;       // Toeplitz blocks only
+    NRLib::Grid2D<double>  dense;       // Dense blocks only
+  };
+
+  int                  n_;
+  std::vector<Block>   blocks_;
+};
+
+#endif
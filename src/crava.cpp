@@ -27,11 +27,14 @@
 #include "src/qualitygrid.h"
 #include "src/io.h"
 #include "src/tasklist.h"
+#include "src/gridwritequeue.h"
 
 #include "lib/timekit.hpp"
 #include "lib/random.h"
 #include "lib/lib_matr.h"
+#include "lib/fft1d.h"
 
+#include "nrlib/exception/exception.hpp"
 #include "nrlib/iotools/logkit.hpp"
 #include "nrlib/stormgrid/stormcontgrid.hpp"
 #include "nrlib/grid/grid2d.hpp"
@@ -45,6 +48,11 @@
 #include <assert.h>
 #include <time.h>
 #include <string>
+#include <new>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 Crava::Crava(ModelSettings           * modelSettings,
              ModelGeneral            * modelGeneral,
@@ -133,29 +141,27 @@ Crava::Crava(ModelSettings           * modelSettings,
     if (modelSettings->getDoInversion() && spatwellfilter == NULL) {
       spatwellfilter = new SpatialWellFilter(modelSettings->getNumberOfWells());
 
-      FFTGrid * alphaCov = seismicParameters.GetCovAlpha();
-      alphaCov->setAccessMode(FFTGrid::RANDOMACCESS);
+      if (seismicParameters.hasImplicitPriorCov()) {
+        for(int i=0; i<nWells_; i++)
+          spatwellfilter->setPriorSpatialCorr(seismicParameters, wells_[i], i);
+      }
+      else {
+        FFTGrid * alphaCov = seismicParameters.GetCovAlpha();
+        alphaCov->setAccessMode(FFTGrid::RANDOMACCESS);
 
-      for(int i=0; i<nWells_; i++)
-        spatwellfilter->setPriorSpatialCorr(alphaCov, wells_[i], i);
+        for(int i=0; i<nWells_; i++)
+          spatwellfilter->setPriorSpatialCorr(alphaCov, wells_[i], i);
 
-      alphaCov->endAccess();
+        alphaCov->endAccess();
+      }
     }
 
-    float corrGradI, corrGradJ;
-    modelGeneral_->getCorrGradIJ(corrGradI, corrGradJ);
-
     fftw_real * corrT = seismicParameters.extractParamCorrFromCovAlpha(nzp_);
 
     float dt = static_cast<float>(modelGeneral->getTimeSimbox()->getdz());
     if((modelSettings_->getOtherOutputFlag() & IO::PRIORCORRELATIONS) > 0)
       seismicParameters.writeFilePriorCorrT(corrT, nzp_, dt);
 
-    errCorr_ = createFFTGrid();
-    errCorr_ ->setType(FFTGrid::COVARIANCE);
-    errCorr_ ->createRealGrid();
-    errCorr_->fillInErrCorr(modelGeneral->getPriorCorrXY(), corrGradI, corrGradJ); // errCorr_->fftInPlace();
-
     for(int i=0 ; i< ntheta_ ; i++)
       assert(seisData_[i]->consistentSize(nx_,ny_,nz_,nxp_,nyp_,nzp_));
 
@@ -590,26 +596,21 @@ Crava::checkScale(void)
 void
 Crava::divideDataByScaleWavelet(const SeismicParametersHolder & seismicParameters)
 {
-  int i,j,k,l,flag;
+  int i,j,k,l;
 
   fftw_real*    rData;
+  fftw_real*    rRow;
   fftw_real     tmp;
   fftw_complex* cData ;
   fftw_complex* adjustmentFactor;
 
-
-  rfftwnd_plan plan1,plan2;
-
-  rData  = static_cast<fftw_real*>(fftw_malloc(2*(nzp_/2+1)*sizeof(fftw_real)));
-  cData  = reinterpret_cast<fftw_complex*>(rData);
+  // The traces in a row are transformed together
+  int rnzp = 2*(nzp_/2+1);
+  rRow  = static_cast<fftw_real*>(fftw_malloc(nyp_*rnzp*sizeof(fftw_real)));
   adjustmentFactor= static_cast<fftw_complex*>(fftw_malloc(2*(nzp_/2+1)*sizeof(fftw_real)));
 
   Wavelet1D* localWavelet ;
 
-  flag   = FFTW_ESTIMATE | FFTW_IN_PLACE;
-  plan1  = rfftwnd_create_plan(1,&nzp_,FFTW_REAL_TO_COMPLEX,flag);
-  plan2  = rfftwnd_create_plan(1,&nzp_,FFTW_COMPLEX_TO_REAL,flag);
-
   for(l=0 ; l< ntheta_ ; l++ )
   {
     int dim=seisWavelet_[l]->getDim();
@@ -621,9 +622,29 @@ Crava::divideDataByScaleWavelet(const SeismicParametersHolder & seismicParameter
 
     seisData_[l]->setAccessMode(FFTGrid::RANDOMACCESS);
     for(i=0; i < nxp_; i++)
+    {
       for(j=0; j< nyp_; j++)
       {
         // gets data
+        rData = rRow + j*rnzp;
+        for(k=0;k<nzp_;k++)
+        {
+          rData[k] = seisData_[l]->getRealValue(i,j,k, true)/static_cast<float>(sqrt(static_cast<float>(nzp_)));
+
+          if(k > nz_)
+          {
+            float dist = seisData_[l]->getDistToBoundary( k, nz_, nzp_);
+            rData[k] *= std::max<float>(1-dist*dist,0);
+          }
+        }
+      }
+      FFT1D::fft(rRow, nzp_, nyp_); // fourier transform of data in profiles (i,j)
+      // end get data
+
+      for(j=0; j< nyp_; j++)
+      {
+        cData = reinterpret_cast<fftw_complex*>(rRow + j*rnzp);
+
         int iInd=i;
         int jInd=j;
 
@@ -644,19 +665,6 @@ Crava::divideDataByScaleWavelet(const SeismicParametersHolder & seismicParameter
         if(jInd >= ny_ )
           jInd = 2*ny_-jInd-1;
 
-        for(k=0;k<nzp_;k++)
-        {
-          rData[k] = seisData_[l]->getRealValue(i,j,k, true)/static_cast<float>(sqrt(static_cast<float>(nzp_)));
-
-          if(k > nz_)
-          {
-            float dist = seisData_[l]->getDistToBoundary( k, nz_, nzp_);
-            rData[k] *= std::max<float>(1-dist*dist,0);
-          }
-        }
-        rfftwnd_one_real_to_complex(plan1,rData ,cData); // fourier transform of data in profile (i,j)
-        // end get data
-
         // Wavelet local properties
         localWavelet = seisWavelet_[l]->createLocalWavelet1D(iInd,jInd);  //
         double sfLoc =(simbox_->getRelThick(i,j)*seisWavelet_[l]->getLocalStretch(iInd,jInd));// scale factor from thickness stretch + (local stretch when 3D wavelet)
@@ -684,12 +692,17 @@ Crava::divideDataByScaleWavelet(const SeismicParametersHolder & seismicParameter
             cData[k].re = 0.0f;
           }
         }
-        rfftwnd_one_complex_to_real(plan2 ,cData ,rData);
+      }
+      FFT1D::fftInv(reinterpret_cast<fftw_complex*>(rRow), nzp_, nyp_);
+      for(j=0; j< nyp_; j++)
+      {
+        rData = rRow + j*rnzp;
         for(k=0;k<nzp_;k++)
         {
           seisData_[l]->setRealValue(i,j,k,rData[k]/static_cast<float>(sqrt(static_cast<float>(nzp_))),true);
         }
       }
+    }
 
       if(ModelSettings::getDebugLevel() > 0)
       {
@@ -714,10 +727,8 @@ Crava::divideDataByScaleWavelet(const SeismicParametersHolder & seismicParameter
       seisData_[l]->endAccess();
   }
 
-  fftw_free(rData);
+  fftw_free(rRow);
   fftw_free(adjustmentFactor);
-  fftwnd_destroy_plan(plan1);
-  fftwnd_destroy_plan(plan2);
 }
 
 
@@ -737,14 +748,12 @@ Crava::computeAdjustmentFactor(fftw_complex                  * adjustmentFactor,
 
     // computes the time covariance for reflection coefficients rcCovT can be globaly stored
   fftw_real* rcCovT;
-  int flag   = FFTW_ESTIMATE | FFTW_IN_PLACE;
-  rfftwnd_plan plan1  = rfftwnd_create_plan(1, &nzp_ ,FFTW_REAL_TO_COMPLEX,flag);
   rcCovT = static_cast<fftw_real*>(fftw_malloc(2*(nzp_/2+1)*sizeof(fftw_real)));
   fftw_complex * rcSpecIntens = reinterpret_cast<fftw_complex*>(rcCovT);
 
   float * corrT = seismicParameters.getPriorCorrTFiltered(nz_, nzp_);
   computeReflectionCoefficientTimeCovariance(rcCovT, corrT, A);
-  rfftwnd_one_real_to_complex(plan1,rcCovT ,rcSpecIntens); // operator FFT (not isometric)
+  FFT1D::fft(rcCovT, nzp_); // operator FFT (not isometric)
   delete [] corrT;
 
   // computes the time Covariance in the errorterm with wavelet Local can be more efficiently computed
@@ -811,27 +820,23 @@ Crava::computeAdjustmentFactor(fftw_complex                  * adjustmentFactor,
   delete errorSmooth;
   delete errorSmooth2;
   delete errorSmooth3;
-  fftwnd_destroy_plan(plan1);
   fftw_free(rcCovT);
 }
 
 void
 Crava::multiplyDataByScaleWaveletAndWriteToFile(const std::string & typeName)
 {
-  int i,j,k,l,flag;
+  int i,j,k,l;
 
   fftw_real*    rData;
+  fftw_real*    rRow;
   fftw_real     tmp;
   fftw_complex* cData;
   fftw_complex scaleWVal;
-  rfftwnd_plan plan1,plan2;
-
-  rData  = static_cast<fftw_real*>(fftw_malloc(2*(nzp_/2+1)*sizeof(fftw_real)));
-  cData  = reinterpret_cast<fftw_complex*>(rData);
 
-  flag   = FFTW_ESTIMATE | FFTW_IN_PLACE;
-  plan1  = rfftwnd_create_plan(1, &nzp_ ,FFTW_REAL_TO_COMPLEX,flag);
-  plan2  = rfftwnd_create_plan(1,&nzp_,FFTW_COMPLEX_TO_REAL,flag);
+  // The traces in a row are transformed together
+  int rnzp = 2*(nzp_/2+1);
+  rRow  = static_cast<fftw_real*>(fftw_malloc(ny_*rnzp*sizeof(fftw_real)));
 
   Wavelet1D* localWavelet;
 
@@ -841,16 +846,22 @@ Crava::multiplyDataByScaleWaveletAndWriteToFile(const std::string & typeName)
     seisData_[l]->invFFTInPlace();
 
     for(i=0; i < nx_; i++)
+    {
       for(j=0; j< ny_; j++)
       {
-        float sf = static_cast<float>(simbox_->getRelThick(i,j))*seisWavelet_[l]->getLocalStretch(i,j);
-
+        rData = rRow + j*rnzp;
         for(k=0;k<nzp_;k++)
         {
           rData[k] = seisData_[l]->getRealValue(i,j,k, true)/static_cast<float>(sqrt(static_cast<float>(nzp_)));
         }
+      }
+      FFT1D::fft(rRow, nzp_, ny_);
+
+      for(j=0; j< ny_; j++)
+      {
+        float sf = static_cast<float>(simbox_->getRelThick(i,j))*seisWavelet_[l]->getLocalStretch(i,j);
 
-        rfftwnd_one_real_to_complex(plan1,rData ,cData);
+        cData = reinterpret_cast<fftw_complex*>(rRow + j*rnzp);
         localWavelet = seisWavelet_[l]->createLocalWavelet1D(i,j);
 
         for(k=0;k < (nzp_/2 +1);k++) // all complex values
@@ -864,13 +875,17 @@ Crava::multiplyDataByScaleWaveletAndWriteToFile(const std::string & typeName)
           cData[k].re   = tmp;
         }
         delete localWavelet;
-        rfftwnd_one_complex_to_real(plan2 ,cData ,rData);
+      }
+      FFT1D::fftInv(reinterpret_cast<fftw_complex*>(rRow), nzp_, ny_);
+      for(j=0; j< ny_; j++)
+      {
+        rData = rRow + j*rnzp;
         for(k=0;k<nzp_;k++)
         {
           seisData_[l]->setRealValue(i,j,k,rData[k]/static_cast<float>(sqrt(static_cast<double>(nzp_))),true);
         }
-
       }
+    }
       std::string angle     = NRLib::ToString(thetaDeg_[l],1);
       std::string sgriLabel = typeName + " for incidence angle "+angle;
       std::string fileName  = typeName + "_" + angle;
@@ -878,9 +893,7 @@ Crava::multiplyDataByScaleWaveletAndWriteToFile(const std::string & typeName)
       seisData_[l]->endAccess();
   }
 
-  fftw_free(rData);
-  fftwnd_destroy_plan(plan1);
-  fftwnd_destroy_plan(plan2);
+  fftw_free(rRow);
 }
 
 int
@@ -981,33 +994,45 @@ Crava::computePostMeanResidAndFFTCov(ModelGeneral            * modelGeneral,
   meanBeta_ ->setAccessMode(FFTGrid::READANDWRITE);
   meanRho_  ->setAccessMode(FFTGrid::READANDWRITE);
 
-  FFTGrid * postCovAlpha       = seismicParameters.GetCovAlpha();
-  FFTGrid * postCovBeta        = seismicParameters.GetCovBeta();
-  FFTGrid * postCovRho         = seismicParameters.GetCovRho();
-  FFTGrid * postCrCovAlphaBeta = seismicParameters.GetCrCovAlphaBeta();
-  FFTGrid * postCrCovAlphaRho  = seismicParameters.GetCrCovAlphaRho();
-  FFTGrid * postCrCovBetaRho   = seismicParameters.GetCrCovBetaRho();
-
   if (modelGeneral->getIs4DActive() == true) {
     std::vector<FFTGrid *> sigma(6);
-    sigma[0] = postCovAlpha;
-    sigma[1] = postCrCovAlphaBeta;
-    sigma[2] = postCrCovAlphaRho;
-    sigma[3] = postCovBeta;
-    sigma[4] = postCrCovBetaRho;
-    sigma[5] = postCovRho;
+    sigma[0] = seismicParameters.GetCovAlpha();
+    sigma[1] = seismicParameters.GetCrCovAlphaBeta();
+    sigma[2] = seismicParameters.GetCrCovAlphaRho();
+    sigma[3] = seismicParameters.GetCovBeta();
+    sigma[4] = seismicParameters.GetCrCovBetaRho();
+    sigma[5] = seismicParameters.GetCovRho();
     modelGeneral->mergeCovariance(sigma); //To avoid a second FFT of these.
   }
+  else if (seismicParameters.hasImplicitPriorCov())
+    seismicParameters.createPostCovGrids(); // The prior is made for each cell in getNextParameterCovariance()
   else
     seismicParameters.FFTCovGrids();
 
-  postCovAlpha      ->setAccessMode(FFTGrid::READ);
-  postCovBeta       ->setAccessMode(FFTGrid::READ);
-  postCovRho        ->setAccessMode(FFTGrid::READ);
-  postCrCovAlphaBeta->setAccessMode(FFTGrid::READ);
-  postCrCovAlphaRho ->setAccessMode(FFTGrid::READ);
-  postCrCovBetaRho  ->setAccessMode(FFTGrid::READ);
+  FFTGrid * postCovAlpha       = seismicParameters.GetCovAlpha();
+  FFTGrid * postCovBeta        = seismicParameters.GetCovBeta();
+  FFTGrid * postCovRho         = seismicParameters.GetCovRho();
+  FFTGrid * postCrCovAlphaBeta = seismicParameters.GetCrCovAlphaBeta();
+  FFTGrid * postCrCovAlphaRho  = seismicParameters.GetCrCovAlphaRho();
+  FFTGrid * postCrCovBetaRho   = seismicParameters.GetCrCovBetaRho();
 
+  // The prior covariance is read and replaced by the posterior. Reduced precision grids are
+  // file grids, where reading and writing are separate access modes.
+  int covAccessMode = (seismicParameters.hasImplicitPriorCov() ? FFTGrid::WRITE : FFTGrid::READANDWRITE);
+  postCovAlpha      ->setAccessMode(covAccessMode);
+  postCovBeta       ->setAccessMode(covAccessMode);
+  postCovRho        ->setAccessMode(covAccessMode);
+  postCrCovAlphaBeta->setAccessMode(covAccessMode);
+  postCrCovAlphaRho ->setAccessMode(covAccessMode);
+  postCrCovBetaRho  ->setAccessMode(covAccessMode);
+
+  // The error correlation is only used here, so it is allocated on first use and released at last use.
+  float corrGradI, corrGradJ;
+  modelGeneral->getCorrGradIJ(corrGradI, corrGradJ);
+  errCorr_ = ModelGeneral::createFFTGrid(nx_, ny_, nz_, nxp_, nyp_, nzp_, fileGrid_, FFTFileGrid::ERROR_CORRELATION);
+  errCorr_->setType(FFTGrid::COVARIANCE);
+  errCorr_->createRealGrid();
+  errCorr_->fillInErrCorr(modelGeneral->getPriorCorrXY(), corrGradI, corrGradJ);
   errCorr_->fftInPlace();
   errCorr_->setAccessMode(FFTGrid::READ);
 
@@ -1177,6 +1202,11 @@ Crava::computePostMeanResidAndFFTCov(ModelGeneral            * modelGeneral,
   postCrCovBetaRho  ->endAccess();
   errCorr_          ->endAccess();
 
+  delete errCorr_;
+  errCorr_ = NULL;
+
+  seismicParameters.releaseImplicitPriorCov(); // The covariance grids now hold the posterior
+
   postAlpha_->invFFTInPlace();
   postBeta_ ->invFFTInPlace();
   postRho_  ->invFFTInPlace();
@@ -1422,33 +1452,9 @@ Crava::simulate(SeismicParametersHolder & seismicParameters, RandomGen * randomG
 
   if(nSim_>0)
   {
-    bool kriging = (krigingParameter_ > 0);
-    FFTGrid * postCovAlpha       = seismicParameters.GetCovAlpha();
-    FFTGrid * postCovBeta        = seismicParameters.GetCovBeta();
-    FFTGrid * postCovRho         = seismicParameters.GetCovRho();
-    FFTGrid * postCrCovAlphaBeta = seismicParameters.GetCrCovAlphaBeta();
-    FFTGrid * postCrCovAlphaRho  = seismicParameters.GetCrCovAlphaRho();
-    FFTGrid * postCrCovBetaRho   = seismicParameters.GetCrCovBetaRho();
-
-    assert( postCovAlpha->getIsTransformed() );
-    assert( postCovBeta->getIsTransformed() );
-    assert( postCovRho->getIsTransformed() );
-    assert( postCrCovAlphaBeta->getIsTransformed() );
-    assert( postCrCovAlphaRho->getIsTransformed() );
-    assert( postCrCovBetaRho->getIsTransformed() );
-
-    int             simNr,i,j,k,l;
-    fftw_complex ** ijkPostCov;
-    fftw_complex *  ijkSeed;
-    FFTGrid *       seed0;
-    FFTGrid *       seed1;
-    FFTGrid *       seed2;
-
-    ijkPostCov = new fftw_complex*[3];
-    for(l=0;l<3;l++)
-      ijkPostCov[l]=new fftw_complex[3];
-
-    ijkSeed = new fftw_complex[3];
+    FFTGrid * seed0;
+    FFTGrid * seed1;
+    FFTGrid * seed2;
 
     seed0 =  createFFTGrid();
     seed1 =  createFFTGrid();
@@ -1457,145 +1463,268 @@ Crava::simulate(SeismicParametersHolder & seismicParameters, RandomGen * randomG
     seed1->createComplexGrid();
     seed2->createComplexGrid();
 
-    // long int timestart, timeend;
+    // With an output queue, each realization is written by a second thread while the next is simulated.
+    int  queueMemory  = modelSettings_->getOutputQueueMemory();
+    bool asynchronous = (queueMemory > 0);
+    GridWriteQueue writeQueue(static_cast<long long int>(queueMemory)*1024*1024);
+
+    // Exceptions must not leave the sections. They are kept and rethrown when the grids are deleted.
+    bool        outOfMemory = false;
+    std::string error       = "";
 
-    for(simNr = 0; simNr < nSim_;  simNr++)
+    if(asynchronous)
     {
-      // time(&timestart);
-
-      seed0->fillInComplexNoise(randomGen);
-      seed1->fillInComplexNoise(randomGen);
-      seed2->fillInComplexNoise(randomGen);
-
-      postCovAlpha      ->setAccessMode(FFTGrid::READ);
-      postCovBeta       ->setAccessMode(FFTGrid::READ);
-      postCovRho        ->setAccessMode(FFTGrid::READ);
-      postCrCovAlphaBeta->setAccessMode(FFTGrid::READ);
-      postCrCovAlphaRho ->setAccessMode(FFTGrid::READ);
-      postCrCovBetaRho  ->setAccessMode(FFTGrid::READ);
-      seed0 ->setAccessMode(FFTGrid::READANDWRITE);
-      seed1 ->setAccessMode(FFTGrid::READANDWRITE);
-      seed2 ->setAccessMode(FFTGrid::READANDWRITE);
-
-      int cnxp=nxp_/2+1;
-      int cholFlag;
-      for(k = 0; k < nzp_; k++)
-        for(j = 0; j < nyp_; j++)
-          for(i = 0; i < cnxp; i++)
-          {
-            ijkPostCov[0][0] = postCovAlpha      ->getNextComplex();
-            ijkPostCov[1][1] = postCovBeta       ->getNextComplex();
-            ijkPostCov[2][2] = postCovRho        ->getNextComplex();
-            ijkPostCov[0][1] = postCrCovAlphaBeta->getNextComplex();
-            ijkPostCov[0][2] = postCrCovAlphaRho ->getNextComplex();
-            ijkPostCov[1][2] = postCrCovBetaRho  ->getNextComplex();
-
-            ijkPostCov[1][0].re =  ijkPostCov[0][1].re;
-            ijkPostCov[1][0].im = -ijkPostCov[0][1].im;
-            ijkPostCov[2][0].re =  ijkPostCov[0][2].re;
-            ijkPostCov[2][0].im = -ijkPostCov[0][2].im;
-            ijkPostCov[2][1].re =  ijkPostCov[1][2].re;
-            ijkPostCov[2][1].im = -ijkPostCov[1][2].im;
-
-            ijkSeed[0]=seed0->getNextComplex();
-            ijkSeed[1]=seed1->getNextComplex();
-            ijkSeed[2]=seed2->getNextComplex();
-
-            cholFlag = lib_matrCholCpx(3,ijkPostCov);  // Choleskey factor of posterior covariance write over ijkPostCov
-            if(cholFlag == 0)
+      GridWriteQueue::setActive(&writeQueue);
+
+#ifdef _OPENMP
+      // The simulation should use all threads while the queue is written.
+#if _OPENMP >= 200805
+      int maxActiveLevels = omp_get_max_active_levels();
+      omp_set_max_active_levels(2);
+#else
+      int nested = omp_get_nested();
+      omp_set_nested(1);
+#endif
+#endif
+
+#pragma omp parallel sections num_threads(2)
+      {
+#pragma omp section
+        {
+          try {
+#ifdef _OPENMP
+            writeQueue.setAsynchronous(omp_get_num_threads() > 1);
+#endif
+            simulateRealizations(seismicParameters, randomGen, seed0, seed1, seed2);
+          }
+          catch (std::bad_alloc &) {
+#pragma omp critical(SimulationError)
+            outOfMemory = true;
+          }
+          catch (std::exception & e) {
+#pragma omp critical(SimulationError)
             {
-              lib_matrProdCholVec(3,ijkPostCov,ijkSeed); // write over ijkSeed
+              if(error == "")
+                error = e.what();
             }
-            else
-            {
-              for(l=0; l< 3;l++)
-              {
-                ijkSeed[l].re =0.0;
-                ijkSeed[l].im = 0.0;
-              }
+          }
+          // Also after an exception, so that the writing thread stops.
+          writeQueue.close();
+        }
 
+#pragma omp section
+        {
+          try {
+            // With one thread in the team, the sections may run in any order, and nothing is queued.
+#ifdef _OPENMP
+            if(omp_get_num_threads() > 1)
+#endif
+              writeQueue.process();
+          }
+          catch (std::bad_alloc &) {
+#pragma omp critical(SimulationError)
+            outOfMemory = true;
+          }
+          catch (std::exception & e) {
+#pragma omp critical(SimulationError)
+            {
+              if(error == "")
+                error = e.what();
             }
-            seed0->setNextComplex(ijkSeed[0]);
-            seed1->setNextComplex(ijkSeed[1]);
-            seed2->setNextComplex(ijkSeed[2]);
           }
+        }
+      }
+      writeQueue.process();
+
+#ifdef _OPENMP
+#if _OPENMP >= 200805
+      omp_set_max_active_levels(maxActiveLevels);
+#else
+      omp_set_nested(nested);
+#endif
+#endif
+      GridWriteQueue::setActive(NULL);
+    }
+    else
+      simulateRealizations(seismicParameters, randomGen, seed0, seed1, seed2);
 
-          postCovAlpha->endAccess();  //
-          postCovBeta->endAccess();   //
-          postCovRho->endAccess();
-          postCrCovAlphaBeta->endAccess();
-          postCrCovAlphaRho->endAccess();
-          postCrCovBetaRho->endAccess();
-          seed0->endAccess();
-          seed1->endAccess();
-          seed2->endAccess();
+    delete seed0;
+    delete seed1;
+    delete seed2;
 
-          // time(&timeend);
-          // printf("Simulation in FFT domain in %ld seconds \n",timeend-timestart);
-          // time(&timestart);
+    if(outOfMemory)
+      throw std::bad_alloc();
+    if(error != "")
+      throw NRLib::Exception(error);
+    writeQueue.rethrowError();
+  }
+  Timings::setTimeSimulation(wall,cpu);
+  return(0);
+}
 
-          seed0->setAccessMode(FFTGrid::RANDOMACCESS);
-          seed0->invFFTInPlace();
+void
+Crava::simulateRealizations(SeismicParametersHolder & seismicParameters,
+                            RandomGen               * randomGen,
+                            FFTGrid                 * seed0,
+                            FFTGrid                 * seed1,
+                            FFTGrid                 * seed2)
+{
+  bool kriging = (krigingParameter_ > 0);
+  FFTGrid * postCovAlpha       = seismicParameters.GetCovAlpha();
+  FFTGrid * postCovBeta        = seismicParameters.GetCovBeta();
+  FFTGrid * postCovRho         = seismicParameters.GetCovRho();
+  FFTGrid * postCrCovAlphaBeta = seismicParameters.GetCrCovAlphaBeta();
+  FFTGrid * postCrCovAlphaRho  = seismicParameters.GetCrCovAlphaRho();
+  FFTGrid * postCrCovBetaRho   = seismicParameters.GetCrCovBetaRho();
+
+  assert( postCovAlpha->getIsTransformed() );
+  assert( postCovBeta->getIsTransformed() );
+  assert( postCovRho->getIsTransformed() );
+  assert( postCrCovAlphaBeta->getIsTransformed() );
+  assert( postCrCovAlphaRho->getIsTransformed() );
+  assert( postCrCovBetaRho->getIsTransformed() );
 
-          seed1->setAccessMode(FFTGrid::RANDOMACCESS);
-          seed1->invFFTInPlace();
+  int             simNr,i,j,k,l;
+  fftw_complex ** ijkPostCov;
+  fftw_complex *  ijkSeed;
 
+  ijkPostCov = new fftw_complex*[3];
+  for(l=0;l<3;l++)
+    ijkPostCov[l]=new fftw_complex[3];
 
-          seed2->setAccessMode(FFTGrid::RANDOMACCESS);
-          seed2->invFFTInPlace();
+  ijkSeed = new fftw_complex[3];
 
-          if(modelAVOdynamic_->getUseLocalNoise()==true)
+  // long int timestart, timeend;
+
+  for(simNr = 0; simNr < nSim_;  simNr++)
+  {
+    // time(&timestart);
+
+    seed0->fillInComplexNoise(randomGen);
+    seed1->fillInComplexNoise(randomGen);
+    seed2->fillInComplexNoise(randomGen);
+
+    postCovAlpha      ->setAccessMode(FFTGrid::READ);
+    postCovBeta       ->setAccessMode(FFTGrid::READ);
+    postCovRho        ->setAccessMode(FFTGrid::READ);
+    postCrCovAlphaBeta->setAccessMode(FFTGrid::READ);
+    postCrCovAlphaRho ->setAccessMode(FFTGrid::READ);
+    postCrCovBetaRho  ->setAccessMode(FFTGrid::READ);
+    seed0 ->setAccessMode(FFTGrid::READANDWRITE);
+    seed1 ->setAccessMode(FFTGrid::READANDWRITE);
+    seed2 ->setAccessMode(FFTGrid::READANDWRITE);
+
+    int cnxp=nxp_/2+1;
+    int cholFlag;
+    for(k = 0; k < nzp_; k++)
+      for(j = 0; j < nyp_; j++)
+        for(i = 0; i < cnxp; i++)
+        {
+          ijkPostCov[0][0] = postCovAlpha      ->getNextComplex();
+          ijkPostCov[1][1] = postCovBeta       ->getNextComplex();
+          ijkPostCov[2][2] = postCovRho        ->getNextComplex();
+          ijkPostCov[0][1] = postCrCovAlphaBeta->getNextComplex();
+          ijkPostCov[0][2] = postCrCovAlphaRho ->getNextComplex();
+          ijkPostCov[1][2] = postCrCovBetaRho  ->getNextComplex();
+
+          ijkPostCov[1][0].re =  ijkPostCov[0][1].re;
+          ijkPostCov[1][0].im = -ijkPostCov[0][1].im;
+          ijkPostCov[2][0].re =  ijkPostCov[0][2].re;
+          ijkPostCov[2][0].im = -ijkPostCov[0][2].im;
+          ijkPostCov[2][1].re =  ijkPostCov[1][2].re;
+          ijkPostCov[2][1].im = -ijkPostCov[1][2].im;
+
+          ijkSeed[0]=seed0->getNextComplex();
+          ijkSeed[1]=seed1->getNextComplex();
+          ijkSeed[2]=seed2->getNextComplex();
+
+          cholFlag = lib_matrCholCpx(3,ijkPostCov);  // Choleskey factor of posterior covariance write over ijkPostCov
+          if(cholFlag == 0)
           {
-            float alpha,beta, rho;
-            float alphanew, betanew, rhonew;
-
-            for(j=0;j<ny_;j++)
-              for(i=0;i<nx_;i++)
-                for(k=0;k<nz_;k++)
-                {
-                  alpha = seed0->getRealValue(i,j,k);
-                  beta = seed1->getRealValue(i,j,k);
-                  rho = seed2->getRealValue(i,j,k);
-                  alphanew = float((*sigmamdnew_)(i,j)[0][0]*alpha+ (*sigmamdnew_)(i,j)[0][1]*beta+(*sigmamdnew_)(i,j)[0][2]*rho);
-                  betanew = float((*sigmamdnew_)(i,j)[1][0]*alpha+ (*sigmamdnew_)(i,j)[1][1]*beta+(*sigmamdnew_)(i,j)[1][2]*rho);
-                  rhonew = float((*sigmamdnew_)(i,j)[2][0]*alpha+ (*sigmamdnew_)(i,j)[2][1]*beta+(*sigmamdnew_)(i,j)[2][2]*rho);
-                  seed0->setRealValue(i,j,k,alphanew);
-                  seed1->setRealValue(i,j,k,betanew);
-                  seed2->setRealValue(i,j,k,rhonew);
-                }
+            lib_matrProdCholVec(3,ijkPostCov,ijkSeed); // write over ijkSeed
           }
+          else
+          {
+            for(l=0; l< 3;l++)
+            {
+              ijkSeed[l].re =0.0;
+              ijkSeed[l].im = 0.0;
+            }
 
-          seed0->add(postAlpha_);
-          seed0->endAccess();
-          seed1->add(postBeta_);
-          seed1->endAccess();
-          seed2->add(postRho_);
-          seed2->endAccess();
-
-          if(kriging == true) {
-            double wall2=0.0, cpu2=0.0;
-            TimeKit::getTime(wall2,cpu2);
-            doPostKriging(seismicParameters, *seed0, *seed1, *seed2);
-            Timings::addToTimeKrigingSim(wall2,cpu2);
           }
-          ParameterOutput::writeParameters(simbox_, modelGeneral_, modelSettings_, seed0, seed1, seed2,
-                                           outputGridsElastic_, fileGrid_, simNr, kriging);
-          // time(&timeend);
-          // printf("Back transform and write of simulation in %ld seconds \n",timeend-timestart);
-    }
+          seed0->setNextComplex(ijkSeed[0]);
+          seed1->setNextComplex(ijkSeed[1]);
+          seed2->setNextComplex(ijkSeed[2]);
+        }
 
-    delete seed0;
-    delete seed1;
-    delete seed2;
+        postCovAlpha->endAccess();  //
+        postCovBeta->endAccess();   //
+        postCovRho->endAccess();
+        postCrCovAlphaBeta->endAccess();
+        postCrCovAlphaRho->endAccess();
+        postCrCovBetaRho->endAccess();
+        seed0->endAccess();
+        seed1->endAccess();
+        seed2->endAccess();
+
+        // time(&timeend);
+        // printf("Simulation in FFT domain in %ld seconds \n",timeend-timestart);
+        // time(&timestart);
+
+        seed0->setAccessMode(FFTGrid::RANDOMACCESS);
+        seed0->invFFTInPlace();
+
+        seed1->setAccessMode(FFTGrid::RANDOMACCESS);
+        seed1->invFFTInPlace();
+
+
+        seed2->setAccessMode(FFTGrid::RANDOMACCESS);
+        seed2->invFFTInPlace();
+
+        if(modelAVOdynamic_->getUseLocalNoise()==true)
+        {
+          float alpha,beta, rho;
+          float alphanew, betanew, rhonew;
 
-    for(l=0;l<3;l++)
-      delete  [] ijkPostCov[l];
-    delete [] ijkPostCov;
-    delete [] ijkSeed;
+          for(j=0;j<ny_;j++)
+            for(i=0;i<nx_;i++)
+              for(k=0;k<nz_;k++)
+              {
+                alpha = seed0->getRealValue(i,j,k);
+                beta = seed1->getRealValue(i,j,k);
+                rho = seed2->getRealValue(i,j,k);
+                alphanew = float((*sigmamdnew_)(i,j)[0][0]*alpha+ (*sigmamdnew_)(i,j)[0][1]*beta+(*sigmamdnew_)(i,j)[0][2]*rho);
+                betanew = float((*sigmamdnew_)(i,j)[1][0]*alpha+ (*sigmamdnew_)(i,j)[1][1]*beta+(*sigmamdnew_)(i,j)[1][2]*rho);
+                rhonew = float((*sigmamdnew_)(i,j)[2][0]*alpha+ (*sigmamdnew_)(i,j)[2][1]*beta+(*sigmamdnew_)(i,j)[2][2]*rho);
+                seed0->setRealValue(i,j,k,alphanew);
+                seed1->setRealValue(i,j,k,betanew);
+                seed2->setRealValue(i,j,k,rhonew);
+              }
+        }
 
+        seed0->add(postAlpha_);
+        seed0->endAccess();
+        seed1->add(postBeta_);
+        seed1->endAccess();
+        seed2->add(postRho_);
+        seed2->endAccess();
+
+        if(kriging == true) {
+          double wall2=0.0, cpu2=0.0;
+          TimeKit::getTime(wall2,cpu2);
+          doPostKriging(seismicParameters, *seed0, *seed1, *seed2);
+          Timings::addToTimeKrigingSim(wall2,cpu2);
+        }
+        ParameterOutput::writeParameters(simbox_, modelGeneral_, modelSettings_, seed0, seed1, seed2,
+                                         outputGridsElastic_, fileGrid_, simNr, kriging);
+        // time(&timeend);
+        // printf("Back transform and write of simulation in %ld seconds \n",timeend-timestart);
   }
-  Timings::setTimeSimulation(wall,cpu);
-  return(0);
+
+  for(l=0;l<3;l++)
+    delete  [] ijkPostCov[l];
+  delete [] ijkPostCov;
+  delete [] ijkSeed;
 }
 
 void
@@ -1629,13 +1758,17 @@ Crava::doPostKriging(SeismicParametersHolder & seismicParameters,
   pKriging.KrigAll(postAlpha, postBeta, postRho, false, modelSettings_->getDebugFlag(), modelSettings_->getDoSmoothKriging());
 }
 
-FFTGrid *
-Crava::computeSeismicImpedance(FFTGrid * alpha, FFTGrid * beta, FFTGrid * rho, int angle)
+void
+Crava::computeSeismicImpedance(FFTGrid                      * alpha,
+                               FFTGrid                      * beta,
+                               FFTGrid                      * rho,
+                               const std::vector<FFTGrid *> & impedance,
+                               int                            firstAngle)
 {
-  FFTGrid * impedance = createFFTGrid();
-  impedance->setType(FFTGrid::DATA);
-  impedance->createRealGrid();
-  impedance->setAccessMode(FFTGrid::WRITE);
+  // The impedances of all the given angles are made in one pass over alpha, beta and rho.
+  int nAngles = static_cast<int>(impedance.size());
+  for(int l = 0; l < nAngles; l++)
+    impedance[l]->setAccessMode(FFTGrid::WRITE);
 
   int rnxp  = alpha->getRNxp();
   alpha->setAccessMode(FFTGrid::READ);
@@ -1646,109 +1779,161 @@ Crava::computeSeismicImpedance(FFTGrid * alpha, FFTGrid * beta, FFTGrid * rho, i
     {
       for(int i = 0; i < rnxp; i++)
       {
-        float imp = 0;
-        imp += alpha->getNextReal()*A_[angle][0];
-        imp += beta->getNextReal()*A_[angle][1];
-        imp += rho->getNextReal()*A_[angle][2];
-
-        impedance->setNextReal(imp);
+        float a = alpha->getNextReal();
+        float b = beta->getNextReal();
+        float r = rho->getNextReal();
+        for(int l = 0; l < nAngles; l++) {
+          float imp = 0;
+          imp += a*A_[firstAngle+l][0];
+          imp += b*A_[firstAngle+l][1];
+          imp += r*A_[firstAngle+l][2];
+
+          impedance[l]->setNextReal(imp);
+        }
       }
     }
   }
-  impedance->endAccess();
+  for(int l = 0; l < nAngles; l++)
+    impedance[l]->endAccess();
   alpha->endAccess();
   beta->endAccess();
   rho->endAccess();
-  return(impedance);
 }
 
-
 void
-Crava::computeSyntSeismic(FFTGrid * alpha, FFTGrid * beta, FFTGrid * rho)
+Crava::convolveSeismicImpedance(const std::vector<FFTGrid *> & impedance,
+                                int                            firstAngle)
 {
-  LogKit::WriteHeader("Compute Synthetic Seismic and Residuals");
-
-  bool fftDomain = alpha->getIsTransformed();
-  if(fftDomain == true) {
-    alpha->invFFTInPlace();
-    beta->invFFTInPlace();
-    rho->invFFTInPlace();
-  }
-
-  for(int l=0;l<ntheta_;l++) {
-    FFTGrid * imp = computeSeismicImpedance(alpha, beta, rho, l);
-    imp->setAccessMode(FFTGrid::RANDOMACCESS);
-    for(int i=0;i<nx_; i++) {
+  // Takes the derivative of each trace, and convolves it with the local wavelet of its angle.
+  // The traces of one row are transformed together for all the given angles, and the buffers
+  // and plans are reused for all rows. The grids must be in random access mode.
+  int           nAngles = static_cast<int>(impedance.size());
+  int           cnzp    = nzp_/2+1;
+  int           rnzp    = 2*cnzp;
+  fftw_real   * trace   = static_cast<fftw_real*>(fftw_malloc(nzp_*sizeof(fftw_real)));
+  fftw_real   * rRow    = static_cast<fftw_real*>(fftw_malloc(nAngles*ny_*rnzp*sizeof(fftw_real)));
+  fftw_complex* cRow    = reinterpret_cast<fftw_complex*>(rRow);
+  float         fac     = 1.0f/static_cast<float>(nzp_-nz_-1);
+  double        scale   = static_cast<double>(1.0/static_cast<double>(nzp_));
+
+  for(int i=0;i<nx_; i++) {
+    for(int l=0;l<nAngles;l++) {
       for(int j=0;j<ny_;j++) {
-        Wavelet1D impVec(0,nz_, nzp_);
-        //impVec.setupAsVector();
         int k;
-        for(k=0;k<nz_;k++){
-          float value = imp->getRealValue(i, j, k, true);
-          impVec.setRAmp(value, k);
-        }
+        for(k=0;k<nz_;k++)
+          trace[k] = impedance[l]->getRealValue(i, j, k, true);
         //Tapering:
-        float fac = 1.0f/static_cast<float>(nzp_-nz_-1);
-        for(;k<nzp_;k++) {
-          float value = fac*((k-nz_)*impVec.getRAmp(0)+(nzp_-k-1)*impVec.getRAmp(nz_-1));
-          impVec.setRAmp(value, k);
-        }
-        Wavelet1D resultVec(&impVec, Wavelet::FIRSTORDERFORWARDDIFF);
-        resultVec.fft1DInPlace();
+        for(;k<nzp_;k++)
+          trace[k] = fac*((k-nz_)*trace[0]+(nzp_-k-1)*trace[nz_-1]);
 
-        Wavelet1D * localWavelet = seisWavelet_[l]->createLocalWavelet1D(i,j);
+        fftw_real * rData = rRow + (l*ny_+j)*rnzp;
+        for(k=0;k<nzp_-1;k++)
+          rData[k] = trace[k+1]-trace[k];
+        rData[nzp_-1] = trace[0]-trace[nzp_-1];
+      }
+    }
+
+    FFT1D::fft(rRow, nzp_, nAngles*ny_, true);
 
-        float sf = static_cast<float>(simbox_->getRelThick(i, j))*seisWavelet_[l]->getLocalStretch(i,j);
+    for(int l=0;l<nAngles;l++) {
+      Wavelet * wavelet = seisWavelet_[firstAngle+l];
+      for(int j=0;j<ny_;j++) {
+        Wavelet1D * localWavelet = wavelet->createLocalWavelet1D(i,j);
+
+        float sf = static_cast<float>(simbox_->getRelThick(i, j))*wavelet->getLocalStretch(i,j);
 
-        for(int k=0;k<(nzp_/2 +1);k++) {
-          fftw_complex r = resultVec.getCAmp(k);
+        fftw_complex * cData = cRow + (l*ny_+j)*cnzp;
+        for(int k=0;k<cnzp;k++) {
+          fftw_complex r = cData[k];
           fftw_complex w = localWavelet->getCAmp(k,static_cast<float>(sf));// returns complex conjugate
-          fftw_complex s;
-          s.re = r.re*w.re+r.im*w.im; //Use complex conjugate of w
-          s.im = -r.re*w.im+r.im*w.re;
-          resultVec.setCAmp(s,k);
+          cData[k].re = r.re*w.re+r.im*w.im; //Use complex conjugate of w
+          cData[k].im = -r.re*w.im+r.im*w.re;
         }
         delete localWavelet;
+      }
+    }
 
-        resultVec.invFFT1DInPlace();
-        for(int k=0;k<nzp_;k++){
-          float value = resultVec.getRAmp(k);
-          imp->setRealValue(i, j, k, value, true);
-        }
+    FFT1D::fftInv(cRow, nzp_, nAngles*ny_, true);
+
+    for(int l=0;l<nAngles;l++) {
+      for(int j=0;j<ny_;j++) {
+        fftw_real * rData = rRow + (l*ny_+j)*rnzp;
+        for(int k=0;k<nzp_;k++)
+          impedance[l]->setRealValue(i, j, k, static_cast<fftw_real>(rData[k]*scale), true);
       }
     }
-    std::string angle     = NRLib::ToString(thetaDeg_[l],1);
-    std::string sgriLabel = " Synthetic seismic for incidence angle "+angle;
-    std::string fileName  = IO::PrefixSyntheticSeismicData() + angle;
-    if(((modelSettings_->getOutputGridsSeismic() & IO::SYNTHETIC_SEISMIC_DATA) > 0) ||
-      (modelSettings_->getForwardModeling() == true))
-      imp->writeFile(fileName, IO::PathToSeismicData(), simbox_,sgriLabel);
-    if((modelSettings_->getOutputGridsSeismic() & IO::SYNTHETIC_RESIDUAL) > 0) {
-      FFTGrid seis(nx_, ny_, nz_, nxp_, nyp_, nzp_);
-
-      std::string fileName = IO::makeFullFileName(IO::PathToSeismicData(), IO::FileTemporarySeismic()+NRLib::ToString(l)+IO::SuffixCrava());
-      std::string errText;
-      seis.readCravaFile(fileName, errText);
-      if(errText == "") {
-        seis.setAccessMode(FFTGrid::RANDOMACCESS);
-        for(int k=0;k<nz_;k++) {
-          for(int j=0;j<ny_;j++) {
-            for(int i=0;i<nx_;i++) {
-              float residual = seis.getRealValue(i, j, k) - imp->getRealValue(i,j,k);
-              imp->setRealValue(i, j, k, residual);
+  }
+  fftw_free(trace);
+  fftw_free(rRow);
+}
+
+
+void
+Crava::computeSyntSeismic(FFTGrid * alpha, FFTGrid * beta, FFTGrid * rho)
+{
+  LogKit::WriteHeader("Compute Synthetic Seismic and Residuals");
+
+  bool fftDomain = alpha->getIsTransformed();
+  if(fftDomain == true) {
+    alpha->invFFTInPlace();
+    beta->invFFTInPlace();
+    rho->invFFTInPlace();
+  }
+
+  // The angles are made together, in one grid each, with one pass over alpha, beta and rho and
+  // one transform of each row of traces. The number of angles in a pass is bounded by the grids
+  // allowed by the memory estimate, and with a single free grid each angle has its own pass.
+  int maxGrids = std::max(1, std::min(ntheta_, FFTGrid::getMaxAllowedGrids() - FFTGrid::getNumberOfGrids()));
+
+  for(int first=0;first<ntheta_;first+=maxGrids) {
+    int nAngles = std::min(maxGrids, ntheta_-first);
+    std::vector<FFTGrid *> imp(nAngles);
+    for(int l=0;l<nAngles;l++) {
+      imp[l] = createFFTGrid();
+      imp[l]->setType(FFTGrid::DATA);
+      imp[l]->createRealGrid();
+    }
+
+    computeSeismicImpedance(alpha, beta, rho, imp, first);
+    for(int l=0;l<nAngles;l++)
+      imp[l]->setAccessMode(FFTGrid::RANDOMACCESS);
+    convolveSeismicImpedance(imp, first);
+
+    for(int l=0;l<nAngles;l++) {
+      std::string angle     = NRLib::ToString(thetaDeg_[first+l],1);
+      std::string sgriLabel = " Synthetic seismic for incidence angle "+angle;
+      std::string fileName  = IO::PrefixSyntheticSeismicData() + angle;
+      if(((modelSettings_->getOutputGridsSeismic() & IO::SYNTHETIC_SEISMIC_DATA) > 0) ||
+        (modelSettings_->getForwardModeling() == true))
+        imp[l]->writeFile(fileName, IO::PathToSeismicData(), simbox_,sgriLabel);
+      if((modelSettings_->getOutputGridsSeismic() & IO::SYNTHETIC_RESIDUAL) > 0) {
+        FFTGrid seis(nx_, ny_, nz_, nxp_, nyp_, nzp_);
+
+        std::string fileName = IO::makeFullFileName(IO::PathToSeismicData(), IO::FileTemporarySeismic()+NRLib::ToString(first+l)+IO::SuffixCrava());
+        std::string errText;
+        seis.readCravaFile(fileName, errText);
+        if(errText == "") {
+          seis.setAccessMode(FFTGrid::RANDOMACCESS);
+          for(int k=0;k<nz_;k++) {
+            for(int j=0;j<ny_;j++) {
+              for(int i=0;i<nx_;i++) {
+                float residual = seis.getRealValue(i, j, k) - imp[l]->getRealValue(i,j,k);
+                imp[l]->setRealValue(i, j, k, residual);
+              }
             }
           }
+          sgriLabel = "Residual computed from synthetic seismic for incidence angle "+angle;
+          fileName = IO::PrefixSyntheticResiduals() + angle;
+          imp[l]->writeFile(fileName, IO::PathToSeismicData(), simbox_,sgriLabel);
+        }
+        else {
+          errText += "\nFailed to read temporary stored seismic data.\n";
+          LogKit::LogMessage(LogKit::Error,errText);
         }
-        sgriLabel = "Residual computed from synthetic seismic for incidence angle "+angle;
-        fileName = IO::PrefixSyntheticResiduals() + angle;
-        imp->writeFile(fileName, IO::PathToSeismicData(), simbox_,sgriLabel);
-      }
-      else {
-        errText += "\nFailed to read temporary stored seismic data.\n";
-        LogKit::LogMessage(LogKit::Error,errText);
       }
+      imp[l]->endAccess();
+      delete imp[l];
     }
-    delete imp;
   }
 
   if(fftDomain == true) {
@@ -2047,10 +2232,12 @@ Crava::computeFaciesProb(SpatialWellFilter             * filteredlogs,
       for(int i=0;i<nfac;i++)
       {
         FFTGrid * grid = fprob_->getFaciesProb(i);
+        grid->setAllowLossyCrava(true);
         std::string fileName = baseName +"With_Undef_"+ facies_names[i];
         ParameterOutput::writeToFile(simbox_, modelGeneral_, modelSettings_, grid, fileName,"");
       }
       FFTGrid * grid = fprob_->getFaciesProbUndef();
+      grid->setAllowLossyCrava(true);
       std::string fileName = baseName + "Undef";
       ParameterOutput::writeToFile(simbox_, modelGeneral_, modelSettings_, grid, fileName,"");
     }
@@ -2062,6 +2249,7 @@ Crava::computeFaciesProb(SpatialWellFilter             * filteredlogs,
       for(int i=0;i<nfac;i++)
       {
         FFTGrid * grid = fprob_->getFaciesProb(i);
+        grid->setAllowLossyCrava(true);
         std::string fileName = baseName + facies_names[i];
         ParameterOutput::writeToFile(simbox_, modelGeneral_, modelSettings_, grid, fileName,"");
       }
@@ -2078,6 +2266,7 @@ Crava::computeFaciesProb(SpatialWellFilter             * filteredlogs,
       for(int i=0;i<nfac;i++) {
         FFTGrid * grid = fprob_->createLHCube(likelihood, i,
                                               modelGeneral_->getPriorFacies(), modelGeneral_->getPriorFaciesCubes());
+        grid->setAllowLossyCrava(true);
         std::string fileName = IO::PrefixLikelihood() + facies_names[i];
         ParameterOutput::writeToFile(simbox_, modelGeneral_, modelSettings_, grid,fileName,"");
         delete grid;
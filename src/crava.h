@@ -77,6 +77,11 @@ private:
   float                  getErrorVariance(int l)  const { return errorVariance_[l]  ;}
   float                  getDataVariance(int l)   const { return dataVariance_[l]   ;}
   int                simulate(SeismicParametersHolder & seismicParameters, RandomGen * randomGen );
+  void               simulateRealizations(SeismicParametersHolder & seismicParameters,
+                                          RandomGen               * randomGen,
+                                          FFTGrid                 * seed0,
+                                          FFTGrid                 * seed1,
+                                          FFTGrid                 * seed2);
   int                computePostMeanResidAndFFTCov(ModelGeneral * modelGeneral);
   void               printEnergyToScreen();
   void               computeSyntSeismic(FFTGrid * alpha, FFTGrid * beta, FFTGrid * rho);
@@ -124,10 +129,14 @@ private:
 
   void                   correctAlphaBetaRho(ModelSettings * modelSettings);
 
-  FFTGrid *              computeSeismicImpedance(FFTGrid * alpha,
-                                                 FFTGrid * beta,
-                                                 FFTGrid * rho,
-                                                 int angle);
+  void                   computeSeismicImpedance(FFTGrid                      * alpha,
+                                                 FFTGrid                      * beta,
+                                                 FFTGrid                      * rho,
+                                                 const std::vector<FFTGrid *> & impedance,
+                                                 int                            firstAngle);
+
+  void                   convolveSeismicImpedance(const std::vector<FFTGrid *> & impedance,
+                                                  int                            firstAngle);
 
   std::complex<double>   SetComplexNumber(const fftw_complex & c);
 
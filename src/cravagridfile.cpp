@@ -0,0 +1,413 @@
+/***************************************************************************
+*      Copyright (C) 2008 by Norwegian Computing Center and Statoil        *
+***************************************************************************/
+
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+#include "nrlib/exception/exception.hpp"
+#include "nrlib/iotools/fileio.hpp"
+
+#include "src/cravagridfile.h"
+#include "src/definitions.h"
+
+namespace {
+  const int TileSize = 64;   // Tiles are at most 64^3 values, or 1MB uncompressed
+}
+
+CravaGridFile::CravaGridFile(const std::string & fileName)
+  : tiled_(false),
+    tileSize_(0),
+    ntx_(0),
+    nty_(0),
+    ntz_(0),
+    errorBound_(0.0f)
+{
+  NRLib::OpenRead(file_, fileName, std::ios::in | std::ios::binary);
+
+  std::string fileType;
+  getline(file_, fileType);
+  tiled_ = (fileType == tiledLabel());
+
+  // Simbox geometry, used by ModelGeneral::geometryFromCravaFile()
+  for (int i = 0 ; i < 4 ; i++)
+    NRLib::ReadBinaryDouble(file_);
+  NRLib::ReadBinaryInt(file_);
+  NRLib::ReadBinaryInt(file_);
+  for (int i = 0 ; i < 7 ; i++)
+    NRLib::ReadBinaryDouble(file_);
+
+  rnxp_ = NRLib::ReadBinaryInt(file_);
+  nyp_  = NRLib::ReadBinaryInt(file_);
+  nzp_  = NRLib::ReadBinaryInt(file_);
+
+  if (tiled_) {
+    tileSize_   = NRLib::ReadBinaryInt(file_);
+    errorBound_ = NRLib::ReadBinaryFloat(file_);
+    int nTiles  = NRLib::ReadBinaryInt(file_);
+    if (tileSize_ <= 0)
+      throw NRLib::Exception("Invalid tile size in crava grid file '"+fileName+"'.");
+
+    ntx_ = (rnxp_ + tileSize_ - 1)/tileSize_;
+    nty_ = (nyp_  + tileSize_ - 1)/tileSize_;
+    ntz_ = (nzp_  + tileSize_ - 1)/tileSize_;
+    if (nTiles != ntx_*nty_*ntz_)
+      throw NRLib::Exception("Tile index does not match the grid dimensions in crava grid file '"+fileName+"'.");
+
+    std::vector<int> sizes(nTiles);
+    NRLib::ReadBinaryIntArray(file_, sizes.begin(), nTiles);
+    tileOffsets_.resize(nTiles + 1);
+    tileOffsets_[0] = 0;
+    for (int t = 0 ; t < nTiles ; t++)
+      tileOffsets_[t+1] = tileOffsets_[t] + sizes[t];
+  }
+  dataStart_ = file_.tellg();
+}
+
+CravaGridFile::~CravaGridFile()
+{
+  file_.close();
+}
+
+void
+CravaGridFile::readSubVolume(int     i0,
+                             int     j0,
+                             int     k0,
+                             int     ni,
+                             int     nj,
+                             int     nk,
+                             float * values)
+{
+  if (i0 < 0 || j0 < 0 || k0 < 0 || ni < 0 || nj < 0 || nk < 0 ||
+      i0 + ni > rnxp_ || j0 + nj > nyp_ || k0 + nk > nzp_)
+    throw NRLib::Exception("Trying to read a sub-volume outside the grid in a crava grid file.");
+  if (ni == 0 || nj == 0 || nk == 0)
+    return;
+
+  if (tiled_ == false) {
+    // Full rows are contiguous on file, and are read in one piece for each layer.
+    int nRows = (ni == rnxp_ ? 1  : nj);
+    int nRead = (ni == rnxp_ ? ni*nj : ni);
+    for (int k = 0 ; k < nk ; k++) {
+      for (int j = 0 ; j < nRows ; j++) {
+        long long first = i0 + static_cast<long long>(rnxp_)*(j0 + j + static_cast<long long>(nyp_)*(k0 + k));
+        file_.seekg(dataStart_ + static_cast<std::streamoff>(4*first));
+        NRLib::ReadBinaryFloatArray(file_, values + static_cast<size_t>(ni)*(j + static_cast<size_t>(nj)*k), nRead);
+      }
+    }
+    return;
+  }
+
+  std::vector<float> tile;
+  for (int tk = k0/tileSize_ ; tk <= (k0 + nk - 1)/tileSize_ ; tk++) {
+    for (int tj = j0/tileSize_ ; tj <= (j0 + nj - 1)/tileSize_ ; tj++) {
+      for (int ti = i0/tileSize_ ; ti <= (i0 + ni - 1)/tileSize_ ; ti++) {
+        int ti0 = ti*tileSize_;
+        int tj0 = tj*tileSize_;
+        int tk0 = tk*tileSize_;
+        int tnx = std::min(tileSize_, rnxp_ - ti0);
+        int tny = std::min(tileSize_, nyp_  - tj0);
+        int tnz = std::min(tileSize_, nzp_  - tk0);
+        tile.resize(static_cast<size_t>(tnx)*tny*tnz);
+        readTile(ti + ntx_*(tj + nty_*tk), tile);
+
+        int iMin = std::max(i0, ti0);
+        int iMax = std::min(i0 + ni, ti0 + tnx);
+        int jMin = std::max(j0, tj0);
+        int jMax = std::min(j0 + nj, tj0 + tny);
+        int kMin = std::max(k0, tk0);
+        int kMax = std::min(k0 + nk, tk0 + tnz);
+        for (int k = kMin ; k < kMax ; k++) {
+          for (int j = jMin ; j < jMax ; j++) {
+            const float * from = &tile[(iMin - ti0) + tnx*((j - tj0) + static_cast<size_t>(tny)*(k - tk0))];
+            float       * to   = values + (iMin - i0) + static_cast<size_t>(ni)*((j - j0) + static_cast<size_t>(nj)*(k - k0));
+            for (int i = 0 ; i < iMax - iMin ; i++)
+              to[i] = from[i];
+          }
+        }
+      }
+    }
+  }
+}
+
+void
+CravaGridFile::writeTiles(std::ofstream & file,
+                          const float   * values,
+                          int             rnxp,
+                          int             nyp,
+                          int             nzp,
+                          float           errorBound)
+{
+  int ntx    = (rnxp + TileSize - 1)/TileSize;
+  int nty    = (nyp  + TileSize - 1)/TileSize;
+  int ntz    = (nzp  + TileSize - 1)/TileSize;
+  int nTiles = ntx*nty*ntz;
+
+  NRLib::WriteBinaryInt(file, TileSize);
+  NRLib::WriteBinaryFloat(file, errorBound);
+  NRLib::WriteBinaryInt(file, nTiles);
+
+  // The index is written with the tile sizes when all tiles are compressed.
+  std::vector<int> sizes(nTiles, 0);
+  std::streampos indexStart = file.tellp();
+  NRLib::WriteBinaryIntArray(file, sizes.begin(), sizes.end());
+
+  std::vector<float>         tileValues;
+  std::vector<unsigned char> tile;
+  for (int tk = 0 ; tk < ntz ; tk++) {
+    for (int tj = 0 ; tj < nty ; tj++) {
+      for (int ti = 0 ; ti < ntx ; ti++) {
+        int ti0 = ti*TileSize;
+        int tj0 = tj*TileSize;
+        int tk0 = tk*TileSize;
+        int tnx = std::min(TileSize, rnxp - ti0);
+        int tny = std::min(TileSize, nyp  - tj0);
+        int tnz = std::min(TileSize, nzp  - tk0);
+        tileValues.resize(static_cast<size_t>(tnx)*tny*tnz);
+        size_t n = 0;
+        for (int k = tk0 ; k < tk0 + tnz ; k++) {
+          for (int j = tj0 ; j < tj0 + tny ; j++) {
+            const float * row = values + static_cast<size_t>(rnxp)*(j + static_cast<size_t>(nyp)*k);
+            for (int i = ti0 ; i < ti0 + tnx ; i++)
+              tileValues[n++] = row[i];
+          }
+        }
+        encodeTile(tileValues, errorBound, tile);
+
+        if (!file.write(reinterpret_cast<const char *>(&tile[0]), static_cast<std::streamsize>(tile.size())))
+          throw NRLib::Exception("Error writing tile to crava grid file.");
+        sizes[ti + ntx*(tj + nty*tk)] = static_cast<int>(tile.size());
+      }
+    }
+  }
+
+  std::streampos end = file.tellp();
+  file.seekp(indexStart);
+  NRLib::WriteBinaryIntArray(file, sizes.begin(), sizes.end());
+  file.seekp(end);
+}
+
+void
+CravaGridFile::readTile(int tileIndex, std::vector<float> & values)
+{
+  size_t size = static_cast<size_t>(tileOffsets_[tileIndex+1] - tileOffsets_[tileIndex]);
+  std::vector<unsigned char> tile(size);
+  file_.seekg(dataStart_ + static_cast<std::streamoff>(tileOffsets_[tileIndex]));
+  if (size == 0 || !file_.read(reinterpret_cast<char *>(&tile[0]), static_cast<std::streamsize>(size)))
+    throw NRLib::Exception("Error reading tile from crava grid file.");
+  decodeTile(tile, errorBound_, values);
+}
+
+void
+CravaGridFile::encodeTile(const std::vector<float>   & values,
+                          float                        errorBound,
+                          std::vector<unsigned char> & tile)
+{
+  size_t n    = values.size();
+  int    mode = 0;
+  std::vector<unsigned int> words(n);
+
+  if (errorBound > 0.0f) {
+    // Quantized values must fit in an int, and missing values are kept exact.
+    double step     = 2.0*errorBound;
+    bool   quantize = true;
+    for (size_t i = 0 ; i < n && quantize ; i++)
+      quantize = (values[i] != RMISSING && fabs(values[i]/step) < 5.0e8);
+
+    if (quantize) {
+      mode = QUANTIZED;
+      int previous = 0;
+      for (size_t i = 0 ; i < n ; i++) {
+        int q    = static_cast<int>(floor(values[i]/step + 0.5));
+        int diff = q - previous;
+        previous = q;
+        // Zigzag coding, so that small differences of either sign have small codes
+        words[i] = (diff < 0 ? ~(static_cast<unsigned int>(diff) << 1) : static_cast<unsigned int>(diff) << 1);
+      }
+    }
+  }
+  if (mode == 0)
+    memcpy(&words[0], &values[0], n*sizeof(float));
+
+  std::vector<unsigned char> shuffled(4*n);
+  for (size_t i = 0 ; i < n ; i++) {
+    shuffled[i]       = static_cast<unsigned char>(words[i] >> 24);
+    shuffled[n + i]   = static_cast<unsigned char>(words[i] >> 16);
+    shuffled[2*n + i] = static_cast<unsigned char>(words[i] >> 8);
+    shuffled[3*n + i] = static_cast<unsigned char>(words[i]);
+  }
+
+  std::vector<unsigned char> packed;
+  compress(shuffled, packed);
+
+  tile.clear();
+  if (packed.size() < shuffled.size()) {
+    tile.push_back(static_cast<unsigned char>(mode | LZ));
+    tile.insert(tile.end(), packed.begin(), packed.end());
+  }
+  else {
+    tile.push_back(static_cast<unsigned char>(mode));
+    tile.insert(tile.end(), shuffled.begin(), shuffled.end());
+  }
+}
+
+void
+CravaGridFile::decodeTile(const std::vector<unsigned char> & tile,
+                          float                              errorBound,
+                          std::vector<float>               & values)
+{
+  size_t n    = values.size();
+  int    mode = tile[0];
+
+  std::vector<unsigned char> shuffled;
+  shuffled.reserve(4*n);
+  if ((mode & LZ) > 0) {
+    if (decompress(&tile[1], tile.size() - 1, shuffled) == false)
+      shuffled.clear();
+  }
+  else
+    shuffled.assign(tile.begin() + 1, tile.end());
+
+  if (shuffled.size() != 4*n)
+    throw NRLib::Exception("Corrupt tile in crava grid file.");
+
+  std::vector<unsigned int> words(n);
+  for (size_t i = 0 ; i < n ; i++) {
+    words[i] = (static_cast<unsigned int>(shuffled[i])       << 24) |
+               (static_cast<unsigned int>(shuffled[n + i])   << 16) |
+               (static_cast<unsigned int>(shuffled[2*n + i]) <<  8) |
+                static_cast<unsigned int>(shuffled[3*n + i]);
+  }
+
+  if ((mode & QUANTIZED) > 0) {
+    double step = 2.0*errorBound;
+    int    q    = 0;
+    for (size_t i = 0 ; i < n ; i++) {
+      q += ((words[i] & 1) > 0 ? -static_cast<int>(words[i] >> 1) - 1 : static_cast<int>(words[i] >> 1));
+      values[i] = static_cast<float>(q*step);
+    }
+  }
+  else
+    memcpy(&values[0], &words[0], n*sizeof(float));
+}
+
+void
+CravaGridFile::compress(const std::vector<unsigned char> & in,
+                        std::vector<unsigned char>       & out)
+{
+  // LZ77 with a hash table of four byte sequences. The output is a list of sequences, each
+  // with a token (literal count and match length in four bits each), extra length bytes
+  // when the count is 15 or more, the literals, and a two byte match offset. The last
+  // sequence has literals only.
+  const int        hashBits = 14;
+  std::vector<int> table(1 << hashBits, -1);
+  size_t           n        = in.size();
+  size_t           anchor   = 0;
+  size_t           i        = 0;
+
+  out.clear();
+  while (i + 4 <= n) {
+    unsigned int word = static_cast<unsigned int>(in[i])             | (static_cast<unsigned int>(in[i+1]) << 8) |
+                        (static_cast<unsigned int>(in[i+2]) << 16) | (static_cast<unsigned int>(in[i+3]) << 24);
+    unsigned int hash = (word*2654435761u) >> (32 - hashBits);
+    int candidate     = table[hash];
+    table[hash]       = static_cast<int>(i);
+
+    if (candidate >= 0 && i - candidate <= 65535 && memcmp(&in[candidate], &in[i], 4) == 0) {
+      size_t length = 4;
+      while (i + length < n && in[candidate + length] == in[i + length])
+        length++;
+
+      size_t nLiterals = i - anchor;
+      size_t litCode   = std::min(nLiterals, static_cast<size_t>(15));
+      size_t matchCode = std::min(length - 4, static_cast<size_t>(15));
+      out.push_back(static_cast<unsigned char>((litCode << 4) | matchCode));
+      if (litCode == 15) {
+        size_t rest = nLiterals - 15;
+        for (; rest >= 255 ; rest -= 255)
+          out.push_back(255);
+        out.push_back(static_cast<unsigned char>(rest));
+      }
+      out.insert(out.end(), in.begin() + anchor, in.begin() + i);
+
+      size_t offset = i - candidate;
+      out.push_back(static_cast<unsigned char>(offset & 255));
+      out.push_back(static_cast<unsigned char>(offset >> 8));
+      if (matchCode == 15) {
+        size_t rest = length - 19;
+        for (; rest >= 255 ; rest -= 255)
+          out.push_back(255);
+        out.push_back(static_cast<unsigned char>(rest));
+      }
+      i     += length;
+      anchor = i;
+    }
+    else
+      i++;
+  }
+
+  size_t nLiterals = n - anchor;
+  size_t litCode   = std::min(nLiterals, static_cast<size_t>(15));
+  out.push_back(static_cast<unsigned char>(litCode << 4));
+  if (litCode == 15) {
+    size_t rest = nLiterals - 15;
+    for (; rest >= 255 ; rest -= 255)
+      out.push_back(255);
+    out.push_back(static_cast<unsigned char>(rest));
+  }
+  out.insert(out.end(), in.begin() + anchor, in.end());
+}
+
+bool
+CravaGridFile::decompress(const unsigned char        * in,
+                          size_t                       inSize,
+                          std::vector<unsigned char> & out)
+{
+  size_t ip = 0;
+  while (ip < inSize) {
+    unsigned int token     = in[ip++];
+    size_t       nLiterals = token >> 4;
+    if (nLiterals == 15) {
+      unsigned char extra = 255;
+      while (extra == 255) {
+        if (ip >= inSize)
+          return(false);
+        extra      = in[ip++];
+        nLiterals += extra;
+      }
+    }
+    if (ip + nLiterals > inSize)
+      return(false);
+    out.insert(out.end(), in + ip, in + ip + nLiterals);
+    ip += nLiterals;
+
+    if (ip == inSize)       // The last sequence has literals only
+      break;
+
+    if (ip + 2 > inSize)
+      return(false);
+    size_t offset = static_cast<size_t>(in[ip]) | (static_cast<size_t>(in[ip+1]) << 8);
+    ip += 2;
+    size_t length = (token & 15) + 4;
+    if ((token & 15) == 15) {
+      unsigned char extra = 255;
+      while (extra == 255) {
+        if (ip >= inSize)
+          return(false);
+        extra   = in[ip++];
+        length += extra;
+      }
+    }
+    if (offset == 0 || offset > out.size())
+      return(false);
+
+    // The match may overlap the bytes it produces, so it is copied one byte at a time.
+    size_t from = out.size() - offset;
+    for (size_t m = 0 ; m < length ; m++) {
+      unsigned char c = out[from + m];
+      out.push_back(c);
+    }
+  }
+  return(true);
+}
@@ -0,0 +1,91 @@
+/***************************************************************************
+*      Copyright (C) 2008 by Norwegian Computing Center and Statoil        *
+***************************************************************************/
+
+#ifndef CRAVAGRIDFILE_H
+#define CRAVAGRIDFILE_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Values of an FFTGrid in the crava binary format. Both versions of the format start with a
+// label line, the simbox geometry and the padded grid dimensions, as written by
+// FFTGrid::writeCravaFile().
+//
+// In the original format ("crava_fftgrid_binary") the padded real grid follows as raw floats.
+// In the tiled format ("crava_fftgrid_binary_tiled") the grid is split into tiles of
+// tileSize^3 values, and each tile is compressed on its own. An index of the compressed tile
+// sizes precedes the tiles, so that a sub-volume can be read without reading the whole file.
+//
+// A tile is byte shuffled (all most significant bytes first, and so on) and LZ compressed.
+// With a positive error bound, tiles are first quantized to a step of twice the bound, and
+// the differences between neighbouring values are stored. The error is then bounded by
+// errorBound (plus float rounding). Tiles with missing values are always stored lossless.
+class CravaGridFile
+{
+public:
+  // Opens a file in either format and reads the grid dimensions and the tile index.
+  CravaGridFile(const std::string & fileName);
+  ~CravaGridFile();
+
+  int                      getRNxp()   const { return rnxp_  ;}
+  int                      getNyp()    const { return nyp_   ;}
+  int                      getNzp()    const { return nzp_   ;}
+  bool                     isTiled()   const { return tiled_ ;}
+
+  // Reads the values with i0 <= i < i0+ni, j0 <= j < j0+nj and k0 <= k < k0+nk into
+  // values, with i running fastest. Only the tiles covering the sub-volume are read.
+  void                     readSubVolume(int     i0,
+                                         int     j0,
+                                         int     k0,
+                                         int     ni,
+                                         int     nj,
+                                         int     nk,
+                                         float * values);
+
+  // Writes the tile index and the tiles of a padded real grid. The header is written by the caller.
+  static void              writeTiles(std::ofstream & file,
+                                      const float   * values,
+                                      int             rnxp,
+                                      int             nyp,
+                                      int             nzp,
+                                      float           errorBound);
+
+  static std::string       tiledLabel()      { return "crava_fftgrid_binary_tiled" ;}
+
+private:
+  enum                     tileModes{LZ = 1, QUANTIZED = 2};
+
+  void                     readTile(int tileIndex, std::vector<float> & values);
+
+  static void              encodeTile(const std::vector<float>   & values,
+                                      float                        errorBound,
+                                      std::vector<unsigned char> & tile);
+
+  static void              decodeTile(const std::vector<unsigned char> & tile,
+                                      float                              errorBound,
+                                      std::vector<float>               & values);
+
+  static void              compress(const std::vector<unsigned char> & in,
+                                    std::vector<unsigned char>       & out);
+
+  static bool              decompress(const unsigned char        * in,
+                                      size_t                       inSize,
+                                      std::vector<unsigned char> & out);
+
+  std::ifstream            file_;
+  bool                     tiled_;
+  int                      rnxp_;
+  int                      nyp_;
+  int                      nzp_;
+  int                      tileSize_;
+  int                      ntx_;              // Number of tiles in each direction
+  int                      nty_;
+  int                      ntz_;
+  float                    errorBound_;
+  std::streampos           dataStart_;        // Position of the first value (original format) or tile
+  std::vector<long long>   tileOffsets_;      // Offsets of the tiles from dataStart_, with the end as last element
+};
+
+#endif
@@ -4,8 +4,11 @@
 #include "src/modelgeneral.h"
 #include "src/inputfiles.h"
 #include "src/fftgrid.h"
+#include "src/gridreadqueue.h"
 
 #include <string.h>
+#include <assert.h>
+#include <algorithm>
 
 CravaTrend::CravaTrend()
 {
@@ -39,34 +42,42 @@ CravaTrend::CravaTrend(Simbox                       * timeSimbox,
     const int nzp  = nz;
     const int rnxp = 2*(nxp/2 + 1);
 
+    // The cubes given on file are read concurrently
+    GridReadQueue                     readQueue(modelSettings);
+    std::vector<FFTGrid *>            file_cubes(n_trend_cubes_, NULL);
+    std::vector<std::string>          file_errors(n_trend_cubes_, "");
+    std::vector<const SegyGeometry *> dummy1(n_trend_cubes_, NULL);
+    const TraceHeaderFormat         * dummy2 = NULL;
+    const float                       offset = modelSettings->getSegyOffset(0); //Facies estimation only allowed for one time lapse
+
+    for(int grid_number=0; grid_number<n_trend_cubes_; grid_number++) {
+      if(trend_cube_type[grid_number] == ModelSettings::CUBE_FROM_FILE) {
+        trendCubeNames[grid_number] = inputFiles->getTrendCube(grid_number);
+        readQueue.addFile(trendCubeNames[grid_number],
+                          "trend cube '"+trend_cube_parameters[grid_number]+"'",
+                          offset,
+                          file_cubes[grid_number],
+                          dummy1[grid_number],
+                          dummy2,
+                          FFTGrid::PARAMETER,
+                          timeSimbox,
+                          timeCutSimbox,
+                          file_errors[grid_number],
+                          true);
+      }
+    }
+    readQueue.readAll();
+
     for(int grid_number=0; grid_number<n_trend_cubes_; grid_number++) {
 
       FFTGrid * trend_cube = NULL;
 
-      const std::string   log_name   = "trend cube '"+trend_cube_parameters[grid_number]+"'";
-
       if(trend_cube_type[grid_number] == ModelSettings::CUBE_FROM_FILE) {
 
-        trendCubeNames[grid_number] = inputFiles->getTrendCube(grid_number);
+        trend_cube = file_cubes[grid_number];
 
-        const SegyGeometry      * dummy1     = NULL;
-        const TraceHeaderFormat * dummy2     = NULL;
-        const float               offset     = modelSettings->getSegyOffset(0); //Facies estimation only allowed for one time lapse
-
-        ModelGeneral::readGridFromFile(trendCubeNames[grid_number],
-                                       log_name,
-                                       offset,
-                                       trend_cube,
-                                       dummy1,
-                                       dummy2,
-                                       FFTGrid::PARAMETER,
-                                       timeSimbox,
-                                       timeCutSimbox,
-                                       modelSettings,
-                                       errorText,
-                                       true);
-
-        if(errorText != "") {
+        if(file_errors[grid_number] != "") {
+          errorText += file_errors[grid_number];
           errorText += "Reading of file \'"+trendCubeNames[grid_number]+"\' failed\n";
           errTxt    += errorText;
           failed     = true;
@@ -183,6 +194,33 @@ CravaTrend::GetTrendPosition(const int & i,
   return trend_cube_values;
 }
 
+void
+CravaTrend::GetTrendPositionsInLayer(const int           & k,
+                                     std::vector<double> & s0,
+                                     std::vector<double> & s1) const
+{
+  // Same as GetTrendPosition(), but for all (i,j) in layer k at once. The positions
+  // are stored with i running fastest, and s0 and s1 must be sized to one layer.
+
+  const size_t n = s0.size();
+
+  assert(s1.size() == n);
+
+  std::vector<double> * s[2] = {&s0, &s1};
+
+  for(int m=0; m<2; m++) {
+    std::vector<double> & sm = *s[m];
+    if(m < n_trend_cubes_) {
+      const double   s_min  = trend_cube_sampling_[m][0];
+      const double * values = &trend_cubes_[m](trend_cubes_[m].GetIndex(0, 0, k));
+      for(size_t c=0; c<n; c++)
+        sm[c] = values[c] - s_min;
+    }
+    else
+      std::fill(sm.begin(), sm.end(), RMISSING);
+  }
+}
+
 std::vector<int>
 CravaTrend::GetSizeTrendCubes() const
 {
@@ -30,6 +30,10 @@ public:
                                                                 const int & j,
                                                                 const int & k) const;
 
+  void                                         GetTrendPositionsInLayer(const int           & k,
+                                                                        std::vector<double> & s0,
+                                                                        std::vector<double> & s1) const;
+
   const std::vector<std::vector<double> >    & GetTrendCubeSampling()          const   { return trend_cube_sampling_;}
 
 private:
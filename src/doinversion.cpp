@@ -15,6 +15,11 @@
 #include "src/seismicparametersholder.h"
 #include "src/simbox.h"
 #include "src/gravimetricinversion.h"
+#include "src/timeline.h"
+#include "src/timelapsecheckpoint.h"
+
+#include "nrlib/iotools/logkit.hpp"
+#include "nrlib/iotools/stringtools.hpp"
 
 void setupStaticModels(ModelGeneral            *& modelGeneral,
                        ModelAVOStatic          *& modelAVOstatic,
@@ -193,3 +198,125 @@ doTimeLapseGravimetricInversion(ModelSettings           * modelSettings,
 
   return(failedLoadingModel);
 }
+
+bool
+doTimeLapseEvent(ModelSettings           * modelSettings,
+                 ModelGeneral            * modelGeneral,
+                 ModelAVOStatic          * modelAVOstatic,
+                 ModelTravelTimeStatic   * modelTravelTimeStatic,
+                 ModelGravityStatic      * modelGravityStatic,
+                 InputFiles              * inputFiles,
+                 SeismicParametersHolder & seismicParameters,
+                 int                       eventType,
+                 int                       vintage,
+                 double                    time)
+{
+  modelGeneral->advanceTime(vintage - 1,
+                            time,
+                            seismicParameters,
+                            modelSettings);
+
+  bool failed;
+
+  switch(eventType) {
+
+  case TimeLine::AVO :
+    failed = doTimeLapseAVOInversion(modelSettings,
+                                     modelGeneral,
+                                     modelAVOstatic,
+                                     inputFiles,
+                                     seismicParameters,
+                                     vintage);
+    break;
+
+  case TimeLine::TRAVEL_TIME :
+    failed = doTimeLapseTravelTimeInversion(modelSettings,
+                                            modelGeneral,
+                                            modelTravelTimeStatic,
+                                            inputFiles,
+                                            vintage,
+                                            seismicParameters);
+    break;
+
+  case TimeLine::GRAVITY :
+    failed = doTimeLapseGravimetricInversion(modelSettings,
+                                             modelGeneral,
+                                             modelGravityStatic,
+                                             inputFiles,
+                                             vintage,
+                                             seismicParameters);
+    break;
+
+  default :
+    failed = true;
+    break;
+  }
+
+  return(failed);
+}
+
+bool
+resumeTimeLapseInversion(ModelSettings           * modelSettings,
+                         ModelGeneral            * modelGeneral,
+                         SeismicParametersHolder & seismicParameters,
+                         int                     & nEventsDone)
+{
+  LogKit::WriteHeader("Resuming time lapse inversion");
+
+  // Find the events before the first event of the vintage to resume from.
+  // The checkpoint of the vintage of the last of these holds the state to resume from.
+  TimeLine * timeLine      = modelGeneral->getTimeLine();
+  int        resumeVintage = modelSettings->getTimeLapseResumeVintage() - 1;
+  int        lastVintage   = -1;
+  int        nEventsBefore = 0;
+  bool       found         = false;
+  int        eventType;
+  int        vintage;
+  double     time;
+
+  timeLine->ReSet();
+  while (found == false && timeLine->GetNextEvent(eventType, vintage, time) == true) {
+    if (vintage == resumeVintage)
+      found = true;
+    else {
+      lastVintage = vintage;
+      nEventsBefore++;
+    }
+  }
+
+  std::string errTxt;
+  if (found == false)
+    errTxt += "There are no events for vintage "+NRLib::ToString(resumeVintage+1)+" in the time line.\n";
+  else if (lastVintage < 0)
+    errTxt += "Vintage "+NRLib::ToString(resumeVintage+1)+" holds the first event of the time line, so there is nothing to resume from.\n";
+  else {
+    LogKit::LogFormatted(LogKit::Low,"\nReading the state after vintage %d from file %s\n",
+                         lastVintage+1, TimeLapseCheckpoint::makeFileName(lastVintage).c_str());
+
+    TimeLapseCheckpoint::readFile(lastVintage,
+                                  modelGeneral,
+                                  seismicParameters,
+                                  modelSettings,
+                                  nEventsDone,
+                                  errTxt);
+
+    if (errTxt == "" && nEventsDone != nEventsBefore)
+      errTxt += "The checkpoint of vintage "+NRLib::ToString(lastVintage+1)+" was written after "+NRLib::ToString(nEventsDone)
+               +" events, but the time line has "+NRLib::ToString(nEventsBefore)+" events before vintage "+NRLib::ToString(resumeVintage+1)+".\n";
+  }
+
+  // Leave the time line at the first event of the vintage to resume from.
+  timeLine->ReSet();
+  for (int i = 0; i < nEventsBefore; i++)
+    timeLine->GetNextEvent(eventType, vintage, time);
+
+  if (errTxt != "") {
+    LogKit::LogMessage(LogKit::Error, "\n"+errTxt);
+    LogKit::LogFormatted(LogKit::Error,"\nAborting\n");
+    return(true);
+  }
+
+  LogKit::LogFormatted(LogKit::Low,"\nSkipping the %d first events of the time line.\n", nEventsBefore);
+
+  return(false);
+}
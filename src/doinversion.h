@@ -52,5 +52,21 @@ bool doTimeLapseGravimetricInversion(ModelSettings           * modelSettings,
                                      int                     & vintage,
                                      SeismicParametersHolder & seismicParameters);
 
+bool doTimeLapseEvent(ModelSettings           * modelSettings,
+                      ModelGeneral            * modelGeneral,
+                      ModelAVOStatic          * modelAVOstatic,
+                      ModelTravelTimeStatic   * modelTravelTimeStatic,
+                      ModelGravityStatic      * modelGravityStatic,
+                      InputFiles              * inputFiles,
+                      SeismicParametersHolder & seismicParameters,
+                      int                       eventType,
+                      int                       vintage,
+                      double                    time);
+
+bool resumeTimeLapseInversion(ModelSettings           * modelSettings,
+                              ModelGeneral            * modelGeneral,
+                              SeismicParametersHolder & seismicParameters,
+                              int                     & nEventsDone);
+
 #endif
 
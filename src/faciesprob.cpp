@@ -1940,23 +1940,13 @@ void FaciesProb::calculateFaciesProb(FFTGrid
   nz   = alphagrid->getNz();
 
   faciesProb_ = new FFTGrid*[nFacies_];
-  if(alphagrid->isFile()==1)
-    faciesProbUndef_ = new FFTFileGrid(nx, ny, nz, nx, ny, nz);
-  else
-    faciesProbUndef_ = new FFTGrid(nx, ny, nz, nx, ny, nz);
+  faciesProbUndef_ = ModelGeneral::createFFTGrid(nx, ny, nz, nx, ny, nz, alphagrid->isFile(), FFTFileGrid::FACIES_PROBABILITY);
   alphagrid->setAccessMode(FFTGrid::READ);
   betagrid->setAccessMode(FFTGrid::READ);
   rhogrid->setAccessMode(FFTGrid::READ);
   for(i=0;i<nFacies_;i++)
   {
-    if(alphagrid->isFile()==1)
-    {
-      faciesProb_[i] = new FFTFileGrid(nx, ny, nz, nx, ny, nz);
-    }
-    else
-    {
-      faciesProb_[i] = new FFTGrid(nx, ny, nz, nx, ny, nz);
-    }
+    faciesProb_[i] = ModelGeneral::createFFTGrid(nx, ny, nz, nx, ny, nz, alphagrid->isFile(), FFTFileGrid::FACIES_PROBABILITY);
     faciesProb_[i]->setAccessMode(FFTGrid::WRITE);
     faciesProb_[i]->createRealGrid(false);
   }
@@ -2119,23 +2109,13 @@ void FaciesProb::CalculateFaciesProbFromPosteriorElasticPDF(FFTGrid
   }
 
   faciesProb_ = new FFTGrid*[nFacies_];
-  if(alphagrid->isFile()==1)
-    faciesProbUndef_ = new FFTFileGrid(nx, ny, nz, nx, ny, nz);
-  else
-    faciesProbUndef_ = new FFTGrid(nx, ny, nz, nx, ny, nz);
+  faciesProbUndef_ = ModelGeneral::createFFTGrid(nx, ny, nz, nx, ny, nz, alphagrid->isFile(), FFTFileGrid::FACIES_PROBABILITY);
   alphagrid->setAccessMode(FFTGrid::READ);
   betagrid->setAccessMode(FFTGrid::READ);
   rhogrid->setAccessMode(FFTGrid::READ);
   for(int i=0;i<nFacies_;i++)
   {
-    if(alphagrid->isFile()==1)
-    {
-      faciesProb_[i] = new FFTFileGrid(nx, ny, nz, nx, ny, nz);
-    }
-    else
-    {
-      faciesProb_[i] = new FFTGrid(nx, ny, nz, nx, ny, nz);
-    }
+    faciesProb_[i] = ModelGeneral::createFFTGrid(nx, ny, nz, nx, ny, nz, alphagrid->isFile(), FFTFileGrid::FACIES_PROBABILITY);
     faciesProb_[i]->setAccessMode(FFTGrid::WRITE);
     faciesProb_[i]->createRealGrid(false);
   }
@@ -4,10 +4,12 @@
 
 #include <iostream>
 #include <sstream>
+#include <algorithm>
 #include <math.h>
 #include <assert.h>
 #include <stdio.h>
 #include <string.h>
+#include <float.h>
 
 #include "fftw.h"
 #include "rfftw.h"
@@ -15,14 +17,20 @@
 #include "f77_func.h"
 
 #include "nrlib/iotools/logkit.hpp"
+#include "nrlib/iotools/fileio.hpp"
 
 #include "src/definitions.h"
 #include "src/fftfilegrid.h"
 #include "src/simbox.h"
 #include "src/io.h"
 
-FFTFileGrid::FFTFileGrid(int nx, int ny, int nz, int nxp, int nyp, int nzp) :
-FFTGrid(nx, ny, nz, nxp, nyp, nzp)
+FFTFileGrid::FFTFileGrid(int nx, int ny, int nz, int nxp, int nyp, int nzp, int storage, int role) :
+FFTGrid(nx, ny, nz, nxp, nyp, nzp),
+storage_(storage),
+role_(role),
+released_(false),
+readPos_(0),
+writePos_(0)
 {
   genFileName();
   accMode_=NONE;
@@ -52,8 +60,14 @@ FFTGrid()
   counterForGet_  = 0;
   counterForSet_  = 0;
   istransformed_  = fftGrid->istransformed_;
+  allowLossyCrava_ = fftGrid->allowLossyCrava_;
   fNameIn_        = "";
   accMode_        = NONE;
+  storage_        = fftGrid->storage_;
+  role_           = fftGrid->role_;
+  released_       = false;
+  readPos_        = 0;
+  writePos_       = 0;
 
   setAccessMode(WRITE);
   fftGrid->setAccessMode(READ);
@@ -92,11 +106,14 @@ FFTGrid()
 FFTFileGrid::~FFTFileGrid()
 {
   endAccess();
-  if(fNameIn_ != "")
+  if(storage_ == FILESTORAGE)
   {
-    remove(fNameIn_.c_str());
+    if(fNameIn_ != "")
+    {
+      remove(fNameIn_.c_str());
+    }
+    remove(fNameOut_.c_str());
   }
-  remove(fNameOut_.c_str());
 }
 
 
@@ -107,14 +124,14 @@ FFTFileGrid::setAccessMode(int mode)
   switch(mode)
   {
   case READ:
-    NRLib::OpenRead(inFile_,fNameIn_,std::ios::in | std::ios::binary);
+    openInput();
     break;
   case WRITE:
-    NRLib::OpenWrite(outFile_,fNameOut_,std::ios::out | std::ios::binary);
+    openOutput();
     break;
   case READANDWRITE:
-    NRLib::OpenRead(inFile_,fNameIn_,std::ios::in | std::ios::binary);
-    NRLib::OpenWrite(outFile_,fNameOut_,std::ios::out | std::ios::binary);
+    openInput();
+    openOutput();
     break;
   case RANDOMACCESS:
     modified_ = 0;
@@ -127,22 +144,16 @@ FFTFileGrid::setAccessMode(int mode)
 void
 FFTFileGrid::endAccess()
 {
-  std::string tmp("");
   switch(accMode_)
   {
   case READ:
-    inFile_.close();
+    closeInput();
     break;
   case READANDWRITE:
-    inFile_.close(); //Intentional fallthrough to WRITE
+    closeInput(); //Intentional fallthrough to WRITE
   case WRITE:
-    outFile_.close();
-    tmp = fNameIn_;
-    fNameIn_ = fNameOut_;
-    if(tmp != "")
-      fNameOut_ = tmp;
-    else
-      fNameOut_ = fNameIn_+"b";
+    closeOutput();
+    swapStorage();
     break;
   case RANDOMACCESS:
     if(modified_ != 0)
@@ -173,8 +184,7 @@ FFTFileGrid::getNextComplex()
   assert(istransformed_==true);
   assert(accMode_ == READ || accMode_ == READANDWRITE);
   fftw_complex cVal;
-  char * buffer = reinterpret_cast<char *>(&cVal);
-  inFile_.read(buffer,sizeof(fftw_complex));
+  readValues(reinterpret_cast<float *>(&cVal), 2);
   return(cVal);
 }
 
@@ -186,9 +196,8 @@ FFTFileGrid::getNextReal()
   assert(istransformed_ == false);
   assert(accMode_ == READ || accMode_ == READANDWRITE);
   float rVal;
-  char * buffer = reinterpret_cast<char *>(&rVal);
-  inFile_.read(buffer,sizeof(float));
-  return float(rVal);
+  readValues(&rVal, 1);
+  return(rVal);
 }
 
 
@@ -255,8 +264,7 @@ FFTFileGrid::SetNextComplex(std::complex<double> & value)
   fftw_complex tmp;
   tmp.re = value.real();
   tmp.im = value.imag();
-  char * buffer = reinterpret_cast<char *>(&tmp);
-  outFile_.write(buffer,sizeof(fftw_complex));
+  writeValues(reinterpret_cast<const float *>(&tmp), 2);
   return(0);
 }
 
@@ -266,8 +274,7 @@ FFTFileGrid::setNextComplex(fftw_complex value)
 {
   assert(istransformed_==true);
   assert(accMode_ == READANDWRITE || accMode_ == WRITE);
-  char * buffer = reinterpret_cast<char *>(&value);
-  outFile_.write(buffer,sizeof(fftw_complex));
+  writeValues(reinterpret_cast<const float *>(&value), 2);
   return(0);
 }
 
@@ -277,8 +284,7 @@ FFTFileGrid::setNextReal(float  value)
 {
   assert(istransformed_== false);
   assert(accMode_ == READANDWRITE || accMode_ == WRITE);
-  char * buffer = reinterpret_cast<char *>(&value);
-  outFile_.write(buffer,sizeof(float));
+  writeValues(&value, 1);
   return(0);
 }
 
@@ -673,17 +679,16 @@ FFTFileGrid::load()
     FFTGrid::createRealGrid();
   else
     FFTGrid::createComplexGrid();
-  if(fNameIn_ != "") //Something has been saved.
+  if(hasStoredValues()) //Something has been saved.
   {
-    int i, nRead = 1;
-    NRLib::OpenRead(inFile_,fNameIn_,std::ios::in | std::ios::binary);
+    openInput();
     //Real/complex does not matter in next line, since same meory is used.
-    for(i=0;((i<rsize_) && (nRead == 1));i++)
-    {
-      char * buffer = reinterpret_cast<char *>(&(rvalue_[i]));
-      inFile_.read(buffer,sizeof(float));
+    readValues(rvalue_, rsize_);
+    closeInput();
+    if(storage_ != FILESTORAGE) {
+      std::vector<unsigned short>().swap(packed_); // Held in rvalue_ until save() or unload()
+      released_ = true;
     }
-    inFile_.close();
   }
 }
 
@@ -691,27 +696,25 @@ void
 FFTFileGrid::save()
 {
   assert(accMode_ == NONE || accMode_ == RANDOMACCESS);
-  NRLib::OpenWrite(outFile_,fNameOut_,std::ios::out | std::ios::binary);
+  openOutput();
   //Real/complex does not matter in next line, since same meory is used.
-  int i, nWritten = 1;
-  for(i=0;((i<rsize_) && (nWritten == 1));i++)
-  {
-    char * buffer = reinterpret_cast<char *>(&(rvalue_[i]));
-    outFile_.write(buffer,sizeof(float));
-  }
-  outFile_.close();
+  writeValues(rvalue_, rsize_);
+  closeOutput();
   unload();
-  std::string tmp = fNameIn_;
-  fNameIn_ = fNameOut_;
-  if(tmp != "")
-    fNameOut_ = tmp;
-  else
-    fNameOut_ = fNameIn_+"b";
+  swapStorage();
 }
 
 void
 FFTFileGrid::unload()
 {
+  if(released_) {
+    // Not modified, so the values are packed again without counting a storage error. Values
+    // that have been stored in 16 bits are packed to the same codes.
+    packed_.resize(rsize_);
+    for(int i=0;i<rsize_;i++)
+      packed_[i] = packValue(rvalue_[i], storage_);
+    released_ = false;
+  }
   fftw_free(rvalue_); // changed
   nGrids_ = nGrids_ - 1;
 // LogKit::LogFormatted(LogKit::Error,"\nFFTFileGrid unload: nGrids_ = %d\n",nGrids_);
@@ -730,6 +733,330 @@ FFTFileGrid::genFileName()
   gNum++;
 }
 
+void
+FFTFileGrid::openInput()
+{
+  if(storage_ == FILESTORAGE)
+    NRLib::OpenRead(inFile_,fNameIn_,std::ios::in | std::ios::binary);
+  else
+    readPos_ = 0;
+}
+
+void
+FFTFileGrid::openOutput()
+{
+  if(storage_ == FILESTORAGE)
+    NRLib::OpenWrite(outFile_,fNameOut_,std::ios::out | std::ios::binary);
+  else {
+    writePos_ = 0;
+    if(packed_.size() != static_cast<size_t>(rsize_))
+      packed_.resize(rsize_);
+    released_ = false;
+    stats_ = PrecisionStats();
+  }
+}
+
+void
+FFTFileGrid::closeInput()
+{
+  if(storage_ == FILESTORAGE)
+    inFile_.close();
+}
+
+void
+FFTFileGrid::closeOutput()
+{
+  if(storage_ == FILESTORAGE)
+    outFile_.close();
+}
+
+void
+FFTFileGrid::readValues(float * values, int n)
+{
+  if(storage_ == FILESTORAGE) {
+    inFile_.read(reinterpret_cast<char *>(values), n*sizeof(float));
+  }
+  else {
+    assert(readPos_ + n <= packed_.size());
+    for(int i=0;i<n;i++)
+      values[i] = unpackValue(packed_[readPos_+i], storage_);
+    readPos_ += n;
+  }
+}
+
+void
+FFTFileGrid::writeValues(const float * values, int n)
+{
+  if(storage_ == FILESTORAGE) {
+    outFile_.write(reinterpret_cast<const char *>(values), n*sizeof(float));
+    return;
+  }
+  assert(writePos_ + n <= packed_.size());
+  assert(accMode_ != READANDWRITE || writePos_ + n <= readPos_); // Values not yet read are kept
+  for(int i=0;i<n;i++) {
+    unsigned short code = packValue(values[i], storage_);
+    packed_[writePos_+i] = code;
+    if(precisionStudy_ && values[i] != RMISSING && fabs(values[i]) <= FLT_MAX) { // Skips NaN and infinite values
+      double stored = unpackValue(code, storage_);
+      double value  = values[i];
+      stats_.nValues++;
+      if(fabs(stored) > FLT_MAX)
+        stats_.nOverflow++;
+      else {
+        double error = fabs(stored - value);
+        stats_.maxAbsError = std::max(stats_.maxAbsError, error);
+        if(value != 0.0)
+          stats_.maxRelError = std::max(stats_.maxRelError, error/fabs(value));
+        stats_.sumSqError += error*error;
+        stats_.sumSqValue += value*value;
+      }
+    }
+  }
+  writePos_ += n;
+}
+
+void
+FFTFileGrid::swapStorage()
+{
+  if(storage_ == FILESTORAGE) {
+    std::string tmp = fNameIn_;
+    fNameIn_ = fNameOut_;
+    if(tmp != "")
+      fNameOut_ = tmp;
+    else
+      fNameOut_ = fNameIn_+"b";
+  }
+  else {
+    // The values are written in place, so only the storage error is collected.
+    if(precisionStudy_) {
+#pragma omp critical(PrecisionStudy)
+      studyStats_[role_].add(stats_);
+    }
+  }
+}
+
+bool
+FFTFileGrid::hasStoredValues() const
+{
+  if(storage_ == FILESTORAGE)
+    return(fNameIn_ != "");
+  else
+    return(packed_.empty() == false);
+}
+
+// Conversions to and from the 16-bit formats, rounding to nearest even. bfloat16 is the upper
+// half of a float, with the same range. float16 has 5 exponent bits, and values larger than
+// 65504 are stored as infinite. RMISSING is stored as a NaN with a reserved payload.
+unsigned short
+FFTFileGrid::packValue(float value, int storage)
+{
+  unsigned int bits;
+  memcpy(&bits, &value, sizeof(float));
+
+  if(storage == BFLOAT16) {
+    if(value == RMISSING)
+      return(0x7FC1);
+    if((bits & 0x7FFFFFFF) > 0x7F800000)
+      return(0x7FC0);
+    bits += 0x7FFF + ((bits >> 16) & 1);
+    return(static_cast<unsigned short>(bits >> 16));
+  }
+
+  if(value == RMISSING)
+    return(0x7E01);
+  unsigned int   sign      = bits & 0x80000000;
+  unsigned int   magnitude = bits ^ sign;
+  unsigned short code;
+  if(magnitude >= 0x47800000) {               // 65536 and above, infinite and NaN
+    code = (magnitude > 0x7F800000 ? 0x7E00 : 0x7C00);
+  }
+  else if(magnitude < 0x38800000) {           // Subnormal float16. The float addition rounds.
+    const unsigned int magicBits = 0x3F000000;  // 0.5f
+    float magic;
+    float absValue;
+    memcpy(&magic, &magicBits, sizeof(float));
+    memcpy(&absValue, &magnitude, sizeof(float));
+    absValue += magic;
+    unsigned int sum;
+    memcpy(&sum, &absValue, sizeof(float));
+    code = static_cast<unsigned short>(sum - magicBits);
+  }
+  else {
+    unsigned int odd = (magnitude >> 13) & 1;
+    magnitude += 0xC8000FFF + odd;            // Rebias exponent from 127 to 15, and round
+    code = static_cast<unsigned short>(magnitude >> 13);
+  }
+  return(static_cast<unsigned short>(code | (sign >> 16)));
+}
+
+float
+FFTFileGrid::unpackValue(unsigned short code, int storage)
+{
+  unsigned int bits;
+
+  if(storage == BFLOAT16) {
+    if(code == 0x7FC1)
+      return(RMISSING);
+    bits = static_cast<unsigned int>(code) << 16;
+  }
+  else {
+    if(code == 0x7E01)
+      return(RMISSING);
+    unsigned int sign     = static_cast<unsigned int>(code & 0x8000) << 16;
+    unsigned int exponent = (code >> 10) & 0x1F;
+    unsigned int mantissa = code & 0x3FF;
+    if(exponent == 0) {
+      float value = static_cast<float>(ldexp(static_cast<double>(mantissa), -24));
+      return(sign != 0 ? -value : value);
+    }
+    else if(exponent == 31)
+      bits = sign | 0x7F800000 | (mantissa << 13);
+    else
+      bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+  }
+
+  float value;
+  memcpy(&value, &bits, sizeof(float));
+  return(value);
+}
+
+void
+FFTFileGrid::setReducedPrecision(int format, int roles, bool study, const std::string & reference)
+{
+  reducedFormat_      = format;
+  reducedRoles_       = roles;
+  precisionStudy_     = study && format != FILESTORAGE;
+  precisionReference_ = (precisionStudy_ ? reference : "");
+  if(precisionReference_ != "" && precisionReference_[precisionReference_.size()-1] != '/')
+    precisionReference_ += "/";
+}
+
+int
+FFTFileGrid::getStorage(int role)
+{
+  if(reducedFormat_ != FILESTORAGE && (reducedRoles_ & role) > 0)
+    return(reducedFormat_);
+  else
+    return(FILESTORAGE);
+}
+
+void
+FFTFileGrid::PrecisionStats::add(const PrecisionStats & stats)
+{
+  nValues     += stats.nValues;
+  nOverflow   += stats.nOverflow;
+  maxAbsError  = std::max(maxAbsError, stats.maxAbsError);
+  maxRelError  = std::max(maxRelError, stats.maxRelError);
+  sumSqError  += stats.sumSqError;
+  sumSqValue  += stats.sumSqValue;
+}
+
+void
+FFTFileGrid::compareWithReference(FFTGrid * grid, const std::string & fileName)
+{
+  if(precisionReference_ == "" || grid->getIsTransformed())
+    return;
+
+  std::string refName = precisionReference_ + IO::PathToInversionResults() + IO::getFilePrefix() + fileName + IO::SuffixCrava();
+  if(NRLib::FileExists(refName) == false) {
+    LogKit::LogFormatted(LogKit::Low,"\nPrecision study: No reference for %s. Write the reference run in CRAVA format.\n", fileName.c_str());
+    return;
+  }
+
+  FFTGrid reference(grid->getNx(), grid->getNy(), grid->getNz(), grid->getNxp(), grid->getNyp(), grid->getNzp());
+  std::string errText;
+  reference.readCravaFile(refName, errText);
+  if(errText != "") {
+    LogKit::LogFormatted(LogKit::Warning,"\nWARNING: Precision study: Could not read %s:\n%s", refName.c_str(), errText.c_str());
+    return;
+  }
+
+  PrecisionStats stats;
+  grid     ->setAccessMode(FFTGrid::RANDOMACCESS);
+  reference.setAccessMode(FFTGrid::RANDOMACCESS);
+  for(int k=0;k<grid->getNz();k++) {
+    for(int j=0;j<grid->getNy();j++) {
+      for(int i=0;i<grid->getNx();i++) {
+        double value = reference.getRealValue(i, j, k);
+        double found = grid->getRealValue(i, j, k);
+        if(value == RMISSING || found == RMISSING)
+          continue;
+        double error = fabs(found - value);
+        stats.nValues++;
+        stats.maxAbsError = std::max(stats.maxAbsError, error);
+        if(value != 0.0)
+          stats.maxRelError = std::max(stats.maxRelError, error/fabs(value));
+        stats.sumSqError += error*error;
+        stats.sumSqValue += value*value;
+      }
+    }
+  }
+  grid     ->endAccess();
+  reference.endAccess();
+
+#pragma omp critical(PrecisionStudy)
+  resultStats_[fileName].add(stats);
+}
+
+void
+FFTFileGrid::reportPrecisionStudy()
+{
+  if(precisionStudy_ == false)
+    return;
+
+  LogKit::WriteHeader("Reduced precision storage");
+  LogKit::LogFormatted(LogKit::Low,"\nThe values below are the errors made each time a grid was stored in %s.\n",
+                       (reducedFormat_ == BFLOAT16 ? "bfloat16" : "float16"));
+  if(precisionReference_ == "")
+    LogKit::LogFormatted(LogKit::Low,"The error of the final results is found by giving a run without reduced precision as reference.\n");
+
+  if(studyStats_.empty()) {
+    LogKit::LogFormatted(LogKit::Low,"\nNo grids were stored in reduced precision.\n");
+    return;
+  }
+
+  LogKit::LogFormatted(LogKit::Low,"\nGrid role              Values stored   Max abs error   Max rel error   RMS rel error   Overflows\n");
+  LogKit::LogFormatted(LogKit::Low,"------------------------------------------------------------------------------------------------\n");
+  for(std::map<int, PrecisionStats>::const_iterator it = studyStats_.begin(); it != studyStats_.end(); ++it) {
+    const PrecisionStats & stats = it->second;
+    std::string role;
+    switch(it->first) {
+    case COVARIANCE:
+      role = "Covariance";
+      break;
+    case ERROR_CORRELATION:
+      role = "Error correlation";
+      break;
+    case FACIES_PROBABILITY:
+      role = "Facies probability";
+      break;
+    default:
+      role = "Other";
+    }
+    double rmsRelError = (stats.sumSqValue > 0.0 ? sqrt(stats.sumSqError/stats.sumSqValue) : 0.0);
+    LogKit::LogFormatted(LogKit::Low,"%-20s %15lld %15.2e %15.2e %15.2e %11lld\n", role.c_str(), stats.nValues,
+                         stats.maxAbsError, stats.maxRelError, rmsRelError, stats.nOverflow);
+  }
+  for(std::map<int, PrecisionStats>::const_iterator it = studyStats_.begin(); it != studyStats_.end(); ++it) {
+    if(it->second.nOverflow > 0) {
+      LogKit::LogFormatted(LogKit::Warning,"\nWARNING: Values too large for float16 were stored as infinite. Use bfloat16 instead.\n");
+      break;
+    }
+  }
+
+  if(resultStats_.empty() == false) {
+    LogKit::LogFormatted(LogKit::Low,"\nResults compared with the full precision run in %s:\n", precisionReference_.c_str());
+    LogKit::LogFormatted(LogKit::Low,"\nResult                                  Values   Max abs error   Max rel error   RMS rel error\n");
+    LogKit::LogFormatted(LogKit::Low,"--------------------------------------------------------------------------------------------\n");
+    for(std::map<std::string, PrecisionStats>::const_iterator it = resultStats_.begin(); it != resultStats_.end(); ++it) {
+      const PrecisionStats & stats = it->second;
+      double rmsRelError = (stats.sumSqValue > 0.0 ? sqrt(stats.sumSqError/stats.sumSqValue) : 0.0);
+      LogKit::LogFormatted(LogKit::Low,"%-32s %13lld %15.2e %15.2e %15.2e\n", it->first.c_str(), stats.nValues,
+                           stats.maxAbsError, stats.maxRelError, rmsRelError);
+    }
+  }
+}
+
 void
 FFTFileGrid::writeResampledStormCube(const GridMapping * gridmapping,
                                      const std::string & fileName,
@@ -773,3 +1100,10 @@ FFTFileGrid::setRealTrace(int i, int j, float *value)
 
 
 int FFTFileGrid::gNum = 0; //Starting value
+
+int  FFTFileGrid::reducedFormat_  = FFTFileGrid::FILESTORAGE;
+int  FFTFileGrid::reducedRoles_   = 0;
+bool FFTFileGrid::precisionStudy_ = false;
+std::map<int, FFTFileGrid::PrecisionStats> FFTFileGrid::studyStats_;
+std::string FFTFileGrid::precisionReference_ = "";
+std::map<std::string, FFTFileGrid::PrecisionStats> FFTFileGrid::resultStats_;
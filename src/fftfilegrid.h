@@ -6,6 +6,8 @@
 #define FFTFILEGRID_H
 
 #include <string>
+#include <vector>
+#include <map>
 #include "fftw.h"
 
 #include "fftgrid.h"
@@ -14,10 +16,17 @@ class Wavelet;
 class Simbox;
 class GridMapping;
 
+// Grid that is only held in memory while it is being worked on (RANDOMACCESS, or inside one of
+// the operations below). Between accesses, the values are stored in a temporary file, or, with
+// a 16-bit storage format, in memory with half the size of a float grid. Values are converted
+// when they are stored and read, so the 16-bit formats are invisible to the code using the grid.
+// The 16-bit values are overwritten in place, also in READANDWRITE where the write position
+// follows the read position, and they are released while the grid is held as floats.
 class FFTFileGrid : public FFTGrid
 {
 public:
-  FFTFileGrid(int nx, int ny, int nz, int nxp, int nyp, int nzp);
+  FFTFileGrid(int nx, int ny, int nz, int nxp, int nyp, int nzp,
+              int storage = FILESTORAGE, int role = 0);
   FFTFileGrid(FFTFileGrid * FFTFileGrid, bool expTrans = false);
   ~FFTFileGrid();
 
@@ -71,12 +80,61 @@ public:
   bool         isFile() {return(1);}
   void         getRealTrace(float * value, int i, int j);
   int          setRealTrace(int i, int j, float *value);
+
+  int          getStorage() const { return storage_ ;}
+
+  enum         storageFormats{FILESTORAGE = 0, BFLOAT16 = 1, FLOAT16 = 2};
+
+  enum         storageRoles{COVARIANCE         = 1,
+                            ERROR_CORRELATION  = 2,
+                            FACIES_PROBABILITY = 4};
+
+  // Grids with a role in roles are stored in format.
+  // With study, the storage error is collected. If reference is given, the results written are also
+  // compared with the CRAVA format grids of a run in full precision, with reference as output directory.
+  static void  setReducedPrecision(int format, int roles, bool study, const std::string & reference = "");
+
+  // Storage format for new grids with the given role. FILESTORAGE if the role is not selected.
+  static int   getStorage(int role);
+
+  // Compares grid with the result of the same name in the reference run, when this is given.
+  static void  compareWithReference(FFTGrid * grid, const std::string & fileName);
+
+  // Logs the storage error of each role, and the error of each result compared with the reference
+  // run, when the precision study is active.
+  static void  reportPrecisionStudy();
+
+  static unsigned short packValue(float value, int storage);
+  static float          unpackValue(unsigned short code, int storage);
+
 private:
+  struct PrecisionStats
+  {
+    PrecisionStats() : nValues(0), nOverflow(0), maxAbsError(0.0), maxRelError(0.0), sumSqError(0.0), sumSqValue(0.0) {}
+    void add(const PrecisionStats & stats);
+
+    long long    nValues;
+    long long    nOverflow;      // Finite values stored as infinite
+    double       maxAbsError;
+    double       maxRelError;
+    double       sumSqError;
+    double       sumSqValue;
+  };
+
   void         genFileName();
   void         load();
   void         unload();
   void         save();
 
+  void         openInput();
+  void         openOutput();
+  void         closeInput();
+  void         closeOutput();
+  void         readValues(float * values, int n);
+  void         writeValues(const float * values, int n);
+  void         swapStorage();                         // The values written become the values to read.
+  bool         hasStoredValues() const;
+
   int          accMode_;
   int          modified_;   //Tells if grid is modified during RANDOMACCESS.
   std::string  fNameIn_; //Temporary names, switches whenever a write has occured.
@@ -84,6 +142,21 @@ private:
   std::ifstream inFile_;
   std::ofstream outFile_;
 
+  int                         storage_;    // One of storageFormats
+  int                         role_;       // One of storageRoles, or 0
+  std::vector<unsigned short> packed_;     // 16-bit values, used instead of the temporary files. Written in place.
+  bool                        released_;   // packed_ has been released, as its values are held in rvalue_
+  size_t                      readPos_;
+  size_t                      writePos_;
+  PrecisionStats              stats_;      // Storage error of the values being written
+
   static int   gNum; //Number used for generating temporary files.
+
+  static int   reducedFormat_;
+  static int   reducedRoles_;
+  static bool  precisionStudy_;
+  static std::map<int, PrecisionStats> studyStats_;
+  static std::string precisionReference_;
+  static std::map<std::string, PrecisionStats> resultStats_;
 };
 #endif
@@ -12,6 +12,7 @@
 
 #include "lib/random.h"
 #include "lib/utils.h"
+#include "lib/fft1d.h"
 #include "lib/timekit.hpp"
 
 #include "fftw.h"
@@ -25,6 +26,7 @@
 #include "nrlib/segy/segy.hpp"
 
 #include "src/fftgrid.h"
+#include "src/cravagridfile.h"
 #include "src/simbox.h"
 #include "src/timings.h"
 #include "src/definitions.h"
@@ -59,6 +61,7 @@ FFTGrid::FFTGrid(int nx, int ny, int nz, int nxp, int nyp, int nzp)
   istransformed_  = false;
   rvalue_         = NULL;
   add_            = true;
+  allowLossyCrava_ = false;
 
   // index= i+rnxp_*j+k*rnxp_*nyp_;
   // i index in x direction
@@ -90,6 +93,7 @@ FFTGrid::FFTGrid(FFTGrid * fftGrid, bool expTrans)
   counterForGet_  = fftGrid->getCounterForGet();
   counterForSet_  = fftGrid->getCounterForSet();
   add_            = fftGrid->add_;
+  allowLossyCrava_ = fftGrid->allowLossyCrava_;
   istransformed_  = fftGrid->getIsTransformed();
 
   if(istransformed_ == false) {
@@ -123,10 +127,13 @@ FFTGrid::~FFTGrid()
 {
   if (rvalue_!=NULL)
   {
-    if(add_==true)
-      nGrids_ = nGrids_ - 1;
     fftw_free(rvalue_);
-    FFTMemUse_ -= rsize_ * sizeof(fftw_real);
+#pragma omp critical(FFTGridMemory)
+    {
+      if(add_==true)
+        nGrids_ = nGrids_ - 1;
+      FFTMemUse_ -= rsize_ * sizeof(fftw_real);
+    }
     LogKit::LogFormatted(LogKit::DebugLow,"\nFFTGrid Destructor: nGrids_ = %d",nGrids_);
   }
 }
@@ -167,12 +174,15 @@ FFTGrid::fillInData(const Simbox  * timeSimbox,
 
   setAccessMode(READANDWRITE);
 
+  // The progress is not shown when several grids are filled at once.
+  bool  monitor     = LogKit::IsThreadBuffering() == false;
   float monitorSize = std::max(1.0f, static_cast<float>(nyp_*rnxp_)*0.02f);
   float nextMonitor = monitorSize;
-  std::cout
-    << "\n  0%       20%       40%       60%       80%      100%"
-    << "\n  |    |    |    |    |    |    |    |    |    |    |  "
-    << "\n  ^";
+  if (monitor)
+    std::cout
+      << "\n  0%       20%       40%       60%       80%      100%"
+      << "\n  |    |    |    |    |    |    |    |    |    |    |  "
+      << "\n  ^";
 
   //
   // Find proper length of time samples to get N*log(N) performance in FFT.
@@ -191,12 +201,6 @@ FFTGrid::fillInData(const Simbox  * timeSimbox,
   int    nt        = findClosestFactorableNumber(static_cast<int>(n_samples));
   int    mt        = 4*nt; // Use four times the sampling density for the fine-meshed data
 
-  //
-  // Create FFT plans
-  //
-  rfftwnd_plan fftplan1 = rfftwnd_create_plan(1, &nt, FFTW_REAL_TO_COMPLEX, FFTW_ESTIMATE | FFTW_IN_PLACE);
-  rfftwnd_plan fftplan2 = rfftwnd_create_plan(1, &mt, FFTW_COMPLEX_TO_REAL, FFTW_ESTIMATE | FFTW_IN_PLACE);
-
   //
   // Do resampling
   //
@@ -286,9 +290,6 @@ FFTGrid::fillInData(const Simbox  * timeSimbox,
           nt = findClosestFactorableNumber(static_cast<int>(n_samples));
           mt = 4*nt;
 
-          fftplan1 = rfftwnd_create_plan(1, &nt, FFTW_REAL_TO_COMPLEX, FFTW_ESTIMATE | FFTW_IN_PLACE);
-          fftplan2 = rfftwnd_create_plan(1, &mt, FFTW_COMPLEX_TO_REAL, FFTW_ESTIMATE | FFTW_IN_PLACE);
-
           //Remove trend from trace
           trend_first = data_trace[0];
           trend_last = data_trace[n_trace - 1];
@@ -327,8 +328,8 @@ FFTGrid::fillInData(const Simbox  * timeSimbox,
           }
 
           resampleTrace(data_trace,
-                        fftplan1,
-                        fftplan2,
+                        nt,
+                        mt,
                         rAmpData,
                         rAmpFine,
                         cnt,
@@ -394,7 +395,7 @@ FFTGrid::fillInData(const Simbox  * timeSimbox,
           missingTracesPadding++;
       }
 
-      if (rnxp_*j + i + 1 >= static_cast<int>(nextMonitor)) {
+      if (monitor && rnxp_*j + i + 1 >= static_cast<int>(nextMonitor)) {
         nextMonitor += monitorSize;
         std::cout << "^";
         fflush(stdout);
@@ -405,9 +406,6 @@ FFTGrid::fillInData(const Simbox  * timeSimbox,
   LogKit::LogFormatted(LogKit::Low,"\n");
   endAccess();
 
-  fftwnd_destroy_plan(fftplan1);
-  fftwnd_destroy_plan(fftplan2);
-
   Timings::setTimeResamplingSeismic(wall,cpu);
 }
 
@@ -457,8 +455,8 @@ FFTGrid::smoothTraceInGuardZone(std::vector<float> & data_trace,
 
 void
 FFTGrid::resampleTrace(const std::vector<float> & data_trace,
-                       const rfftwnd_plan       & fftplan1,
-                       const rfftwnd_plan       & fftplan2,
+                       int                        nt,
+                       int                        mt,
                        fftw_real                * rAmpData,
                        fftw_real                * rAmpFine,
                        int                        cnt,
@@ -485,7 +483,7 @@ FFTGrid::resampleTrace(const std::vector<float> & data_trace,
   //
   // Transform to Fourier domain
   //
-  rfftwnd_one_real_to_complex(fftplan1, rAmpData, cAmpData);
+  FFT1D::fft(rAmpData, nt);
 
   //
   // Fill fine-sampled grid
@@ -503,7 +501,7 @@ FFTGrid::resampleTrace(const std::vector<float> & data_trace,
   //
   // Fine-sampled grid: Fourier --> Time
   //
-  rfftwnd_one_complex_to_real(fftplan2, cAmpFine, rAmpFine);
+  FFT1D::fftInv(cAmpFine, mt);
 
   //
   // Scale and fill grid_trace
@@ -1192,8 +1190,10 @@ FFTGrid::createRealGrid(bool add)
 {
   istransformed_=false;
   add_ = add;
-  if(add==true)
+  if(add==true) {
+#pragma omp critical(FFTGridMemory)
     nGrids_ += 1;
+  }
   createGrid();
 }
 
@@ -1201,6 +1201,7 @@ void
 FFTGrid::createComplexGrid()
 {
   istransformed_  = true;
+#pragma omp critical(FFTGridMemory)
   nGrids_        += 1;
   createGrid();
 }
@@ -1230,12 +1231,16 @@ void FFTGrid::createGrid()
       //TaskList::addTask("Crava needs more memory than expected. The results are still correct. \n Norwegian Computing Center would like to have a look at your project.");
     }
   }
-  maxAllocatedGrids_ = std::max(nGrids_, maxAllocatedGrids_);
+  // Grids may be created by several threads when files are read concurrently.
+#pragma omp critical(FFTGridMemory)
+  {
+    maxAllocatedGrids_ = std::max(nGrids_, maxAllocatedGrids_);
 
-  FFTMemUse_ += rsize_ * sizeof(fftw_real);
-  if(FFTMemUse_ > maxFFTMemUse_) {
-    maxFFTMemUse_ = FFTMemUse_;
-    LogKit::LogFormatted(LogKit::DebugLow,"\nNew FFT-grid memory peak (%2d): %10.2f MB\n",nGrids_, FFTMemUse_/(1024.f*1024.f));
+    FFTMemUse_ += rsize_ * sizeof(fftw_real);
+    if(FFTMemUse_ > maxFFTMemUse_) {
+      maxFFTMemUse_ = FFTMemUse_;
+      LogKit::LogFormatted(LogKit::DebugLow,"\nNew FFT-grid memory peak (%2d): %10.2f MB\n",nGrids_, FFTMemUse_/(1024.f*1024.f));
+    }
   }
 
 
@@ -1727,6 +1732,72 @@ FFTGrid::collapseAndAdd(float * grid)
     return(0);
 }
 
+void
+FFTGrid::addLateralAutoCorrelation(float * grid)
+{
+  // Adds the circular lateral autocorrelation, summed over all time slices, to grid (nxp*nyp).
+  // This is the zero time lag of the 3D autocorrelation. The power spectra of the slices are
+  // summed, so only one inverse transform is needed. The slices are split in a fixed number of
+  // blocks that are summed in order, so the result does not depend on the number of threads.
+  assert(istransformed_==false);
+
+  const int cnxp      = nxp_/2 + 1;
+  const int sliceSize = rnxp_*nyp_;
+  const int specSize  = cnxp*nyp_;
+  const int nBlocks   = std::min(nzp_, 16);
+
+  std::vector<double> blockPower(static_cast<size_t>(nBlocks)*specSize, 0.0);
+
+#pragma omp parallel
+  {
+    rfftwnd_plan plan;
+#pragma omp critical(FFTWPlans)
+    plan = rfftw2d_create_plan(nyp_, nxp_, FFTW_REAL_TO_COMPLEX, FFTW_ESTIMATE | FFTW_IN_PLACE);
+
+    std::vector<fftw_real> slice(sliceSize);
+
+#pragma omp for schedule(dynamic, 1)
+    for(int b=0;b<nBlocks;b++)
+    {
+      double * power = &blockPower[static_cast<size_t>(b)*specSize];
+      for(int k=b*nzp_/nBlocks;k<(b+1)*nzp_/nBlocks;k++)
+      {
+        std::copy(rvalue_ + static_cast<size_t>(k)*sliceSize, rvalue_ + static_cast<size_t>(k+1)*sliceSize, slice.begin());
+        rfftwnd_one_real_to_complex(plan, &slice[0], NULL);
+        const fftw_complex * spectrum = reinterpret_cast<const fftw_complex *>(&slice[0]);
+        for(int c=0;c<specSize;c++)
+          power[c] += static_cast<double>(spectrum[c].re)*spectrum[c].re + static_cast<double>(spectrum[c].im)*spectrum[c].im;
+      }
+    }
+
+#pragma omp critical(FFTWPlans)
+    rfftwnd_destroy_plan(plan);
+  }
+
+  std::vector<fftw_real> corr(sliceSize);
+  fftw_complex * spectrum = reinterpret_cast<fftw_complex *>(&corr[0]);
+  for(int c=0;c<specSize;c++)
+  {
+    double power = 0.0;
+    for(int b=0;b<nBlocks;b++)
+      power += blockPower[static_cast<size_t>(b)*specSize + c];
+    spectrum[c].re = static_cast<fftw_real>(power);
+    spectrum[c].im = 0.0f;
+  }
+
+  rfftwnd_plan plan;
+#pragma omp critical(FFTWPlans)
+  plan = rfftw2d_create_plan(nyp_, nxp_, FFTW_COMPLEX_TO_REAL, FFTW_ESTIMATE | FFTW_IN_PLACE);
+  rfftwnd_one_complex_to_real(plan, spectrum, NULL);
+#pragma omp critical(FFTWPlans)
+  rfftwnd_destroy_plan(plan);
+
+  float scale = 1.0f/static_cast<float>(nxp_*nyp_);
+  for(int j=0;j<nyp_;j++)
+    for(int i=0;i<nxp_;i++)
+      grid[i + j*nxp_] += corr[i + j*rnxp_]*scale;
+}
+
 void
 FFTGrid::fftInPlace()
 {
@@ -1931,16 +2002,10 @@ FFTGrid::fft1DzInPlace(fftw_real*  in, int nzp)
   // in is over vritten by out
   // not norm preservingtransform ifft(fft(funk))=N*funk
 
-  int flag;
-
-  rfftwnd_plan plan;
   fftw_complex* out;
   out = reinterpret_cast<fftw_complex*>(in);
 
-  flag    = FFTW_ESTIMATE | FFTW_IN_PLACE;
-  plan    = rfftwnd_create_plan(1, &nzp ,FFTW_REAL_TO_COMPLEX,flag);
-  rfftwnd_one_real_to_complex(plan,in ,out);
-  fftwnd_destroy_plan(plan);
+  FFT1D::fft(in, nzp);
 
   return out;
 }
@@ -1951,15 +2016,10 @@ FFTGrid::invFFT1DzInPlace(fftw_complex* in, int nzp)
   // in is over vritten by out
   // not norm preserving transform  ifft(fft(funk))=N*funk
 
-  int flag;
-  rfftwnd_plan plan;
   fftw_real*  out;
   out = reinterpret_cast<fftw_real*>(in);
 
-  flag = FFTW_ESTIMATE | FFTW_IN_PLACE;
-  plan= rfftwnd_create_plan(1,&nzp,FFTW_COMPLEX_TO_REAL,flag);
-  rfftwnd_one_complex_to_real(plan,in,out);
-  fftwnd_destroy_plan(plan);
+  FFT1D::fftInv(in, nzp);
   return out;
 }
 
@@ -1988,26 +2048,36 @@ FFTGrid::writeFile(const std::string       & fName,
                    bool                      padding,
                    bool                      scientific_format)
 {
+  // Each format is written from a shared traversal where possible: binary and ascii storm
+  // files are written in one pass over the grid, and the trace positions and surfaces are
+  // found once for both SegY and sgri output.
   std::string fileName = IO::makeFullFileName(subDir, fName);
 
   if (formatFlag_ > 0) //Output format specified.
   {
+    bool storm = (formatFlag_ & IO::STORM) > 0;
+    bool ascii = (formatFlag_ & IO::ASCII) > 0;
+    bool segy  = (formatFlag_ & IO::SEGY)  > 0;
+    bool sgri  = (formatFlag_ & IO::SGRI)  > 0;
+
     if ((domainFlag_ & IO::TIMEDOMAIN) > 0) {
       if (timeMap == NULL) { //No resampling of storm
-        if ((formatFlag_ & IO::STORM) > 0)
-          FFTGrid::writeStormFile(fileName, simbox, false,padding);
-        if ((formatFlag_ & IO::ASCII) > 0)
-          FFTGrid::writeStormFile(fileName, simbox, true,padding, false, scientific_format);
+        if (storm || ascii)
+          FFTGrid::writeStormFiles(fileName, simbox, storm, ascii, padding, false, scientific_format);
       }
       else {
         FFTGrid::writeResampledStormCube(timeMap, fileName, simbox, formatFlag_);
       }
 
       //SEGY, SGRI CRAVA are never resampled in time.
-      if ((formatFlag_ & IO::SEGY) >0)
-        FFTGrid::writeSegyFile(fileName, simbox, z0, thf);
-      if ((formatFlag_ & IO::SGRI) >0)
-        FFTGrid::writeSgriFile(fileName, simbox, label);
+      if (segy || sgri) {
+        std::vector<TraceGeometry> traces;
+        getTraceGeometry(simbox, traces);
+        if (segy)
+          FFTGrid::writeSegyFile(fileName, simbox, z0, thf, traces);
+        if (sgri)
+          FFTGrid::writeSgriFile(fileName, simbox, label, traces);
+      }
       if ((formatFlag_ & IO::CRAVA) >0)
         FFTGrid::writeCravaFile(fileName, simbox);
     }
@@ -2020,12 +2090,10 @@ FFTGrid::writeFile(const std::string       & fName,
             "WARNING: Depth interval lacking when trying to write %s. Write cancelled.\n",depthName.c_str());
           return;
         }
-        if ((formatFlag_ & IO::STORM) > 0)
-          FFTGrid::writeStormFile(depthName, depthMap->getSimbox(), false);
-        if ((formatFlag_ & IO::ASCII) > 0)
-          FFTGrid::writeStormFile(depthName, depthMap->getSimbox(), true);
-        if ((formatFlag_ & IO::SEGY) >0)
-          makeDepthCubeForSegy(depthMap->getSimbox(),depthName);
+        if (storm || ascii)
+          FFTGrid::writeStormFiles(depthName, depthMap->getSimbox(), storm, ascii, false, false, false);
+        if (segy)
+          FFTGrid::writeSegyFromStorm(depthMap->getSimbox(), NULL, depthName + IO::SuffixSegy());
       }
       else
       {
@@ -2050,6 +2118,18 @@ FFTGrid::writeStormFile(const std::string & fileName,
                         bool                padding,
                         bool                flat,
                         bool                scientific_format)
+{
+  writeStormFiles(fileName, simbox, !ascii, ascii, padding, flat, scientific_format);
+}
+
+void
+FFTGrid::writeStormFiles(const std::string & fileName,
+                         const Simbox      * simbox,
+                         bool                binary,
+                         bool                ascii,
+                         bool                padding,
+                         bool                flat,
+                         bool                scientific_format)
 {
   int nx, ny, nz;
   if(padding == true)
@@ -2066,51 +2146,70 @@ FFTGrid::writeStormFile(const std::string & fileName,
   }
 
   std::string gfName;
-  std::string header = simbox->getStormHeader(cubetype_, nx, ny, nz, flat, ascii);
-  int i, j, k;
-  float value;
+  std::ofstream binFile;
+  std::ofstream file;
 
-  if(ascii == false) {
+  if(binary == true) {
     gfName = fileName + IO::SuffixStormBinary();
     LogKit::LogFormatted(LogKit::Low,"\nWriting STORM binary file "+gfName+"...");
-    std::ofstream binFile;
     NRLib::OpenWrite(binFile, gfName, std::ios::out | std::ios::binary);
-    binFile << header;
-    for(k=0;k<nz;k++)
-      for(j=0;j<ny;j++)
-        for(i=0;i<nx;i++)
-        {
-          value = getRealValue(i,j,k,true);
-          NRLib::WriteBinaryFloat(binFile, value);
-        }
-    binFile << "0\n";
-    binFile.close();
+    binFile << simbox->getStormHeader(cubetype_, nx, ny, nz, flat, false);
   }
-  else {
+  if(ascii == true) {
     gfName = fileName + IO::SuffixGeneralData();
-    std::ofstream file;
     NRLib::OpenWrite(file, gfName);
     LogKit::LogFormatted(LogKit::Low,"\nWriting STORM ascii file "+gfName+"...");
-    file << header;
+    file << simbox->getStormHeader(cubetype_, nx, ny, nz, flat, true);
     if (scientific_format){
       file << std::scientific;
     }
     else{
       file << std::fixed << std::setprecision(6);
     }
-    for(k=0;k<nz;k++)
-      for(j=0;j<ny;j++) {
-        for(i=0;i<nx-1;i++) {
-          value = getRealValue(i,j,k,true);
-          file << value << " ";              // Rearrangement to avoid trailing blanks
-        }
-        value = getRealValue(nx-1,j,k,true); // Rearrangement to avoid trailing blanks
-        file << value << "\n";
-      }
-    file << "0\n";
   }
 
-  LogKit::LogFormatted(LogKit::Low,"done\n");
+  int i, j, k;
+  for(k=0;k<nz;k++)
+    for(j=0;j<ny;j++)
+    {
+      // Rows are contiguous in the grid, and are written without copying.
+      const fftw_real * row = rvalue_ + j*rnxp_ + k*rnxp_*nyp_;
+      if(binary == true)
+        NRLib::WriteBinaryFloatArray(binFile, row, row + nx);
+      if(ascii == true)
+        for(i=0;i<nx;i++)
+          file << row[i] << (i < nx-1 ? " " : "\n"); // Rearrangement to avoid trailing blanks
+    }
+
+  if(binary == true) {
+    binFile << "0\n";
+    binFile.close();
+  }
+  if(ascii == true)
+    file << "0\n";
+
+  if(binary == true || ascii == true)
+    LogKit::LogFormatted(LogKit::Low,"done\n");
+}
+
+
+void
+FFTGrid::getTraceGeometry(const Simbox * simbox, std::vector<TraceGeometry> & traces) const
+{
+  int nx = simbox->getnx();
+  int ny = simbox->getny();
+  traces.resize(nx*ny);
+  for(int j=0;j<ny;j++)
+  {
+    for(int i=0;i<nx;i++)
+    {
+      TraceGeometry & trace = traces[i+j*nx];
+      simbox->getXYCoord(i, j, trace.x, trace.y);
+      trace.top = simbox->getTop(trace.x, trace.y);
+      trace.bot = simbox->getBot(trace.x, trace.y);
+      trace.dz  = simbox->getdz()*simbox->getRelThick(i,j);
+    }
+  }
 }
 
 
@@ -2119,6 +2218,19 @@ FFTGrid::writeSegyFile(const std::string       & fileName,
                        const Simbox            * simbox,
                        float                     z0,
                        const TraceHeaderFormat & thf)
+{
+  std::vector<TraceGeometry> traces;
+  getTraceGeometry(simbox, traces);
+  return(writeSegyFile(fileName, simbox, z0, thf, traces));
+}
+
+
+int
+FFTGrid::writeSegyFile(const std::string                & fileName,
+                       const Simbox                     * simbox,
+                       float                              z0,
+                       const TraceHeaderFormat          & thf,
+                       const std::vector<TraceGeometry> & traces)
 {
   //  long int timestart, timeend;
   //  time(&timestart);
@@ -2144,14 +2256,14 @@ FFTGrid::writeSegyFile(const std::string       & fileName,
   LogKit::LogFormatted(LogKit::Low,"\nWriting SEGY file "+gfName+"...");
 
   int i,j,k;
-  double x,y,z;
+  int nx = simbox->getnx();
   std::vector<float> trace(segynz);//Maximum amount of data needed.
   for(j=0;j<simbox->getny();j++)
   {
-    for(i=0;i<simbox->getnx();i++)
+    for(i=0;i<nx;i++)
     {
-      simbox->getCoord(i, j, 0, x, y, z);
-      z = simbox->getTop(x,y);
+      const TraceGeometry & geom = traces[i+j*nx];
+      double z = geom.top;
 
       if(z == RMISSING || z == WELLMISSING)
       {
@@ -2161,7 +2273,7 @@ FFTGrid::writeSegyFile(const std::string       & fileName,
       }
       else
       {
-        double gdz       = simbox->getdz()*simbox->getRelThick(i,j);
+        double gdz       = geom.dz;
         int    firstData = static_cast<int>(floor(0.5+(z-z0)/dz));
         int    endData   = static_cast<int>(floor(0.5+((z-z0)+nz_*gdz)/dz));
 
@@ -2178,8 +2290,8 @@ FFTGrid::writeSegyFile(const std::string       & fileName,
         for(;k<segynz;k++)
           trace[k] = 0;
 //          trace[k] = -1e35; //NBNB-Frode: Norsar-hack
-        float xx = static_cast<float>(x);
-        float yy = static_cast<float>(y);
+        float xx = static_cast<float>(geom.x);
+        float yy = static_cast<float>(geom.y);
         segy->StoreTrace(xx, yy, trace, NULL);
       }
     }
@@ -2204,23 +2316,40 @@ FFTGrid::writeResampledStormCube(const GridMapping * gridmapping,
 {
   // simbox is related to the cube we resample from. gridmapping contains simbox for the cube we resample to.
 
-  float time, kindex;
   StormContGrid *mapping = gridmapping->getMapping();
   StormContGrid *outgrid = new StormContGrid(*mapping);
 
-  double x,y;
+  // The layers and weights depend only on the mapping and simbox, and are shared by all
+  // grids written with this mapping. The interpolation is that of getRealValueInterpolated().
+  const int   * layers;
+  const float * weights;
+  gridmapping->getResamplingTables(simbox, layers, weights);
+
   int nz = static_cast<int>(mapping->GetNK());
-  for(int i=0;i<nx_;i++)
+#pragma omp parallel for
+  for(int j=0;j<ny_;j++)
   {
-    for(int j=0;j<ny_;j++)
+    for(int i=0;i<nx_;i++)
     {
-      simbox->getXYCoord(i,j,x,y);
+      const fftw_real * trace = rvalue_ + i + rnxp_*j;
       for(int k=0;k<nz;k++)
       {
-        time = (*mapping)(i,j,k);
-        kindex = float((time - static_cast<float>(simbox->getTop(x,y)))/simbox->getdz());
-        float value = getRealValueInterpolated(i,j,kindex);
-        (*outgrid)(i,j,k) = value;
+        size_t index = mapping->GetIndex(i,j,k);
+        int    layer = layers[index];
+        float  value = RMISSING;
+        if(layer >= 0 && layer < nz_)
+        {
+          float val1 = trace[layer*rnxp_*nyp_];
+          if(val1 != RMISSING)
+          {
+            float val2 = (layer+1 < nz_ ? trace[(layer+1)*rnxp_*nyp_] : RMISSING);
+            if(val2 == RMISSING)
+              value = val1;
+            else
+              value = float(1.0-weights[index])*val1+weights[index]*val2;
+          }
+        }
+        (*outgrid)(index) = value;
       }
     }
   }
@@ -2252,6 +2381,17 @@ FFTGrid::writeResampledStormCube(const GridMapping * gridmapping,
 
 int
 FFTGrid::writeSgriFile(const std::string & fileName, const Simbox *simbox, const std::string label)
+{
+  std::vector<TraceGeometry> traces;
+  getTraceGeometry(simbox, traces);
+  return(writeSgriFile(fileName, simbox, label, traces));
+}
+
+int
+FFTGrid::writeSgriFile(const std::string                & fileName,
+                       const Simbox                     * simbox,
+                       const std::string                  label,
+                       const std::vector<TraceGeometry> & traces)
 {
   double vertScale = 0.001;
   double horScale  = 0.001;
@@ -2298,27 +2438,28 @@ FFTGrid::writeSgriFile(const std::string & fileName, const Simbox *simbox, const
   std::ofstream binFile;
   NRLib::OpenWrite(binFile, fName, std::ios::out | std::ios::binary);
 
+#ifndef BIGENDIAN
+  NRLib::Endianess fileEndianess = NRLib::END_BIG_ENDIAN;
+#else
+  NRLib::Endianess fileEndianess = NRLib::END_LITTLE_ENDIAN;
+#endif
+
   int i,j,k;
-  double x, y, z, zTop, zBot;
-  float value;
+  double z;
+  std::vector<float> row(nx);
   for(k=0;k<nz;k++) {
+    z = zMin + k*dz;
     for (j=0; j<ny; j++) {
       for (i=0; i<nx; i++) {
-        simbox->getXYCoord(i, j, x, y);
-        zTop = simbox->getTop(x, y);
-        zBot = simbox->getBot(x, y);
-        z = zMin + k*dz;
-        if (z < zTop || z > zBot)
-          value = RMISSING;
+        const TraceGeometry & geom = traces[i+j*nx];
+        if (z < geom.top || z > geom.bot)
+          row[i] = RMISSING;
         else {
-           int simboxK = static_cast<int> ((z - zTop)/ (simbox->getdz()*simbox->getRelThick(i,j)) + 0.5);
-          value = getRealValue(i,j,simboxK);        }
-#ifndef BIGENDIAN
-        NRLib::WriteBinaryFloat(binFile, value);
-#else
-        NRLib::WriteBinaryFloat(binFile, value, END_LITTLE_ENDIAN);
-#endif
+          int simboxK = static_cast<int> ((z - geom.top)/geom.dz + 0.5);
+          row[i] = getRealValue(i,j,simboxK);
+        }
       }
+      NRLib::WriteBinaryFloatArray(binFile, row.begin(), row.end(), fileEndianess);
     }
   }
   return(0);
@@ -2333,7 +2474,7 @@ FFTGrid::writeCravaFile(const std::string & fileName, const Simbox * simbox)
     std::string fName = fileName + IO::SuffixCrava();
     NRLib::OpenWrite(binFile, fName, std::ios::out | std::ios::binary);
 
-    std::string fileType = "crava_fftgrid_binary";
+    std::string fileType = CravaGridFile::tiledLabel();
     binFile << fileType << "\n";
 
     NRLib::WriteBinaryDouble(binFile, simbox->getx0());
@@ -2352,8 +2493,7 @@ FFTGrid::writeCravaFile(const std::string & fileName, const Simbox * simbox)
     NRLib::WriteBinaryInt(binFile, rnxp_);
     NRLib::WriteBinaryInt(binFile, nyp_);
     NRLib::WriteBinaryInt(binFile, nzp_);
-    for(int i=0;i<rsize_;i++)
-      NRLib::WriteBinaryFloat(binFile, rvalue_[i]);
+    CravaGridFile::writeTiles(binFile, rvalue_, rnxp_, nyp_, nzp_, (allowLossyCrava_ ? cravaErrorBound_ : 0.0f));
 
     binFile.close();
   }
@@ -2369,28 +2509,12 @@ FFTGrid::readCravaFile(const std::string & fileName, std::string & errText, bool
 {
   std::string error;
   try {
-    std::ifstream binFile;
-    NRLib::OpenRead(binFile, fileName, std::ios::in | std::ios::binary);
-
-    std::string fileType;
-    getline(binFile,fileType);
-
-    double dummy = NRLib::ReadBinaryDouble(binFile);
-    dummy = NRLib::ReadBinaryDouble(binFile);
-    dummy = NRLib::ReadBinaryDouble(binFile);
-    dummy = NRLib::ReadBinaryDouble(binFile);
-    dummy = NRLib::ReadBinaryInt(binFile);
-    dummy = NRLib::ReadBinaryInt(binFile);
-    dummy = NRLib::ReadBinaryDouble(binFile);
-    dummy = NRLib::ReadBinaryDouble(binFile);
-    dummy = NRLib::ReadBinaryDouble(binFile);
-    dummy = NRLib::ReadBinaryDouble(binFile);
-    dummy = NRLib::ReadBinaryDouble(binFile);
-    dummy = NRLib::ReadBinaryDouble(binFile);
-    dummy = NRLib::ReadBinaryDouble(binFile);
-    int rnxp = NRLib::ReadBinaryInt(binFile);
-    int nyp  = NRLib::ReadBinaryInt(binFile);
-    int nzp  = NRLib::ReadBinaryInt(binFile);
+    // Reads both the tiled and the original format
+    CravaGridFile binFile(fileName);
+
+    int rnxp = binFile.getRNxp();
+    int nyp  = binFile.getNyp();
+    int nzp  = binFile.getNzp();
 
     if(rnxp != rnxp_ || nyp != nyp_ || nzp != nzp_) {
       LogKit::LogFormatted(LogKit::Low,"\n\nERROR: The grid has different dimensions than the model grid. Check the padding settings");
@@ -2398,16 +2522,11 @@ FFTGrid::readCravaFile(const std::string & fileName, std::string & errText, bool
       LogKit::LogFormatted(LogKit::Low,"\n--------------------------------");
       LogKit::LogFormatted(LogKit::Low,"\nModel grid  :   %4d  %4d  %4d",rnxp_,nyp_,nzp_);
       LogKit::LogFormatted(LogKit::Low,"\nGrid on file:   %4d  %4d  %4d\n",rnxp ,nyp ,nzp );
-      binFile.close();
       throw(NRLib::Exception("Grid dimension is wrong for file '"+fileName+"'."));
     }
     createRealGrid(!nopadding);
     add_ = !nopadding;
-    int i;
-    for(i=0;i<rsize_;i++)
-      rvalue_[i] = NRLib::ReadBinaryFloat(binFile);
-
-    binFile.close();
+    binFile.readSubVolume(0, 0, 0, rnxp_, nyp_, nzp_, rvalue_);
   }
   catch (NRLib::Exception & e) {
     error = std::string("Error: ") + e.what() + "\n";
@@ -2493,100 +2612,117 @@ void
 FFTGrid::interpolateSeismic(float energyTreshold)
 {
   assert(cubetype_ == DATA);
-  int i, j, k, index = 0;
+  int i, j, index = 0;
   short int * flags = new short int[nx_*ny_];
   int curFlag, flag = 0; //Flag rules: bit 0 = this trace bad, bit 1 = any prev. bad
   int imin = nx_;
   int imax = 0;
   int jmin = ny_;
   int jmax = 0;
-  float value, energy, totalEnergy = 0;;
+  float totalEnergy = 0;
   float * energyMap = new float[nx_*ny_];
+
+  // The energy of each trace is summed in the same order as trace by trace, but a row at a
+  // time, as the traces are strided in memory.
+#pragma omp parallel for schedule(dynamic)
+  for(int jj=0;jj<ny_;jj++)
+  {
+    float * energy = energyMap + jj*nx_;
+    for(int ii=0;ii<nx_;ii++)
+      energy[ii] = 0;
+    for(int k=0;k<nz_;k++)
+    {
+      const fftw_real * row = rvalue_ + jj*rnxp_ + k*rnxp_*nyp_;
+      for(int ii=0;ii<nx_;ii++)
+      {
+        float value = static_cast<float>(row[ii]);
+        energy[ii] += value*value;
+      }
+    }
+  }
+  for(index=0;index<nx_*ny_;index++)
+    totalEnergy += energyMap[index];
+
+  index = 0;
+  float energyLimit = energyTreshold*totalEnergy/float(nx_*ny_);
+  int nInter = 0;    //#traces interpolated.
+  int nInter0 = 0;   //#traces interpolated where there was no response at all.
   for(j=0;j<ny_;j++)
     for(i=0;i<nx_;i++)
     {
-      energy = 0;
-      for(k=0;k<nz_;k++) {
-        value = getRealValue(i, j, k);
-        energy += value*value;
+      curFlag = 0;
+      if(energyMap[index] <= energyLimit) {//Values in this trace are bogus, interpolate.
+        curFlag = 1;
+        nInter++;
+        if(energyMap[index] == 0.0f)
+          nInter0++;
+      }
+      flags[index] = short(flag+curFlag);
+      if(curFlag == 1)
+        flag = 2;
+      else
+      {
+        if(i < imin)
+          imin = i;
+        if(i > imax)
+          imax = i;
+        if(j < jmin)
+          jmin = j;
+        if(j > jmax)
+          jmax = j;
       }
-      energyMap[index] = energy;
-      totalEnergy += energy;
       index++;
     }
 
-    index = 0;
-    float energyLimit = energyTreshold*totalEnergy/float(nx_*ny_);
-    int nInter = 0;    //#traces interpolated.
-    int nInter0 = 0;   //#traces interpolated where there was no response at all.
-    for(j=0;j<ny_;j++)
-      for(i=0;i<nx_;i++)
-      {
-        curFlag = 0;
-        if(energyMap[index] <= energyLimit) {//Values in this trace are bogus, interpolate.
-          curFlag = 1;
-          nInter++;
-          if(energyMap[index] == 0.0f)
-            nInter0++;
-        }
-        flags[index] = short(flag+curFlag);
-        if(curFlag == 1)
-          flag = 2;
-        else
-        {
-          if(i < imin)
-            imin = i;
-          if(i > imax)
-            imax = i;
-          if(j < jmin)
-            jmin = j;
-          if(j > jmax)
-            jmax = j;
-        }
-        index++;
-      }
+  LogKit::LogFormatted(LogKit::Low,"\n%d of %d traces (%d with zero response)",
+    nInter, nx_*ny_, nInter0);
 
-      LogKit::LogFormatted(LogKit::Low,"\n%d of %d traces (%d with zero response)",
-        nInter, nx_*ny_, nInter0);
-      int curIndex = 0;
-      for(j=0;j<ny_;j++)
-        for(i=0;i<nx_;i++)
+  // Which traces are interpolated from which neighbours depends only on the flags. The
+  // interpolations are found trace by trace as before, and then done for all time samples in
+  // parallel, in the order they were found.
+  std::vector<TraceInterpolation> interpolations;
+  int curIndex = 0;
+  for(j=0;j<ny_;j++)
+    for(i=0;i<nx_;i++)
+    {
+      if((flags[curIndex] % 2) == 1)
+      {
+        if((interpolateTrace(curIndex, flags, i, j, interpolations) % 2) == 0)
         {
-          if((flags[curIndex] % 2) == 1)
+          index = curIndex-1;
+          while(index >= 0 && flags[index] > 1)
           {
-            if((interpolateTrace(curIndex, flags, i, j) % 2) == 0)
-            {
-              index = curIndex-1;
-              while(index >= 0 && flags[index] > 1)
-              {
-                if((flags[index] % 2) == 1)
-                  interpolateTrace(index, flags, (index % nx_), index/nx_);
-                index--;
-              }
-              if(index < 0)
-                index = 0;
-              assert(flags[index] < 2);
-              index++;
-              while(flags[index-1] == 0 && index <= curIndex)
-              {
-                if(flags[index] > 1)
-                  flags[index] -= 2;
-                index++;
-              }
-            }
+            if((flags[index] % 2) == 1)
+              interpolateTrace(index, flags, (index % nx_), index/nx_, interpolations);
+            index--;
+          }
+          if(index < 0)
+            index = 0;
+          assert(flags[index] < 2);
+          index++;
+          while(flags[index-1] == 0 && index <= curIndex)
+          {
+            if(flags[index] > 1)
+              flags[index] -= 2;
+            index++;
           }
-          curIndex++;
         }
-        extrapolateSeismic(imin, imax, jmin, jmax);
-        delete [] energyMap;
-        delete [] flags;
+      }
+      curIndex++;
+    }
+  interpolateTraces(interpolations);
+
+  extrapolateSeismic(imin, imax, jmin, jmax);
+  delete [] energyMap;
+  delete [] flags;
 }
 
 
 int
-FFTGrid::interpolateTrace(int index, short int * flags, int i, int j)
+FFTGrid::interpolateTrace(int index, short int * flags, int i, int j,
+                          std::vector<TraceInterpolation> & interpolations)
 {
-  int  k, nt = 0;
+  int nt = 0;
   bool left = (i > 0 && (flags[index-1] % 2) == 0);
   bool right = (i < nx_-1 && (flags[index+1] % 2) == 0);
   bool up = (j > 0 && (flags[index-nx_] % 2) == 0);
@@ -2597,26 +2733,15 @@ FFTGrid::interpolateTrace(int index, short int * flags, int i, int j)
   if(down == true) nt++;
   if(nt > 1)
   {
-    float * mean = new float[nzp_];
-    for(k=0;k<nzp_;k++)
-    {
-      if(left == true)
-        mean[k] = getRealValue(i-1, j, k,true);
-      else
-        mean[k] = 0;
-    }
-    if(right == true)
-      for(k=0;k<nzp_;k++)
-        mean[k] += getRealValue(i+1,j,k,true);
-    if(up == true)
-      for(k=0;k<nzp_;k++)
-        mean[k] += getRealValue(i,j-1,k,true);
-    if(down == true)
-      for(k=0;k<nzp_;k++)
-        mean[k] += getRealValue(i,j+1,k,true);
-    for(k=0;k<nzp_;k++)
-      setRealValue(i, j, k, mean[k]/float(nt),true);
-    delete [] mean;
+    TraceInterpolation interpolation;
+    interpolation.i     = i;
+    interpolation.j     = j;
+    interpolation.left  = left;
+    interpolation.right = right;
+    interpolation.up    = up;
+    interpolation.down  = down;
+    interpolation.nt    = nt;
+    interpolations.push_back(interpolation);
     assert((flags[index] % 2) == 1);
     flags[index]--;
   }
@@ -2624,35 +2749,82 @@ FFTGrid::interpolateTrace(int index, short int * flags, int i, int j)
 }
 
 
+void
+FFTGrid::interpolateTraces(const std::vector<TraceInterpolation> & interpolations)
+{
+  // A trace is the mean of its neighbours when it is interpolated, and these are either
+  // original traces or traces interpolated before it. Each time sample is done separately.
+  const int nInterpolations = static_cast<int>(interpolations.size());
+  if(nInterpolations == 0)
+    return;
+
+#pragma omp parallel for schedule(static)
+  for(int k=0;k<nzp_;k++)
+  {
+    fftw_real * slice = rvalue_ + k*rnxp_*nyp_;
+    for(int n=0;n<nInterpolations;n++)
+    {
+      const TraceInterpolation & interpolation = interpolations[n];
+      int   index = interpolation.i + rnxp_*interpolation.j;
+      float mean  = 0;
+      if(interpolation.left == true)
+        mean = static_cast<float>(slice[index-1]);
+      if(interpolation.right == true)
+        mean += static_cast<float>(slice[index+1]);
+      if(interpolation.up == true)
+        mean += static_cast<float>(slice[index-rnxp_]);
+      if(interpolation.down == true)
+        mean += static_cast<float>(slice[index+rnxp_]);
+      slice[index] = mean/float(interpolation.nt);
+    }
+  }
+}
+
+
 void
 FFTGrid::extrapolateSeismic(int imin, int imax, int jmin, int jmax)
 {
-  int i, j, k, refi, refj;
-  float value, distx, disty, distz, mult;
-  for(j=0;j<nyp_;j++)
+  // Only cells outside the area with data are set, from cells inside it, so the time samples
+  // are independent.
+  std::vector<int>   refI(nxp_);
+  std::vector<int>   refJ(nyp_);
+  std::vector<float> distX(nxp_);
+  std::vector<float> distY(nyp_);
+  for(int i=0;i<nxp_;i++)
   {
-    refj = getYSimboxIndex(j);
-    if(refj < jmin)
-      refj = jmin;
-    else if(refj > jmax)
-      refj = jmax;
-    for(i=0;i<nxp_;i++)
+    refI[i] = getXSimboxIndex(i);
+    if(refI[i] < imin)
+      refI[i] = imin;
+    else if(refI[i] > imax)
+      refI[i] = imax;
+    distX[i] = getDistToBoundary(i,nx_,nxp_);
+  }
+  for(int j=0;j<nyp_;j++)
+  {
+    refJ[j] = getYSimboxIndex(j);
+    if(refJ[j] < jmin)
+      refJ[j] = jmin;
+    else if(refJ[j] > jmax)
+      refJ[j] = jmax;
+    distY[j] = getDistToBoundary(j,ny_,nyp_);
+  }
+
+#pragma omp parallel for schedule(static)
+  for(int k=0;k<nzp_;k++)
+  {
+    fftw_real * slice = rvalue_ + k*rnxp_*nyp_;
+    float       distz = getDistToBoundary(k,nz_,nzp_);
+    for(int j=0;j<nyp_;j++)
     {
-      if(i < imin || i > imax || j < jmin || j > jmax)
+      float disty = distY[j];
+      for(int i=0;i<nxp_;i++)
       {
-        refi = getXSimboxIndex(i);
-        if(refi < imin)
-          refi = imin;
-        else if(refi > imax)
-          refi = imax;
-        for(k=0;k<nzp_;k++)
+        if(i < imin || i > imax || j < jmin || j > jmax)
         {
-          value = getRealValue(refi, refj, k, true);
-          distx  = getDistToBoundary(i,nx_,nxp_);
-          disty  = getDistToBoundary(j,ny_,nyp_);
-          distz  = getDistToBoundary(k,nz_,nzp_);
-          mult   = float(pow(std::max<double>(1.0-distx*distx-disty*disty-distz*distz,0.0),3));
-          setRealValue(i, j, k, mult*value, true);
+          float value = getRealValue(refI[i], refJ[j], k, true);
+          float distx = distX[i];
+          float mult  = float(pow(std::max<double>(1.0-distx*distx-disty*disty-distz*distz,0.0),3));
+          slice[i + rnxp_*j] = mult*value;
         }
       }
     }
@@ -2692,10 +2864,13 @@ FFTGrid::checkNaN()
 
 void FFTGrid::writeSegyFromStorm(Simbox * simbox, StormContGrid *data, std::string fileName)
 {
+  // Without data, the traces are taken directly from this grid, which then lies in simbox.
+  const NRLib::Volume & volume = (data != NULL ? static_cast<const NRLib::Volume &>(*data) : *simbox);
+
   int i,k,j;
   TextualHeader header = TextualHeader::standardHeader();
-  int nx = static_cast<int>(data->GetNI());
-  int ny = static_cast<int>(data->GetNJ());
+  int nx = (data != NULL ? static_cast<int>(data->GetNI()) : nx_);
+  int ny = (data != NULL ? static_cast<int>(data->GetNJ()) : ny_);
 
   SegyGeometry geometry (simbox->getx0(), simbox->gety0(), simbox->getdx(), simbox->getdy(),
                          simbox->getnx(), simbox->getny(),simbox->getIL0(), simbox->getXL0(),
@@ -2707,16 +2882,18 @@ void FFTGrid::writeSegyFromStorm(Simbox * simbox, StormContGrid *data, std::stri
   //                      nx,ny,data->GetAngle());
 
 
-  float dz = float(floor((data->GetLZ()/data->GetNK())));
+  int nk = (data != NULL ? static_cast<int>(data->GetNK()) : nz_);
+  float dz = float(floor((volume.GetLZ()/nk)));
   //int nz = int(data->GetZMax()/dz);
   //float z0 = float(data->GetZMin());
   float z0 = 0.0;
-  int nz = int(ceil((data->GetZMax())/dz));
+  int nz = int(ceil((volume.GetZMax(nx, ny))/dz));
   SegY segyout(fileName,0,nz,dz,header);
   segyout.SetGeometry(&geometry);
 
   std::vector<float> datavec;
   datavec.resize(nz);
+  float missing = (data != NULL ? data->GetMissingCode() : StormContGrid().GetMissingCode()); // As for a grid copied to a StormContGrid
   float x, y, xt, yt, z;
   for(j=0;j<ny;j++)
     for(i=0;i<nx;i++)
@@ -2726,8 +2903,8 @@ void FFTGrid::writeSegyFromStorm(Simbox * simbox, StormContGrid *data, std::stri
       x = float(geometry.GetX0()+xt*geometry.GetCosRot()-yt*geometry.GetSinRot());
       y = float(geometry.GetY0()+yt*geometry.GetCosRot()+xt*geometry.GetSinRot());
 
-      double zbot= data->GetBotSurface().GetZ(x,y);
-      double ztop = data->GetTopSurface().GetZ(x,y);
+      double zbot= volume.GetBotSurface().GetZ(x,y);
+      double ztop = volume.GetTopSurface().GetZ(x,y);
       int    firstData = static_cast<int>(floor((ztop)/dz));
       int    endData   = static_cast<int>(floor((zbot)/dz));
 
@@ -2741,10 +2918,43 @@ void FFTGrid::writeSegyFromStorm(Simbox * simbox, StormContGrid *data, std::stri
         datavec[k] = 0.0;
       }
 
-      for(k=firstData;k<endData;k++)
+      if(firstData < endData)
       {
-         z = z0+k*dz;
-        datavec[k] = float(data->GetValueZInterpolated(x,y,z));
+        // Same interpolation as StormContGrid::GetValueZInterpolated(), with the trace
+        // position and surfaces found once per trace rather than once per sample.
+        size_t ci, cj;
+        if (data != NULL)
+          data->FindXYIndex(x, y, ci, cj);
+        else {
+          int xInd, yInd;
+          simbox->getIndexes(x, y, xInd, yInd);
+          if (xInd == IMISSING || yInd == IMISSING)
+            throw NRLib::Exception("Trying to look up an xy-position outside grid.\n");
+          ci = static_cast<size_t>(xInd);
+          cj = static_cast<size_t>(yInd);
+        }
+        double gdz     = (zbot - ztop)/nk;
+        for(k=firstData;k<endData;k++)
+        {
+          z = z0+k*dz;
+          if(z <= ztop + 0.5*gdz)
+            datavec[k] = getSegyTraceValue(data, ci, cj, 0);
+          else if(z >= zbot - 0.5*gdz)
+            datavec[k] = getSegyTraceValue(data, ci, cj, nk-1);
+          else {
+            size_t kk = static_cast<size_t>(floor(((z - ztop)/gdz) - 0.5));
+            double t  = (z - ztop)/gdz - 0.5 - static_cast<double>(kk);
+            float  v1 = getSegyTraceValue(data, ci, cj, kk);
+            float  v2 = getSegyTraceValue(data, ci, cj, kk+1);
+            // Same interpolation as StormContGrid::GetValueZInterpolatedFromIndex()
+            if (v1 == missing)
+              datavec[k] = v2;
+            else if (v2 == missing)
+              datavec[k] = v1;
+            else
+              datavec[k] = static_cast<float>(v1*(1-t) + v2*t);
+          }
+        }
       }
       for(k=endData;k<nz;k++)
       {
@@ -2757,18 +2967,12 @@ void FFTGrid::writeSegyFromStorm(Simbox * simbox, StormContGrid *data, std::stri
 
 }
 
-void FFTGrid::makeDepthCubeForSegy(Simbox *simbox,const std::string & fileName)
+float FFTGrid::getSegyTraceValue(const StormContGrid * data, size_t i, size_t j, size_t k) const
 {
-  StormContGrid * stormcube = new StormContGrid((*simbox),nx_,ny_,nz_);
-
-  int i,j,k;
-  for(k=0;k<nz_;k++)
-    for(j=0;j<ny_;j++)
-      for(i=0;i<nx_;i++)
-        (*stormcube)(i,j,k) = getRealValue(i,j,k,true);
-
-  std::string fullFileName = fileName + IO::SuffixSegy();
-  FFTGrid::writeSegyFromStorm(simbox, stormcube, fullFileName);
+  if (data != NULL)
+    return((*data)(data->GetIndex(i, j, k)));
+  else
+    return(rvalue_[i + rnxp_*j + rnxp_*nyp_*k]);
 }
 
 int FFTGrid::findClosestFactorableNumber(int leastint)
@@ -2809,5 +3013,6 @@ int FFTGrid::maxAllowedGrids_   = 1;   // One grid is allocated and deallocated
 int FFTGrid::maxAllocatedGrids_ = 0;
 int FFTGrid::nGrids_            = 0;
 bool FFTGrid::terminateOnMaxGrid_ = false;
+float FFTGrid::cravaErrorBound_   = 0.0f;
 float FFTGrid::maxFFTMemUse_    = 0;
 float FFTGrid::FFTMemUse_       = 0;
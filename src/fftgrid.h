@@ -8,6 +8,7 @@
 #include <assert.h>
 #include <complex>
 #include <string>
+#include <vector>
 
 #include "fftw.h"
 #include "rfftw.h"
@@ -48,8 +49,8 @@ public:
                                               float                smooth_length);
                                               //std::string        & errTxt);
   void                 resampleTrace(const std::vector<float> & data_trace,
-                                     const rfftwnd_plan       & fftplan1,
-                                     const rfftwnd_plan       & fftplan2,
+                                     int                        nt,
+                                     int                        mt,
                                      fftw_real                * rAmpData,
                                      fftw_real                * rAmpFine,
                                      int                        cnt,
@@ -132,6 +133,7 @@ public:
   virtual int          logTransf();                             // No mode/randomaccess
   virtual void         realAbs();
   virtual int          collapseAndAdd(float* grid);             // No mode/randomaccess
+  void                 addLateralAutoCorrelation(float * grid); // Randomaccess
   virtual void         fftInPlace();                            // No mode/randomaccess
   virtual void         invFFTInPlace();                         // No mode/randomaccess
 
@@ -194,6 +196,7 @@ public:
                                                const Simbox *simbox, const int format);
   virtual void         writeCravaFile(const std::string & fileName, const Simbox * simbox);
   virtual void         readCravaFile(const std::string & fileName, std::string & errText, bool nopadding = false);
+  void                 setAllowLossyCrava(bool allow) { allowLossyCrava_ = allow ;} // For probability and covariance grids
 
   virtual bool         isFile() {return(0);}    // indicates wether the grid is in memory or on disk
 
@@ -205,7 +208,10 @@ public:
   static void          setMaxAllowedGrids(int maxAllowedGrids) {maxAllowedGrids_ = maxAllowedGrids ;}
   static int           getMaxAllowedGrids()   { return maxAllowedGrids_   ;}
   static int           getMaxAllocatedGrids() { return maxAllocatedGrids_ ;}
+  static int           getNumberOfGrids()     { return nGrids_            ;}
+  static float         getMaxFFTMemUse()      { return maxFFTMemUse_      ;}
   static void          setTerminateOnMaxGrid(bool terminate) {terminateOnMaxGrid_ = terminate ;}
+  static void          setCravaErrorBound(float errorBound) {cravaErrorBound_ = errorBound ;}
   static int           findClosestFactorableNumber(int leastint);
 
   static fftw_complex* fft1DzInPlace(fftw_real*  in, int nzp);
@@ -246,13 +252,44 @@ protected:
                                                          double dzReg, int kReg,
                                                          double z0Grid, double dzGrid);
 
+  /// Position, top, base and sampling of a trace in the simbox. Found once and shared by the SegY and sgri writers.
+  struct TraceGeometry
+  {
+    double x;
+    double y;
+    double top;
+    double bot;
+    double dz;
+  };
+  void                 getTraceGeometry(const Simbox * simbox, std::vector<TraceGeometry> & traces) const;
+
+  /// Writes binary and/or ascii storm files in one traversal of the grid.
+  void                 writeStormFiles(const std::string & fileName, const Simbox * simbox, bool binary, bool ascii,
+                                       bool padding, bool flat, bool scientific_format);
+  int                  writeSegyFile(const std::string & fileName, const Simbox * simbox, float z0,
+                                     const TraceHeaderFormat & thf, const std::vector<TraceGeometry> & traces);
+  int                  writeSgriFile(const std::string & fileName, const Simbox * simbox, const std::string label,
+                                     const std::vector<TraceGeometry> & traces);
+
   //Supporting functions for interpolateSeismic
-  int                  interpolateTrace(int index, short int * flags, int i, int j);
+  struct TraceInterpolation
+  {
+    int  i;
+    int  j;
+    bool left;                                // Neighbours the trace is the mean of
+    bool right;
+    bool up;
+    bool down;
+    int  nt;                                  // Number of neighbours
+  };
+  int                  interpolateTrace(int index, short int * flags, int i, int j,
+                                        std::vector<TraceInterpolation> & interpolations);
+  void                 interpolateTraces(const std::vector<TraceInterpolation> & interpolations);
   void                 extrapolateSeismic(int imin, int imax, int jmin, int jmax);
 
-  /// Called from writeResampledStormCube
+  /// Writes a depth SegY cube from data, or directly from this grid in simbox if data is NULL.
   void                 writeSegyFromStorm(Simbox * simbox, StormContGrid *data, std::string fileName);
-  void                 makeDepthCubeForSegy(Simbox *simbox,const std::string & fileName);
+  float                getSegyTraceValue(const StormContGrid * data, size_t i, size_t j, size_t k) const;
 
   int                  cubetype_;          // see enum gridtypes above
   float                theta_;             // angle in angle gather (case of data)
@@ -289,6 +326,9 @@ protected:
   static int           nGrids_;            // The actually number of grids allocated (varies as crava runs).
   static bool          terminateOnMaxGrid_; // If true, terminate when we try to allocate more than maxAllowedGrids.
   bool                 add_;                // Tells whether we should change nGrids_ or not
+  bool                 allowLossyCrava_;    // If true, the grid is stored with cravaErrorBound_ in crava files
+
+  static float         cravaErrorBound_;    // Error bound for lossy crava files (0 = lossless).
 
   static float         maxFFTMemUse_;
   static float         FFTMemUse_;
@@ -183,14 +183,6 @@ GravimetricInversion::GravimetricInversion(ModelGeneral            *  modelGener
   LogKit::WriteHeader("Performing Gravimetric Inversion");
 
   NRLib::Matrix G = modelGravityDynamic->GetGMatrix();
-  ExpandMatrixWithZeros(G, Np_up, include_level_shift);
-
-  NRLib::Vector    Rho(Np_up);
-  VectorizeFFTGrid(Rho, upscaled_mean_rho_total);
-
-  NRLib::Matrix            Sigma(Np_up, Np_up);
-  NRLib::InitializeMatrix (Sigma, 0.0);
-  ReshapeCovAccordingToLag(Sigma, upscaled_cov_rho_total);
 
   NRLib::Vector      gravity_data(30);
   std::vector<float> d = modelGravityDynamic->GetGravityResponse();
@@ -207,52 +199,77 @@ GravimetricInversion::GravimetricInversion(ModelGeneral            *  modelGener
     }
     shift_parameter = shift_parameter*10;
 
-  if(include_level_shift){
-    // Expand prior mean with one element equal to 0
-    int l = Rho.length();
-    NRLib::Vector RhoNew(l+1);
-    for(int i = 0; i<Rho.length(); i++){
-      RhoNew(i) = Rho(i);
-    }
-    RhoNew(l) = 0;   // set last value
-    Rho = RhoNew;
+  FFTGrid * posterior_upscaled_cov_rho_total = new FFTGrid(nx_upscaled, ny_upscaled, nz_upscaled,
+                                                           nxp_upscaled, nyp_upscaled, nzp_upscaled);
+  posterior_upscaled_cov_rho_total->createRealGrid();
+  posterior_upscaled_cov_rho_total->setType(FFTGrid::PARAMETER);
 
-    // Expand prior covariance matrix
-    ExpandCovMatrixWithLevelShift(Sigma, shift_parameter);
+  bool matrix_free = modelGravityStatic->GetMatrixFree();
+
+  if(matrix_free){
+    // Updates upscaled_mean_rho_total to the posterior mean
+    level_shift = MatrixFreeInversion(G, gravity_data, Sigma_error, shift_parameter, include_level_shift,
+                                      upscaled_mean_rho_total, upscaled_cov_rho_total, posterior_upscaled_cov_rho_total);
   }
+  else{
+    ExpandMatrixWithZeros(G, Np_up, include_level_shift);
 
-  NRLib::WriteVectorToFile("Rho_prior.txt", Rho);
+    NRLib::Vector    Rho(Np_up);
+    VectorizeFFTGrid(Rho, upscaled_mean_rho_total);
 
-  NRLib::Vector Rho_posterior  (Np_up);
-  NRLib::Matrix Sigma_posterior(Np_up, Np_up);
+    NRLib::Matrix            Sigma(Np_up, Np_up);
+    NRLib::InitializeMatrix (Sigma, 0.0);
+    ReshapeCovAccordingToLag(Sigma, upscaled_cov_rho_total);
 
-  NRLib::Matrix GT         = NRLib::transpose(G);
-  NRLib::Matrix G_Sigma    = G * Sigma;
-  NRLib::Matrix G_Sigma_GT = G_Sigma * GT;
-  NRLib::Matrix Sigma_GT   = Sigma * GT;
+    if(include_level_shift){
+      // Expand prior mean with one element equal to 0
+      int l = Rho.length();
+      NRLib::Vector RhoNew(l+1);
+      for(int i = 0; i<Rho.length(); i++){
+        RhoNew(i) = Rho(i);
+      }
+      RhoNew(l) = 0;   // set last value
+      Rho = RhoNew;
 
-  NRLib::Matrix inv_G_Sigma_GT_plus_Sigma_error = G_Sigma_GT + Sigma_error;
-  NRLib::Invert(inv_G_Sigma_GT_plus_Sigma_error);
+      // Expand prior covariance matrix
+      ExpandCovMatrixWithLevelShift(Sigma, shift_parameter);
+    }
 
-  NRLib::Vector temp_1 = gravity_data - G*Rho;
-  NRLib::Vector temp_2 = inv_G_Sigma_GT_plus_Sigma_error * temp_1;
-  temp_1               = Sigma_GT*temp_2;
-  Rho_posterior        = Rho + temp_1;
+    NRLib::WriteVectorToFile("Rho_prior.txt", Rho);
 
+    NRLib::Vector Rho_posterior  (Np_up);
+    NRLib::Matrix Sigma_posterior(Np_up, Np_up);
 
-  NRLib::Matrix temp_3 = inv_G_Sigma_GT_plus_Sigma_error * G_Sigma;
-  NRLib::Matrix temp_4 = Sigma_GT*temp_3;
-  Sigma_posterior      = Sigma - temp_4;
+    NRLib::Matrix GT         = NRLib::transpose(G);
+    NRLib::Matrix G_Sigma    = G * Sigma;
+    NRLib::Matrix G_Sigma_GT = G_Sigma * GT;
+    NRLib::Matrix Sigma_GT   = Sigma * GT;
 
-  // Remove shift parameter
-  if(include_level_shift){
-    RemoveLevelShiftFromVector(Rho_posterior, level_shift);
-    RemoveLevelShiftFromCovMatrix(Sigma_posterior);
-  }
-  NRLib::WriteVectorToFile("Rho_posterior.txt", Rho_posterior);
+    NRLib::Matrix inv_G_Sigma_GT_plus_Sigma_error = G_Sigma_GT + Sigma_error;
+    NRLib::Invert(inv_G_Sigma_GT_plus_Sigma_error);
 
-  // Reshape back to FFTGrid
-  ReshapeVectorToFFTGrid(upscaled_mean_rho_total, Rho_posterior);
+    NRLib::Vector temp_1 = gravity_data - G*Rho;
+    NRLib::Vector temp_2 = inv_G_Sigma_GT_plus_Sigma_error * temp_1;
+    temp_1               = Sigma_GT*temp_2;
+    Rho_posterior        = Rho + temp_1;
+
+
+    NRLib::Matrix temp_3 = inv_G_Sigma_GT_plus_Sigma_error * G_Sigma;
+    NRLib::Matrix temp_4 = Sigma_GT*temp_3;
+    Sigma_posterior      = Sigma - temp_4;
+
+    // Remove shift parameter
+    if(include_level_shift){
+      RemoveLevelShiftFromVector(Rho_posterior, level_shift);
+      RemoveLevelShiftFromCovMatrix(Sigma_posterior);
+    }
+    NRLib::WriteVectorToFile("Rho_posterior.txt", Rho_posterior);
+
+    // Reshape back to FFTGrid
+    ReshapeVectorToFFTGrid(upscaled_mean_rho_total, Rho_posterior);
+
+    ReshapeCovMatrixToFFTGrid(posterior_upscaled_cov_rho_total, Sigma_posterior);
+  }
 
   // For backsampling and deconvolution, need to be in FFT-domain
   if(mean_rho_total->getIsTransformed()==false)
@@ -265,15 +282,6 @@ GravimetricInversion::GravimetricInversion(ModelGeneral            *  modelGener
   Backsample(upscaled_mean_rho_total, mean_rho_total); //Now meanRhoTotal is posterior!
   Divide(mean_rho_total, upscaling_kernel_conj);
 
-  /// Posterior upscaled covariance
-  FFTGrid * posterior_upscaled_cov_rho_total = new FFTGrid(nx_upscaled, ny_upscaled, nz_upscaled,
-                                                           nxp_upscaled, nyp_upscaled, nzp_upscaled);
-  posterior_upscaled_cov_rho_total->createRealGrid();
-  posterior_upscaled_cov_rho_total->setType(FFTGrid::PARAMETER);
-
-  ReshapeCovMatrixToFFTGrid(posterior_upscaled_cov_rho_total, Sigma_posterior);
-
-
   // Odds algorithme
   // Pick elements that corresponds to effect of inversion, not from adjusting to pos def matrix, in FFT domain
   FFTGrid * fft_factor = new FFTGrid(nx_upscaled,  ny_upscaled,  nz_upscaled,
@@ -350,14 +358,16 @@ GravimetricInversion::GravimetricInversion(ModelGeneral            *  modelGener
   Divide(cov_rho_total, upscaling_kernel_abs);
 
 
-   // Only for debugging purposes
-  if(posterior_upscaled_cov_rho_total->getIsTransformed() == true)
-    posterior_upscaled_cov_rho_total->invFFTInPlace();
-  NRLib::Matrix Post_sigma_temp(Np_up, Np_up);
-  NRLib::InitializeMatrix (Post_sigma_temp, 0.0);
+   // Only for debugging purposes. Not written in the matrix free inversion, as the matrix is too large.
+  if(matrix_free == false){
+    if(posterior_upscaled_cov_rho_total->getIsTransformed() == true)
+      posterior_upscaled_cov_rho_total->invFFTInPlace();
+    NRLib::Matrix Post_sigma_temp(Np_up, Np_up);
+    NRLib::InitializeMatrix (Post_sigma_temp, 0.0);
 
-  ReshapeCovAccordingToLag(Post_sigma_temp, posterior_upscaled_cov_rho_total);
-  NRLib::WriteMatrixToFile("Sigma_posterior.txt", Post_sigma_temp);
+    ReshapeCovAccordingToLag(Post_sigma_temp, posterior_upscaled_cov_rho_total);
+    NRLib::WriteMatrixToFile("Sigma_posterior.txt", Post_sigma_temp);
+  }
 
 
   // For transforming back to log-domain, need to be in real domain
@@ -849,7 +859,7 @@ void
 }
 
 void
-  GravimetricInversion::RemoveLevelShiftFromVector(NRLib::Vector &rho, double level_shift)
+  GravimetricInversion::RemoveLevelShiftFromVector(NRLib::Vector &rho, double &level_shift)
 {
     int r       = rho.length();
 
@@ -880,6 +890,221 @@ void
   Sigma = new_Sigma;
 }
 
+double
+  GravimetricInversion::MatrixFreeInversion(const NRLib::Matrix & G,
+                                            const NRLib::Vector & gravity_data,
+                                            const NRLib::Matrix & Sigma_error,
+                                            double                shift_parameter,
+                                            bool                  include_level_shift,
+                                            FFTGrid             * mean_grid,
+                                            FFTGrid             * cov_grid,
+                                            FFTGrid             * posterior_cov_grid)
+{
+  // The prior covariance Sigma(I,J) = c(x_J - x_I) is circulant on the padded grid, so Sigma*g is a
+  // circular correlation with c. Only the columns of U = Sigma*G^T are formed, and the posterior is
+  //
+  //   rho_post   = rho + U*W*(d - G*rho)
+  //   Sigma_post = Sigma - U*W*U^T,        W = (G*U + Sigma_error)^-1
+  //
+  // The columns of G are the grid cells without padding, with k running fastest. The level shift is
+  // an extra parameter with prior variance shift_parameter, independent of rho. Its column of G is one
+  // for every observation, so its row of U is shift_parameter and its posterior mean is
+  // shift_parameter*sum_r (W*residual)(r).
+
+  assert(mean_grid->getIsTransformed() == false);
+  assert(cov_grid ->getIsTransformed() == false);
+
+  int nx   = mean_grid->getNx();
+  int ny   = mean_grid->getNy();
+  int nz   = mean_grid->getNz();
+  int nxp  = mean_grid->getNxp();
+  int nyp  = mean_grid->getNyp();
+  int nzp  = mean_grid->getNzp();
+  int N    = nx*ny*nz;
+  int Np   = nxp*nyp*nzp;
+  int nObs = G.rows().length();
+
+  assert(G.cols().length() == N);
+
+  // Index in padded grid, I = i + j*nxp + k*nxp*nyp, for each column of G
+  std::vector<int> cell_index(N);
+  int J = 0;
+  for(int i = 0; i < nx; i++){
+    for(int j = 0; j < ny; j++){
+      for(int k = 0; k < nz; k++){
+        cell_index[J] = i + j*nxp + k*nxp*nyp;
+        J++;
+      }
+    }
+  }
+
+  FFTGrid * cov_fft = new FFTGrid(cov_grid);
+  cov_fft->setType(FFTGrid::COVARIANCE);  // Unscaled transform, so that a product with a parameter grid is a convolution
+  cov_fft->fftInPlace();
+  cov_fft->conjugate();                   // Correlation rather than convolution
+
+  FFTGrid * work = new FFTGrid(nx, ny, nz, nxp, nyp, nzp);
+  work->createRealGrid();
+  work->setType(FFTGrid::PARAMETER);
+
+  // U = Sigma*G^T for all cells in the padded grid. The level shift row is shift_parameter.
+  NRLib::Matrix U(Np, nObs);
+  for(int r = 0; r < nObs; r++){
+    work->setTransformedStatus(false);
+    work->fillInConstant(0.0);
+    work->setAccessMode(FFTGrid::RANDOMACCESS);
+    for(J = 0; J < N; J++)
+      work->setRealValue(cell_index[J] % nxp, (cell_index[J] / nxp) % nyp, cell_index[J] / (nxp*nyp), static_cast<float>(G(r,J)));
+    work->endAccess();
+
+    work->fftInPlace();
+    work->multiply(cov_fft);
+    work->invFFTInPlace();
+
+    work->setAccessMode(FFTGrid::RANDOMACCESS);
+    for(int k = 0; k < nzp; k++)
+      for(int j = 0; j < nyp; j++)
+        for(int i = 0; i < nxp; i++)
+          U(i + j*nxp + k*nxp*nyp, r) = work->getRealValue(i, j, k, true);
+    work->endAccess();
+  }
+  delete cov_fft;
+
+  // Data space system. The level shift adds the same value to all observations, so with
+  // prior variance shift_parameter it adds shift_parameter to every element of W.
+  NRLib::Vector rho(Np);
+  mean_grid->setAccessMode(FFTGrid::RANDOMACCESS);
+  for(int k = 0; k < nzp; k++)
+    for(int j = 0; j < nyp; j++)
+      for(int i = 0; i < nxp; i++)
+        rho(i + j*nxp + k*nxp*nyp) = mean_grid->getRealValue(i, j, k, true);
+  mean_grid->endAccess();
+
+  NRLib::Matrix W(nObs, nObs);
+  NRLib::Vector residual(nObs);
+  for(int r = 0; r < nObs; r++){
+    residual(r) = gravity_data(r);
+    for(J = 0; J < N; J++)
+      residual(r) -= G(r,J)*rho(cell_index[J]);   // Prior mean of level shift is zero
+
+    for(int b = 0; b < nObs; b++){
+      double sum = Sigma_error(r,b);
+      for(J = 0; J < N; J++)
+        sum += G(r,J)*U(cell_index[J], b);
+      if(include_level_shift)
+        sum += shift_parameter;
+      W(r,b) = sum;
+    }
+  }
+  NRLib::Invert(W);
+
+  NRLib::Vector v = W*residual;
+
+  double level_shift = 0.0;
+  if(include_level_shift){
+    for(int r = 0; r < nObs; r++)
+      level_shift += v(r);
+    level_shift *= shift_parameter;
+  }
+
+  // Posterior mean, including the padded region
+  NRLib::Vector rho_prior(N);
+  NRLib::Vector rho_posterior(N);
+  for(J = 0; J < N; J++)
+    rho_prior(J) = rho(cell_index[J]);
+
+  NRLib::Vector delta = U*v;
+  mean_grid->setAccessMode(FFTGrid::RANDOMACCESS);
+  for(int k = 0; k < nzp; k++)
+    for(int j = 0; j < nyp; j++)
+      for(int i = 0; i < nxp; i++){
+        int I = i + j*nxp + k*nxp*nyp;
+        mean_grid->setRealValue(i, j, k, static_cast<float>(rho(I) + delta(I)), true);
+      }
+  mean_grid->endAccess();
+
+  for(J = 0; J < N; J++)
+    rho_posterior(J) = rho(cell_index[J]) + delta(cell_index[J]);
+
+  NRLib::WriteVectorToFile("Rho_prior.txt", rho_prior);
+  NRLib::WriteVectorToFile("Rho_posterior.txt", rho_posterior);
+
+  // As in the dense inversion, the posterior covariance is made stationary by averaging Sigma_post(I,J)
+  // over the cells J without padding, for each lag l = x_J - x_I. With Y = U*W this gives
+  //
+  //   post(l) = c(l) - 1/N sum_r sum_J Y(J,r)*U(J-l,r)
+  //
+  // where the sum over J is a circular correlation, found by FFT for each r.
+  NRLib::Matrix Y(N, nObs);
+  for(J = 0; J < N; J++){
+    for(int r = 0; r < nObs; r++){
+      double sum = 0.0;
+      for(int b = 0; b < nObs; b++)
+        sum += U(cell_index[J], b)*W(b,r);
+      Y(J,r) = sum;
+    }
+  }
+
+  FFTGrid * y_grid = new FFTGrid(nx, ny, nz, nxp, nyp, nzp);
+  y_grid->createRealGrid();
+  y_grid->setType(FFTGrid::PARAMETER);
+
+  FFTGrid * correlation = new FFTGrid(nx, ny, nz, nxp, nyp, nzp);
+  correlation->setType(FFTGrid::PARAMETER);
+  correlation->fillInConstant(0.0);
+  correlation->fftInPlace();
+
+  for(int r = 0; r < nObs; r++){
+    y_grid->fillInConstant(0.0);
+    y_grid->setAccessMode(FFTGrid::RANDOMACCESS);
+    for(J = 0; J < N; J++)
+      y_grid->setRealValue(cell_index[J] % nxp, (cell_index[J] / nxp) % nyp, cell_index[J] / (nxp*nyp), static_cast<float>(Y(J,r)));
+    y_grid->endAccess();
+
+    work->fillInConstant(0.0);
+    work->setAccessMode(FFTGrid::RANDOMACCESS);
+    for(int k = 0; k < nzp; k++)
+      for(int j = 0; j < nyp; j++)
+        for(int i = 0; i < nxp; i++)
+          work->setRealValue(i, j, k, static_cast<float>(U(i + j*nxp + k*nxp*nyp, r)), true);
+    work->endAccess();
+
+    y_grid->fftInPlace();
+    work  ->fftInPlace();
+    work  ->conjugate();
+    y_grid->multiply(work);
+    correlation->add(y_grid);
+
+    y_grid->setTransformedStatus(false);  // Going to fill them with new values in real domain
+    work  ->setTransformedStatus(false);
+  }
+  correlation->invFFTInPlace();
+
+  // Each parameter transform is scaled by 1/sqrt(Np), so the product is scaled by 1/sqrt(Np) after the inverse.
+  double scale = sqrt(static_cast<double>(Np))/N;
+
+  correlation       ->setAccessMode(FFTGrid::RANDOMACCESS);
+  cov_grid          ->setAccessMode(FFTGrid::RANDOMACCESS);
+  posterior_cov_grid->setAccessMode(FFTGrid::RANDOMACCESS);
+  for(int k = 0; k < nzp; k++){
+    for(int j = 0; j < nyp; j++){
+      for(int i = 0; i < nxp; i++){
+        double value = cov_grid->getRealValue(i, j, k, true) - scale*correlation->getRealValue(i, j, k, true);
+        posterior_cov_grid->setRealValue(i, j, k, static_cast<float>(value), true);
+      }
+    }
+  }
+  correlation       ->endAccess();
+  cov_grid          ->endAccess();
+  posterior_cov_grid->endAccess();
+
+  delete work;
+  delete y_grid;
+  delete correlation;
+
+  return(level_shift);
+}
+
 
 
 void
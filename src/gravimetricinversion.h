@@ -59,9 +59,21 @@ private:
   // Functions related to expanding linear system with level_shift unknown
   void                   ExpandMatrixWithZeros(NRLib::Matrix &G, int Np, bool include_level_shift);
   void                   ExpandCovMatrixWithLevelShift(NRLib::Matrix &Sigma, double shift_parameter);
-  void                   RemoveLevelShiftFromVector(NRLib::Vector &rho, double level_shift);
+  void                   RemoveLevelShiftFromVector(NRLib::Vector &rho, double &level_shift);
   void                   RemoveLevelShiftFromCovMatrix(NRLib::Matrix &Sigma);
 
+  // Alternative to the dense inversion, where Sigma*G^T is found by FFT and the posterior covariance is
+  // a low rank update of the prior. Updates mean_grid to the posterior mean and returns the posterior
+  // level shift (zero when include_level_shift is false). All grids in real domain.
+  double                 MatrixFreeInversion(const NRLib::Matrix & G,
+                                             const NRLib::Vector & gravity_data,
+                                             const NRLib::Matrix & Sigma_error,
+                                             double                shift_parameter,
+                                             bool                  include_level_shift,
+                                             FFTGrid             * mean_grid,
+                                             FFTGrid             * cov_grid,
+                                             FFTGrid             * posterior_cov_grid);
+
   void                   Divide(FFTGrid *& fftGrid_numerator, FFTGrid * fftGrid_denominator);
 
   void                   ComputeSyntheticGravimetry(FFTGrid * rho, ModelGravityDynamic *& modelGravityDynamic, double level_shift);
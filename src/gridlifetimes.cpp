@@ -0,0 +1,155 @@
+/***************************************************************************
+*      Copyright (C) 2008 by Norwegian Computing Center and Statoil        *
+***************************************************************************/
+
+#include <assert.h>
+#include <algorithm>
+
+#include "nrlib/iotools/logkit.hpp"
+#include "nrlib/iotools/stringtools.hpp"
+
+#include "src/definitions.h"
+#include "src/gridlifetimes.h"
+
+GridLifetimes::GridLifetimes(long long int gridSizePad,
+                             long long int gridSizeBase)
+  : gridSizePad_(gridSizePad),
+    gridSizeBase_(gridSizeBase)
+{
+  for(int phase = 0 ; phase < N_PHASES ; phase++)
+    active_[phase] = true;
+}
+
+void
+GridLifetimes::addPaddedGrids(const std::string & name, int nGrids, int firstPhase, int lastPhase)
+{
+  addGroup(name, nGrids, 0, 0, firstPhase, lastPhase);
+}
+
+void
+GridLifetimes::addUnpaddedGrids(const std::string & name, int nGrids, int firstPhase, int lastPhase)
+{
+  addGroup(name, 0, nGrids, 0, firstPhase, lastPhase);
+}
+
+void
+GridLifetimes::addMemory(const std::string & name, long long int memory, int firstPhase, int lastPhase)
+{
+  addGroup(name, 0, 0, memory, firstPhase, lastPhase);
+}
+
+void
+GridLifetimes::addGroup(const std::string & name,
+                        int                 nPadded,
+                        int                 nUnpadded,
+                        long long int       memory,
+                        int                 firstPhase,
+                        int                 lastPhase)
+{
+  assert(firstPhase >= 0 && firstPhase <= lastPhase && lastPhase < N_PHASES);
+  if(nPadded == 0 && nUnpadded == 0 && memory == 0)
+    return;
+
+  Group group;
+  group.name       = name;
+  group.nPadded    = nPadded;
+  group.nUnpadded  = nUnpadded;
+  group.memory     = memory;
+  group.firstPhase = firstPhase;
+  group.lastPhase  = lastPhase;
+  groups_.push_back(group);
+}
+
+long long int
+GridLifetimes::getMemory(const Group & group) const
+{
+  return(group.nPadded*gridSizePad_ + group.nUnpadded*gridSizeBase_ + group.memory);
+}
+
+bool
+GridLifetimes::isAlive(const Group & group, int phase) const
+{
+  return(active_[phase] && group.firstPhase <= phase && phase <= group.lastPhase);
+}
+
+long long int
+GridLifetimes::getMemory(int phase) const
+{
+  long long int memory = 0;
+  for(size_t i = 0 ; i < groups_.size() ; i++) {
+    if(isAlive(groups_[i], phase))
+      memory += getMemory(groups_[i]);
+  }
+  return(memory);
+}
+
+long long int
+GridLifetimes::getPeakMemory() const
+{
+  long long int peak = 0;
+  for(int phase = 0 ; phase < N_PHASES ; phase++)
+    peak = std::max(peak, getMemory(phase));
+  return(peak);
+}
+
+int
+GridLifetimes::getPeakPaddedGrids() const
+{
+  int peak = 0;
+  for(int phase = 0 ; phase < N_PHASES ; phase++) {
+    int nGrids = 0;
+    for(size_t i = 0 ; i < groups_.size() ; i++) {
+      if(isAlive(groups_[i], phase))
+        nGrids += groups_[i].nPadded;
+    }
+    peak = std::max(peak, nGrids);
+  }
+  return(peak);
+}
+
+void
+GridLifetimes::writeSchedule() const
+{
+  const char * phaseNames[N_PHASES] = {"Inversion", "Simulation", "Facies prob."};
+  const float  megaByte             = 1024.0f*1024.0f;
+
+  LogKit::LogFormatted(LogKit::Medium,"\nMemory held by grids in each phase (MB):\n\n");
+  LogKit::LogFormatted(LogKit::Medium,"  %-36s","Grids");
+  for(int phase = 0 ; phase < N_PHASES ; phase++) {
+    if(active_[phase])
+      LogKit::LogFormatted(LogKit::Medium,"%14s",phaseNames[phase]);
+  }
+  LogKit::LogFormatted(LogKit::Medium,"\n  ------------------------------------");
+  for(int phase = 0 ; phase < N_PHASES ; phase++) {
+    if(active_[phase])
+      LogKit::LogFormatted(LogKit::Medium,"--------------");
+  }
+  LogKit::LogFormatted(LogKit::Medium,"\n");
+
+  for(size_t i = 0 ; i < groups_.size() ; i++) {
+    const Group & group = groups_[i];
+    std::string   label = group.name;
+    if(group.nPadded > 0)
+      label += " ("+NRLib::ToString(group.nPadded)+" padded)";
+    else if(group.nUnpadded > 0)
+      label += " ("+NRLib::ToString(group.nUnpadded)+")";
+
+    LogKit::LogFormatted(LogKit::Medium,"  %-36s",label.c_str());
+    for(int phase = 0 ; phase < N_PHASES ; phase++) {
+      if(active_[phase] == false)
+        continue;
+      if(isAlive(group, phase))
+        LogKit::LogFormatted(LogKit::Medium,"%14.2f",getMemory(group)/megaByte);
+      else
+        LogKit::LogFormatted(LogKit::Medium,"%14s","-");
+    }
+    LogKit::LogFormatted(LogKit::Medium,"\n");
+  }
+
+  LogKit::LogFormatted(LogKit::Medium,"  %-36s","Total");
+  for(int phase = 0 ; phase < N_PHASES ; phase++) {
+    if(active_[phase])
+      LogKit::LogFormatted(LogKit::Medium,"%14.2f",getMemory(phase)/megaByte);
+  }
+  LogKit::LogFormatted(LogKit::Medium,"\n");
+}
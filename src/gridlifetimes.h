@@ -0,0 +1,62 @@
+/***************************************************************************
+*      Copyright (C) 2008 by Norwegian Computing Center and Statoil        *
+***************************************************************************/
+
+#ifndef GRIDLIFETIMES_H
+#define GRIDLIFETIMES_H
+
+#include <string>
+#include <vector>
+
+// Lifetimes of the grids held in memory during an inversion. The run is split in phases, and
+// each group of grids is allocated at its first phase and released after its last phase. The
+// groups are given from the model settings before the run starts, so that the memory held in
+// each phase, and the peak, is known up front. Phases that are not part of the run are skipped.
+class GridLifetimes
+{
+public:
+  enum phases{INVERSION          = 0,
+              SIMULATION         = 1,
+              FACIES_PROBABILITY = 2,
+              N_PHASES           = 3};
+
+  // gridSizePad and gridSizeBase are the sizes (bytes) of a padded and an unpadded grid.
+  GridLifetimes(long long int gridSizePad,
+                long long int gridSizeBase);
+
+  void                     setActive(int phase, bool active) { active_[phase] = active ;}
+
+  void                     addPaddedGrids(const std::string & name, int nGrids, int firstPhase, int lastPhase);
+  void                     addUnpaddedGrids(const std::string & name, int nGrids, int firstPhase, int lastPhase);
+  void                     addMemory(const std::string & name, long long int memory, int firstPhase, int lastPhase);
+
+  long long int            getMemory(int phase)  const;
+  long long int            getPeakMemory()       const;
+  int                      getPeakPaddedGrids()  const;
+
+  // Logs the memory of each group in each active phase.
+  void                     writeSchedule()       const;
+
+private:
+  struct Group
+  {
+    std::string   name;
+    int           nPadded;
+    int           nUnpadded;
+    long long int memory;       // Memory beyond the grids
+    int           firstPhase;
+    int           lastPhase;
+  };
+
+  void                     addGroup(const std::string & name, int nPadded, int nUnpadded,
+                                    long long int memory, int firstPhase, int lastPhase);
+  long long int            getMemory(const Group & group) const;
+  bool                     isAlive(const Group & group, int phase) const;
+
+  long long int            gridSizePad_;
+  long long int            gridSizeBase_;
+  bool                     active_[N_PHASES];
+  std::vector<Group>       groups_;
+};
+
+#endif
@@ -39,6 +39,15 @@ GridMapping::~GridMapping()
   mapping_ = NULL;
   delete z0Grid_;
   delete z1Grid_;
+  deleteResamplingTables();
+}
+
+void
+GridMapping::deleteResamplingTables()
+{
+  for(size_t t=0;t<resampleTables_.size();t++)
+    delete resampleTables_[t];
+  resampleTables_.clear();
 }
 
 void
@@ -49,7 +58,9 @@ GridMapping::makeTimeTimeMapping(const Simbox * timeCutSimbox)
   int nz   = timeCutSimbox->getnz();
   mapping_ = new StormContGrid(*timeCutSimbox, nx, ny, nz);
   simbox_  = new Simbox(timeCutSimbox);
+  deleteResamplingTables();
 
+#pragma omp parallel for
   for(int i=0;i<nx;i++)
   {
     for(int j=0;j<ny;j++)
@@ -75,7 +86,10 @@ GridMapping::makeTimeDepthMapping(FFTGrid      * velocity,
   int ny  = depthSimbox->getny();
   int nz  = depthSimbox->getnz();
   mapping_ = new StormContGrid(*depthSimbox, nx, ny, nz);
+  deleteResamplingTables();
  // velocity->setAccessMode(FFTGrid::RANDOMACCESS);
+  // The traces are independent. Only random access reads are made from velocity.
+#pragma omp parallel for
   for(int i=0;i<nx;i++)
   {
     for(int j=0;j<ny;j++)
@@ -153,6 +167,71 @@ GridMapping::setMappingFromVelocity(FFTGrid * velocity, const Simbox * timeSimbo
 
 
 
+void
+GridMapping::getResamplingTables(const Simbox  * simbox,
+                                 const int    *& layers,
+                                 const float  *& weights) const
+{
+  // The tables are kept for the simbox geometry rather than the simbox object, as the
+  // simbox may be replaced by a new one at the same address. The surfaces are identified
+  // by the depth id of the simbox.
+  std::vector<double> geometry(6);
+  geometry[0] = simbox->getx0();
+  geometry[1] = simbox->gety0();
+  geometry[2] = simbox->getdx();
+  geometry[3] = simbox->getdy();
+  geometry[4] = simbox->getAngle();
+  geometry[5] = simbox->getdz();
+  int depthId = simbox->getDepthId();
+
+  // The tables may be asked for by the thread writing grids in the background. Tables are
+  // never changed once made, so they are read outside the critical section.
+  ResamplingTables * tables = NULL;
+#pragma omp critical(GridMappingTables)
+  {
+    for(size_t t=0;t<resampleTables_.size() && tables == NULL;t++)
+      if(resampleTables_[t]->depthId == depthId && resampleTables_[t]->geometry == geometry)
+        tables = resampleTables_[t];
+
+    if(tables == NULL)
+    {
+      int nx = static_cast<int>(mapping_->GetNI());
+      int ny = static_cast<int>(mapping_->GetNJ());
+      int nz = static_cast<int>(mapping_->GetNK());
+
+      tables           = new ResamplingTables;
+      tables->geometry = geometry;
+      tables->depthId  = depthId;
+      tables->layers.resize(mapping_->GetN());
+      tables->weights.resize(mapping_->GetN());
+
+      // Same index and weight as FFTGrid::getRealValueInterpolated() is given in the trace by trace resampling
+      double dz = simbox->getdz();
+#pragma omp parallel for
+      for(int j=0;j<ny;j++)
+      {
+        for(int i=0;i<nx;i++)
+        {
+          double x,y;
+          simbox->getXYCoord(i,j,x,y);
+          float top = static_cast<float>(simbox->getTop(x,y));
+          for(int k=0;k<nz;k++)
+          {
+            size_t index  = mapping_->GetIndex(i,j,k);
+            float  kindex = float(((*mapping_)(index) - top)/dz);
+            int    layer  = int(floor(kindex));
+            tables->layers[index]  = layer;
+            tables->weights[index] = kindex - layer;
+          }
+        }
+      }
+      resampleTables_.push_back(tables);
+    }
+  }
+  layers  = &tables->layers[0];
+  weights = &tables->weights[0];
+}
+
 void
 GridMapping::calculateSurfaceFromVelocity(FFTGrid      * velocity,
                                           const Simbox * timeSimbox)
@@ -177,6 +256,7 @@ GridMapping::calculateSurfaceFromVelocity(FFTGrid      * velocity,
     double dx = 0.5*isochore->GetDX();
     double dy = 0.5*isochore->GetDY();
 
+#pragma omp parallel for
     for(int j=0 ; j<static_cast<int>(isochore->GetNJ()) ; j++)
     {
       for(int i=0 ; i<static_cast<int>(isochore->GetNI()) ; i++)
@@ -6,6 +6,7 @@
 #define GRIDMAPPING_H
 
 #include <stdio.h>
+#include <vector>
 
 #include "src/definitions.h"
 
@@ -43,6 +44,13 @@ public:
 
   void            setMappingFromVelocity(FFTGrid * velocity, const Simbox * timeSimbox);
 
+  // Tables for resampling a grid in simbox to the mapping. For each cell of the mapping, the
+  // layer above in simbox and the weight of the layer below. Made once for each simbox geometry
+  // and kept unchanged with the mapping, so they can be read while other tables are made.
+  void            getResamplingTables(const Simbox  * simbox,
+                                      const int    *& layers,
+                                      const float  *& weights) const;
+
   //Please do not renumber the modes below. It is very convenient that TOPGIVEN+BOTTOMGIVEN = BOTHGIVEN.
   enum            surfaceModes{NONEGIVEN = 0, TOPGIVEN = 1, BOTTOMGIVEN = 2, BOTHGIVEN = 3};
 
@@ -55,5 +63,17 @@ private:
   Surface       * z1Grid_;
 
   int             surfaceMode_;
+
+  struct ResamplingTables
+  {
+    std::vector<double> geometry;   // Simbox x0, y0, dx, dy, angle and dz
+    int                 depthId;    // Simbox::getDepthId(), identifying the simbox surfaces
+    std::vector<int>    layers;
+    std::vector<float>  weights;
+  };
+
+  void            deleteResamplingTables();
+
+  mutable std::vector<ResamplingTables *> resampleTables_;
 };
 #endif
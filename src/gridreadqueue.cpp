@@ -0,0 +1,190 @@
+/***************************************************************************
+*      Copyright (C) 2008 by Norwegian Computing Center and Statoil        *
+***************************************************************************/
+
+#include <time.h>
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "src/gridreadqueue.h"
+#include "src/modelgeneral.h"
+#include "src/modelsettings.h"
+#include "src/simbox.h"
+#include "src/fftgrid.h"
+
+#include "nrlib/iotools/fileio.hpp"
+#include "nrlib/iotools/logkit.hpp"
+#include "nrlib/iotools/stringtools.hpp"
+#include "nrlib/exception/exception.hpp"
+
+GridReadQueue::GridReadQueue(const ModelSettings * modelSettings)
+  : modelSettings_(modelSettings)
+{
+}
+
+void
+GridReadQueue::addFile(const std::string       & fileName,
+                       const std::string       & parName,
+                       float                     offset,
+                       FFTGrid                *& grid,
+                       const SegyGeometry     *& geometry,
+                       const TraceHeaderFormat * format,
+                       int                       gridType,
+                       const Simbox            * timeSimbox,
+                       const Simbox            * timeCutSimbox,
+                       std::string             & errText,
+                       bool                      nopadding)
+{
+  Request request;
+  request.fileName      = fileName;
+  request.parName       = parName;
+  request.offset        = offset;
+  request.grid          = &grid;
+  request.geometry      = &geometry;
+  request.format        = format;
+  request.gridType      = gridType;
+  request.timeSimbox    = timeSimbox;
+  request.timeCutSimbox = timeCutSimbox;
+  request.errText       = &errText;
+  request.error         = "";
+  request.nopadding     = nopadding;
+  request.seconds       = 0.0;
+
+  int nxp = timeSimbox->getnx();
+  int nyp = timeSimbox->getny();
+  int nzp = timeSimbox->getnz();
+  if(nopadding == false) {
+    nxp = modelSettings_->getNXpad();
+    nyp = modelSettings_->getNYpad();
+    nzp = modelSettings_->getNZpad();
+  }
+  long long int gridMemory = static_cast<long long int>(2*(nxp/2 + 1))*nyp*nzp*sizeof(fftw_real);
+  long long int fileSize   = 0;
+  try {
+    fileSize = static_cast<long long int>(NRLib::FindFileSize(fileName));
+  }
+  catch (NRLib::Exception &) {
+    // A missing file is reported when it is read.
+  }
+  request.fileSize = fileSize;
+  request.memory   = fileSize + gridMemory;
+
+  requests_.push_back(request);
+}
+
+void
+GridReadQueue::readAll()
+{
+  int nRequests = static_cast<int>(requests_.size());
+  if(nRequests == 0)
+    return;
+
+  int nThreads = 1;
+#ifdef _OPENMP
+  nThreads = omp_get_max_threads();
+#endif
+  if(modelSettings_->getGridReadingThreads() > 0)
+    nThreads = modelSettings_->getGridReadingThreads();
+  if(modelSettings_->getFileGrid())
+    nThreads = 1;
+  nThreads = std::min(nThreads, nRequests);
+
+  long long int memoryLimit = static_cast<long long int>(modelSettings_->getGridReadingMemory())*1024*1024;
+
+  double start = getWallTime();
+
+  // The files are read in batches of consecutive files, each within the memory limit. A batch
+  // has at least one file, even if it is larger than the limit.
+  int first = 0;
+  while(first < nRequests) {
+    int           last   = first + 1;
+    long long int memory = requests_[first].memory;
+    while(last < nRequests && last - first < nThreads &&
+          (memoryLimit == 0 || memory + requests_[last].memory <= memoryLimit)) {
+      memory += requests_[last].memory;
+      last++;
+    }
+
+    int nBatch = last - first;
+    if(nBatch == 1) {
+      read(requests_[first]);
+    }
+    else {
+      std::vector<std::vector<NRLib::BufferMessage *> *> messages(nBatch);
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nBatch)
+      for(int i = 0 ; i < nBatch ; i++) {
+        LogKit::StartThreadBuffering();
+        read(requests_[first + i]);
+        messages[i] = LogKit::EndThreadBuffering();
+      }
+      for(int i = 0 ; i < nBatch ; i++)
+        LogKit::LogBuffer(messages[i]);
+    }
+    for(int i = first ; i < last ; i++)
+      *requests_[i].errText += requests_[i].error;
+    first = last;
+  }
+
+  writeThroughput(getWallTime() - start, nThreads);
+}
+
+void
+GridReadQueue::read(Request & request) const
+{
+  double start = getWallTime();
+
+  // Exceptions must not leave a parallel region.
+  try {
+    ModelGeneral::readGridFromFile(request.fileName,
+                                   request.parName,
+                                   request.offset,
+                                   *request.grid,
+                                   *request.geometry,
+                                   request.format,
+                                   request.gridType,
+                                   request.timeSimbox,
+                                   request.timeCutSimbox,
+                                   modelSettings_,
+                                   request.error,
+                                   request.nopadding);
+  }
+  catch (std::exception & e) {
+    request.error += e.what();
+  }
+
+  request.seconds = getWallTime() - start;
+}
+
+void
+GridReadQueue::writeThroughput(double seconds, int nThreads) const
+{
+  const float megaByte = 1024.0f*1024.0f;
+
+  LogKit::LogFormatted(LogKit::Medium,"\nGrid read                                  File (MB)   Time (s)     MB/s\n");
+  LogKit::LogFormatted(LogKit::Medium,"-------------------------------------------------------------------------\n");
+  float total = 0.0f;
+  for(size_t i = 0 ; i < requests_.size() ; i++) {
+    float size = requests_[i].fileSize/megaByte;
+    total     += size;
+    LogKit::LogFormatted(LogKit::Medium,"%-42s %10.1f %10.2f %8.1f\n",
+                         requests_[i].parName.substr(0,42).c_str(), size, requests_[i].seconds,
+                         size/std::max(requests_[i].seconds, 0.001));
+  }
+  LogKit::LogFormatted(LogKit::Medium,"-------------------------------------------------------------------------\n");
+  LogKit::LogFormatted(LogKit::Medium,"%-42s %10.1f %10.2f %8.1f\n",
+                       ("All files ("+NRLib::ToString(nThreads)+" threads)").c_str(), total, seconds,
+                       total/std::max(seconds, 0.001));
+}
+
+double
+GridReadQueue::getWallTime()
+{
+#ifdef _OPENMP
+  return(omp_get_wtime());
+#else
+  return(static_cast<double>(clock())/CLOCKS_PER_SEC);
+#endif
+}
@@ -0,0 +1,74 @@
+/***************************************************************************
+*      Copyright (C) 2008 by Norwegian Computing Center and Statoil        *
+***************************************************************************/
+
+#ifndef GRIDREADQUEUE_H
+#define GRIDREADQUEUE_H
+
+#include <string>
+#include <vector>
+
+#include "src/definitions.h"
+
+class FFTGrid;
+class Simbox;
+class ModelSettings;
+
+// Grids to be read from file concurrently. The reads are queued with addFile(), which takes
+// the same arguments as ModelGeneral::readGridFromFile(), and are done by readAll(). Each file
+// is read, checked and resampled by one thread, and the number of threads and the memory of the
+// files read at the same time are bounded by the model settings. The log messages from each file
+// are held back and logged in the order the files were added, so the log is as for serial reading.
+//
+// File grids are read one at a time, as they share the temporary file storage.
+class GridReadQueue
+{
+public:
+  GridReadQueue(const ModelSettings * modelSettings);
+
+  // The grid and geometry are set, and errors added to errText, by readAll(). The simboxes must
+  // live until then.
+  void                     addFile(const std::string       & fileName,
+                                   const std::string       & parName,
+                                   float                     offset,
+                                   FFTGrid                *& grid,
+                                   const SegyGeometry     *& geometry,
+                                   const TraceHeaderFormat * format,
+                                   int                       gridType,
+                                   const Simbox            * timeSimbox,
+                                   const Simbox            * timeCutSimbox,
+                                   std::string             & errText,
+                                   bool                      nopadding = false);
+
+  // Reads all queued files, and logs the read time and throughput of each.
+  void                     readAll();
+
+private:
+  struct Request
+  {
+    std::string               fileName;
+    std::string               parName;
+    float                     offset;
+    FFTGrid                ** grid;
+    const SegyGeometry     ** geometry;
+    const TraceHeaderFormat * format;
+    int                       gridType;
+    const Simbox            * timeSimbox;
+    const Simbox            * timeCutSimbox;
+    std::string             * errText;
+    std::string               error;     // Error text from this file, added to errText after reading
+    bool                      nopadding;
+    long long int             fileSize;  // Bytes
+    long long int             memory;    // File size and grid memory (bytes)
+    double                    seconds;
+  };
+
+  void                     read(Request & request) const;
+  void                     writeThroughput(double seconds, int nThreads) const;
+  static double            getWallTime();
+
+  const ModelSettings    * modelSettings_;
+  std::vector<Request>     requests_;
+};
+
+#endif
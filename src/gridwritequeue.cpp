@@ -0,0 +1,173 @@
+/***************************************************************************
+*      Copyright (C) 2008 by Norwegian Computing Center and Statoil        *
+***************************************************************************/
+
+#include <assert.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "src/gridwritequeue.h"
+#include "src/fftgrid.h"
+
+#include "nrlib/exception/exception.hpp"
+
+GridWriteQueue * GridWriteQueue::active_ = NULL;
+
+GridWriteQueue::GridWriteQueue(long long int memoryLimit)
+  : memoryLimit_(memoryLimit),
+    memoryUsed_(0),
+    asynchronous_(false),
+    closed_(false),
+    error_("")
+{
+}
+
+GridWriteQueue::~GridWriteQueue()
+{
+  assert(queued_.empty());
+  deleteWritten();
+  if (active_ == this)
+    active_ = NULL;
+}
+
+void
+GridWriteQueue::writeFile(FFTGrid                 * grid,
+                          const std::string       & fileName,
+                          const std::string       & subDir,
+                          const Simbox            * simbox,
+                          const std::string       & sgriLabel,
+                          float                     z0,
+                          const GridMapping       * depthMap,
+                          const GridMapping       * timeMap,
+                          const TraceHeaderFormat & thf,
+                          bool                      padding)
+{
+  if (asynchronous_ == false || closed_ == true || grid->isFile() == true) {
+    grid->writeFile(fileName, subDir, simbox, sgriLabel, z0, depthMap, timeMap, thf, padding);
+    return;
+  }
+
+  long long int memory = static_cast<long long int>(grid->getrsize())*sizeof(fftw_real);
+
+  // Wait for space. A grid larger than the limit is queued when the queue is empty.
+  deleteWritten();
+  while (memoryUsed_ > 0 && memoryUsed_ + memory > memoryLimit_) {
+    wait();
+    deleteWritten();
+  }
+
+  Request * request  = new Request;
+  request->grid      = new FFTGrid(grid);
+  request->fileName  = fileName;
+  request->subDir    = subDir;
+  request->simbox    = simbox;
+  request->sgriLabel = sgriLabel;
+  request->z0        = z0;
+  request->depthMap  = depthMap;
+  request->timeMap   = timeMap;
+  request->thf       = thf;
+  request->padding   = padding;
+  request->memory    = memory;
+  memoryUsed_       += memory;
+
+#pragma omp critical(GridWriteQueue)
+  queued_.push_back(request);
+}
+
+void
+GridWriteQueue::close()
+{
+#pragma omp critical(GridWriteQueue)
+  closed_ = true;
+
+  bool empty = false;
+  while (empty == false) {
+    deleteWritten();
+#pragma omp critical(GridWriteQueue)
+    empty = queued_.empty();
+    if (empty == false)
+      wait();
+  }
+  deleteWritten();
+}
+
+void
+GridWriteQueue::process()
+{
+  bool done = false;
+  while (done == false) {
+    Request * request = NULL;
+#pragma omp critical(GridWriteQueue)
+    {
+      if (queued_.empty() == false)
+        request = queued_.front();
+      else
+        done = closed_;
+    }
+
+    if (request != NULL) {
+      // A failed grid is dropped, so that the computing thread is not left waiting for it.
+      try {
+        request->grid->writeFile(request->fileName,
+                                 request->subDir,
+                                 request->simbox,
+                                 request->sgriLabel,
+                                 request->z0,
+                                 request->depthMap,
+                                 request->timeMap,
+                                 request->thf,
+                                 request->padding);
+      }
+      catch (std::exception & e) {
+#pragma omp critical(GridWriteQueue)
+        {
+          if (error_ == "")
+            error_ = e.what();
+        }
+      }
+#pragma omp critical(GridWriteQueue)
+      {
+        queued_.pop_front();
+        written_.push_back(request);
+      }
+    }
+    else if (done == false)
+      wait();
+  }
+}
+
+void
+GridWriteQueue::rethrowError() const
+{
+  if (error_ != "")
+    throw NRLib::Exception(error_);
+}
+
+void
+GridWriteQueue::deleteWritten()
+{
+  std::list<Request *> written;
+#pragma omp critical(GridWriteQueue)
+  written.swap(written_);
+
+  for (std::list<Request *>::iterator it = written.begin(); it != written.end(); ++it) {
+    memoryUsed_ -= (*it)->memory;
+    delete (*it)->grid;
+    delete *it;
+  }
+}
+
+void
+GridWriteQueue::wait()
+{
+  // OpenMP 2.0 has no condition variables, so the threads poll the queue.
+#ifdef _WIN32
+  Sleep(5);
+#else
+  usleep(5000);
+#endif
+}
@@ -0,0 +1,90 @@
+/***************************************************************************
+*      Copyright (C) 2008 by Norwegian Computing Center and Statoil        *
+***************************************************************************/
+
+#ifndef GRIDWRITEQUEUE_H
+#define GRIDWRITEQUEUE_H
+
+#include <list>
+#include <string>
+
+#include "src/definitions.h"
+
+class FFTGrid;
+class Simbox;
+class GridMapping;
+
+// Queue of grids to be written to file by a separate thread, so that output overlaps with
+// computation. A grid is copied when it is queued, and the caller may change or delete it at
+// once. The copies are written by process(), which is run in an OpenMP section next to the
+// section doing the computations. Only the computing thread allocates and deletes grids.
+//
+// The memory used by queued grids is bounded. When the limit is reached, the computing thread
+// waits until enough grids have been written. If the queue is not asynchronous (no second
+// thread, or file grids), grids are written directly.
+class GridWriteQueue
+{
+public:
+  GridWriteQueue(long long int memoryLimit);
+  ~GridWriteQueue();
+
+  void                     setAsynchronous(bool asynchronous) { asynchronous_ = asynchronous ;}
+
+  // Same arguments as FFTGrid::writeFile(). The simbox and mappings must live until the queue is closed.
+  void                     writeFile(FFTGrid                 * grid,
+                                     const std::string       & fileName,
+                                     const std::string       & subDir,
+                                     const Simbox            * simbox,
+                                     const std::string       & sgriLabel,
+                                     float                     z0,
+                                     const GridMapping       * depthMap,
+                                     const GridMapping       * timeMap,
+                                     const TraceHeaderFormat & thf,
+                                     bool                      padding);
+
+  // Called by the computing thread when all grids are queued. Returns when all have been written.
+  void                     close();
+
+  // Writes grids until the queue is closed and empty. Called by the writing thread.
+  void                     process();
+
+  // Throws the first exception from writing a queued grid. Called when the sections have ended,
+  // as exceptions must not leave a parallel region.
+  void                     rethrowError() const;
+
+  // The queue that ParameterOutput writes through, if any.
+  static GridWriteQueue  * getActive()                         { return active_ ;}
+  static void              setActive(GridWriteQueue * queue)   { active_ = queue ;}
+
+private:
+  struct Request
+  {
+    FFTGrid           * grid;
+    std::string         fileName;
+    std::string         subDir;
+    const Simbox      * simbox;
+    std::string         sgriLabel;
+    float               z0;
+    const GridMapping * depthMap;
+    const GridMapping * timeMap;
+    TraceHeaderFormat   thf;
+    bool                padding;
+    long long int       memory;
+  };
+
+  void                     deleteWritten();
+  static void              wait();
+
+  long long int            memoryLimit_;    // Limit for memory used by queued grids (bytes)
+  long long int            memoryUsed_;     // Memory used by queued and written, but not deleted, grids
+  bool                     asynchronous_;
+  bool                     closed_;
+  std::string              error_;          // Message of the first exception from process()
+
+  std::list<Request *>     queued_;         // Grids to be written. The front one may be being written.
+  std::list<Request *>     written_;        // Grids written, to be deleted by the computing thread
+
+  static GridWriteQueue  * active_;
+};
+
+#endif
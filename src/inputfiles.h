@@ -52,6 +52,7 @@ public:
   const std::string              & getAreaSurfaceFile(void)      const { return areaSurfaceFile_      ;}
   const std::vector<std::string> & getMultizoneSurfaceFiles()    const { return multizoneSurfaceFiles_;}
   const std::string              & getTrendCube(int i)           const { return trendCubes_[i]        ;}
+  const std::vector<std::string> & getTrendCubes(void)           const { return trendCubes_           ;}
   const std::string              & getGravimetricData(int i)     const { return gravimetricData_[i]   ;}
 
   int                              getNumberOfSeismicFiles(int i)const { return static_cast<int>(timeLapseSeismicFiles_[i].size());}
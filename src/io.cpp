@@ -56,6 +56,42 @@ IO::writeSurfaceToFile(const Surface     & surface,
 }
 
 
+void
+IO::writeSurfaceBinary(std::ostream & stream, const Surface & surface)
+{
+  NRLib::WriteBinaryDouble(stream, surface.GetXMin());
+  NRLib::WriteBinaryDouble(stream, surface.GetYMin());
+  NRLib::WriteBinaryDouble(stream, surface.GetLengthX());
+  NRLib::WriteBinaryDouble(stream, surface.GetLengthY());
+  NRLib::WriteBinaryInt(stream, static_cast<int>(surface.GetNI()));
+  NRLib::WriteBinaryInt(stream, static_cast<int>(surface.GetNJ()));
+  NRLib::WriteBinaryDouble(stream, surface.GetMissingValue());
+  for (size_t j = 0; j < surface.GetNJ(); j++) {
+    for (size_t i = 0; i < surface.GetNI(); i++)
+      NRLib::WriteBinaryDouble(stream, surface(i,j));
+  }
+}
+
+void
+IO::readSurfaceBinary(std::istream & stream, Surface & surface)
+{
+  double x0 = NRLib::ReadBinaryDouble(stream);
+  double y0 = NRLib::ReadBinaryDouble(stream);
+  double lx = NRLib::ReadBinaryDouble(stream);
+  double ly = NRLib::ReadBinaryDouble(stream);
+  int    ni = NRLib::ReadBinaryInt(stream);
+  int    nj = NRLib::ReadBinaryInt(stream);
+  double mv = NRLib::ReadBinaryDouble(stream);
+
+  surface = Surface(x0, y0, lx, ly, ni, nj);
+  surface.SetMissingValue(mv);
+  for (int j = 0; j < nj; j++) {
+    for (int i = 0; i < ni; i++)
+      surface(i,j) = NRLib::ReadBinaryDouble(stream);
+  }
+}
+
+
 int
 IO::findGridType(const std::string & fileName)
 {
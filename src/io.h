@@ -6,6 +6,7 @@
 #define CRAVA_SRC_IO_H
 
 #include <string>
+#include <iosfwd>
 #include "src/definitions.h"
 
 class IO
@@ -30,6 +31,8 @@ public:
   inline static  std::string    PathToCorrelations(void)           { return std::string("correlations/")            ;}
   inline static  std::string    PathToInversionResults(void)       { return std::string("inversionresults/")        ;}
   inline static  std::string    PathToRockPhysics()                { return std::string("rock_physics/")            ;}
+  inline static  std::string    PathToCheckpoints()                { return std::string("checkpoints/")             ;}
+  inline static  std::string    PathToRunArtifactCache()           { return std::string("cache/")                   ;}
   inline static  std::string    PathToTmpFiles(void)               { return std::string("")                         ;}
   inline static  std::string    PathToDebug(void)                  { return std::string("")                         ;}
 
@@ -44,6 +47,8 @@ public:
   inline static  std::string    FileTemporalCorr(void)             { return std::string("Temporal_Correlation")     ;}
   inline static  std::string    FileTimeToDepthVelocity(void)      { return std::string("Time-To-Depth_Velocity")   ;}
   inline static  std::string    FileTemporarySeismic(void)         { return std::string("Temp_seis")                ;}
+  inline static  std::string    FileTimeLapseCheckpoint(void)      { return std::string("Time_Lapse_Checkpoint")    ;}
+  inline static  std::string    FileRunArtifactKey(void)           { return std::string("Run_Artifact_Key")         ;}
 
   // Prefixes
 
@@ -120,6 +125,12 @@ public:
                                                    const std::string & path,
                                                    int                 format);
 
+  // Surfaces in binary files, with full precision.
+  static         void           writeSurfaceBinary(std::ostream  & stream,
+                                                   const Surface & surface);
+  static         void           readSurfaceBinary(std::istream & stream,
+                                                  Surface      & surface);
+
   enum           domains{TIMEDOMAIN  = 1,
                          DEPTHDOMAIN = 2};
 
@@ -12,6 +12,10 @@
 #define _USE_MATH_DEFINES
 #include <cmath>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include "src/definitions.h"
 #include "src/modelgeneral.h"
 #include "src/modelavostatic.h"
@@ -29,12 +33,14 @@
 #include "src/fftgrid.h"
 #include "src/fftfilegrid.h"
 #include "src/gridmapping.h"
+#include "src/gridreadqueue.h"
 #include "src/inputfiles.h"
 #include "src/timings.h"
 #include "src/io.h"
 #include "src/waveletfilter.h"
 #include "src/tasklist.h"
 #include "src/seismicparametersholder.h"
+#include "src/runartifactcache.h"
 
 #include "lib/utils.h"
 #include "lib/random.h"
@@ -137,6 +143,11 @@ ModelAVODynamic::ModelAVODynamic(ModelSettings               *& modelSettings,
       //
       bool estimationMode = modelSettings->getEstimationMode();
 
+      RunArtifactCache * artifactCache = NULL;
+      if (modelSettings->getUseRunArtifactCache() == true && estimationMode == false &&
+          modelSettings->getOptimizeWellLocation() == false)
+        artifactCache = new RunArtifactCache(modelSettings, inputFiles, thisTimeLapse_);
+
       if (!failedWells && !failedDepthConv) {
         bool backgroundDone = false;
 
@@ -159,7 +170,8 @@ ModelAVODynamic::ModelAVODynamic(ModelSettings               *& modelSettings,
                               inputFiles,
                               thisTimeLapse_,
                               errText,
-                              failedBackground);
+                              failedBackground,
+                              artifactCache);
 
             backgroundDone = true;
           }
@@ -185,7 +197,7 @@ ModelAVODynamic::ModelAVODynamic(ModelSettings               *& modelSettings,
               modelSettings->getOptimizeWellLocation() == true))
           {
             processSeismic(seisCube_, timeSimbox, timeDepthMapping, timeCutMapping,
-                           modelSettings, inputFiles, errText, failedSeismic);
+                           modelSettings, inputFiles, errText, failedSeismic, artifactCache);
             if (failedSeismic == false && modelSettings->getOptimizeWellLocation() == true)
             {
               for (int i=0;i<numberOfAngles_;i++)
@@ -252,7 +264,8 @@ ModelAVODynamic::ModelAVODynamic(ModelSettings               *& modelSettings,
                                                  inputFiles,
                                                  seismicParameters,
                                                  errText,
-                                                 failedPriorCorr);
+                                                 failedPriorCorr,
+                                                 artifactCache);
         }
 
         if(failedSeismic == false && failedBackground == false &&
@@ -273,6 +286,12 @@ ModelAVODynamic::ModelAVODynamic(ModelSettings               *& modelSettings,
         }
       }
 
+      if (artifactCache != NULL) {
+        if (failedBackground == false && failedSeismic == false && failedPriorCorr == false)
+          artifactCache->writeKey();
+        delete artifactCache;
+      }
+
       if (!failedWells) {
         if(estimationMode || (modelSettings->getWellOutputFlag() & IO::WELLS) > 0)
           modelAVOstatic->writeWells(modelGeneral->getWells(), modelSettings);
@@ -490,7 +509,8 @@ ModelAVODynamic::processSeismic(FFTGrid             **& seisCube,
                                 const ModelSettings   * modelSettings,
                                 const InputFiles      * inputFiles,
                                 std::string           & errText,
-                                bool                  & failed)
+                                bool                  & failed,
+                                RunArtifactCache      * artifactCache)
 {
   double wall=0.0, cpu=0.0;
   TimeKit::getTime(wall,cpu);
@@ -509,30 +529,44 @@ ModelAVODynamic::processSeismic(FFTGrid             **& seisCube,
     else
       timeCutSimbox = timeSimbox;
 
+    // Seismic data of an earlier run of the same model
+    bool fromCache = false;
+    if (artifactCache != NULL && artifactCache->hasSeismic())
+      fromCache = artifactCache->readSeismic(seisCube, angle_, timeSimbox, modelSettings);
+
+    // The angle stacks are read concurrently
+    GridReadQueue            readQueue(modelSettings);
+    std::vector<std::string> tmpErrText(numberOfAngles_, "");
+    std::vector<std::string> dataName(numberOfAngles_);
     for (int i = 0 ; i < numberOfAngles_ ; i++) {
       geometry[i] = NULL;
-      std::string tmpErrText("");
-      std::string fileName = inputFiles->getSeismicFile(thisTimeLapse_,i);
       std::string angle    = NRLib::ToString(angle_[i]*(180/M_PI), 1);
-      std::string dataName = "Seismic data angle stack "+angle;
+      dataName[i]          = "Seismic data angle stack "+angle;
       if(offset[i] < 0)
         offset[i] = modelSettings->getSegyOffset(thisTimeLapse_);
 
-      ModelGeneral::readGridFromFile(fileName,
-                                     dataName,
-                                     offset[i],
-                                     seisCube[i],
-                                     geometry[i],
-                                     modelSettings->getTraceHeaderFormat(thisTimeLapse_,i),
-                                     FFTGrid::DATA,
-                                     timeSimbox,
-                                     timeCutSimbox,
-                                     modelSettings,
-                                     tmpErrText);
-      if(tmpErrText != "")
+      if (fromCache == false) {
+        seisCube[i] = NULL;
+        readQueue.addFile(inputFiles->getSeismicFile(thisTimeLapse_,i),
+                          dataName[i],
+                          offset[i],
+                          seisCube[i],
+                          geometry[i],
+                          modelSettings->getTraceHeaderFormat(thisTimeLapse_,i),
+                          FFTGrid::DATA,
+                          timeSimbox,
+                          timeCutSimbox,
+                          tmpErrText[i]);
+      }
+    }
+    readQueue.readAll();
+
+    for (int i = 0 ; i < numberOfAngles_ ; i++) {
+      if(tmpErrText[i] != "")
       {
-        tmpErrText += "\nReading of file \'"+fileName+"\' for "+dataName+" failed.\n";
-        errText += tmpErrText;
+        std::string fileName = inputFiles->getSeismicFile(thisTimeLapse_,i);
+        tmpErrText[i] += "\nReading of file \'"+fileName+"\' for "+dataName[i]+" failed.\n";
+        errText += tmpErrText[i];
         failed = true;
       }
       else {
@@ -568,6 +602,9 @@ ModelAVODynamic::processSeismic(FFTGrid             **& seisCube,
         }
       }
 
+      if (artifactCache != NULL && fromCache == false)
+        artifactCache->writeSeismic(seisCube, numberOfAngles_, timeSimbox);
+
       if((modelSettings->getOutputGridsSeismic() & IO::ORIGINAL_SEISMIC_DATA) > 0) {
         for(int i=0;i<numberOfAngles_;i++) {
           std::string angle    = NRLib::ToString(angle_[i]*(180/M_PI), 1);
@@ -615,7 +652,8 @@ ModelAVODynamic::processBackground(Background                    *& background,
                                    const InputFiles               * inputFiles,
                                    const int                      & thisTimeLapse,
                                    std::string                    & errText,
-                                   bool                           & failed)
+                                   bool                           & failed,
+                                   RunArtifactCache               * artifactCache)
 {
   if (modelSettings->getForwardModeling())
     LogKit::WriteHeader("Earth Model");
@@ -638,7 +676,15 @@ ModelAVODynamic::processBackground(Background                    *& background,
   const int nxPad = modelSettings->getNXpad();
   const int nyPad = modelSettings->getNYpad();
   const int nzPad = modelSettings->getNZpad();
-  if (modelSettings->getGenerateBackground()) {
+
+  bool fromCache = false;
+  if (artifactCache != NULL && artifactCache->hasBackground())
+    fromCache = artifactCache->readBackground(backModel, timeSimbox, modelSettings);
+
+  if (fromCache) {
+    background = new Background(backModel);
+  }
+  else if (modelSettings->getGenerateBackground()) {
 
     if(modelSettings->getGenerateBackgroundFromRockPhysics() == false) {
 
@@ -726,6 +772,27 @@ ModelAVODynamic::processBackground(Background                    *& background,
       parName.push_back("Vs "+modelSettings->getBackgroundType());
     parName.push_back("Rho "+modelSettings->getBackgroundType());
 
+    // The background files are read concurrently
+    GridReadQueue             readQueue(modelSettings);
+    std::vector<std::string>  errorText(3, "");
+    const SegyGeometry      * dummy1[3] = {NULL, NULL, NULL};
+    const TraceHeaderFormat * dummy2    = NULL;
+    for(int i=0 ; i<3 ; i++)
+    {
+      if(modelSettings->getConstBackValue(i) < 0 && inputFiles->getBackFile(i).size() > 0)
+        readQueue.addFile(inputFiles->getBackFile(i),
+                          parName[i],
+                          modelSettings->getSegyOffset(thisTimeLapse),
+                          backModel[i],
+                          dummy1[i],
+                          dummy2,
+                          FFTGrid::PARAMETER,
+                          timeSimbox,
+                          timeCutSimbox,
+                          errorText[i]);
+    }
+    readQueue.readAll();
+
     for(int i=0 ; i<3 ; i++)
     {
       float constBackValue = modelSettings->getConstBackValue(i);
@@ -736,25 +803,10 @@ ModelAVODynamic::processBackground(Background                    *& background,
       {
         if(backFile.size() > 0)
         {
-          const SegyGeometry      * dummy1 = NULL;
-          const TraceHeaderFormat * dummy2 = NULL;
-          const float               offset = modelSettings->getSegyOffset(thisTimeLapse);
-          std::string errorText("");
-          ModelGeneral::readGridFromFile(backFile,
-                                         parName[i],
-                                         offset,
-                                         backModel[i],
-                                         dummy1,
-                                         dummy2,
-                                         FFTGrid::PARAMETER,
-                                         timeSimbox,
-                                         timeCutSimbox,
-                                         modelSettings,
-                                         errorText);
-          if(errorText != "")
+          if(errorText[i] != "")
           {
-            errorText += "Reading of file '"+backFile+"' for parameter '"+parName[i]+"' failed\n\n";
-            errText += errorText;
+            errorText[i] += "Reading of file '"+backFile+"' for parameter '"+parName[i]+"' failed\n\n";
+            errText += errorText[i];
             failed = true;
           }
           else {
@@ -811,6 +863,10 @@ ModelAVODynamic::processBackground(Background                    *& background,
   }
 
   if (failed == false) {
+    if (artifactCache != NULL && fromCache == false) {
+      FFTGrid * grids[3] = {background->getAlpha(), background->getBeta(), background->getRho()};
+      artifactCache->writeBackground(grids, timeSimbox);
+    }
     if((modelSettings->getOutputGridsElastic() & IO::BACKGROUND) > 0) {
       background->writeBackgrounds(timeSimbox,
                                    timeDepthMapping,
@@ -1050,49 +1106,82 @@ ModelAVODynamic::processWavelets(Wavelet                    **& wavelet,
     TaskList::addTask(text);
   }
 
+  // The angle stacks are processed in parallel. Their log messages and errors are held back and
+  // given in angle order, so the log is as for serial processing. Angles are done serially in
+  // debug mode, as the wavelet estimation then writes common files, and for file grids, as each
+  // seismic cube is then brought into memory while it is used.
+  int nThreads = 1;
+#ifdef _OPENMP
+  if(ModelSettings::getDebugLevel() == 0 && modelSettings->getFileGrid() == false)
+    nThreads = std::min(omp_get_max_threads(), numberOfAngles_);
+#endif
+  nThreads = std::max(nThreads, 1);
+
+  std::vector<int>                                   angleError(numberOfAngles_, 0);
+  std::vector<std::string>                           angleErrText(numberOfAngles_);
+  std::vector<std::vector<NRLib::BufferMessage *> *> messages(numberOfAngles_);
+
   // check if local noise is set for some angles.
   bool localNoiseSet = false;
   std::vector<bool> useRickerWavelet = modelSettings->getUseRickerWavelet(thisTimeLapse_);
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nThreads) if(nThreads > 1)
   for (int i=0 ; i < numberOfAngles_ ; i++) {
+    if (nThreads > 1)
+      LogKit::StartThreadBuffering();
     float angle = float(angle_[i]*180.0/M_PI);
     LogKit::LogFormatted(LogKit::Low,"\nAngle stack : %.1f deg",angle);
     if (modelSettings->getForwardModeling()==false)
       seisCube[i]->setAccessMode(FFTGrid::RANDOMACCESS);
 
-    if (modelSettings->getWaveletDim(i) == Wavelet::ONE_D)
-      error += process1DWavelet(modelSettings,
-                                inputFiles,
-                                timeSimbox,
-                                seisCube,
-                                wells,
-                                waveletEstimInterval,
-                                reflectionMatrix[i],
-                                errText,
-                                wavelet[i],
-                                i,
-                                useRickerWavelet[i]);
-    else
-      error += process3DWavelet(modelSettings,
-                                inputFiles,
-                                timeSimbox,
-                                seisCube,
-                                wells,
-                                waveletEstimInterval,
-                                reflectionMatrix[i],
-                                errText,
-                                wavelet[i],
-                                i,
-                                refTimeGradX,
-                                refTimeGradY,
-                                tGradX,
-                                tGradY);
+    // Exceptions must not leave a parallel region.
+    try {
+      if (modelSettings->getWaveletDim(i) == Wavelet::ONE_D)
+        angleError[i] = process1DWavelet(modelSettings,
+                                         inputFiles,
+                                         timeSimbox,
+                                         seisCube,
+                                         wells,
+                                         waveletEstimInterval,
+                                         reflectionMatrix[i],
+                                         angleErrText[i],
+                                         wavelet[i],
+                                         i,
+                                         useRickerWavelet[i]);
+      else
+        angleError[i] = process3DWavelet(modelSettings,
+                                         inputFiles,
+                                         timeSimbox,
+                                         seisCube,
+                                         wells,
+                                         waveletEstimInterval,
+                                         reflectionMatrix[i],
+                                         angleErrText[i],
+                                         wavelet[i],
+                                         i,
+                                         refTimeGradX,
+                                         refTimeGradY,
+                                         tGradX,
+                                         tGradY);
+    }
+    catch (std::exception & e) {
+      angleErrText[i] += e.what();
+      angleError[i]++;
+    }
 
-    if(localNoiseScale_[i]!=NULL)
-      localNoiseSet = true;
     if(modelSettings->getForwardModeling()==false) // else, no seismic data
       seisCube[i]->endAccess();
+    if (nThreads > 1)
+      messages[i] = LogKit::EndThreadBuffering();
   } // end i (angles)
 
+  for (int i=0 ; i < numberOfAngles_ ; i++) {
+    LogKit::LogBuffer(messages[i]);
+    errText += angleErrText[i];
+    error   += angleError[i];
+    if(localNoiseScale_[i]!=NULL)
+      localNoiseSet = true;
+  }
+
   if(localNoiseSet==true) {
     for(int i=0;i<numberOfAngles_;i++)
       if(localNoiseScale_[i]==NULL)
@@ -26,6 +26,7 @@ class InputFiles;
 class ModelAVOStatic;
 class ModelGeneral;
 class SeismicParametersHolder;
+class RunArtifactCache;
 
 class ModelAVODynamic
 {
@@ -98,7 +99,8 @@ public:
                                             const InputFiles               * inputFile,
                                             const int                      & thisTimeLapse,
                                             std::string                    & errText,
-                                            bool                           & failed);
+                                            bool                           & failed,
+                                            RunArtifactCache               * artifactCache = NULL);
 private:
   void             processSeismic(FFTGrid         **& seisCube,
                                   const Simbox      * timeSimbox,
@@ -107,7 +109,8 @@ private:
                                   const ModelSettings * modelSettings,
                                   const InputFiles  * inputFiles,
                                   std::string       & errText,
-                                  bool              & failed);
+                                  bool              & failed,
+                                  RunArtifactCache  * artifactCache = NULL);
 
 
   void             processReflectionMatrix(float               **& reflectionMatrix,
@@ -12,6 +12,10 @@
 #define _USE_MATH_DEFINES
 #include <cmath>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include "src/definitions.h"
 #include "src/modelgeneral.h"
 #include "src/modelavostatic.h"
@@ -30,6 +34,7 @@
 #include "src/gridmapping.h"
 #include "src/inputfiles.h"
 #include "src/timings.h"
+#include "src/gridlifetimes.h"
 #include "src/io.h"
 #include "src/waveletfilter.h"
 #include "src/tasklist.h"
@@ -214,6 +219,9 @@ ModelAVOStatic::checkAvailableMemory(Simbox           * timeSimbox,
   int nGridKriging      = 1;                                      // One grid for kriging, unpadded.
   int nGridCompute      = 1;                                      // Computation grid, padded (for convenience)
   int nGridFileMode     = 1;                                      // One grid for intermediate file storage
+  int nGridCheckpoint   = 36;                                     // Copy of 4D state and prior, padded, written during next vintage
+
+  bool checkpoints      = modelSettings->getDo4DInversion() && modelSettings->getWriteTimeLapseCheckpoints();
 
   int nGrids;
   long long int gridMem;
@@ -221,7 +229,7 @@ ModelAVOStatic::checkAvailableMemory(Simbox           * timeSimbox,
     if (modelSettings->getFileGrid())  // Use disk buffering
       nGrids = nGridFileMode;
     else
-      nGrids = nGridParameters + 1;
+      nGrids = nGridParameters + nGridSeismicData; //The synthetic seismic is made for all angles together.
 
     gridMem = nGrids*gridSizePad;
   }
@@ -238,55 +246,76 @@ ModelAVOStatic::checkAvailableMemory(Simbox           * timeSimbox,
       }
 
       gridMem = nGrids*gridSizePad;
+      if(checkpoints)
+        gridMem += nGridCheckpoint*gridSizePad;
     }
     else {
-      //baseP and baseU are the padded and unpadde grids allocated at each peak.
-      int baseP = nGridParameters + nGridCovariances;
-      if(modelSettings->getUseLocalNoise(0) == true || (modelSettings->getEstimateFaciesProb() && modelSettings->getFaciesProbRelative()))
-        baseP += nGridBackground;
-      int baseU = 0;
+      bool simulate         = (modelSettings->getNumberOfSimulations() > 0);
+      bool faciesProb       = modelSettings->getEstimateFaciesProb();
+      bool relative         = faciesProb && modelSettings->getFaciesProbRelative();
+      const int inversion   = GridLifetimes::INVERSION;
+      const int simulation  = GridLifetimes::SIMULATION;
+      const int facies      = GridLifetimes::FACIES_PROBABILITY;
+
+      //Grids in reduced precision use half the memory. They are only expanded to floats one at a time.
+      int reduced = 0;
+      if(modelSettings->getReducedPrecisionFormat() != FFTFileGrid::FILESTORAGE)
+        reduced = modelSettings->getReducedPrecisionGrids();
+      if(modelSettings->getDo4DInversion())
+        reduced &= ~FFTFileGrid::COVARIANCE;
+
+      GridLifetimes lifetimes(gridSizePad, gridSizeBase);
+      lifetimes.setActive(simulation, simulate);
+      lifetimes.setActive(facies, faciesProb);
+
+      lifetimes.addPaddedGrids("Elastic parameters", nGridParameters, inversion, facies);
+      if((reduced & FFTFileGrid::COVARIANCE) > 0) {
+        lifetimes.addMemory("Covariances, 16-bit", nGridCovariances*gridSizePad/2, inversion, facies);
+        lifetimes.addPaddedGrids("Covariance being transformed", 1, inversion, inversion);
+      }
+      else
+        lifetimes.addPaddedGrids("Covariances", nGridCovariances, inversion, facies);
+      lifetimes.addPaddedGrids("Seismic data", nGridSeismicData, inversion, inversion);
+      //The error correlation is filled in and transformed at full size, also when it is then held in 16 bits.
+      lifetimes.addPaddedGrids("Error correlation", 1, inversion, inversion);
+      if(relative)  //Copies of the prior mean, released after the facies probabilities.
+        lifetimes.addPaddedGrids("Prior mean copies", nGridBackground, inversion, facies);
+      else if(modelSettings->getUseLocalNoise(0) == true) //Released when the local noise has been handled.
+        lifetimes.addPaddedGrids("Prior mean copies", nGridBackground, inversion, inversion);
       if(modelSettings->getIsPriorFaciesProbGiven()==ModelSettings::FACIES_FROM_CUBES)
-        baseU += static_cast<int>(facies_prob.size());
+        lifetimes.addUnpaddedGrids("Prior facies probabilities", static_cast<int>(facies_prob.size()), inversion, facies);
 
-      //First peak: At inversion
-      int peak1P = baseP + nGridSeismicData; //Need seismic data as well here.
-      int peak1U = baseU;
-
-      long long int peakGridMem = peak1P*gridSizePad + peak1U*gridSizeBase; //First peak must be currently largest.
-      int peakNGrid   = peak1P;                                             //Also in number of padded grids
-
-      if(modelSettings->getNumberOfSimulations() > 0) { //Second possible peak when simulating.
-        int peak2P = baseP + 3; //Three extra parameter grids for simulated parameters.
-        if(modelSettings->getUseLocalNoise(0) == true &&
-           (modelSettings->getEstimateFaciesProb() == false || modelSettings->getFaciesProbRelative() == false))
-          peak2P -= nGridBackground; //Background grids are released before simulation in this case.
-        int peak2U = baseU;     //Base level is the same, but may increase.
+      if(simulate) {
+        lifetimes.addPaddedGrids("Simulated parameters", nGridParameters, simulation, simulation);
         bool computeGridUsed = ((modelSettings->getOutputGridsElastic() & (IO::AI + IO::LAMBDARHO + IO::LAMELAMBDA + IO::LAMEMU + IO::MURHO + IO::POISSONRATIO + IO::SI + IO::VPVSRATIO)) > 0);
-        if(computeGridUsed == true)
-          peak2P += nGridCompute;
+        if(computeGridUsed == true) //The derived parameters are made one at a time in the computation grid.
+          lifetimes.addPaddedGrids("Derived parameters", nGridCompute, simulation, simulation);
         else if(modelSettings->getKrigingParameter() > 0) //Note the else, since this grid will use same memory as computation grid if both are active.
-          peak2U += nGridKriging;
-
-        if(peak2P > peakNGrid)
-          peakNGrid = peak2P;
+          lifetimes.addUnpaddedGrids("Kriging", nGridKriging, simulation, simulation);
 
-        long long int peak2Mem = peak2P*gridSizePad + peak2U*gridSizeBase;
-        if(peak2Mem > peakGridMem)
-          peakGridMem = peak2Mem;
+        if(modelSettings->getOutputQueueMemory() > 0) { //Copies of realizations waiting to be written.
+          long long int queueMem = static_cast<long long int>(modelSettings->getOutputQueueMemory())*1024*1024;
+          lifetimes.addPaddedGrids("Output queue", std::max(1, static_cast<int>(queueMem/gridSizePad)), simulation, simulation);
+        }
       }
 
-      if(modelSettings->getEstimateFaciesProb() == true) {//Third possible peak when computing facies prob.
-        int peak3P = baseP;                //No extra padded grids, so this one can not peak here.
-        int peak3U = baseU + nGridFacies;  //But this one will, and may trigger new memory max.
-        if((modelSettings->getOtherOutputFlag() & IO::FACIES_LIKELIHOOD) > 0)
-          peak3U += 1; //Also needs to store seismic likelihood.
+      if(checkpoints) //Held in memory, not as grids, while the next vintage is inverted.
+        lifetimes.addMemory("Time lapse checkpoint", nGridCheckpoint*gridSizePad, inversion, inversion);
 
-        long long int peak3Mem = peak3P*gridSizePad + peak3U*gridSizeBase + 2000000*nGridHistograms; //These are 2MB when Vs is used.
-        if(peak3Mem > peakGridMem)
-          peakGridMem = peak3Mem;
+      if(faciesProb) {
+        if((reduced & FFTFileGrid::FACIES_PROBABILITY) > 0)
+          lifetimes.addMemory("Facies probabilities, 16-bit", nGridFacies*gridSizeBase/2, facies, facies);
+        else
+          lifetimes.addUnpaddedGrids("Facies probabilities", nGridFacies, facies, facies);
+        if((modelSettings->getOtherOutputFlag() & IO::FACIES_LIKELIHOOD) > 0)
+          lifetimes.addUnpaddedGrids("Facies likelihood", 1, facies, facies);
+        lifetimes.addMemory("Facies histograms", static_cast<long long int>(2000000)*nGridHistograms, facies, facies); //These are 2MB when Vs is used.
       }
-      nGrids  = peakNGrid;
-      gridMem = peakGridMem;
+
+      lifetimes.writeSchedule();
+
+      nGrids  = lifetimes.getPeakPaddedGrids();
+      gridMem = lifetimes.getPeakMemory();
     }
   }
   FFTGrid::setMaxAllowedGrids(nGrids);
@@ -297,7 +326,24 @@ ModelAVOStatic::checkAvailableMemory(Simbox           * timeSimbox,
 
   float mem0        = 4.0f * workSize;
   float mem1        = static_cast<float>(gridMem);
-  float mem2        = static_cast<float>(modelSettings->getNumberOfAngles(0))*gridSizePad + memOneSeis; //Peak memory when reading seismic, overestimated.
+  //The seismic files read at the same time each need a file buffer, as counted by GridReadQueue.
+  int nAngles  = modelSettings->getNumberOfAngles(0);
+  int nReaders = 1;
+#ifdef _OPENMP
+  nReaders = omp_get_max_threads();
+#endif
+  if(modelSettings->getGridReadingThreads() > 0)
+    nReaders = modelSettings->getGridReadingThreads();
+  if(modelSettings->getFileGrid())
+    nReaders = 1;
+  nReaders = std::max(1, std::min(nReaders, nAngles));
+  long long int readingMemory = static_cast<long long int>(modelSettings->getGridReadingMemory())*1024*1024;
+  if(readingMemory > 0) {
+    int nFit = static_cast<int>(readingMemory/(static_cast<long long int>(memOneSeis) + gridSizePad));
+    nReaders = std::max(1, std::min(nReaders, nFit));
+  }
+
+  float mem2        = static_cast<float>(nAngles)*gridSizePad + nReaders*memOneSeis; //Peak memory when reading seismic, overestimated.
 
   float neededMem   = mem0 + std::max(mem1, mem2);
 
@@ -30,6 +30,7 @@
 #include "src/fftgrid.h"
 #include "src/fftfilegrid.h"
 #include "src/gridmapping.h"
+#include "src/gridreadqueue.h"
 #include "src/inputfiles.h"
 #include "src/timings.h"
 #include "src/io.h"
@@ -41,6 +42,7 @@
 #include "src/cravatrend.h"
 #include "src/seismicparametersholder.h"
 #include "src/parameteroutput.h"
+#include "src/runartifactcache.h"
 
 #include "lib/utils.h"
 #include "lib/random.h"
@@ -139,6 +141,16 @@ ModelGeneral::ModelGeneral(ModelSettings           *& modelSettings,
     //Set output for all FFTGrids.
     FFTGrid::setOutputFlags(modelSettings->getOutputGridFormat(),
                             modelSettings->getOutputGridDomain());
+    FFTGrid::setCravaErrorBound(modelSettings->getCravaErrorBound());
+
+    // The 4D state copies the covariance grids to ordinary grids, so these are kept in full precision.
+    int reducedPrecisionGrids = modelSettings->getReducedPrecisionGrids();
+    if(modelSettings->getDo4DInversion())
+      reducedPrecisionGrids &= ~FFTFileGrid::COVARIANCE;
+    FFTFileGrid::setReducedPrecision(modelSettings->getReducedPrecisionFormat(),
+                                     reducedPrecisionGrids,
+                                     modelSettings->getPrecisionStudy(),
+                                     modelSettings->getPrecisionReference());
 
     std::string errText("");
 
@@ -346,10 +358,12 @@ ModelGeneral::readSegyFile(const std::string       & fileName,
       float padding         = 2*guard_zone;
       bool  relativePadding = false;
 
-      segy->ReadAllTraces(timeCutSimbox,
-                          padding,
-                          onlyVolume,
-                          relativePadding);
+      // Only the trace headers are kept. FFTGrid::fillInData() reads the data
+      // trace by trace, so the cube is not held in memory next to the grid.
+      segy->ReadAllTraceHeaders(timeCutSimbox,
+                                padding,
+                                onlyVolume,
+                                relativePadding);
       segy->CreateRegularGrid();
     }
     else {
@@ -1604,8 +1618,11 @@ ModelGeneral::printSettings(ModelSettings     * modelSettings,
       LogKit::LogFormatted(LogKit::Medium,"  ASCII                                    :        yes\n");
     if (gridFormat & IO::SGRI)
       LogKit::LogFormatted(LogKit::Medium,"  Norsar                                   :        yes\n");
-    if (gridFormat & IO::CRAVA)
+    if (gridFormat & IO::CRAVA) {
       LogKit::LogFormatted(LogKit::Medium,"  Crava                                    :        yes\n");
+      if (modelSettings->getCravaErrorBound() > 0.0f)
+        LogKit::LogFormatted(LogKit::Medium,"  Crava lossy error bound                  : %10.2e\n",modelSettings->getCravaErrorBound());
+    }
 
     LogKit::LogFormatted(LogKit::Medium,"\nGrid output domains:\n");
     if (gridDomain & IO::TIMEDOMAIN)
@@ -1683,6 +1700,17 @@ ModelGeneral::printSettings(ModelSettings     * modelSettings,
 
   LogKit::LogFormatted(LogKit::Medium, "  Use intermediate disk storage for grids  : %10s\n", (modelSettings->getFileGrid() ? "yes" : "no"));
 
+  if (modelSettings->getReducedPrecisionFormat() != FFTFileGrid::FILESTORAGE) {
+    int grids = modelSettings->getReducedPrecisionGrids();
+    LogKit::LogFormatted(LogKit::Medium, "  Reduced precision storage format         : %10s\n", (modelSettings->getReducedPrecisionFormat() == FFTFileGrid::BFLOAT16 ? "bfloat16" : "float16"));
+    LogKit::LogFormatted(LogKit::Medium, "    Covariance grids                       : %10s\n", ((grids & FFTFileGrid::COVARIANCE) > 0 ? "yes" : "no"));
+    LogKit::LogFormatted(LogKit::Medium, "    Error correlation grid                 : %10s\n", ((grids & FFTFileGrid::ERROR_CORRELATION) > 0 ? "yes" : "no"));
+    LogKit::LogFormatted(LogKit::Medium, "    Facies probability grids               : %10s\n", ((grids & FFTFileGrid::FACIES_PROBABILITY) > 0 ? "yes" : "no"));
+    LogKit::LogFormatted(LogKit::Medium, "    Precision study                        : %10s\n", (modelSettings->getPrecisionStudy() ? "yes" : "no"));
+    if (modelSettings->getPrecisionReference() != "")
+      LogKit::LogFormatted(LogKit::Medium, "    Full precision reference run           : %10s\n", modelSettings->getPrecisionReference().c_str());
+  }
+
   if (inputFiles->getReflMatrFile() != "")
     LogKit::LogFormatted(LogKit::Medium, "  Take reflection matrix from file         : %10s\n", inputFiles->getReflMatrFile().c_str());
 
@@ -2977,11 +3005,14 @@ ModelGeneral::getRockDistributionTime0() const
 }
 
 FFTGrid*
-ModelGeneral::createFFTGrid(int nx, int ny, int nz, int nxp, int nyp, int nzp, bool fileGrid)
+ModelGeneral::createFFTGrid(int nx, int ny, int nz, int nxp, int nyp, int nzp, bool fileGrid, int role)
 {
   FFTGrid* fftGrid;
+  int storage = FFTFileGrid::getStorage(role);
 
-  if(fileGrid)
+  if(storage != FFTFileGrid::FILESTORAGE)
+    fftGrid =  new FFTFileGrid(nx, ny, nz, nxp, nyp, nzp, storage, role);
+  else if(fileGrid)
     fftGrid =  new FFTFileGrid(nx, ny, nz, nxp, nyp, nzp);
   else
     fftGrid =  new FFTGrid(nx, ny, nz, nxp, nyp, nzp);
@@ -3038,7 +3069,7 @@ ModelGeneral::generateRockPhysics3DBackground(const std::vector<DistributionsRoc
   const int nx   = vp.getNx();
   const int nzp  = vp.getNzp();
   const int nyp  = vp.getNyp();
-  const int nxp = vp.getNxp();
+  const int nxp  = vp.getNxp();
   const int rnxp = vp.getRNxp();
 
   LogKit::LogFormatted(LogKit::Low,"\nGenerating background model from rock physics:\n");
@@ -3050,7 +3081,7 @@ ModelGeneral::generateRockPhysics3DBackground(const std::vector<DistributionsRoc
     << "\n  |    |    |    |    |    |    |    |    |    |    |  "
     << "\n  ^";
 
-  const size_t number_of_facies = probability.size();
+  const int number_of_facies = static_cast<int>(probability.size());
 
   // Temporary grids for storing top and base values of (vp,vs,rho) for use in linear interpolation in the padding
   NRLib::Grid2D<float> topVp  (nx, ny, 0.0);
@@ -3060,11 +3091,86 @@ ModelGeneral::generateRockPhysics3DBackground(const std::vector<DistributionsRoc
   NRLib::Grid2D<float> baseVs (nx, ny, 0.0);
   NRLib::Grid2D<float> baseRho(nx, ny, 0.0);
 
-  vp.setAccessMode(FFTGrid::WRITE);
-  vs.setAccessMode(FFTGrid::WRITE);
-  rho.setAccessMode(FFTGrid::WRITE);
+  vp.setAccessMode(FFTGrid::RANDOMACCESS);
+  vs.setAccessMode(FFTGrid::RANDOMACCESS);
+  rho.setAccessMode(FFTGrid::RANDOMACCESS);
+
+  // File grids flag modifications in setRealValue(), so they are filled serially.
+  const bool parallel = !(vp.isFile() || vs.isFile() || rho.isFile());
+
+  int nTruncated  = 0;
+  int nLayersDone = 0;
+
+  // Inside the simbox, use the trend values to get the expectation values for each facies from the rock.
+  // A full layer is done at a time, interpolating the tabulated rock expectations for all trend positions
+  // in the layer. The layer buffers are allocated once per thread.
+#pragma omp parallel if(parallel)
+  {
+    const size_t nxy = static_cast<size_t>(nx)*ny;
+
+    std::vector<double> s0(nxy);
+    std::vector<double> s1(nxy);
+    std::vector<float>  layerVp(nxy);
+    std::vector<float>  layerVs(nxy);
+    std::vector<float>  layerRho(nxy);
+
+#pragma omp for schedule(dynamic) reduction(+:nTruncated)
+    for (int k = 0; k < nz; k++) {
+      trend_cubes_.GetTrendPositionsInLayer(k, s0, s1);
+
+      std::fill(layerVp.begin(),  layerVp.end(),  0.0f);
+      std::fill(layerVs.begin(),  layerVs.end(),  0.0f);
+      std::fill(layerRho.begin(), layerRho.end(), 0.0f);
+
+      // Sum up for all facies: probability for a facies multiplied with the expectations of (vp, vs, rho) given the facies
+      for (int f = 0; f < number_of_facies; f++)
+        rock_distribution[f]->AddWeightedLogExpectation(probability[f], &s0[0], &s1[0], nxy,
+                                                        &layerVp[0], &layerVs[0], &layerRho[0],
+                                                        nTruncated);
+
+      for (int j = 0; j < ny; j++) {
+        for (int i = 0; i < nx; i++) {
+          const size_t c = i + static_cast<size_t>(j)*nx;
 
-  // Loop through all cells in the FFTGrids
+          // Set values in expectation grids
+          vp.setRealValue(i, j, k, layerVp[c]);
+          vs.setRealValue(i, j, k, layerVs[c]);
+          rho.setRealValue(i, j, k, layerRho[c]);
+
+          // Store top and base values of the expectations for later use in interpolation in the padded region.
+          if(k==0) {
+            topVp(i,j)  = layerVp[c];
+            topVs(i,j)  = layerVs[c];
+            topRho(i,j) = layerRho[c];
+          }
+          else if(k==nz-1) {
+            baseVp(i,j)  = layerVp[c];
+            baseVs(i,j)  = layerVs[c];
+            baseRho(i,j) = layerRho[c];
+          }
+        }
+      }
+
+      // Log progress
+#pragma omp critical
+      {
+        nLayersDone++;
+        if (nLayersDone >= static_cast<int>(nextMonitor)) {
+          nextMonitor += monitorSize;
+          std::cout << "^";
+          fflush(stdout);
+        }
+      }
+    }
+  }
+
+  if (nTruncated > 0) {
+    LogKit::LogFormatted(LogKit::Warning,"\nWARNING: %d trend values were outside the tabulated range of the rock physics model.\n", nTruncated);
+    LogKit::LogFormatted(LogKit::Warning,"         These have been set to the closest tabulated value.\n");
+  }
+
+  // Fill the padding, using the top and base values found above.
+#pragma omp parallel for schedule(dynamic) if(parallel)
   for (int k = 0; k < nzp; k++) {
     for (int j = 0; j < nyp; j++) {
       for (int i = 0; i < rnxp; i++) {
@@ -3081,12 +3187,9 @@ ModelGeneral::generateRockPhysics3DBackground(const std::vector<DistributionsRoc
           indexI = std::min(i,indexI);
           indexJ = std::min(j,indexJ);
 
-          float vpVal  = topVp(indexI,indexJ);
-          float vsVal  = topVs(indexI,indexJ);
-          float rhoVal = topRho(indexI,indexJ);
-          vp.setNextReal(vpVal);
-          vs.setNextReal(vsVal);
-          rho.setNextReal(rhoVal);
+          vp.setRealValue(i, j, k, topVp(indexI,indexJ), true);
+          vs.setRealValue(i, j, k, topVs(indexI,indexJ), true);
+          rho.setRealValue(i, j, k, topRho(indexI,indexJ), true);
         }
 
         // If outside in z-direction, use linear interpolation between top and base values of the expectations
@@ -3097,54 +3200,12 @@ ModelGeneral::generateRockPhysics3DBackground(const std::vector<DistributionsRoc
           double rhoVal = topRho(i,j)*t + baseRho(i,j)*(1-t);
 
           // Set interpolated values in expectation grids
-          vp.setNextReal(static_cast<float>(vpVal));
-          vs.setNextReal(static_cast<float>(vsVal));
-          rho.setNextReal(static_cast<float>(rhoVal));
-        }
-
-        // Otherwise use trend values to get expectation values for each facies from the rock
-        else {
-          std::vector<double> trend_position = trend_cubes_.GetTrendPosition(i,j,k);
-
-          std::vector<float> expectations(3, 0);  // Antar initialisert til 0.
-
-          std::vector<std::vector<double> > expectation_m(number_of_facies);
-          for(size_t f = 0; f < number_of_facies; f++)
-            expectation_m[f] = rock_distribution[f]->GetLogExpectation(trend_position);
-
-          // Sum up for all facies: probability for a facies multiplied with the expectations of (vp, vs, rho) given the facies
-          for(size_t f = 0; f < number_of_facies; f++){
-            expectations[0] += static_cast<float>(expectation_m[f][0] * probability[f]);
-            expectations[1] += static_cast<float>(expectation_m[f][1] * probability[f]);
-            expectations[2] += static_cast<float>(expectation_m[f][2] * probability[f]);
-          }
-
-          // Set values in expectation grids
-          vp.setNextReal(expectations[0]);
-          vs.setNextReal(expectations[1]);
-          rho.setNextReal(expectations[2]);
-
-          // Store top and base values of the expectations for later use in interpolation in the padded region.
-          if(k==0) {
-            topVp(i,j)  = expectations[0];
-            topVs(i,j)  = expectations[1];
-            topRho(i,j) = expectations[2];
-          }
-          else if(k==nz-1) {
-            baseVp(i,j)  = expectations[0];
-            baseVs(i,j)  = expectations[1];
-            baseRho(i,j) = expectations[2];
-          }
+          vp.setRealValue(i, j, k, static_cast<float>(vpVal), true);
+          vs.setRealValue(i, j, k, static_cast<float>(vsVal), true);
+          rho.setRealValue(i, j, k, static_cast<float>(rhoVal), true);
         }
       }
     }
-
-    // Log progress
-    if (k+1 >= static_cast<int>(nextMonitor) && k < nz) {
-      nextMonitor += monitorSize;
-      std::cout << "^";
-      fflush(stdout);
-    }
   }
 
   vp.endAccess();
@@ -3828,7 +3889,8 @@ ModelGeneral::processPriorCorrelations(Background                     * backgrou
                                        const InputFiles               * inputFiles,
                                        SeismicParametersHolder        & seismicParameters,
                                        std::string                    & errText,
-                                       bool                           & failed)
+                                       bool                           & failed,
+                                       RunArtifactCache               * artifactCache)
 {
   bool printResult = ((modelSettings->getOtherOutputFlag() & IO::PRIORCORRELATIONS) > 0 ||
                       modelSettings->getEstimationMode() == true);
@@ -3850,9 +3912,38 @@ ModelGeneral::processPriorCorrelations(Background                     * backgrou
     // Consistency check that only one option (file or rock physics) is possible, is done in XmlModelFile::checkInversionConsistency
     //
     float ** paramCov = NULL;
+    std::vector<float> corrT;
+
+    //
+    // Use the correlations of an earlier run of the same model if they are in the run artifact cache.
+    //
+    bool fromCache = false;
+    if(artifactCache != NULL && artifactCache->hasPriorCorrelations()) {
+      paramCov = new float * [3];
+      for(int i=0;i<3;i++)
+        paramCov[i] = new float[3];
+      priorCorrXY_ = findCorrXYGrid(timeSimbox, modelSettings);
+
+      fromCache = artifactCache->readPriorCorrelations(paramCov, corrT, *priorCorrXY_);
+      if(fromCache) {
+        estimateParamCov = false;
+        estimateTempCorr = false;
+      }
+      else {
+        for(int i=0;i<3;i++)
+          delete [] paramCov[i];
+        delete [] paramCov;
+        paramCov = NULL;
+        delete priorCorrXY_;
+      }
+    }
+
     bool failedParamCorr = false;
     std::string tmpErrText("");
-    if(!estimateParamCov) {
+    if(fromCache) {
+      // Read from the run artifact cache above
+    }
+    else if(!estimateParamCov) {
       paramCov = ModelAVODynamic::readMatrix(paramCovFile, 3, 3, "parameter covariance", tmpErrText);
       validateCorrelationMatrix(paramCov, modelSettings, tmpErrText);
       if(paramCov == NULL || tmpErrText != "") {
@@ -3903,9 +3994,10 @@ ModelGeneral::processPriorCorrelations(Background                     * backgrou
     //
     // Estimate lateral correlation from seismic data
     //
-    priorCorrXY_ = findCorrXYGrid(timeSimbox, modelSettings);
+    if(fromCache == false)
+      priorCorrXY_ = findCorrXYGrid(timeSimbox, modelSettings);
 
-    if(modelSettings->getLateralCorr()==NULL) // NBNB-PAL: this will never be true (default lateral corr)
+    if(fromCache == false && modelSettings->getLateralCorr()==NULL) // NBNB-PAL: this will never be true (default lateral corr)
     {
       int timelapse = 0; // Setting timelapse = 0 as this is the generation of prior model
       estimateCorrXYFromSeismic(priorCorrXY_, seisCube, modelSettings->getNumberOfAngles(timelapse));
@@ -3917,10 +4009,8 @@ ModelGeneral::processPriorCorrelations(Background                     * backgrou
     else
       nCorrT = nCorrT/2;
 
-    std::vector<float> corrT;
-
     bool failedTempCorr = false;
-    if(!estimateTempCorr)
+    if(fromCache == false && !estimateTempCorr)
     {
       if(modelSettings->getUseVerticalVariogram() == true) {
         corrT.resize(nCorrT+1);
@@ -4034,6 +4124,9 @@ ModelGeneral::processPriorCorrelations(Background                     * backgrou
                                                  nyPad,
                                                  nzPad);
 
+      if(artifactCache != NULL && fromCache == false)
+        artifactCache->writePriorCorrelations(paramCov, corrT, *priorCorrXY_);
+
       for(int i=0; i<3; i++)
         delete [] paramCov[i];
       delete [] paramCov;
@@ -4171,8 +4264,7 @@ ModelGeneral::estimateCorrXYFromSeismic(Surface *& corrXY,
                                         FFTGrid ** seisCube,
                                         int numberOfAngles)
 {
-  FFTGrid * transf;
-  float   * grid;
+  float * grid;
 
   int n = static_cast<int>(corrXY->GetNI()*corrXY->GetNJ());
   grid = new float[n];
@@ -4180,20 +4272,14 @@ ModelGeneral::estimateCorrXYFromSeismic(Surface *& corrXY,
   for(int i=0 ; i<n ; i++)
     grid[i] = 0.0;
 
+  // The lateral correlation is the zero time lag of the autocorrelation of the data, which is
+  // found from 2D transforms of the time slices. The cubes are used as they are, so file grids
+  // are read once, and not copied.
   for(int i=0 ; i<numberOfAngles ; i++)
   {
-    if(seisCube[i]->isFile())
-      transf = new FFTFileGrid(static_cast<FFTFileGrid *>(seisCube[i])); //move new out of loop? Copy grid instead
-    else
-      transf = new FFTGrid(seisCube[i]); //move new out of loop? Copy grid instead
-
-    transf->setAccessMode(FFTGrid::RANDOMACCESS);
-    transf->fftInPlace();
-    transf->square();
-    transf->invFFTInPlace();
-    transf->collapseAndAdd( grid ); //the result of the collapse (the result for z=0) is is added to grid
-    transf->endAccess();
-    delete transf;
+    seisCube[i]->setAccessMode(FFTGrid::RANDOMACCESS);
+    seisCube[i]->addLateralAutoCorrelation(grid);
+    seisCube[i]->endAccess();
   }
   float sill = grid[0];
   for(int i=0;i<n;i++)
@@ -4552,46 +4638,51 @@ ModelGeneral::readPriorFaciesProbCubes(const InputFiles        * inputFiles,
 
   typedef std::map<std::string,std::string> mapType;
   mapType myMap = inputFiles->getPriorFaciesProbFile();
-  for(int i=0;i<nFacies;i++)
+
+  // The cubes are read concurrently, up to the first facies without a cube
+  int nRead = 0;
+  while(nRead < nFacies && myMap.find(faciesNames_[nRead]) != myMap.end())
+    nRead++;
+
+  GridReadQueue             readQueue(modelSettings);
+  std::vector<std::string>  errorText(nRead, "");
+  std::vector<const SegyGeometry *> dummy1(nRead, NULL);
+  const TraceHeaderFormat * dummy2 = NULL;
+  const float               offset = modelSettings->getSegyOffset(0); //Facies estimation only allowed for one time lapse
+  for(int i=0;i<nRead;i++)
   {
-    mapType::iterator iter = myMap.find(faciesNames_[i]);
+    readQueue.addFile(myMap[faciesNames_[i]],
+                      "Prior probability for facies "+faciesNames_[i],
+                      offset,
+                      priorFaciesProbCubes[i],
+                      dummy1[i],
+                      dummy2,
+                      FFTGrid::PARAMETER,
+                      timeSimbox,
+                      timeCutSimbox,
+                      errorText[i],
+                      true);
+  }
+  readQueue.readAll();
 
-    if(iter!=myMap.end())
-    {
-      const std::string & faciesProbFile = iter->second;
-      const SegyGeometry      * dummy1 = NULL;
-      const TraceHeaderFormat * dummy2 = NULL;
-      const float               offset = modelSettings->getSegyOffset(0); //Facies estimation only allowed for one time lapse
-      std::string errorText("");
-      ModelGeneral::readGridFromFile(faciesProbFile,
-                       "priorfaciesprob",
-                       offset,
-                       priorFaciesProbCubes[i],
-                       dummy1,
-                       dummy2,
-                       FFTGrid::PARAMETER,
-                       timeSimbox,
-                       timeCutSimbox,
-                       modelSettings,
-                       errorText,
-                       true);
-      if(errorText != "")
-      {
-        errorText += "Reading of file \'"+faciesProbFile+"\' for prior facies probability for facies \'"
-                     +faciesNames_[i]+"\' failed\n";
-        errTxt += errorText;
-        failed = true;
-      }
-    }
-    else
+  for(int i=0;i<nRead;i++)
+  {
+    if(errorText[i] != "")
     {
-      LogKit::LogFormatted(LogKit::Warning,"\nWARNING: No prior facies probability found for facies %12s\n",
-                           faciesNames_[i].c_str());
-      TaskList::addTask("Check that facies "+NRLib::ToString(faciesNames_[i].c_str())+" is given prior probability in the xml-file");
-      modelSettings->setEstimateFaciesProb(false);
-      break;
+      errorText[i] += "Reading of file \'"+myMap[faciesNames_[i]]+"\' for prior facies probability for facies \'"
+                      +faciesNames_[i]+"\' failed\n";
+      errTxt += errorText[i];
+      failed = true;
     }
   }
+
+  if(nRead < nFacies)
+  {
+    LogKit::LogFormatted(LogKit::Warning,"\nWARNING: No prior facies probability found for facies %12s\n",
+                         faciesNames_[nRead].c_str());
+    TaskList::addTask("Check that facies "+NRLib::ToString(faciesNames_[nRead].c_str())+" is given prior probability in the xml-file");
+    modelSettings->setEstimateFaciesProb(false);
+  }
 }
 
 bool
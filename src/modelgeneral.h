@@ -36,6 +36,7 @@ class InputFiles;
 class TimeLine;
 class WellData;
 class SeismicParameters;
+class RunArtifactCache;
 
 class ModelGeneral
 {
@@ -62,6 +63,7 @@ public:
   void                       getCorrGradIJ(float & corrGradI, float &corrGradJ) const;
   Surface                  * getCorrelationDirection()  const { return correlationDirection_   ;}
   const State4D            & getState4D()               const { return state4d_                ;}
+  const TimeEvolution      & getTimeEvolution()         const { return timeEvolution_          ;}
 
   TimeLine                 * getTimeLine()              const { return timeLine_               ;}
   std::vector<WellData *>  & getWells()             /*const*/ { return wells_                  ;}
@@ -124,7 +126,8 @@ public:
                                   int nxp,
                                   int nyp,
                                   int nzp,
-                                  bool fileGrid);
+                                  bool fileGrid,
+                                  int  role = 0);     // FFTFileGrid::storageRoles
 
   static void       readGridFromFile(const std::string       & fileName,
                                      const std::string       & parName,
@@ -190,7 +193,8 @@ public:
                                              const InputFiles               * inputFiles,
                                              SeismicParametersHolder        & seismicParameters,
                                              std::string                    & errText,
-                                             bool                           & failed);
+                                             bool                           & failed,
+                                             RunArtifactCache               * artifactCache = NULL);
 
    void             processPriorFaciesProb(const std::vector<Surface*>  & faciesEstimInterval,
                                           std::vector<WellData *>        wells,
@@ -225,6 +229,7 @@ public:
                                 ModelSettings           * modelSettings);
 
   void              setTimeSimbox(Simbox * new_timeSimbox);
+  void              setTimeEvolution(const TimeEvolution & timeEvolution) { timeEvolution_ = timeEvolution ;}
 
   void              setTimeDepthMapping(GridMapping * new_timeDepthMapping);
   void              dump4Dparameters(ModelSettings* modelSettings, std::string identifyer, int timestep);
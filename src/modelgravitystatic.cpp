@@ -34,6 +34,7 @@ ModelGravityStatic::ModelGravityStatic(ModelSettings        *& modelSettings,
 
   failed_                 = false;
   before_injection_start_ = false;
+  matrix_free_            = modelSettings->getMatrixFreeGravimetricInversion();
 
   bool failedLoadingModel = false;
   bool failedReadingFile  = false;
@@ -102,11 +103,13 @@ ModelGravityStatic::ModelGravityStatic(ModelSettings        *& modelSettings,
     MakeUpscalingKernel(modelSettings, fullTimeSimbox);
     LogKit::LogFormatted(LogKit::Low, "ok.\n");
 
-    LogKit::LogFormatted(LogKit::Low, "Generating lag index table (size " + NRLib::ToString(nxp_upscaled_) + " x "
-                                                                          + NRLib::ToString(nyp_upscaled_) + " x "
-                                                                          + NRLib::ToString(nzp_upscaled_) + ") ...");
-    MakeLagIndex(nxp_upscaled_, nyp_upscaled_, nzp_upscaled_); // Including padded region!
-    LogKit::LogFormatted(LogKit::Low, "ok.\n");
+    if (matrix_free_ == false) {
+      LogKit::LogFormatted(LogKit::Low, "Generating lag index table (size " + NRLib::ToString(nxp_upscaled_) + " x "
+                                                                            + NRLib::ToString(nyp_upscaled_) + " x "
+                                                                            + NRLib::ToString(nzp_upscaled_) + ") ...");
+      MakeLagIndex(nxp_upscaled_, nyp_upscaled_, nzp_upscaled_); // Including padded region!
+      LogKit::LogFormatted(LogKit::Low, "ok.\n");
+    }
   }
 
   if (failedLoadingModel) {
@@ -23,6 +23,7 @@ public:
 
   FFTGrid *                     GetUpscalingKernel()       const { return upscaling_kernel_       ;}
   std::vector<std::vector<std::vector<int> > > GetLagIndex() const { return lag_index_            ;}
+  bool                          GetMatrixFree()            const { return matrix_free_            ;}
 
   int                           GetNx_upscaled()            const { return nx_upscaled_           ;}
   int                           GetNy_upscaled()            const { return ny_upscaled_           ;}
@@ -87,6 +88,8 @@ private:
   FFTGrid * upscaling_kernel_;
   std::vector<std::vector<std::vector<int> > > lag_index_;  // eller ha som klassevar i gravimetric inversion-klassen, hrer vel mer hjemme der.
 
+  bool      matrix_free_;              ///< If true, the inversion is done by FFT and the lag index table is not needed
+
   ModelGeneral * modelGeneral_;
 
   void MakeUpscalingKernel(ModelSettings * modelSettings,
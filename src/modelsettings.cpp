@@ -136,6 +136,7 @@ ModelSettings::ModelSettings(void)
   outputGridsSeismic_      =        0;
   outputGridsDefault_      =     true;
   formatFlag_              = IO::STORM;
+  cravaErrorBound_         =      0.0;
   domainFlag_              = IO::TIMEDOMAIN;
   wellFlag_                =        0;
   wellFormatFlag_          = IO::RMSWELL;
@@ -148,6 +149,18 @@ ModelSettings::ModelSettings(void)
   useVerticalVariogram_    =    false;
   do4DInversion_           =    false;
   do4DRockPhysicsInversion_=    false;
+  writeTimeLapseCheckpoints_=   false;
+  timeLapseResumeVintage_  =        0;
+  matrixFreeGravimetricInversion_ = false;
+  outputQueueMemory_       =        0;
+  reducedPrecisionFormat_  =        0;
+  reducedPrecisionGrids_   =        0;
+  precisionStudy_          =    false;
+  precisionReference_      =       "";
+  gridReadingThreads_      =        0;
+  gridReadingMemory_       =        0;
+  useRunArtifactCache_     =    false;
+  runArtifactModelKey_     =       "";
   backgroundFromRockPhysics_=   false;
   calibrateRockPhysicsToWells_= false;
   estimationMode_          =    false;
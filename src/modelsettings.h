@@ -72,6 +72,18 @@ public:
   bool                             getEstimateGlobalWaveletScale(int i, int j) const { return timeLapseEstimateGlobalWaveletScale_[i][j];}
   bool                             getDo4DInversion(void)               const { return do4DInversion_                             ;}
   bool                             getDo4DRockPhysicsInversion(void)    const { return do4DRockPhysicsInversion_                  ;}
+  bool                             getWriteTimeLapseCheckpoints(void)   const { return writeTimeLapseCheckpoints_                 ;}
+  int                              getTimeLapseResumeVintage(void)      const { return timeLapseResumeVintage_                    ;}
+  bool                             getMatrixFreeGravimetricInversion(void) const { return matrixFreeGravimetricInversion_        ;}
+  int                              getOutputQueueMemory(void)           const { return outputQueueMemory_                         ;}
+  int                              getReducedPrecisionFormat(void)      const { return reducedPrecisionFormat_                    ;}
+  int                              getReducedPrecisionGrids(void)       const { return reducedPrecisionGrids_                     ;}
+  bool                             getPrecisionStudy(void)              const { return precisionStudy_                            ;}
+  const std::string              & getPrecisionReference(void)          const { return precisionReference_                        ;}
+  int                              getGridReadingThreads(void)          const { return gridReadingThreads_                        ;}
+  int                              getGridReadingMemory(void)           const { return gridReadingMemory_                         ;}
+  bool                             getUseRunArtifactCache(void)         const { return useRunArtifactCache_                       ;}
+  const std::string              & getRunArtifactModelKey(void)         const { return runArtifactModelKey_                       ;}
   bool                             getEstimateBackground(void)          const { return estimateBackground_                        ;}
   bool                             getEstimateCorrelations(void)        const { return estimateCorrelations_                      ;}
   bool                             getEstimateWaveletNoise(void)        const { return estimateWaveletNoise_                      ;}
@@ -159,6 +171,7 @@ public:
   int                              getOutputGridsSeismic(void)          const { return outputGridsSeismic_                        ;}
   int                              getOutputGridFormat(void)            const { return formatFlag_                                ;}
   int                              getOutputGridDomain(void)            const { return domainFlag_                                ;}
+  float                            getCravaErrorBound(void)             const { return cravaErrorBound_                           ;}
   bool                             getOutputGridsDefaultInd(void)       const { return outputGridsDefault_                        ;}
   int                              getWellOutputFlag(void)              const { return wellFlag_                                  ;}
   int                              getWellFormatFlag(void)              const { return wellFormatFlag_                            ;}
@@ -304,6 +317,18 @@ public:
 
   void setDo4DInversion(bool do4DInversion)               { do4DInversion_            = do4DInversion            ;}
   void setDo4DRockPhysicsInversion(bool do4DRockPhysicsInversion)                      {do4DRockPhysicsInversion_= do4DRockPhysicsInversion;}
+  void setWriteTimeLapseCheckpoints(bool writeCheckpoints){ writeTimeLapseCheckpoints_= writeCheckpoints         ;}
+  void setTimeLapseResumeVintage(int vintage)             { timeLapseResumeVintage_   = vintage                  ;}
+  void setMatrixFreeGravimetricInversion(bool matrixFree) { matrixFreeGravimetricInversion_ = matrixFree         ;}
+  void setOutputQueueMemory(int memory)                   { outputQueueMemory_        = memory                   ;}
+  void setReducedPrecisionFormat(int format)              { reducedPrecisionFormat_   = format                   ;}
+  void addReducedPrecisionGrids(int roles)                { reducedPrecisionGrids_   += roles                    ;}
+  void setPrecisionStudy(bool study)                      { precisionStudy_           = study                    ;}
+  void setPrecisionReference(const std::string & dir)     { precisionReference_       = dir                      ;}
+  void setGridReadingThreads(int threads)                 { gridReadingThreads_       = threads                  ;}
+  void setGridReadingMemory(int memory)                   { gridReadingMemory_        = memory                   ;}
+  void setUseRunArtifactCache(bool useCache)              { useRunArtifactCache_      = useCache                 ;}
+  void setRunArtifactModelKey(const std::string & key)    { runArtifactModelKey_      = key                      ;}
   void setEstimateBackground(bool estimateBackground)     { estimateBackground_       = estimateBackground       ;}
   void setEstimateCorrelations(bool estimateCorrelations) { estimateCorrelations_     = estimateCorrelations     ;}
   void setEstimateWaveletNoise(bool estimateWaveletNoise) { estimateWaveletNoise_     = estimateWaveletNoise     ;}
@@ -391,6 +416,7 @@ public:
   void setWritePrediction(bool write)                     { writePrediction_          = write                    ;}
   void setOutputGridFormat(int formatFlag)                { formatFlag_               = formatFlag               ;}
   void setOutputGridDomain(int domainFlag)                { domainFlag_               = domainFlag               ;}
+  void setCravaErrorBound(float errorBound)               { cravaErrorBound_          = errorBound               ;}
   void setOutputGridsElastic(int outputGridsElastic)      { outputGridsElastic_       = outputGridsElastic       ;}
   void setOutputGridsOther(int outputGridsOther)          { outputGridsOther_         = outputGridsOther         ;}
   void setOutputGridsSeismic(int outputGridsSeismic)      { outputGridsSeismic_       = outputGridsSeismic       ;}
@@ -635,6 +661,18 @@ private:
 
   bool                              do4DInversion_;              ///< True if CRAVA is to run a 4D inversion
   bool                              do4DRockPhysicsInversion_;   ///< True if we should do rockpysics inversion, only active for 4D inversion
+  bool                              writeTimeLapseCheckpoints_;  ///< True if the 4D state is to be written to file after each time lapse event
+  int                               timeLapseResumeVintage_;     ///< Vintage (counting from 1) to resume a 4D inversion from. 0 = no resume
+  bool                              matrixFreeGravimetricInversion_; ///< True if the gravimetric posterior is found by FFT, without dense covariance matrices
+  int                               outputQueueMemory_;          ///< Memory (MB) for grids queued for background writing. 0 = grids are written directly
+  int                               reducedPrecisionFormat_;     ///< 16-bit format (FFTFileGrid::storageFormats) for reducedPrecisionGrids_
+  int                               reducedPrecisionGrids_;      ///< Grid roles (FFTFileGrid::storageRoles) kept in reduced precision
+  bool                              precisionStudy_;             ///< True if the error of the reduced precision storage is to be reported
+  std::string                       precisionReference_;         ///< Output directory of a full precision run that the results are compared with
+  int                               gridReadingThreads_;         ///< Number of grid files read concurrently. 0 = one per OpenMP thread
+  int                               gridReadingMemory_;          ///< Memory (MB) for grid files read concurrently. 0 = no limit
+  bool                              useRunArtifactCache_;        ///< True if background, seismic data and prior correlations are reused from an earlier run
+  std::string                       runArtifactModelKey_;        ///< The model file without the settings that do not affect the cached artifacts
   bool                              backgroundFromRockPhysics_;  ///< True if background is to be generated from rock physics. Is this relevant? Or same as faciesProbFromRockPhysics_?
   bool                              estimateBackground_;         ///< In estimation mode, skip estimation of background if false
   bool                              estimateCorrelations_;       ///< As above, but correlations.
@@ -760,6 +798,7 @@ private:
   int                               outputGridsSeismic_;         ///< Decides seismic grid output to be written to file.
   int                               domainFlag_;                 ///< Decides writing in time and/or depth.
   int                               formatFlag_;                 ///< Decides output format, see above.
+  float                             cravaErrorBound_;            ///< Error bound for probability and covariance grids in crava format. 0 = lossless
   int                               wellFlag_;                   ///< Decides well output.
   int                               wellFormatFlag_;             ///< Decides well output format.
   int                               waveletFlag_;                ///< Decides wavelet output
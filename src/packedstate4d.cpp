@@ -0,0 +1,159 @@
+#include <assert.h>
+#include <stdlib.h>
+
+#include "src/packedstate4d.h"
+#include "src/fftgrid.h"
+
+PackedState4D::PackedState4D(int nCells)
+  : nCells_(nCells)
+{
+  // Align the cells to cache lines, so that no two cells share a line.
+  memory_ = new char[nCells_*sizeof(Cell) + CACHE_LINE];
+  size_t offset = reinterpret_cast<size_t>(memory_) % CACHE_LINE;
+  cells_  = reinterpret_cast<Cell *>(memory_ + (offset == 0 ? 0 : CACHE_LINE - offset));
+}
+
+PackedState4D::~PackedState4D()
+{
+  delete [] memory_;
+}
+
+void
+PackedState4D::readNextMu(const std::vector<FFTGrid *> & mu)
+{
+  assert(mu.size() == 6);
+  for (int d = 0; d < 6; d++) {
+    for (int c = 0; c < nCells_; c++)
+      cells_[c].mu[d] = mu[d]->getNextComplex();
+  }
+}
+
+void
+PackedState4D::readNextSigma(const std::vector<FFTGrid *> & sigma)
+{
+  assert(sigma.size() == 21);
+  for (int d = 0; d < 21; d++) {
+    for (int c = 0; c < nCells_; c++)
+      cells_[c].sigma[d] = sigma[d]->getNextComplex();
+  }
+}
+
+void
+PackedState4D::writeNextMu(const std::vector<FFTGrid *> & mu) const
+{
+  assert(mu.size() == 6);
+  for (int d = 0; d < 6; d++) {
+    for (int c = 0; c < nCells_; c++)
+      mu[d]->setNextComplex(cells_[c].mu[d]);
+  }
+}
+
+void
+PackedState4D::writeNextSigma(const std::vector<FFTGrid *> & sigma) const
+{
+  assert(sigma.size() == 21);
+  for (int d = 0; d < 21; d++) {
+    for (int c = 0; c < nCells_; c++)
+      sigma[d]->setNextComplex(cells_[c].sigma[d]);
+  }
+}
+
+void
+PackedState4D::getFullSigma(const Cell & cell, fftw_complex ** sigma)
+{
+  int counter = 0;
+  for (int l = 0; l < 6; l++) {
+    for (int m = l; m < 6; m++) {
+      sigma[l][m] = cell.sigma[counter];
+      if (m != l) {
+        sigma[m][l].re =  sigma[l][m].re;
+        sigma[m][l].im = -sigma[l][m].im;
+      }
+      counter++;
+    }
+  }
+}
+
+void
+PackedState4D::setFullSigma(Cell & cell, fftw_complex ** sigma)
+{
+  int counter = 0;
+  for (int l = 0; l < 6; l++) {
+    for (int m = l; m < 6; m++) {
+      cell.sigma[counter] = sigma[l][m];
+      counter++;
+    }
+  }
+}
+
+void
+PackedState4D::evolve(Cell         & cell,
+                      const double * A,
+                      const double * b,
+                      const double * C,
+                      double         meanScale,
+                      double         lambda)
+{
+  // Mean. The correction term b is only added in the (0,0,0) coefficient (meanScale = 0 elsewhere).
+  double muRe[6];
+  double muIm[6];
+  for (int d = 0; d < 6; d++) {
+    muRe[d] = cell.mu[d].re;
+    muIm[d] = cell.mu[d].im;
+  }
+  for (int l = 0; l < 6; l++) {
+    double re = 0.0;
+    double im = 0.0;
+    for (int m = 0; m < 6; m++) {
+      re += A[6*l + m]*muRe[m];
+      im += A[6*l + m]*muIm[m];
+    }
+    cell.mu[l].re = static_cast<float>(re + b[l]*meanScale);
+    cell.mu[l].im = static_cast<float>(im);
+  }
+
+  // Covariance. Expand to full Hermitian matrix, and find tmp = A*Sigma.
+  double sRe[36];
+  double sIm[36];
+  int counter = 0;
+  for (int l = 0; l < 6; l++) {
+    for (int m = l; m < 6; m++) {
+      sRe[6*l + m] =  cell.sigma[counter].re;
+      sIm[6*l + m] =  cell.sigma[counter].im;
+      sRe[6*m + l] =  sRe[6*l + m];
+      sIm[6*m + l] = -sIm[6*l + m];
+      counter++;
+    }
+  }
+
+  double tRe[36];
+  double tIm[36];
+  for (int l = 0; l < 6; l++) {
+    for (int m = 0; m < 6; m++) {
+      double re = 0.0;
+      double im = 0.0;
+      for (int n = 0; n < 6; n++) {
+        re += A[6*l + n]*sRe[6*n + m];
+        im += A[6*l + n]*sIm[6*n + m];
+      }
+      tRe[6*l + m] = re;
+      tIm[6*l + m] = im;
+    }
+  }
+
+  // The result tmp*A^T is Hermitian, so only the upper triangle is needed.
+  counter = 0;
+  for (int l = 0; l < 6; l++) {
+    for (int m = l; m < 6; m++) {
+      double re = 0.0;
+      double im = 0.0;
+      for (int n = 0; n < 6; n++) {
+        re += tRe[6*l + n]*A[6*m + n];
+        im += tIm[6*l + n]*A[6*m + n];
+      }
+      cell.sigma[counter].re = static_cast<float>(re + C[6*l + m]*lambda);
+      cell.sigma[counter].im = static_cast<float>(im);
+      counter++;
+    }
+  }
+}
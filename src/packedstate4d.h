@@ -0,0 +1,66 @@
+#ifndef PACKEDSTATE4D_H
+#define PACKEDSTATE4D_H
+
+#include <vector>
+
+#include "fftw.h"
+
+class FFTGrid;
+
+// Packed storage of the 4D state for one layer of the complex (half spectrum) FFT grids.
+// For each cell, the six means and the 21 upper triangular entries of the Hermitian 6x6
+// covariance matrix are stored contiguously, padded to four cache lines. The layer is
+// read from and written back to the State4D grids through their cursors, so it works for
+// both memory and file grids. The per-cell updates in State4D then work on contiguous
+// memory only, and can be done in parallel.
+class PackedState4D
+{
+public:
+  struct Cell
+  {
+    fftw_complex mu[6];        // [0,1,2] = static vp, vs, rho, [3,4,5] = dynamic vp, vs, rho
+    fftw_complex sigma[21];    // Row-wise upper triangle: (0,0), (0,1), ..., (0,5), (1,1), ..., (5,5)
+    fftw_complex padding[5];
+  };
+
+  PackedState4D(int nCells);
+  ~PackedState4D();
+
+  int            getNCells()   const { return nCells_ ;}
+  Cell         & operator()(int c)   { return cells_[c] ;}
+  const Cell   & operator()(int c) const { return cells_[c] ;}
+
+  // Reads/writes the next nCells values using the current access mode of the grids.
+  // The sigma grids must be given in the packed order (see State4D::getPackedGrids()).
+  void           readNextMu(const std::vector<FFTGrid *>    & mu);
+  void           readNextSigma(const std::vector<FFTGrid *> & sigma);
+  void           writeNextMu(const std::vector<FFTGrid *>    & mu)    const;
+  void           writeNextSigma(const std::vector<FFTGrid *> & sigma) const;
+
+  static int     sigmaIndex(int l, int m)  { return (l <= m ? l*6 - (l*(l-1))/2 + m - l : sigmaIndex(m, l)) ;}
+
+  // Expands the packed covariance of a cell to a full 6x6 matrix, using Hermitian symmetry.
+  static void    getFullSigma(const Cell & cell, fftw_complex ** sigma);
+  static void    setFullSigma(Cell & cell, fftw_complex ** sigma);
+
+  // Forward transition in time: mu = A*mu + meanScale*b and Sigma = A*Sigma*A^T + lambda*C,
+  // where A, b and C are real. Only the upper triangle of the result is computed.
+  static void    evolve(Cell         & cell,
+                        const double * A,                       // 6x6, row major
+                        const double * b,                       // 6
+                        const double * C,                       // 6x6, row major
+                        double         meanScale,
+                        double         lambda);
+
+private:
+  PackedState4D(const PackedState4D & rhs);              // Not implemented, owns the memory
+  PackedState4D & operator=(const PackedState4D & rhs);  // Not implemented
+
+  int            nCells_;
+  char         * memory_;
+  Cell         * cells_;
+
+  enum           { CACHE_LINE = 64 };
+};
+
+#endif
@@ -9,6 +9,12 @@
 #include "src/simbox.h"
 #include "src/modelgeneral.h"
 #include "src/io.h"
+#include "src/gridwritequeue.h"
+
+#include <assert.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
 
 void
 ParameterOutput::writeParameters(const Simbox  * simbox,
@@ -40,46 +46,9 @@ ParameterOutput::writeParameters(const Simbox  * simbox,
   if(kriged)
     suffix = "_Kriged"+suffix;
 
-  if((outputFlag & IO::MURHO) > 0)
-  {
-    fileName = prefix+"MuRho"+suffix;
-    computeMuRho(simbox, modelGeneral, modelSettings, alpha, beta, rho, fileGrid, fileName);
-  }
-  if((outputFlag & IO::LAMBDARHO) > 0)
-  {
-    fileName = prefix+"LambdaRho"+suffix;
-    computeLambdaRho(simbox, modelGeneral, modelSettings, alpha, beta, rho, fileGrid, fileName);
-  }
-  if((outputFlag & IO::LAMELAMBDA) > 0)
-  {
-    fileName = prefix+"LameLambda"+suffix;
-    computeLameLambda(simbox, modelGeneral, modelSettings, alpha, beta, rho, fileGrid, fileName);
-  }
-  if((outputFlag & IO::LAMEMU) > 0)
-  {
-    fileName = prefix+"LameMu"+suffix;
-    computeLameMu(simbox, modelGeneral,  modelSettings, beta, rho, fileGrid, fileName);
-  }
-  if((outputFlag & IO::POISSONRATIO) > 0)
-  {
-    fileName = prefix+"PoissonRatio"+suffix;
-    computePoissonRatio(simbox, modelGeneral, modelSettings, alpha, beta, fileGrid, fileName);
-  }
-  if((outputFlag & IO::AI) > 0)
-  {
-    fileName = prefix+"AI"+suffix;
-    computeAcousticImpedance(simbox, modelGeneral, modelSettings, alpha, rho, fileGrid, fileName);
-  }
-  if((outputFlag & IO::SI) > 0)
-  {
-    fileName = prefix+"SI"+suffix;
-    computeShearImpedance(simbox, modelGeneral, modelSettings, beta, rho, fileGrid, fileName);
-  }
-  if((outputFlag & IO::VPVSRATIO) > 0)
-  {
-    fileName = prefix+"VpVsRatio"+suffix;
-    computeVpVsRatio(simbox, modelGeneral, modelSettings, alpha, beta, fileGrid, fileName);
-  }
+  computeDerivedParameters(simbox, modelGeneral, modelSettings, alpha, beta, rho,
+                           outputFlag, fileGrid, prefix, suffix);
+
   if((outputFlag & IO::VP) > 0)
   {
     fileName = prefix+"Vp"+suffix;
@@ -113,304 +82,170 @@ ParameterOutput::writeParameters(const Simbox  * simbox,
 }
 
 void
-ParameterOutput::computeAcousticImpedance(const Simbox * simbox, ModelGeneral * modelGeneral, const ModelSettings * modelSettings,
-                                          FFTGrid * Alpha, FFTGrid * Rho ,
-                                          bool fileGrid, const std::string & fileName)
-{
-  if(Alpha->getIsTransformed()) Alpha->invFFTInPlace();
-  if(Rho->getIsTransformed()) Rho->invFFTInPlace();
-
-  Alpha->setAccessMode(FFTGrid::READ);
-  Rho->setAccessMode(FFTGrid::READ);
-
-  FFTGrid* prImpedance;
-  prImpedance = createFFTGrid(Alpha, fileGrid);
-  prImpedance->setType(FFTGrid::PARAMETER);
-  prImpedance->createRealGrid();
-  prImpedance->setAccessMode(FFTGrid::WRITE);
-
-  int i;
-  int rSize =  prImpedance->getrsize();
-  double ijkA, ijkR, compVal;
-  for(i=0; i  <  rSize; i++)
-  {
-    ijkA = Alpha->getNextReal();
-    ijkR = Rho->getNextReal();
-    compVal = exp(ijkA + ijkR);
-    prImpedance->setNextReal(float( compVal));
-  }
-
-  Alpha->endAccess();
-  Rho->endAccess();
-
-  prImpedance->endAccess();
-  writeToFile(simbox, modelGeneral, modelSettings, prImpedance, fileName, "Acoustic Impedance");
-  delete prImpedance;
-}
-
-void
-ParameterOutput::computeShearImpedance(const Simbox * simbox, ModelGeneral * modelGeneral, const ModelSettings * modelSettings,
-                                       FFTGrid * Beta, FFTGrid * Rho,
-                                       bool fileGrid, const std::string & fileName)
+ParameterOutput::computeDerivedParameters(const Simbox        * simbox,
+                                          ModelGeneral        * modelGeneral,
+                                          const ModelSettings * modelSettings,
+                                          FFTGrid             * alpha,
+                                          FFTGrid             * beta,
+                                          FFTGrid             * rho,
+                                          int                   outputFlag,
+                                          bool                  fileGrid,
+                                          const std::string   & prefix,
+                                          const std::string   & suffix)
 {
-
-  if(Beta->getIsTransformed()) Beta->invFFTInPlace();
-  if(Rho->getIsTransformed()) Rho->invFFTInPlace();
-
-  Beta->setAccessMode(FFTGrid::READ);
-  Rho->setAccessMode(FFTGrid::READ);
-
-  FFTGrid* shImpedance;
-  shImpedance  = createFFTGrid(Beta, fileGrid);
-  shImpedance->setType(FFTGrid::PARAMETER);
-  shImpedance->createRealGrid();
-  shImpedance->setAccessMode(FFTGrid::WRITE);
-  int i;
-  int rSize =  shImpedance->getrsize();
-  double ijkB, ijkR, compVal;
-  for(i=0; i  <  rSize; i++)
+  // All requested parameters are made in one pass over alpha, beta and rho, reading each cell
+  // once and writing every parameter in the same loop. The pass holds one output grid for each
+  // parameter. In memory, the parameters are split in as many passes as needed to stay within the
+  // grids allowed by the memory estimate, which counts one output grid. File grids are all made
+  // in one pass. The grids are written in the order of the parameters below.
+  const int nParam = 8;
+  const int flags[nParam]         = {IO::MURHO, IO::LAMBDARHO, IO::LAMELAMBDA, IO::LAMEMU,
+                                     IO::POISSONRATIO, IO::AI, IO::SI, IO::VPVSRATIO};
+  const std::string names[nParam] = {"MuRho", "LambdaRho", "LameLambda", "LameMu",
+                                     "PoissonRatio", "AI", "SI", "VpVsRatio"};
+  const std::string labels[nParam]= {"Mu rho", "Lambda rho", "Lame lambda", "Lame mu",
+                                     "Poisson ratio", "Acoustic Impedance", "Shear impedance", "Vp-Vs ratio"};
+
+  // Inputs needed: MuRho, LameMu and SI do not use alpha. AI does not use beta, and
+  // PoissonRatio and VpVsRatio do not use rho.
+  const int alphaFlags = IO::LAMBDARHO + IO::LAMELAMBDA + IO::POISSONRATIO + IO::AI + IO::VPVSRATIO;
+  const int betaFlags  = IO::MURHO + IO::LAMBDARHO + IO::LAMELAMBDA + IO::LAMEMU + IO::POISSONRATIO + IO::SI + IO::VPVSRATIO;
+  const int rhoFlags   = IO::MURHO + IO::LAMBDARHO + IO::LAMELAMBDA + IO::LAMEMU + IO::AI + IO::SI;
+
+  std::vector<int> requested;
+  for(int p=0; p<nParam; p++)
+    if((outputFlag & flags[p]) > 0)
+      requested.push_back(p);
+  int nRequested = static_cast<int>(requested.size());
+  if(nRequested == 0)
+    return;
+
+  int maxGrids = nRequested;
+  if(fileGrid == false)
+    maxGrids = std::max(1, std::min(nRequested, FFTGrid::getMaxAllowedGrids() - FFTGrid::getNumberOfGrids()));
+
+  for(int first=0; first < nRequested; first += maxGrids)
   {
-    ijkB = Beta->getNextReal();
-    ijkR = Rho->getNextReal();
-    compVal = exp(ijkB + ijkR);
-    shImpedance->setNextReal(float( compVal));
+    int nPass    = std::min(maxGrids, nRequested - first);
+    int passFlag = 0;
+    for(int n=0; n < nPass; n++)
+      passFlag += flags[requested[first+n]];
+
+    bool useAlpha = (passFlag & alphaFlags) > 0;
+    bool useBeta  = (passFlag & betaFlags)  > 0;
+    bool useRho   = (passFlag & rhoFlags)   > 0;
+
+    FFTGrid * refGrid = (useAlpha ? alpha : beta);
+    std::vector<FFTGrid *> grids(nPass);
+    for(int n=0; n < nPass; n++) {
+      grids[n] = createFFTGrid(refGrid, fileGrid);
+      grids[n]->setType(FFTGrid::PARAMETER);
+      grids[n]->createRealGrid();
+      grids[n]->setAccessMode(FFTGrid::WRITE);
+    }
+
+    if(useAlpha) {
+      if(alpha->getIsTransformed()) alpha->invFFTInPlace();
+      alpha->setAccessMode(FFTGrid::READ);
+    }
+    if(useBeta) {
+      if(beta->getIsTransformed()) beta->invFFTInPlace();
+      beta->setAccessMode(FFTGrid::READ);
+    }
+    if(useRho) {
+      if(rho->getIsTransformed()) rho->invFFTInPlace();
+      rho->setAccessMode(FFTGrid::READ);
+    }
+
+    int rnxp  = refGrid->getRNxp();
+    int nRows = refGrid->getNyp()*refGrid->getNzp();
+    std::vector<double> ijkA(rnxp, 0.0);
+    std::vector<double> ijkB(rnxp, 0.0);
+    std::vector<double> ijkR(rnxp, 0.0);
+    std::vector<float>  value(rnxp);
+    for(int row=0; row < nRows; row++)
+    {
+      for(int i=0; i < rnxp; i++)
+      {
+        if(useAlpha)
+          ijkA[i] = alpha->getNextReal();
+        if(useBeta)
+          ijkB[i] = beta->getNextReal();
+        if(useRho)
+          ijkR[i] = rho->getNextReal();
+      }
+      for(int n=0; n < nPass; n++)
+      {
+        computeDerivedValues(flags[requested[first+n]], &ijkA[0], &ijkB[0], &ijkR[0], &value[0], rnxp);
+        for(int i=0; i < rnxp; i++)
+          grids[n]->setNextReal(value[i]);
+      }
+    }
+
+    if(useAlpha)
+      alpha->endAccess();
+    if(useBeta)
+      beta->endAccess();
+    if(useRho)
+      rho->endAccess();
+
+    for(int n=0; n < nPass; n++) {
+      int p = requested[first+n];
+      grids[n]->endAccess();
+      writeToFile(simbox, modelGeneral, modelSettings, grids[n], prefix+names[p]+suffix, labels[p]);
+      delete grids[n];
+    }
   }
-
-  Beta->endAccess();
-  Rho->endAccess();
-
-  shImpedance->endAccess();
-  writeToFile(simbox, modelGeneral, modelSettings, shImpedance, fileName, "Shear impedance");
-  delete shImpedance;
 }
 
-
 void
-ParameterOutput::computeVpVsRatio(const Simbox * simbox, ModelGeneral * modelGeneral, const ModelSettings * modelSettings,
-                                  FFTGrid * Alpha, FFTGrid * Beta,
-                                  bool fileGrid, const std::string & fileName)
+ParameterOutput::computeDerivedValues(int            parameter,
+                                      const double * ijkA,
+                                      const double * ijkB,
+                                      const double * ijkR,
+                                      float        * value,
+                                      int            n)
 {
-  if(Alpha->getIsTransformed()) Alpha->invFFTInPlace();
-  if(Beta->getIsTransformed())  Beta->invFFTInPlace();
-
-  Alpha->setAccessMode(FFTGrid::READ);
-  Beta->setAccessMode(FFTGrid::READ);
-
-  FFTGrid* ratioVpVs;
-  ratioVpVs = createFFTGrid(Alpha, fileGrid);
-  ratioVpVs->setType(FFTGrid::PARAMETER);
-  ratioVpVs->createRealGrid();
-  ratioVpVs->setAccessMode(FFTGrid::WRITE);
+  // -13.81551 in the exponent divides by 1e6=(1 000 000)
   int i;
-  int rSize =  ratioVpVs->getrsize();
-  double ijkA, ijkB, compVal;
-  for(i=0; i  <  rSize; i++)
-  {
-    ijkA = Alpha->getNextReal();
-    ijkB = Beta->getNextReal();
-    compVal = exp(ijkA - ijkB);
-    ratioVpVs->setNextReal(float( compVal));
+  switch(parameter) {
+  case IO::MURHO:
+    for(i=0; i<n; i++)
+      value[i] = float(exp(2.0*(ijkB[i] +ijkR[i])-13.81551));
+    break;
+  case IO::LAMBDARHO:
+    for(i=0; i<n; i++)
+      value[i] = float(exp(2.0*(ijkA[i] +ijkR[i])-13.81551)-2.0*exp(2.0*(ijkB[i] +ijkR[i])-13.81551));
+    break;
+  case IO::LAMELAMBDA:
+    for(i=0; i<n; i++)
+      value[i] = float(exp(ijkR[i])*(exp(2*ijkA[i]-13.81551)-2*exp(2*ijkB[i]-13.81551)));
+    break;
+  case IO::LAMEMU:
+    for(i=0; i<n; i++)
+      value[i] = float(exp(ijkR[i]+2*ijkB[i]-13.81551));
+    break;
+  case IO::POISSONRATIO:
+    for(i=0; i<n; i++) {
+      double vRatioSq = exp(2*(ijkA[i]-ijkB[i]));
+      value[i] = float(0.5*(vRatioSq - 2)/(vRatioSq - 1));
+    }
+    break;
+  case IO::AI:
+    for(i=0; i<n; i++)
+      value[i] = float(exp(ijkA[i] + ijkR[i]));
+    break;
+  case IO::SI:
+    for(i=0; i<n; i++)
+      value[i] = float(exp(ijkB[i] + ijkR[i]));
+    break;
+  case IO::VPVSRATIO:
+    for(i=0; i<n; i++)
+      value[i] = float(exp(ijkA[i] - ijkB[i]));
+    break;
+  default:
+    assert(false);
   }
-
-  Alpha->endAccess();
-  Beta->endAccess();
-
-  ratioVpVs->endAccess();
-  writeToFile(simbox, modelGeneral, modelSettings, ratioVpVs, fileName, "Vp-Vs ratio");
-  delete ratioVpVs;
-}
-
-void
-ParameterOutput::computePoissonRatio(const Simbox * simbox, ModelGeneral * modelGeneral, const ModelSettings * modelSettings,
-                                     FFTGrid * Alpha, FFTGrid * Beta,
-                                     bool fileGrid, const std::string & fileName)
-{
-  if(Alpha->getIsTransformed()) Alpha->invFFTInPlace();
-  if(Beta->getIsTransformed()) Beta->invFFTInPlace();
-
-  Alpha->setAccessMode(FFTGrid::READ);
-  Beta->setAccessMode(FFTGrid::READ);
-
-  FFTGrid* poiRat;
-  poiRat  = createFFTGrid(Alpha, fileGrid);
-  poiRat->setType(FFTGrid::PARAMETER);
-  poiRat->createRealGrid();
-  poiRat->setAccessMode(FFTGrid::WRITE);
-
-  int i;
-  int rSize =  poiRat->getrsize();
-  double ijkA, ijkB, compVal, vRatioSq;
-  for(i=0; i  <  rSize; i++)
-  {
-    ijkA      = Alpha->getNextReal();
-    ijkB      = Beta->getNextReal();
-    vRatioSq  = exp(2*(ijkA-ijkB));
-    compVal   = 0.5*(vRatioSq - 2)/(vRatioSq - 1);
-    poiRat->setNextReal(float( compVal));
-  }
-
-  Alpha->endAccess();
-  Beta->endAccess();
-
-  poiRat->endAccess();
-  writeToFile(simbox, modelGeneral, modelSettings, poiRat, fileName, "Poisson ratio");
-  delete poiRat;
-}
-
-void
-ParameterOutput::computeLameMu(const Simbox * simbox, ModelGeneral * modelGeneral, const ModelSettings * modelSettings,
-                               FFTGrid * Beta, FFTGrid * Rho,
-                               bool fileGrid, const std::string & fileName )
-{
-  if(Beta->getIsTransformed()) Beta->invFFTInPlace();
-  if(Rho->getIsTransformed()) Rho->invFFTInPlace();
-
-  Beta->setAccessMode(FFTGrid::READ);
-  Rho->setAccessMode(FFTGrid::READ);
-
-  FFTGrid* mu;
-  mu  = createFFTGrid(Beta, fileGrid);
-  mu->setType(FFTGrid::PARAMETER);
-  mu->createRealGrid();
-  mu->setAccessMode(FFTGrid::WRITE);
-
-  int i;
-  int rSize =  mu->getrsize();
-  double ijkB, ijkR, compVal;
-  for(i=0; i  <  rSize; i++)
-  {
-    ijkB = Beta->getNextReal();
-    ijkR = Rho->getNextReal();
-    compVal = exp(ijkR+2*ijkB-13.81551); // -13.81551 in the exponent divides by 1 000 000
-    mu->setNextReal(float( compVal));
-  }
-
-  Beta->endAccess();
-  Rho->endAccess();
-  mu->endAccess();
-  writeToFile(simbox, modelGeneral, modelSettings, mu, fileName, "Lame mu");
-
-  delete mu;
-}
-
-void
-ParameterOutput::computeLameLambda(const Simbox * simbox, ModelGeneral * modelGeneral, const ModelSettings * modelSettings,
-                                   FFTGrid * Alpha, FFTGrid * Beta, FFTGrid * Rho,
-                                   bool fileGrid, const std::string & fileName)
-{
-  if(Alpha->getIsTransformed()) Alpha->invFFTInPlace();
-  if(Beta->getIsTransformed()) Beta->invFFTInPlace();
-  if(Rho->getIsTransformed()) Rho->invFFTInPlace();
-
-  Alpha->setAccessMode(FFTGrid::READ);
-  Beta->setAccessMode(FFTGrid::READ);
-  Rho->setAccessMode(FFTGrid::READ);
-
-  FFTGrid* lambda;
-  lambda  = createFFTGrid(Alpha, fileGrid);
-  lambda->setType(FFTGrid::PARAMETER);
-  lambda->createRealGrid();
-  lambda->setAccessMode(FFTGrid::WRITE);
-
-  int i;
-  int rSize =  lambda->getrsize();
-  double ijkA, ijkB, ijkR, compVal;
-  for(i=0; i  <  rSize; i++)
-  {
-    ijkA = Alpha->getNextReal();
-    ijkB = Beta->getNextReal();
-    ijkR = Rho->getNextReal();
-    compVal = exp(ijkR)*(exp(2*ijkA-13.81551)-2*exp(2*ijkB-13.81551)); // -13.81551 in the exponent divides by 1 000 000
-    lambda->setNextReal(float( compVal));
-  }
-
-  Alpha->endAccess();
-  Beta->endAccess();
-  Rho->endAccess();
-
-  lambda->endAccess();
-  writeToFile(simbox, modelGeneral, modelSettings, lambda, fileName, "Lame lambda");
-
-  delete lambda;
-}
-
-void
-ParameterOutput::computeLambdaRho(const Simbox * simbox, ModelGeneral * modelGeneral, const ModelSettings * modelSettings,
-                                  FFTGrid * Alpha, FFTGrid * Beta, FFTGrid * Rho,
-                                  bool fileGrid, const std::string & fileName)
-{
-  if(Alpha->getIsTransformed()) Alpha->invFFTInPlace();
-  if(Beta->getIsTransformed()) Beta->invFFTInPlace();
-  if(Rho->getIsTransformed()) Rho->invFFTInPlace();
-
-  Alpha->setAccessMode(FFTGrid::READ);
-  Beta->setAccessMode(FFTGrid::READ);
-  Rho->setAccessMode(FFTGrid::READ);
-
-  FFTGrid* lambdaRho;
-  lambdaRho  = createFFTGrid(Alpha, fileGrid);
-  lambdaRho->setType(FFTGrid::PARAMETER);
-  lambdaRho->createRealGrid();
-  lambdaRho->setAccessMode(FFTGrid::WRITE);
-
-  int i;
-  int rSize =  lambdaRho->getrsize();
-  double ijkA, ijkB, ijkR, compVal;
-  for(i=0; i  <  rSize; i++)
-  {
-    ijkA = Alpha->getNextReal();
-    ijkB = Beta->getNextReal();
-    ijkR = Rho->getNextReal();
-    compVal = exp(2.0*(ijkA +ijkR)-13.81551)-2.0*exp(2.0*(ijkB +ijkR)-13.81551); // -13.81551 in the exponent divides by 1e6=(1 000 000)
-    lambdaRho->setNextReal(float( compVal));
-  }
-
-  Alpha->endAccess();
-  Beta->endAccess();
-  Rho->endAccess();
-
-  lambdaRho->endAccess();
-
-  writeToFile(simbox, modelGeneral, modelSettings, lambdaRho, fileName, "Lambda rho");
-  delete lambdaRho;
-}
-
-void
-ParameterOutput::computeMuRho(const Simbox * simbox, ModelGeneral * modelGeneral, const ModelSettings * modelSettings,
-                              FFTGrid * Alpha, FFTGrid * Beta, FFTGrid * Rho,
-                              bool fileGrid, const std::string & fileName)
-{
-  if(Beta->getIsTransformed()) Beta->invFFTInPlace();
-  if(Rho->getIsTransformed()) Rho->invFFTInPlace();
-
-  Beta->setAccessMode(FFTGrid::READ);
-  Rho->setAccessMode(FFTGrid::READ);
-
-  FFTGrid* muRho;
-  muRho = createFFTGrid(Alpha, fileGrid);
-  muRho->setType(FFTGrid::PARAMETER);
-  muRho->createRealGrid();
-  muRho->setAccessMode(FFTGrid::WRITE);
-
-  int i;
-  int rSize =  muRho->getrsize();
-  double ijkB, ijkR, compVal;
-  for(i=0; i  <  rSize; i++)
-  {
-    ijkB = Beta->getNextReal();
-    ijkR = Rho->getNextReal();
-    compVal = exp(2.0*(ijkB +ijkR)-13.81551); // -13.81551 in the exponent divides by 1e6=(1 000 000)
-    muRho->setNextReal(float( compVal));
-  }
-
-  Alpha->endAccess();
-  Beta->endAccess();
-  Rho->endAccess();
-
-  muRho->endAccess();
-  writeToFile(simbox, modelGeneral, modelSettings, muRho, fileName, "Mu rho");
-
-  delete muRho;
 }
 
 FFTGrid*
@@ -447,6 +282,23 @@ ParameterOutput::writeToFile(const Simbox      * simbox,
   float         seismicStartTime = 0.0; //Hack for Sebastian, was: model->getModelSettings()->getSegyOffset();
   TraceHeaderFormat *format = modelSettings->getTraceHeaderFormatOutput();
 
+  FFTFileGrid::compareWithReference(grid, fileName);
+
+  GridWriteQueue * writeQueue = GridWriteQueue::getActive();
+  if(writeQueue != NULL) {
+    writeQueue->writeFile(grid,
+                          fileName,
+                          IO::PathToInversionResults(),
+                          simbox,
+                          sgriLabel,
+                          seismicStartTime,
+                          timeDepthMapping,
+                          timeCutMapping,
+                          *format,
+                          padding);
+    return;
+  }
+
   grid->writeFile(fileName,
                   IO::PathToInversionResults(),
                   simbox,
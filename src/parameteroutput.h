@@ -39,30 +39,25 @@ public:
 
 
 private:
-  static void      computeAcousticImpedance(const Simbox * simbox, ModelGeneral * modelGeneral, const ModelSettings * modelSettings,
-                                            FFTGrid * Alpha, FFTGrid * Rho,
-                                            bool fileGrid, const std::string & fileName);
-  static void      computeShearImpedance(const Simbox * simbox, ModelGeneral * modelGeneral, const ModelSettings * modelSettings,
-                                         FFTGrid * Beta, FFTGrid * Rho,
-                                         bool fileGrid, const std::string & fileName);
-  static void      computeVpVsRatio(const Simbox * simbox, ModelGeneral * modelGeneral, const ModelSettings * modelSettings,
-                                    FFTGrid * Alpha, FFTGrid * Beta,
-                                    bool fileGrid, const std::string & fileName);
-  static void      computePoissonRatio(const Simbox * simbox, ModelGeneral * modelGeneral, const ModelSettings * modelSettings,
-                                       FFTGrid * Alpha, FFTGrid * Beta,
-                                       bool fileGrid, const std::string & fileName);
-  static void      computeLameMu(const Simbox * simbox, ModelGeneral * modelGeneral, const ModelSettings * modelSettings,
-                                 FFTGrid * Beta, FFTGrid * Rho,
-                                 bool fileGrid, const std::string & FileName);
-  static void      computeLameLambda(const Simbox * simbox,ModelGeneral * modelGeneral, const ModelSettings * modelSettings,
-                                     FFTGrid * Alpha, FFTGrid * Beta, FFTGrid * Rho,
-                                     bool fileGrid, const std::string & fileName);
-  static void      computeMuRho(const Simbox * simbox, ModelGeneral * modelGeneral, const ModelSettings * modelSettings,
-                                FFTGrid * Alpha, FFTGrid * Beta, FFTGrid * Rho,
-                                bool fileGrid, const std::string & fileName);
-  static void      computeLambdaRho(const Simbox * simbox, ModelGeneral * modelGeneral, const ModelSettings * modelSettings,
-                                    FFTGrid * Alpha, FFTGrid * Beta, FFTGrid * Rho,
-                                    bool fileGrid, const std::string & fileName);
+  // Computes and writes the requested parameters derived from alpha, beta and rho.
+  static void      computeDerivedParameters(const Simbox        * simbox,
+                                            ModelGeneral        * modelGeneral,
+                                            const ModelSettings * modelSettings,
+                                            FFTGrid             * alpha,
+                                            FFTGrid             * beta,
+                                            FFTGrid             * rho,
+                                            int                   outputFlag,
+                                            bool                  fileGrid,
+                                            const std::string   & prefix,
+                                            const std::string   & suffix);
+
+  // Values of the derived parameter given by its IO flag, from n values of ln Vp, ln Vs and ln Rho.
+  static void      computeDerivedValues(int            parameter,
+                                        const double * ijkA,
+                                        const double * ijkB,
+                                        const double * ijkR,
+                                        float        * value,
+                                        int            n);
 
   static FFTGrid * createFFTGrid(FFTGrid * referenceGrid, bool fileGrid);
 };
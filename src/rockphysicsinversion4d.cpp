@@ -2,6 +2,7 @@
 #include "src/simbox.h"
 #include "src/fftgrid.h"
 #include "lib/lib_matr.h"
+#include "lib/fft1d.h"
 #include <vector>
 
 RockPhysicsInversion4D::RockPhysicsInversion4D()
@@ -20,8 +21,6 @@ RockPhysicsInversion4D::~RockPhysicsInversion4D()
     }
   }
 
- fftwnd_destroy_plan(fftplan1_);
- fftwnd_destroy_plan(fftplan2_);
 }
 
 RockPhysicsInversion4D::RockPhysicsInversion4D(NRLib::Vector                      priorMean,
@@ -36,9 +35,6 @@ RockPhysicsInversion4D::RockPhysicsInversion4D(NRLib::Vector
   nf_[3] = 60;
   nfp_= 135;
 
-  fftplan1_ = rfftwnd_create_plan(1, &nfp_, FFTW_REAL_TO_COMPLEX, FFTW_ESTIMATE | FFTW_IN_PLACE);
-  fftplan2_ = rfftwnd_create_plan(1, &nfp_, FFTW_COMPLEX_TO_REAL, FFTW_ESTIMATE | FFTW_IN_PLACE);
-
   v_.resize(4,6);
   SolveGEVProblem(priorCov,posteriorCov, v_);
   NRLib::Matrix tmp;
@@ -400,7 +396,7 @@ RockPhysicsInversion4D::MakeSmoothingFilter(double posteriorVariance,double  df)
   for(int i=0;i<nfp_;i++)
     gaussKernel[i]/=float(sum);
 
-  rfftwnd_one_real_to_complex(fftplan1_,gaussKernel, smoothingFilter);
+  FFT1D::fft(gaussKernel, nfp_);
 
   return smoothingFilter;
 }
@@ -476,15 +472,44 @@ RockPhysicsInversion4D::DivideAndSmoothTable(int tableInd,std::vector<std::vecto
       meanRockPrediction_(tableInd,j)->setAccessMode(FFTGrid::RANDOMACCESS);
    }
 
+  LogKit::LogFormatted(LogKit::Low,"\n Smoothing direction 1 of 4\n");
+  SmoothTableInDirection(tableInd, 0, smoothingFilter[0]);
+
+  LogKit::LogFormatted(LogKit::Low,"\n\n Smoothing direction 2 of 4\n");
+  SmoothTableInDirection(tableInd, 1, smoothingFilter[1]);
+
+  LogKit::LogFormatted(LogKit::Low,"\n\n Smoothing direction 3 of 4\n");
+  SmoothTableInDirection(tableInd, 2, smoothingFilter[2]);
+
+  LogKit::LogFormatted(LogKit::Low,"\n Smoothing last direction \n");
+  SmoothTableInDirection(tableInd, 3, smoothingFilter[3]);
+
+  for (int j=0; j<nf_[0]; j++){
+      meanRockPrediction_(tableInd,j)->endAccess();
+  }
+}
+
+void
+RockPhysicsInversion4D::SmoothTableInDirection(int tableInd, int dir, const fftw_complex * smoothingFilter)
+{
+  // The other three directions, in the order they are looped over. The vectors along dir
+  // for all indices of the innermost direction c are transformed together.
+  int other[3];
+  int n = 0;
+  for(int d=0;d<4;d++)
+    if(d != dir)
+      other[n++] = d;
+  int a = other[0];
+  int b = other[1];
+  int c = other[2];
+
   int cnfp=nfp_/2+1;
   int rnfp=2*cnfp;
 
-  fftw_real*    rTemp = static_cast<fftw_real*>(fftw_malloc(sizeof(float)*rnfp));
-  fftw_complex* cTemp = reinterpret_cast<fftw_complex*>(rTemp);
+  fftw_real* rTemp = static_cast<fftw_real*>(fftw_malloc(sizeof(float)*rnfp*nf_[c]));
 
   double minDivisor = 1e-3;
 
-  LogKit::LogFormatted(LogKit::Low,"\n Smoothing direction 1 of 4\n");
   float monitorSize = std::max(1.0f, static_cast<float>(nf_[0]*nf_[1]*nf_[2]*nf_[3])*0.02f);
   float nextMonitor = monitorSize;
   std::cout
@@ -492,164 +517,53 @@ RockPhysicsInversion4D::DivideAndSmoothTable(int tableInd,std::vector<std::vecto
     << "\n  |    |    |    |    |    |    |    |    |    |    |  "
     << "\n  ^";
 
-  // divide and smooth direction1
-  for(int i1=0;i1<nf_[1];i1++)
-    for(int i2=0;i2<nf_[2];i2++)
-      for(int i3=0;i3<nf_[3];i3++)
+  int ind[4];
+  for(ind[a]=0;ind[a]<nf_[a];ind[a]++)
+    for(ind[b]=0;ind[b]<nf_[b];ind[b]++)
+    {
+      for(ind[c]=0;ind[c]<nf_[c];ind[c]++)
       {
-        for(int i0=0;i0<nf_[0];i0++)
-        {
-          double divisor=std::max(minDivisor,priorDistribution_[0][i0]);
-          rTemp[i0]=float(GetGridValue(tableInd,i0,i1,i2,i3)/ divisor);
-        }
-        for(int i0=nf_[0];i0<nfp_;i0++)
-          rTemp[i0]=0.0f;
-
-        rfftwnd_one_real_to_complex(fftplan1_,rTemp,cTemp);
-
-        for(int i0=0;i0<cnfp;i0++)
+        fftw_real* rVec = rTemp + ind[c]*rnfp;
+        for(int i=0;i<nf_[dir];i++)
         {
-          cTemp[i0].re=cTemp[i0].re*smoothingFilter[0][i0].re;
-          cTemp[i0].im=cTemp[i0].im*smoothingFilter[0][i0].re;
-        }
-
-        rfftwnd_one_complex_to_real(fftplan2_,cTemp,rTemp);
-        for(int i0=0;i0<nf_[0];i0++)
-        {
-          SetGridValue(tableInd,i0,i1,i2,i3, rTemp[i0]);
-          if ( i1*nf_[2]*nf_[3]*nf_[0] +i2*nf_[3]*nf_[0]+ i3*nf_[0] + i0 + 1 >= static_cast<int>(nextMonitor)) {
-            nextMonitor += monitorSize;
-            std::cout << "^";
-          }
+          ind[dir]=i;
+          double divisor=std::max(minDivisor,priorDistribution_[dir][i]);
+          rVec[i]=float(GetGridValue(tableInd,ind[0],ind[1],ind[2],ind[3])/divisor);
         }
+        for(int i=nf_[dir];i<nfp_;i++)
+          rVec[i]=0.0f;
       }
 
-  LogKit::LogFormatted(LogKit::Low,"\n\n Smoothing direction 2 of 4\n");
-  monitorSize = std::max(1.0f, static_cast<float>(nf_[0]*nf_[1]*nf_[2]*nf_[3])*0.02f);
-  nextMonitor = monitorSize;
-  std::cout
-    << "\n  0%       20%       40%       60%       80%      100%"
-    << "\n  |    |    |    |    |    |    |    |    |    |    |  "
-    << "\n  ^";
+      FFT1D::fft(rTemp, nfp_, nf_[c]);
 
-  // divide and smoothdirection2
-  for(int i0=0;i0<nf_[0];i0++)
-    for(int i2=0;i2<nf_[2];i2++)
-      for(int i3=0;i3<nf_[3];i3++)
+      for(int v=0;v<nf_[c];v++)
       {
-        for(int i1=0;i1<nf_[1];i1++)
+        fftw_complex* cVec = reinterpret_cast<fftw_complex*>(rTemp + v*rnfp);
+        for(int i=0;i<cnfp;i++)
         {
-          double divisor=std::max(minDivisor,priorDistribution_[1][i1]);
-          rTemp[i1]=float(GetGridValue(tableInd,i0,i1,i2,i3)/divisor);
-        }
-        for(int i1=nf_[1];i1<nfp_;i1++)
-          rTemp[i1]=0.0f;
-
-        rfftwnd_one_real_to_complex(fftplan1_,rTemp,cTemp);
-
-        for(int i1=0;i1<cnfp;i1++)
-        {
-          cTemp[i1].re=cTemp[i1].re*smoothingFilter[1][i1].re;
-          cTemp[i1].im=cTemp[i1].im*smoothingFilter[1][i1].re;
-        }
-
-        rfftwnd_one_complex_to_real(fftplan2_,cTemp,rTemp);
-        for(int i1=0;i1<nf_[1];i1++)
-        {
-          SetGridValue(tableInd,i0,i1,i2,i3, rTemp[i1]);
-          if ( i0*nf_[2]*nf_[3]*nf_[1] +i2*nf_[3]*nf_[1]+ i3*nf_[1] + i1 + 1 >= static_cast<int>(nextMonitor)) {
-            nextMonitor += monitorSize;
-            std::cout << "^";
-          }
+          cVec[i].re=cVec[i].re*smoothingFilter[i].re;
+          cVec[i].im=cVec[i].im*smoothingFilter[i].re;
         }
       }
 
-  LogKit::LogFormatted(LogKit::Low,"\n\n Smoothing direction 3 of 4\n");
-  monitorSize = std::max(1.0f, static_cast<float>(nf_[0]*nf_[1]*nf_[2]*nf_[3])*0.02f);
-  nextMonitor = monitorSize;
-  std::cout
-    << "\n  0%       20%       40%       60%       80%      100%"
-    << "\n  |    |    |    |    |    |    |    |    |    |    |  "
-    << "\n  ^";
-
-  //  divide and smoothdirection 3
-  for(int i0=0;i0<nf_[0];i0++)
-    for(int i1=0;i1<nf_[1];i1++)
-      for(int i3=0;i3<nf_[3];i3++)
-      {
-        for(int i2=0;i2<nf_[2];i2++)
-        {
-          double divisor=std::max(minDivisor,priorDistribution_[2][i2]);
-          rTemp[i2]=float(GetGridValue(tableInd,i0,i1,i2,i3)/divisor);
-
-        }
-        for(int i2=nf_[2];i2<nfp_;i2++)
-          rTemp[i2]=0.0f;
-
-        rfftwnd_one_real_to_complex(fftplan1_,rTemp,cTemp);
-
-        for(int i2=0;i2<cnfp;i2++)
-        {
-          cTemp[i2].re=cTemp[i2].re*smoothingFilter[2][i2].re;
-          cTemp[i2].im=cTemp[i2].im*smoothingFilter[2][i2].re;
-        }
-
-        rfftwnd_one_complex_to_real(fftplan2_,cTemp,rTemp);
-        for(int i2=0;i2<nf_[2];i2++)
-        {
-          SetGridValue(tableInd,i0,i1,i2,i3, rTemp[i2]);
-          if ( i0*nf_[1]*nf_[3]*nf_[2] +i1*nf_[3]*nf_[2]+ i3*nf_[2] + i2 + 1 >= static_cast<int>(nextMonitor)) {
-            nextMonitor += monitorSize;
-            std::cout << "^";
-          }
-        }
-      }
+      FFT1D::fftInv(reinterpret_cast<fftw_complex*>(rTemp), nfp_, nf_[c]);
 
-  LogKit::LogFormatted(LogKit::Low,"\n Smoothing last direction \n");
-  monitorSize = std::max(1.0f, static_cast<float>(nf_[0]*nf_[1]*nf_[2]*nf_[3])*0.02f);
-  nextMonitor = monitorSize;
-  std::cout
-    << "\n  0%       20%       40%       60%       80%      100%"
-    << "\n  |    |    |    |    |    |    |    |    |    |    |  "
-    << "\n  ^";
- //  divide and smoothdirection 4
-   for(int i0=0;i0<nf_[0];i0++)
-    for(int i1=0;i1<nf_[1];i1++)
-      for(int i2=0;i2<nf_[2];i2++)
+      for(ind[c]=0;ind[c]<nf_[c];ind[c]++)
       {
-        for(int i3=0;i3<nf_[3];i3++)
+        fftw_real* rVec = rTemp + ind[c]*rnfp;
+        for(int i=0;i<nf_[dir];i++)
         {
-          double divisor=std::max(minDivisor,priorDistribution_[3][i3]);
-          rTemp[i3]=float(GetGridValue(tableInd,i0,i1,i2,i3)/divisor);
-        }
-        for(int i3=nf_[3];i3<nfp_;i3++)
-          rTemp[i3]=0.0f;
-
-        rfftwnd_one_real_to_complex(fftplan1_,rTemp,cTemp);
-
-        for(int i3=0;i3<cnfp;i3++)
-        {
-          cTemp[i3].re=cTemp[i3].re*smoothingFilter[3][i3].re;
-          cTemp[i3].im=cTemp[i3].im*smoothingFilter[3][i3].re;
-        }
-
-        rfftwnd_one_complex_to_real(fftplan2_,cTemp,rTemp);
-        for(int i3=0;i3<nf_[3];i3++)
-        {
-          SetGridValue(tableInd,i0,i1,i2,i3, rTemp[i3]);
-          if ( i0*nf_[1]*nf_[2]*nf_[3] +i1*nf_[2]*nf_[3]+ i2*nf_[3] + i3 + 1 >= static_cast<int>(nextMonitor)) {
+          ind[dir]=i;
+          SetGridValue(tableInd,ind[0],ind[1],ind[2],ind[3], rVec[i]);
+          if ( ((ind[a]*nf_[b] + ind[b])*nf_[c] + ind[c])*nf_[dir] + i + 1 >= static_cast<int>(nextMonitor)) {
             nextMonitor += monitorSize;
             std::cout << "^";
           }
         }
       }
-
-  for (int j=0; j<nf_[0]; j++){
-      meanRockPrediction_(tableInd,j)->endAccess();
-  }
+    }
 
   fftw_free(rTemp);
-
 }
 
 void
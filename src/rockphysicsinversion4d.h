@@ -34,6 +34,7 @@ public:
   void     fillInTable( std::vector<std::vector<double> >  mSamp,std::vector<double>   rSamp,int tableInd);
   void     smoothAllDirectionsAndNormalize();
   void     DivideAndSmoothTable(int tableInd,std::vector<std::vector<double> > priorDistribution, std::vector<fftw_complex*> smoothingFilter);
+  void     SmoothTableInDirection(int tableInd, int dir, const fftw_complex * smoothingFilter);
   fftw_complex*        MakeSmoothingFilter(double posteriorVariance,double  df);
   std::vector<double>  MakeGaussKernel(double mean, double variance, double minf, double  df,int nf);
   // another option is to use data reference
@@ -68,8 +69,6 @@ private:
   NRLib::Vector minf_;
   NRLib::Vector maxf_;
   NRLib::Vector meanf_;
-  rfftwnd_plan fftplan1_;
-  rfftwnd_plan fftplan2_;
 
 };
 #endif
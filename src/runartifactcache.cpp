@@ -0,0 +1,353 @@
+/***************************************************************************
+*      Copyright (C) 2008 by Norwegian Computing Center and Statoil        *
+***************************************************************************/
+
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fstream>
+#include <algorithm>
+
+#include "nrlib/iotools/fileio.hpp"
+#include "nrlib/iotools/logkit.hpp"
+#include "nrlib/iotools/stringtools.hpp"
+#include "nrlib/exception/exception.hpp"
+
+#include "src/runartifactcache.h"
+#include "src/modelgeneral.h"
+#include "src/modelsettings.h"
+#include "src/inputfiles.h"
+#include "src/fftgrid.h"
+#include "src/simbox.h"
+#include "src/io.h"
+
+RunArtifactCache::RunArtifactCache(const ModelSettings * modelSettings,
+                                   const InputFiles    * inputFiles,
+                                   int                   thisTimeLapse)
+  : hash_(14695981039346656037ULL), // FNV-1a offset basis
+    valid_(false)
+{
+  addToHash(hash_, "crava_run_artifact_cache_1");
+  addToHash(hash_, NRLib::ToString(thisTimeLapse));
+  addToHash(hash_, modelSettings->getRunArtifactModelKey());
+  addInputFiles(modelSettings, inputFiles, thisTimeLapse);
+
+  std::string keyFile = makeFileName(IO::FileRunArtifactKey());
+  if (NRLib::FileExists(keyFile)) {
+    std::ifstream file;
+    NRLib::OpenRead(file, keyFile);
+    std::string fileType;
+    std::string key;
+    getline(file, fileType);
+    getline(file, key);
+    if (fileType == "crava_run_artifact_cache" && key == getKeyText()) {
+      valid_ = true;
+      std::string name;
+      while (getline(file, name)) {
+        if (name != "")
+          stored_.push_back(name);
+      }
+    }
+    file.close();
+
+    // Artifacts of another key are overwritten by this run, and must not be used by later runs
+    // if this run stops.
+    if (valid_ == false)
+      remove(keyFile.c_str());
+  }
+
+  LogKit::WriteHeader("Run Artifact Cache");
+  LogKit::LogFormatted(LogKit::Low,"\nKey                 : %s\n", getKeyText().c_str());
+  if (valid_) {
+    LogKit::LogFormatted(LogKit::Low,"Stored artifacts    :");
+    for (size_t i = 0; i < stored_.size(); i++)
+      LogKit::LogFormatted(LogKit::Low," %s", stored_[i].c_str());
+    LogKit::LogFormatted(LogKit::Low,"\n");
+  }
+  else
+    LogKit::LogFormatted(LogKit::Low,"Stored artifacts    : None for this key. The artifacts are built and stored.\n");
+}
+
+RunArtifactCache::~RunArtifactCache()
+{
+}
+
+bool
+RunArtifactCache::readBackground(FFTGrid            ** backModel,
+                                 const Simbox        * timeSimbox,
+                                 const ModelSettings * modelSettings) const
+{
+  return readGrids("Background", backModel, 3, FFTGrid::PARAMETER, timeSimbox, modelSettings);
+}
+
+void
+RunArtifactCache::writeBackground(FFTGrid      ** backModel,
+                                  const Simbox  * timeSimbox)
+{
+  writeGrids("Background", backModel, 3, timeSimbox);
+  addArtifact("Background");
+}
+
+bool
+RunArtifactCache::readSeismic(FFTGrid                 ** seisCube,
+                              const std::vector<float> & angle,
+                              const Simbox             * timeSimbox,
+                              const ModelSettings      * modelSettings) const
+{
+  int nAngles = static_cast<int>(angle.size());
+  if (readGrids("Seismic", seisCube, nAngles, FFTGrid::DATA, timeSimbox, modelSettings) == false)
+    return false;
+
+  for (int i = 0; i < nAngles; i++)
+    seisCube[i]->setAngle(angle[i]);
+  return true;
+}
+
+void
+RunArtifactCache::writeSeismic(FFTGrid      ** seisCube,
+                               int             nAngles,
+                               const Simbox  * timeSimbox)
+{
+  writeGrids("Seismic", seisCube, nAngles, timeSimbox);
+  addArtifact("Seismic");
+}
+
+bool
+RunArtifactCache::readPriorCorrelations(float             ** paramCov,
+                                        std::vector<float> & corrT,
+                                        Surface            & priorCorrXY) const
+{
+  std::string fileName = makeFileName("PriorCorrelations");
+  try {
+    std::ifstream binFile;
+    NRLib::OpenRead(binFile, fileName, std::ios::in | std::ios::binary);
+
+    std::string fileType;
+    getline(binFile, fileType);
+    if (fileType != "crava_run_artifact_prior_correlations")
+      throw NRLib::Exception("File '" + fileName + "' does not hold prior correlations.");
+
+    for (int i = 0; i < 3; i++) {
+      for (int j = 0; j < 3; j++)
+        paramCov[i][j] = NRLib::ReadBinaryFloat(binFile);
+    }
+    corrT.resize(NRLib::ReadBinaryInt(binFile));
+    NRLib::ReadBinaryFloatArray(binFile, corrT.begin(), corrT.size());
+    IO::readSurfaceBinary(binFile, priorCorrXY);
+
+    binFile.close();
+  }
+  catch (NRLib::Exception & e) {
+    LogKit::LogFormatted(LogKit::Warning,"\nWARNING: Could not read the cached prior correlations: %s\n", e.what());
+    return false;
+  }
+
+  LogKit::LogFormatted(LogKit::Low,"\nPrior correlations are read from the run artifact cache.\n");
+  return true;
+}
+
+void
+RunArtifactCache::writePriorCorrelations(float                   ** paramCov,
+                                         const std::vector<float>  & corrT,
+                                         const Surface             & priorCorrXY)
+{
+  std::string fileName = makeFileName("PriorCorrelations");
+  try {
+    std::ofstream binFile;
+    NRLib::OpenWrite(binFile, fileName, std::ios::out | std::ios::binary);
+
+    binFile << "crava_run_artifact_prior_correlations" << "\n";
+
+    for (int i = 0; i < 3; i++) {
+      for (int j = 0; j < 3; j++)
+        NRLib::WriteBinaryFloat(binFile, paramCov[i][j]);
+    }
+    NRLib::WriteBinaryInt(binFile, static_cast<int>(corrT.size()));
+    NRLib::WriteBinaryFloatArray(binFile, corrT.begin(), corrT.end());
+    IO::writeSurfaceBinary(binFile, priorCorrXY);
+
+    binFile.close();
+  }
+  catch (NRLib::Exception & e) {
+    LogKit::LogFormatted(LogKit::Warning,"\nWARNING: Could not write the prior correlations to the run artifact cache: %s\n", e.what());
+    return;
+  }
+  addArtifact("PriorCorrelations");
+}
+
+void
+RunArtifactCache::writeKey() const
+{
+  // Write to a temporary file first, so that a run that stops leaves no key.
+  std::string fileName = makeFileName(IO::FileRunArtifactKey());
+  std::string tmpName  = fileName + ".tmp";
+  try {
+    std::ofstream file;
+    NRLib::OpenWrite(file, tmpName);
+    file << "crava_run_artifact_cache" << "\n";
+    file << getKeyText() << "\n";
+    for (size_t i = 0; i < stored_.size(); i++)
+      file << stored_[i] << "\n";
+    file.close();
+
+    remove(fileName.c_str());
+    if (rename(tmpName.c_str(), fileName.c_str()) != 0)
+      throw NRLib::IOError("Could not rename '" + tmpName + "' to '" + fileName + "'.");
+  }
+  catch (NRLib::Exception & e) {
+    LogKit::LogFormatted(LogKit::Warning,"\nWARNING: Could not write the run artifact cache key: %s\n", e.what());
+  }
+}
+
+bool
+RunArtifactCache::hasArtifact(const std::string & name) const
+{
+  return(valid_ && std::find(stored_.begin(), stored_.end(), name) != stored_.end());
+}
+
+void
+RunArtifactCache::addArtifact(const std::string & name)
+{
+  if (std::find(stored_.begin(), stored_.end(), name) == stored_.end())
+    stored_.push_back(name);
+}
+
+bool
+RunArtifactCache::readGrids(const std::string   & name,
+                            FFTGrid            ** grids,
+                            int                   nGrids,
+                            int                   gridType,
+                            const Simbox        * timeSimbox,
+                            const ModelSettings * modelSettings) const
+{
+  std::string errText;
+  for (int i = 0; i < nGrids; i++) {
+    grids[i] = ModelGeneral::createFFTGrid(timeSimbox->getnx(),
+                                           timeSimbox->getny(),
+                                           timeSimbox->getnz(),
+                                           modelSettings->getNXpad(),
+                                           modelSettings->getNYpad(),
+                                           modelSettings->getNZpad(),
+                                           modelSettings->getFileGrid());
+    grids[i]->setType(gridType);
+    grids[i]->readCravaFile(makeFileName(name + "_" + NRLib::ToString(i)) + IO::SuffixCrava(), errText);
+  }
+
+  if (errText != "") {
+    for (int i = 0; i < nGrids; i++) {
+      delete grids[i];
+      grids[i] = NULL;
+    }
+    LogKit::LogFormatted(LogKit::Warning,"\nWARNING: Could not read the cached %s grids:\n%s", name.c_str(), errText.c_str());
+    return false;
+  }
+
+  LogKit::LogFormatted(LogKit::Low,"\n%s grids are read from the run artifact cache.\n", name.c_str());
+  return true;
+}
+
+void
+RunArtifactCache::writeGrids(const std::string  & name,
+                             FFTGrid           ** grids,
+                             int                  nGrids,
+                             const Simbox       * timeSimbox) const
+{
+  for (int i = 0; i < nGrids; i++)
+    grids[i]->writeCravaFile(makeFileName(name + "_" + NRLib::ToString(i)), timeSimbox);
+}
+
+void
+RunArtifactCache::addInputFiles(const ModelSettings * modelSettings,
+                                const InputFiles    * inputFiles,
+                                int                   thisTimeLapse)
+{
+  for (int i = 0; i < inputFiles->getNumberOfSeismicFiles(thisTimeLapse); i++)
+    addFile(inputFiles->getSeismicFile(thisTimeLapse, i));
+  for (int i = 0; i < modelSettings->getNumberOfWells(); i++)
+    addFile(inputFiles->getWellFile(i));
+  for (int i = 0; i < 3; i++)
+    addFile(inputFiles->getBackFile(i));
+  addFile(inputFiles->getBackVelFile());
+  addFile(inputFiles->getVelocityField());
+
+  const std::vector<std::string> & timeSurfFiles  = inputFiles->getTimeSurfFiles();
+  const std::vector<std::string> & depthSurfFiles = inputFiles->getDepthSurfFiles();
+  const std::vector<std::string> & multizoneFiles = inputFiles->getMultizoneSurfaceFiles();
+  const std::vector<std::string> & trendCubes     = inputFiles->getTrendCubes();
+  for (size_t i = 0; i < timeSurfFiles.size(); i++)
+    addFile(timeSurfFiles[i]);
+  for (size_t i = 0; i < depthSurfFiles.size(); i++)
+    addFile(depthSurfFiles[i]);
+  for (size_t i = 0; i < multizoneFiles.size(); i++)
+    addFile(multizoneFiles[i]);
+  for (size_t i = 0; i < trendCubes.size(); i++)
+    addFile(trendCubes[i]);
+
+  addFile(inputFiles->getCorrDirFile());
+  addFile(inputFiles->getCorrDirTopFile());
+  addFile(inputFiles->getCorrDirBaseFile());
+  std::map<std::string, std::string>::const_iterator it;
+  for (it = inputFiles->getCorrDirIntervalFile().begin(); it != inputFiles->getCorrDirIntervalFile().end(); it++)
+    addFile(it->second);
+  for (it = inputFiles->getCorrDirIntervalTopSurfaceFile().begin(); it != inputFiles->getCorrDirIntervalTopSurfaceFile().end(); it++)
+    addFile(it->second);
+  for (it = inputFiles->getCorrDirIntervalBaseSurfaceFile().begin(); it != inputFiles->getCorrDirIntervalBaseSurfaceFile().end(); it++)
+    addFile(it->second);
+  for (it = inputFiles->getPriorFaciesProbFile().begin(); it != inputFiles->getPriorFaciesProbFile().end(); it++)
+    addFile(it->second);
+
+  addFile(inputFiles->getParamCorrFile());
+  addFile(inputFiles->getTempCorrFile());
+  addFile(inputFiles->getRefSurfaceFile());
+  addFile(inputFiles->getAreaSurfaceFile());
+  addFile(inputFiles->getSeedFile());
+}
+
+void
+RunArtifactCache::addFile(const std::string & fileName)
+{
+  // Names that are not files, like constant values and commands, are part of the model file.
+  // A file is identified by its size and modification time, so that making the key costs no
+  // more than a look at the directory. A file that cannot be read is reported when it is used.
+  addToHash(hash_, fileName);
+  if (fileName == "")
+    return;
+
+  struct stat status;
+  if (stat(fileName.c_str(), &status) != 0)
+    return;
+
+  addToHash(hash_, NRLib::ToString(static_cast<long long int>(status.st_size)));
+  addToHash(hash_, NRLib::ToString(static_cast<long long int>(status.st_mtime)));
+}
+
+void
+RunArtifactCache::addToHash(Hash & hash, const char * data, size_t n)
+{
+  // 64 bit FNV-1a
+  for (size_t i = 0; i < n; i++) {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 1099511628211ULL;
+  }
+}
+
+void
+RunArtifactCache::addToHash(Hash & hash, const std::string & text)
+{
+  // The terminating zero separates consecutive texts.
+  addToHash(hash, text.c_str(), text.size() + 1);
+}
+
+std::string
+RunArtifactCache::makeFileName(const std::string & name) const
+{
+  return IO::makeFullFileName(IO::PathToRunArtifactCache(), name);
+}
+
+std::string
+RunArtifactCache::getKeyText() const
+{
+  char text[17];
+  sprintf(text, "%08x%08x", static_cast<unsigned int>(hash_ >> 32), static_cast<unsigned int>(hash_ & 0xffffffffULL));
+  return std::string(text);
+}
@@ -0,0 +1,102 @@
+/***************************************************************************
+*      Copyright (C) 2008 by Norwegian Computing Center and Statoil        *
+***************************************************************************/
+
+#ifndef RUNARTIFACTCACHE_H
+#define RUNARTIFACTCACHE_H
+
+#include <string>
+#include <vector>
+
+#include "src/definitions.h"
+
+class FFTGrid;
+class Simbox;
+class InputFiles;
+class ModelSettings;
+
+// Artifacts of a run that can be reused by the next run of the same model: the background
+// model, the seismic data resampled to the simbox and the prior correlation parameters. The
+// artifacts are keyed by a hash of the model file, without the settings that only affect the
+// wavelets, the noise and the output, and of the names, sizes and modification times of the
+// input files they are built from. A rerun where only such settings have changed loads the
+// artifacts instead of building them. The files themselves are not read to make the key. The
+// prior covariance grids are cheap to make from the correlation parameters, so the parameters
+// are stored rather than the grids.
+//
+// The key file is written last, so the artifacts of a run that stopped are never used. Each
+// read returns false if the artifact could not be read, and the caller then builds it.
+class RunArtifactCache
+{
+public:
+  RunArtifactCache(const ModelSettings * modelSettings,
+                   const InputFiles    * inputFiles,
+                   int                   thisTimeLapse);
+
+  ~RunArtifactCache();
+
+  bool                hasBackground()        const { return hasArtifact("Background")        ;}
+  bool                hasSeismic()           const { return hasArtifact("Seismic")           ;}
+  bool                hasPriorCorrelations() const { return hasArtifact("PriorCorrelations") ;}
+
+  bool                readBackground(FFTGrid            ** backModel,
+                                     const Simbox        * timeSimbox,
+                                     const ModelSettings * modelSettings) const;
+
+  void                writeBackground(FFTGrid      ** backModel,
+                                      const Simbox  * timeSimbox);
+
+  bool                readSeismic(FFTGrid                 ** seisCube,
+                                  const std::vector<float> & angle,
+                                  const Simbox             * timeSimbox,
+                                  const ModelSettings      * modelSettings) const;
+
+  void                writeSeismic(FFTGrid      ** seisCube,
+                                   int             nAngles,
+                                   const Simbox  * timeSimbox);
+
+  bool                readPriorCorrelations(float             ** paramCov,
+                                            std::vector<float> & corrT,
+                                            Surface            & priorCorrXY) const;
+
+  void                writePriorCorrelations(float                   ** paramCov,
+                                             const std::vector<float>  & corrT,
+                                             const Surface             & priorCorrXY);
+
+  // Writes the key and the names of the artifacts stored by this run.
+  void                writeKey() const;
+
+private:
+  typedef unsigned long long int Hash;
+
+  bool                hasArtifact(const std::string & name) const;
+  void                addArtifact(const std::string & name);
+
+  bool                readGrids(const std::string   & name,
+                                FFTGrid            ** grids,
+                                int                   nGrids,
+                                int                   gridType,
+                                const Simbox        * timeSimbox,
+                                const ModelSettings * modelSettings) const;
+
+  void                writeGrids(const std::string  & name,
+                                 FFTGrid           ** grids,
+                                 int                  nGrids,
+                                 const Simbox       * timeSimbox) const;
+
+  void                addInputFiles(const ModelSettings * modelSettings,
+                                    const InputFiles    * inputFiles,
+                                    int                   thisTimeLapse);
+  void                addFile(const std::string & fileName);
+
+  static void         addToHash(Hash & hash, const char * data, size_t n);
+  static void         addToHash(Hash & hash, const std::string & text);
+  std::string         makeFileName(const std::string & name) const;
+  std::string         getKeyText() const;
+
+  Hash                        hash_;
+  bool                        valid_;       // True if the stored artifacts have this key
+  std::vector<std::string>    stored_;      // Artifacts stored with this key
+};
+
+#endif
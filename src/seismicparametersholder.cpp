@@ -1,5 +1,7 @@
 #include <stdio.h>
 
+#include "rfftw.h"
+
 #include "nrlib/flens/nrlib_flens.hpp"
 
 #include "src/seismicparametersholder.h"
@@ -20,6 +22,15 @@ SeismicParametersHolder::SeismicParametersHolder(void)
   crCovAlphaBeta_ = NULL;
   crCovAlphaRho_  = NULL;
   crCovBetaRho_   = NULL;
+
+  implicitPriorCov_ = false;
+  nextCovIndex_     = 0;
+  nx_               = 0;
+  ny_               = 0;
+  nz_               = 0;
+  nxp_              = 0;
+  nyp_              = 0;
+  nzp_              = 0;
 }
 
 //--------------------------------------------------------------------
@@ -136,14 +147,28 @@ SeismicParametersHolder::setCorrelationParameters(float                    ** pr
   //tmp=priorVar0_;
   //NRLib::ComputeEigenVectors(tmp,eVals,eVec);
 
-  createCorrGrids(nx, ny, nz, nxPad, nyPad, nzPad, false);
-
-  initializeCorrelations(priorCorrXY,
-                         priorCorrT,
-                         corrGradI,
-                         corrGradJ,
-                         minIntFq,
-                         nzPad);
+  nx_  = nx;
+  ny_  = ny;
+  nz_  = nz;
+  nxp_ = nxPad;
+  nyp_ = nyPad;
+  nzp_ = nzPad;
+
+  if(corrGradI == 0.0f && corrGradJ == 0.0f) {
+    initializeImplicitCorrelations(priorCorrXY,
+                                   priorCorrT,
+                                   minIntFq);
+  }
+  else {
+    createCorrGrids(nx, ny, nz, nxPad, nyPad, nzPad, false);
+
+    initializeCorrelations(priorCorrXY,
+                           priorCorrT,
+                           corrGradI,
+                           corrGradJ,
+                           minIntFq,
+                           nzPad);
+  }
 }
 //--------------------------------------------------------------------
 
@@ -156,12 +181,12 @@ SeismicParametersHolder::createCorrGrids(int  nx,
                                          int  nzp,
                                          bool fileGrid)
 {
-  covAlpha_       = createFFTGrid(nx,ny,nz,nxp,nyp,nzp,fileGrid);
-  covBeta_        = createFFTGrid(nx,ny,nz,nxp,nyp,nzp,fileGrid);
-  covRho_         = createFFTGrid(nx,ny,nz,nxp,nyp,nzp,fileGrid);
-  crCovAlphaBeta_ = createFFTGrid(nx,ny,nz,nxp,nyp,nzp,fileGrid);
-  crCovAlphaRho_  = createFFTGrid(nx,ny,nz,nxp,nyp,nzp,fileGrid);
-  crCovBetaRho_   = createFFTGrid(nx,ny,nz,nxp,nyp,nzp,fileGrid);
+  covAlpha_       = ModelGeneral::createFFTGrid(nx,ny,nz,nxp,nyp,nzp,fileGrid,FFTFileGrid::COVARIANCE);
+  covBeta_        = ModelGeneral::createFFTGrid(nx,ny,nz,nxp,nyp,nzp,fileGrid,FFTFileGrid::COVARIANCE);
+  covRho_         = ModelGeneral::createFFTGrid(nx,ny,nz,nxp,nyp,nzp,fileGrid,FFTFileGrid::COVARIANCE);
+  crCovAlphaBeta_ = ModelGeneral::createFFTGrid(nx,ny,nz,nxp,nyp,nzp,fileGrid,FFTFileGrid::COVARIANCE);
+  crCovAlphaRho_  = ModelGeneral::createFFTGrid(nx,ny,nz,nxp,nyp,nzp,fileGrid,FFTFileGrid::COVARIANCE);
+  crCovBetaRho_   = ModelGeneral::createFFTGrid(nx,ny,nz,nxp,nyp,nzp,fileGrid,FFTFileGrid::COVARIANCE);
 
   covAlpha_       ->setType(FFTGrid::COVARIANCE);
   covBeta_        ->setType(FFTGrid::COVARIANCE);
@@ -178,19 +203,6 @@ SeismicParametersHolder::createCorrGrids(int  nx,
   crCovBetaRho_   ->createRealGrid();
 }
 //-------------------------------------------------------------------
-FFTGrid *
-SeismicParametersHolder::createFFTGrid(int nx,  int ny,  int nz,
-                                       int nxp, int nyp, int nzp,
-                                       bool fileGrid)
-{
-  FFTGrid * fftGrid;
-  if(fileGrid)
-    fftGrid = new FFTFileGrid(nx, ny, nz, nxp, nyp, nzp);
-  else
-    fftGrid = new FFTGrid(nx, ny, nz, nxp, nyp, nzp);
-  return(fftGrid);
-}
-//-------------------------------------------------------------------
 void
 SeismicParametersHolder::initializeCorrelations(const Surface            * priorCorrXY,
                                                 const std::vector<float> & priorCorrT,
@@ -201,6 +213,17 @@ SeismicParametersHolder::initializeCorrelations(const Surface            * prior
 {
   fftw_real * circCorrT = computeCircCorrT(priorCorrT, lowIntCut, nzp);
 
+  fillInCorrGrids(priorCorrXY, circCorrT, corrGradI, corrGradJ);
+
+  fftw_free(circCorrT);
+}
+//-------------------------------------------------------------------
+void
+SeismicParametersHolder::fillInCorrGrids(const Surface   * priorCorrXY,
+                                         const fftw_real * circCorrT,
+                                         const float     & corrGradI,
+                                         const float     & corrGradJ)
+{
   covAlpha_      ->fillInParamCorr(priorCorrXY, circCorrT, corrGradI, corrGradJ);
   covBeta_       ->fillInParamCorr(priorCorrXY, circCorrT, corrGradI, corrGradJ);
   covRho_        ->fillInParamCorr(priorCorrXY, circCorrT, corrGradI, corrGradJ);
@@ -214,8 +237,98 @@ SeismicParametersHolder::initializeCorrelations(const Surface            * prior
   crCovAlphaBeta_->multiplyByScalar(static_cast<float>(priorVar0_(0,1)));
   crCovAlphaRho_ ->multiplyByScalar(static_cast<float>(priorVar0_(0,2)));
   crCovBetaRho_  ->multiplyByScalar(static_cast<float>(priorVar0_(1,2)));
+}
+//-------------------------------------------------------------------
+void
+SeismicParametersHolder::initializeImplicitCorrelations(const Surface            * priorCorrXY,
+                                                        const std::vector<float> & priorCorrT,
+                                                        const int                & lowIntCut)
+{
+  // The prior covariance of (i,j,k) is priorVar0_ * priorCorrXY(i,j) * circCorrT(k), so the
+  // unscaled 3D transform of each covariance grid is priorVar0_ times the product of the
+  // 2D lateral and the 1D temporal spectra.
+  priorCorrXY_ = *priorCorrXY;
+
+  int         nRealT    = 2*(nzp_/2 + 1);
+  fftw_real * circCorrT = computeCircCorrT(priorCorrT, lowIntCut, nzp_);
+  circCorrT_.assign(circCorrT, circCorrT + nRealT);
 
+  fftw_complex * corrTSpectrum = FFTGrid::fft1DzInPlace(circCorrT, nzp_);
+  corrTSpectrum_.assign(corrTSpectrum, corrTSpectrum + nzp_/2 + 1);
   fftw_free(circCorrT);
+
+  int         cnxp   = nxp_/2 + 1;
+  fftw_real * corrXY = static_cast<fftw_real*>(fftw_malloc(2*cnxp*nyp_*sizeof(fftw_real)));
+  for(int j = 0; j < nyp_; j++) {
+    for(int i = 0; i < 2*cnxp; i++) {
+      if(i < nxp_)
+        corrXY[i + 2*cnxp*j] = static_cast<fftw_real>((*priorCorrXY)(i + nxp_*j));
+      else
+        corrXY[i + 2*cnxp*j] = 0.0;
+    }
+  }
+
+  int dims[2] = {nyp_, nxp_};
+  rfftwnd_plan plan = rfftwnd_create_plan(2, dims, FFTW_REAL_TO_COMPLEX, FFTW_ESTIMATE | FFTW_IN_PLACE);
+  rfftwnd_one_real_to_complex(plan, corrXY, reinterpret_cast<fftw_complex*>(corrXY));
+  fftwnd_destroy_plan(plan);
+
+  fftw_complex * corrXYSpectrum = reinterpret_cast<fftw_complex*>(corrXY);
+  corrXYSpectrum_.assign(corrXYSpectrum, corrXYSpectrum + cnxp*nyp_);
+  fftw_free(corrXY);
+
+  implicitPriorCov_ = true;
+  nextCovIndex_     = 0;
+}
+//-------------------------------------------------------------------
+void
+SeismicParametersHolder::makeCovGrids()
+{
+  if(implicitPriorCov_ == false || covAlpha_ != NULL)
+    return;
+
+  LogKit::LogFormatted(LogKit::DebugLow,"\nFilling in prior covariance grids from the separable prior covariance.\n");
+
+  createCorrGrids(nx_, ny_, nz_, nxp_, nyp_, nzp_, false);
+
+  fillInCorrGrids(&priorCorrXY_, &circCorrT_[0], 0.0f, 0.0f);
+
+  implicitPriorCov_ = false;
+}
+//-------------------------------------------------------------------
+void
+SeismicParametersHolder::createPostCovGrids()
+{
+  assert(implicitPriorCov_ == true && covAlpha_ == NULL);
+
+  createCorrGrids(nx_, ny_, nz_, nxp_, nyp_, nzp_, false);
+
+  covAlpha_      ->setTransformedStatus(true); //Going to fill it with transformed info.
+  covBeta_       ->setTransformedStatus(true);
+  covRho_        ->setTransformedStatus(true);
+  crCovAlphaBeta_->setTransformedStatus(true);
+  crCovAlphaRho_ ->setTransformedStatus(true);
+  crCovBetaRho_  ->setTransformedStatus(true);
+
+  nextCovIndex_ = 0;
+}
+//-------------------------------------------------------------------
+float
+SeismicParametersHolder::getPriorCorrCyclic(int i, int j, int k) const
+{
+  assert(implicitPriorCov_);
+
+  if(i < 0)
+    i += nxp_;
+  if(j < 0)
+    j += nyp_;
+  if(k < 0)
+    k += nzp_;
+
+  float value    = circCorrT_[k]*static_cast<float>(priorCorrXY_(i + nxp_*j));
+  float constant = circCorrT_[0]*static_cast<float>(priorCorrXY_(0));
+
+  return value/constant;
 }
 
 //--------------------------------------------------------------------
@@ -269,6 +382,9 @@ SeismicParametersHolder::FFTAllGrids()
 void
 SeismicParametersHolder::invFFTCovGrids()
 {
+  if (implicitPriorCov_ && covAlpha_ == NULL)
+    return;
+
   LogKit::LogFormatted(LogKit::High,"\nBacktransforming correlation grids from FFT domain to time domain...");
 
   if (covAlpha_->getIsTransformed())
@@ -295,6 +411,8 @@ SeismicParametersHolder::invFFTCovGrids()
 void
 SeismicParametersHolder::FFTCovGrids()
 {
+  makeCovGrids();
+
   LogKit::LogFormatted(LogKit::High,"\nTransforming correlation grids from time domain to FFT domain...");
 
   if (!covAlpha_->getIsTransformed())
@@ -322,6 +440,10 @@ SeismicParametersHolder::FFTCovGrids()
 void
 SeismicParametersHolder::getNextParameterCovariance(fftw_complex **& parVar) const
 {
+  if(implicitPriorCov_) {
+    getNextImplicitParameterCovariance(parVar);
+    return;
+  }
 
   fftw_complex iiTmp = covAlpha_      ->getNextComplex();
   fftw_complex jjTmp = covBeta_       ->getNextComplex();
@@ -364,6 +486,40 @@ SeismicParametersHolder::getNextParameterCovariance(fftw_complex **& parVar) con
   parVar[2][1].im = -jk.im;
 }
 
+//--------------------------------------------------------------------
+void
+SeismicParametersHolder::getNextImplicitParameterCovariance(fftw_complex **& parVar) const
+{
+  // Same order as getNextComplex() of the covariance grids
+  int cnxp = nxp_/2 + 1;
+  int i    = nextCovIndex_ % cnxp;
+  int j    = (nextCovIndex_/cnxp) % nyp_;
+  int k    = nextCovIndex_/(cnxp*nyp_);
+
+  nextCovIndex_++;
+  if(nextCovIndex_ == cnxp*nyp_*nzp_)
+    nextCovIndex_ = 0;
+
+  const fftw_complex & xy = corrXYSpectrum_[i + cnxp*j];
+  fftw_complex         t;
+  if(k <= nzp_/2)
+    t = corrTSpectrum_[k];
+  else {
+    t.re =  corrTSpectrum_[nzp_ - k].re;
+    t.im = -corrTSpectrum_[nzp_ - k].im;
+  }
+
+  // As in getParameterCovariance(), only the absolute value of the real part is used
+  float corr = std::abs(xy.re*t.re - xy.im*t.im);
+
+  for(int l = 0; l < 3; l++) {
+    for(int m = 0; m < 3; m++) {
+      parVar[l][m].re = corr*static_cast<float>(priorVar0_(l,m));
+      parVar[l][m].im = 0.0;
+    }
+  }
+}
+
 //--------------------------------------------------------------------
 fftw_complex
 SeismicParametersHolder::getParameterCovariance(const NRLib::Matrix & prior_var,
@@ -673,31 +829,37 @@ SeismicParametersHolder::writeFilePostCovGrids(Simbox const * simbox) const
   std::string fileName;
   fileName = IO::PrefixPosterior() + IO::PrefixCovariance() + "Vp";
   covAlpha_ ->setAccessMode(FFTGrid::RANDOMACCESS);
+  covAlpha_ ->setAllowLossyCrava(true);
   covAlpha_ ->writeFile(fileName, IO::PathToCorrelations(), simbox, "Posterior covariance for Vp");
   covAlpha_ ->endAccess();
 
   fileName = IO::PrefixPosterior() + IO::PrefixCovariance() + "Vs";
   covBeta_ ->setAccessMode(FFTGrid::RANDOMACCESS);
+  covBeta_ ->setAllowLossyCrava(true);
   covBeta_ ->writeFile(fileName, IO::PathToCorrelations(), simbox, "Posterior covariance for Vs");
   covBeta_ ->endAccess();
 
   fileName = IO::PrefixPosterior() + IO::PrefixCovariance() + "Rho";
   covRho_ ->setAccessMode(FFTGrid::RANDOMACCESS);
+  covRho_ ->setAllowLossyCrava(true);
   covRho_ ->writeFile(fileName, IO::PathToCorrelations(), simbox, "Posterior covariance for density");
   covRho_ ->endAccess();
 
   fileName = IO::PrefixPosterior() + IO::PrefixCrossCovariance() + "VpVs";
   crCovAlphaBeta_ ->setAccessMode(FFTGrid::RANDOMACCESS);
+  crCovAlphaBeta_ ->setAllowLossyCrava(true);
   crCovAlphaBeta_ ->writeFile(fileName, IO::PathToCorrelations(), simbox, "Posterior cross-covariance for (Vp,Vs)");
   crCovAlphaBeta_ ->endAccess();
 
   fileName = IO::PrefixPosterior() + IO::PrefixCrossCovariance() + "VpRho";
   crCovAlphaRho_ ->setAccessMode(FFTGrid::RANDOMACCESS);
+  crCovAlphaRho_ ->setAllowLossyCrava(true);
   crCovAlphaRho_ ->writeFile(fileName, IO::PathToCorrelations(), simbox, "Posterior cross-covariance for (Vp,density)");
   crCovAlphaRho_ ->endAccess();
 
   fileName = IO::PrefixPosterior() + IO::PrefixCrossCovariance() + "VsRho";
   crCovBetaRho_ ->setAccessMode(FFTGrid::RANDOMACCESS);
+  crCovBetaRho_ ->setAllowLossyCrava(true);
   crCovBetaRho_ ->writeFile(fileName, IO::PathToCorrelations(), simbox, "Posterior cross-covariance for (Vs,density)");
   crCovBetaRho_ ->endAccess();
 }
@@ -706,6 +868,17 @@ SeismicParametersHolder::writeFilePostCovGrids(Simbox const * simbox) const
 fftw_real *
 SeismicParametersHolder::extractParamCorrFromCovAlpha(int nzp) const
 {
+  if(implicitPriorCov_ && covAlpha_ == NULL) {
+    fftw_real * circCorrT = reinterpret_cast<fftw_real*>(fftw_malloc(2*(nzp/2+1)*sizeof(fftw_real)));
+    for(int k = 0 ; k < 2*(nzp/2+1) ; k++ ){
+      if(k < nzp)
+        circCorrT[k] = getPriorCorrCyclic(0,0,k);
+      else
+        circCorrT[k] = RMISSING;
+    }
+    return circCorrT;
+  }
+
   assert(covAlpha_->getIsTransformed() == false);
 
   covAlpha_->setAccessMode(FFTGrid::RANDOMACCESS);
@@ -729,6 +902,8 @@ SeismicParametersHolder::extractParamCorrFromCovAlpha(int nzp) const
 void
 SeismicParametersHolder::updatePriorVar()
 {
+  if(implicitPriorCov_ && covAlpha_ == NULL)
+    return; // priorVar0_ is the variance at lag zero
   priorVar0_(0,0) = getOrigin(covAlpha_);
   priorVar0_(1,1) = getOrigin(covBeta_);
   priorVar0_(2,2) = getOrigin(covRho_);
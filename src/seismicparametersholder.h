@@ -5,13 +5,21 @@
 #ifndef SEISMIC_PARAMETERS_HOLDER
 #define SEISMIC_PARAMETERS_HOLDER
 
+#include <vector>
+
 #include "nrlib/flens/nrlib_flens.hpp"
 #include <src/fftgrid.h>
+#include "src/definitions.h"
 
 class ModelSettings;
 
 // A class holding the pointers for the seismic parameters
 // for easy parameter transmission of the pointers to the class TimeEvolution.
+//
+// When the prior covariance is separable (no lateral correlation gradient), it is held
+// implicitly as priorVar0_ times the lateral and temporal correlations, and the 3x3 prior
+// of each frequency is made from their spectra in getNextParameterCovariance(). The six
+// covariance grids are then only filled if they are asked for, as in 4D inversion.
 
 class SeismicParametersHolder
 {
@@ -26,12 +34,24 @@ public:
   FFTGrid                * GetMuAlpha()                            { return muAlpha_        ;}
   FFTGrid                * GetMuBeta()                             { return muBeta_         ;}
   FFTGrid                * GetMuRho()                              { return muRho_          ;}
-  FFTGrid                * GetCovAlpha()                           { return covAlpha_       ;}
-  FFTGrid                * GetCovBeta()                            { return covBeta_        ;}
-  FFTGrid                * GetCovRho()                             { return covRho_         ;}
-  FFTGrid                * GetCrCovAlphaBeta()                     { return crCovAlphaBeta_ ;}
-  FFTGrid                * GetCrCovAlphaRho()                      { return crCovAlphaRho_  ;}
-  FFTGrid                * GetCrCovBetaRho()                       { return crCovBetaRho_   ;}
+  FFTGrid                * GetCovAlpha()                           { makeCovGrids(); return covAlpha_       ;}
+  FFTGrid                * GetCovBeta()                            { makeCovGrids(); return covBeta_        ;}
+  FFTGrid                * GetCovRho()                             { makeCovGrids(); return covRho_         ;}
+  FFTGrid                * GetCrCovAlphaBeta()                     { makeCovGrids(); return crCovAlphaBeta_ ;}
+  FFTGrid                * GetCrCovAlphaRho()                      { makeCovGrids(); return crCovAlphaRho_  ;}
+  FFTGrid                * GetCrCovBetaRho()                       { makeCovGrids(); return crCovBetaRho_   ;}
+
+  bool                     hasImplicitPriorCov()             const { return implicitPriorCov_ ;}
+
+  // Allocates the covariance grids in FFT domain, to be overwritten by the posterior covariance,
+  // while the implicit prior is still used by getNextParameterCovariance().
+  void                     createPostCovGrids();
+
+  // Called when the covariance grids hold the posterior covariance.
+  void                     releaseImplicitPriorCov()                { implicitPriorCov_ = false ;}
+
+  // Prior correlation for lag (i,j,k), using cyclicity. Only for an implicit prior covariance.
+  float                    getPriorCorrCyclic(int i, int j, int k) const;
 
   void                     invFFTAllGrids();
   void                     invFFTCovGrids();
@@ -62,6 +82,8 @@ public:
 
   NRLib::Matrix            getPriorVar0(void) const;
 
+  void                     setPriorVar0(const NRLib::Matrix & priorVar0) { priorVar0_ = priorVar0 ;}
+
   float                  * getPriorCorrTFiltered(int nz, int nzp) const;
 
   fftw_real              * computeCircCorrT(const std::vector<float> & priorCorrT,
@@ -102,6 +124,19 @@ public:
 private:
   void                     createCorrGrids(int nx, int ny, int nz, int nxp, int nyp, int nzp, bool fileGrid);
 
+  void                     makeCovGrids();
+
+  void                     getNextImplicitParameterCovariance(fftw_complex **& parVar) const;
+
+  void                     fillInCorrGrids(const Surface   * priorCorrXY,
+                                           const fftw_real * circCorrT,
+                                           const float     & corrGradI,
+                                           const float     & corrGradJ);
+
+  void                     initializeImplicitCorrelations(const Surface            * priorCorrXY,
+                                                          const std::vector<float> & priorCorrT,
+                                                          const int                & lowIntCut);
+
   void                     initializeCorrelations(const Surface            * priorCorrXY,
                                                   const std::vector<float> & priorCorrT,
                                                   const float              & corrGradI,
@@ -109,10 +144,6 @@ private:
                                                   const int                & lowIntCut,
                                                   const int                & nzp);
 
-  FFTGrid                * createFFTGrid(int nx,  int ny,  int nz,
-                                         int nxp, int nyp, int nzp,
-                                         bool fileGrid);
-
   void                     makeCircCorrTPosDef(fftw_real * circCorrT,
                                                const int & minIntFq,
                                                const int & nzp) const;
@@ -137,5 +168,18 @@ private:
 
   NRLib::Matrix            priorVar0_;
 
+  bool                      implicitPriorCov_;  // The covariance grids are not filled, the prior is given by the members below
+  Surface                   priorCorrXY_;
+  std::vector<fftw_real>    circCorrT_;         // Filtered circular temporal correlation, as from computeCircCorrT()
+  std::vector<fftw_complex> corrXYSpectrum_;    // Unscaled transform of priorCorrXY_, (nxp/2+1)*nyp
+  std::vector<fftw_complex> corrTSpectrum_;     // Unscaled transform of circCorrT_, nzp/2+1
+  mutable int               nextCovIndex_;      // Cell of next call to getNextImplicitParameterCovariance()
+
+  int                       nx_;
+  int                       ny_;
+  int                       nz_;
+  int                       nxp_;
+  int                       nyp_;
+  int                       nzp_;
 };
 #endif
@@ -30,6 +30,7 @@ Simbox::Simbox(void)
   xlStepY_     = 0;
   ilStepX_     = 0;
   ilStepY_     = 1;
+  depthId_     = 0;
 }
 
 Simbox::Simbox(double x0, double y0, const Surface & z0, double lx,
@@ -45,6 +46,7 @@ Simbox::Simbox(double x0, double y0, const Surface & z0, double lx,
   Surface z1(z0);
   z1.Add(lz);
   SetSurfaces(z0,z1); //Automatically sets lz correct in this case.
+  depthId_     = newDepthId();
 
   cosrot_      = cos(rot);
   sinrot_      = sin(rot);
@@ -87,6 +89,7 @@ Simbox::Simbox(const Simbox *simbox) :
   minRelThick_ = simbox->minRelThick_;
   topName_     = simbox->topName_;
   botName_     = simbox->botName_;
+  depthId_     = simbox->depthId_;
 }
 
 Simbox::~Simbox()
@@ -617,6 +620,7 @@ Simbox::setDepth(const Surface & zRef, double zShift, double lz, double dz, bool
   Surface zBot(zTop);
   zBot.Add(lz);
   SetSurfaces(zTop,zBot,skipCheck);
+  depthId_ = newDepthId();
   dz_ = dz;
   nz_ = int(0.5+lz/dz_);
   if(status_ == EMPTY)
@@ -629,6 +633,7 @@ void
 Simbox::setDepth(const Surface & z0, const Surface & z1, int nz, bool skipCheck)
 {
   SetSurfaces(z0, z1, skipCheck);
+  depthId_ = newDepthId();
   nz_ = nz;
   dz_ = -1;
   if(status_ == EMPTY)
@@ -749,3 +754,14 @@ void Simbox::getMinAndMaxXY(double &xmin, double &xmax, double &ymin, double &ym
   ymax = std::max(ymax,GetYMin()+GetLY()*cosrot_);
   ymax = std::max(ymax,GetYMin()+GetLX()*sinrot_+GetLY()*cosrot_);
 }
+
+int
+Simbox::newDepthId()
+{
+  int id;
+#pragma omp critical(SimboxDepthId)
+  id = ++nextDepthId_;
+  return(id);
+}
+
+int Simbox::nextDepthId_ = 0;
@@ -84,6 +84,7 @@ public:
   void           setDepth(const Surface & zRef, double zShift, double lz, double dz, bool skipCheck = false);
   void           setDepth(const Surface & z0, const Surface & z1, int nz, bool skipCheck = false);
   int            status() const {return(status_);}
+  int            getDepthId() const {return(depthId_);}   // New id each time the surfaces are set. Copies keep the id.
   void           externalFailure() {status_ = EXTERNALERROR;}
   void           getMinAndMaxXY(double &xmin, double &xmax, double &ymin, double &ymax) const;
   enum           simboxstatus{BOXOK, INTERNALERROR, EXTERNALERROR, EMPTY, NOAREA, NODEPTH};
@@ -103,5 +104,9 @@ private:
 
   bool           constThick_;
   double         minRelThick_;
+
+  int            depthId_;
+  static int     nextDepthId_;
+  static int     newDepthId();
 };
 #endif
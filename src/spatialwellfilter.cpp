@@ -95,10 +95,32 @@ void SpatialWellFilter::setPriorSpatialCorrSyntWell(FFTGrid             * parSpa
   parSpatialCorr->endAccess();
 }
 
-void SpatialWellFilter::setPriorSpatialCorr(FFTGrid *parSpatialCorr, WellData *well, int wellnr)
-{
-  float constant = parSpatialCorr->getRealValue(0, 0, 0);
+namespace {
+  // Prior correlation held in a grid, normalised by its value at lag zero
+  class GridCorr
+  {
+  public:
+    GridCorr(FFTGrid * grid) : grid_(grid), constant_(grid->getRealValue(0, 0, 0)) {}
+    float operator()(int i, int j, int k) const { return grid_->getRealValueCyclic(i, j, k) / constant_; }
+  private:
+    FFTGrid * grid_;
+    float     constant_;
+  };
+
+  // Prior correlation held implicitly by the parameters holder
+  class ImplicitCorr
+  {
+  public:
+    ImplicitCorr(const SeismicParametersHolder & seismicParameters) : seismicParameters_(seismicParameters) {}
+    float operator()(int i, int j, int k) const { return seismicParameters_.getPriorCorrCyclic(i, j, k); }
+  private:
+    const SeismicParametersHolder & seismicParameters_;
+  };
+}
 
+template <typename T>
+void SpatialWellFilter::fillPriorSpatialCorr(const T & corr, WellData *well, int wellnr)
+{
   int n = well->getBlockedLogsOrigThick()->getNumberOfBlocks();
   priorSpatialCorr_[wellnr] = new double *[n];
   n_[wellnr] = n;
@@ -119,12 +141,22 @@ void SpatialWellFilter::setPriorSpatialCorr(FFTGrid *parSpatialCorr, WellData *w
       i2 = ipos[l2];
       j2 = jpos[l2];
       k2 = kpos[l2];
-      priorSpatialCorr_[wellnr][l1][l2] = parSpatialCorr->getRealValueCyclic(i1-i2,j1-j2,k1-k2) / constant;
+      priorSpatialCorr_[wellnr][l1][l2] = corr(i1-i2,j1-j2,k1-k2);
       priorSpatialCorr_[wellnr][l2][l1] = priorSpatialCorr_[wellnr][l1][l2];
     }
   }
 }
 
+void SpatialWellFilter::setPriorSpatialCorr(FFTGrid *parSpatialCorr, WellData *well, int wellnr)
+{
+  fillPriorSpatialCorr(GridCorr(parSpatialCorr), well, wellnr);
+}
+
+void SpatialWellFilter::setPriorSpatialCorr(const SeismicParametersHolder & seismicParameters, WellData *well, int wellnr)
+{
+  fillPriorSpatialCorr(ImplicitCorr(seismicParameters), well, wellnr);
+}
+
 void SpatialWellFilter::doFilteringSyntWells(std::vector<SyntWellData *>              & syntWellData,
                                              const std::vector<std::vector<double> >  & v,
                                              SeismicParametersHolder                  & seismicParameters,
@@ -29,6 +29,11 @@ public:
                                                WellData   * well,
                                                int          wellnr);
 
+  // As above, for a prior covariance that is not held in grids
+  void                     setPriorSpatialCorr(const SeismicParametersHolder & seismicParameters,
+                                               WellData                      * well,
+                                               int                             wellnr);
+
   void                     doFiltering(std::vector<WellData *>         wells,
                                        int                             nWells,
                                        bool                            useVpRhoFilter,
@@ -56,6 +61,9 @@ public:
 
 private:
 
+  template <typename T>
+  void fillPriorSpatialCorr(const T & corr, WellData * well, int wellnr);
+
   void doVpRhoFiltering(std::vector<NRLib::Matrix> &  sigmaeVpRho,
                         double                     ** sigmapri,
                         double                     ** sigmapost,
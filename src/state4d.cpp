@@ -10,6 +10,7 @@
 #include <string>
 #include "src/vario.h"
 #include "src/fftgrid.h"
+#include "src/packedstate4d.h"
 
 State4D::State4D()
 {
@@ -139,51 +140,41 @@ void State4D::merge(SeismicParametersHolder & current_state )
   mu[1] =  current_state.GetMuBeta(); //mu_Beta
   mu[2] =  current_state.GetMuRho(); //mu_Rho
 
+  std::vector<FFTGrid *> muFull;
+  std::vector<FFTGrid *> sigmaFull;
+  getPackedGrids(muFull, sigmaFull);
+
   for(int i = 0; i<3; i++)
   {
     mu[i]->setTransformedStatus(true); //Going to fill it with transformed info.
     mu[i]->setAccessMode(FFTGrid::WRITE);
-    mu_static_[i]->setAccessMode(FFTGrid::READ);
-    mu_dynamic_[i]->setAccessMode(FFTGrid::READ);
   }
+  for(int i = 0; i<6; i++)
+    muFull[i]->setAccessMode(FFTGrid::READ);
 
   int nzp = mu[0]->getNzp();
   int nyp = mu[0]->getNyp();
   int cnxp = mu[0]->getCNxp();
 
-  fftw_complex*  muFullPrior=new fftw_complex[6];
-  fftw_complex*  muCurrentPrior=new fftw_complex[3];
+  PackedState4D layer(cnxp*nyp);
 
   for (int k = 0; k < nzp; k++) {
-    for (int j = 0; j < nyp; j++) {
-      for (int i = 0; i < cnxp; i++) {
-         muFullPrior[0] = mu_static_[0]->getNextComplex();
-         muFullPrior[1] = mu_static_[1]->getNextComplex();
-         muFullPrior[2] = mu_static_[2]->getNextComplex();
-         muFullPrior[3] = mu_dynamic_[0]->getNextComplex();
-         muFullPrior[4] = mu_dynamic_[1]->getNextComplex();
-         muFullPrior[5] = mu_dynamic_[2]->getNextComplex();
-         for(int l=0;l<3;l++){
-           muCurrentPrior[l].re =muFullPrior[l].re+muFullPrior[l+3].re;
-           muCurrentPrior[l].im =muFullPrior[l].im+muFullPrior[l+3].im;
-         }
-
-         mu[0]->setNextComplex(muCurrentPrior[0]);
-         mu[1]->setNextComplex(muCurrentPrior[1]);
-         mu[2]->setNextComplex(muCurrentPrior[2]);
+    layer.readNextMu(muFull);
+    for (int c = 0; c < layer.getNCells(); c++) {
+      const PackedState4D::Cell & cell = layer(c);
+      for(int l=0;l<3;l++){
+        fftw_complex muCurrentPrior;
+        muCurrentPrior.re = cell.mu[l].re + cell.mu[l+3].re;
+        muCurrentPrior.im = cell.mu[l].im + cell.mu[l+3].im;
+        mu[l]->setNextComplex(muCurrentPrior);
       }
     }
   }
 
   for(int i = 0; i<3; i++)
-  {
     mu[i]->endAccess();
-    mu_static_[i]->endAccess();
-    mu_dynamic_[i]->endAccess();
-  }
-
-  delete [] muFullPrior;
-  delete [] muCurrentPrior;
+  for(int i = 0; i<6; i++)
+    muFull[i]->endAccess();
 
   //Merge covariances
   std::vector<FFTGrid *> sigma(6);
@@ -202,90 +193,68 @@ void State4D::mergeCov(std::vector<FFTGrid * > & sigma)
 {
   assert(sigma.size() == 6);
 
+  std::vector<FFTGrid *> muFull;
+  std::vector<FFTGrid *> sigmaFull;
+  getPackedGrids(muFull, sigmaFull);
+
   for(int i = 0; i<6; i++)
   {
     sigma[i]->setTransformedStatus(true); //Going to fill it with transformed info.
     sigma[i]->setAccessMode(FFTGrid::WRITE);
-    sigma_static_static_[i]->setAccessMode(FFTGrid::READ);
-    sigma_dynamic_dynamic_[i]->setAccessMode(FFTGrid::READ);
   }
 
-  for(int i = 0; i<9; i++)
-    sigma_static_dynamic_[i]->setAccessMode(FFTGrid::READ);
-
-  std::vector<std::vector<fftw_complex> > sigmaFullPrior(6);
-  for(int i=0;i<6;i++)
-    sigmaFullPrior[i].resize(6);
-
-  std::vector<std::vector<fftw_complex> > sigmaCurrentPrior(3);
-  for(int i=0;i<3;i++)
-    sigmaCurrentPrior[i].resize(3);
+  for(int i = 0; i<21; i++)
+    sigmaFull[i]->setAccessMode(FFTGrid::READ);
 
   int nzp = sigma[0]->getNzp();
   int nyp = sigma[0]->getNyp();
   int cnxp = sigma[0]->getCNxp();
 
+  PackedState4D layer(cnxp*nyp);
+
+  // Upper triangle of the current covariance, in the order of the sigma grids
+  std::vector<fftw_complex> sigmaCurrentPrior(6*layer.getNCells());
+
   for (int k = 0; k < nzp; k++) {
-    for (int j = 0; j < nyp; j++) {
-      for (int i = 0; i < cnxp; i++) {
-         sigmaFullPrior[0][0] = sigma_static_static_[0]->getNextComplex();
-         sigmaFullPrior[0][1] = sigma_static_static_[1]->getNextComplex();
-         sigmaFullPrior[0][2] = sigma_static_static_[2]->getNextComplex();
-         sigmaFullPrior[0][3] = sigma_static_dynamic_[0]->getNextComplex();
-         sigmaFullPrior[0][4] = sigma_static_dynamic_[1]->getNextComplex();
-         sigmaFullPrior[0][5] = sigma_static_dynamic_[2]->getNextComplex();
-         sigmaFullPrior[1][1] = sigma_static_static_[3]->getNextComplex();
-         sigmaFullPrior[1][2] = sigma_static_static_[4]->getNextComplex();
-         sigmaFullPrior[1][3] = sigma_static_dynamic_[3]->getNextComplex();
-         sigmaFullPrior[1][4] = sigma_static_dynamic_[4]->getNextComplex();
-         sigmaFullPrior[1][5] = sigma_static_dynamic_[5]->getNextComplex();
-         sigmaFullPrior[2][2] = sigma_static_static_[5]->getNextComplex();
-         sigmaFullPrior[2][3] = sigma_static_dynamic_[6]->getNextComplex();
-         sigmaFullPrior[2][4] = sigma_static_dynamic_[7]->getNextComplex();
-         sigmaFullPrior[2][5] = sigma_static_dynamic_[8]->getNextComplex();
-         sigmaFullPrior[3][3] = sigma_dynamic_dynamic_[0]->getNextComplex();
-         sigmaFullPrior[3][4] = sigma_dynamic_dynamic_[1]->getNextComplex();
-         sigmaFullPrior[3][5] = sigma_dynamic_dynamic_[2]->getNextComplex();
-         sigmaFullPrior[4][4] = sigma_dynamic_dynamic_[3]->getNextComplex();
-         sigmaFullPrior[4][5] = sigma_dynamic_dynamic_[4]->getNextComplex();
-         sigmaFullPrior[5][5] = sigma_dynamic_dynamic_[5]->getNextComplex();
-         for(int l=0;l<6;l++)
-           for(int m=l+1;m<6;m++)
-           {
-             sigmaFullPrior[m][l].re=sigmaFullPrior[l][m].re;
-             sigmaFullPrior[m][l].im=-sigmaFullPrior[l][m].im;
-           }
+    layer.readNextSigma(sigmaFull);
+
+#pragma omp parallel for
+    for (int c = 0; c < layer.getNCells(); c++) {
+      const PackedState4D::Cell & cell = layer(c);
+      fftw_complex * current = &sigmaCurrentPrior[6*c];
+
+      // The current covariance is Sigma_ss + Sigma_dd + Sigma_ds + Sigma_sd, where the
+      // static-dynamic blocks are taken from the upper triangle using Hermitian symmetry.
+      int counter = 0;
+      for(int l=0;l<3;l++)
+        for(int m=l;m<3;m++){
+          const fftw_complex & ss = cell.sigma[PackedState4D::sigmaIndex(l  , m  )];
+          const fftw_complex & dd = cell.sigma[PackedState4D::sigmaIndex(l+3, m+3)];
+          const fftw_complex & ds = cell.sigma[PackedState4D::sigmaIndex(m  , l+3)];  // (l+3,m) is the adjoint of (m,l+3)
+          const fftw_complex & sd = cell.sigma[PackedState4D::sigmaIndex(l  , m+3)];
+          current[counter].re  = ss.re;
+          current[counter].re += dd.re;
+          current[counter].re += ds.re;
+          current[counter].re += sd.re;
+          current[counter].im  = ss.im;
+          current[counter].im += dd.im;
+          current[counter].im -= ds.im;
+          current[counter].im += sd.im;
+          counter++;
+        }
+    }
 
-         for(int l=0;l<3;l++)
-           for(int m=0;m<3;m++){
-             sigmaCurrentPrior[l][m].re  = sigmaFullPrior[l  ][m  ].re;
-             sigmaCurrentPrior[l][m].re += sigmaFullPrior[l+3][m+3].re;
-             sigmaCurrentPrior[l][m].re += sigmaFullPrior[l+3][m  ].re;
-             sigmaCurrentPrior[l][m].re += sigmaFullPrior[l  ][m+3].re;
-             sigmaCurrentPrior[l][m].im  = sigmaFullPrior[l  ][m  ].im;
-             sigmaCurrentPrior[l][m].im += sigmaFullPrior[l+3][m+3].im;
-             sigmaCurrentPrior[l][m].im += sigmaFullPrior[l+3][m  ].im;
-             sigmaCurrentPrior[l][m].im += sigmaFullPrior[l  ][m+3].im;
-           }
-         sigma[0]->setNextComplex(sigmaCurrentPrior[0][0]);
-         sigma[1]->setNextComplex(sigmaCurrentPrior[0][1]);
-         sigma[2]->setNextComplex(sigmaCurrentPrior[0][2]);
-         sigma[3]->setNextComplex(sigmaCurrentPrior[1][1]);
-         sigma[4]->setNextComplex(sigmaCurrentPrior[1][2]);
-         sigma[5]->setNextComplex(sigmaCurrentPrior[2][2]);
-      }
+    for (int c = 0; c < layer.getNCells(); c++) {
+      for(int i = 0; i<6; i++)
+        sigma[i]->setNextComplex(sigmaCurrentPrior[6*c + i]);
     }
   }
 
   for(int i = 0; i<6; i++)
-  {
     sigma[i]->endAccess();
-    sigma_static_static_[i]->endAccess();
-    sigma_dynamic_dynamic_[i]->endAccess();
-  }
 
-  for(int i = 0; i<9; i++)
-    sigma_static_dynamic_[i]->endAccess();
+  for(int i = 0; i<21; i++)
+    sigmaFull[i]->endAccess();
 }
 
 void State4D::split(SeismicParametersHolder & current_state )
@@ -300,14 +269,6 @@ void State4D::split(SeismicParametersHolder & current_state )
   mu[1] =  current_state.GetMuBeta(); //mu_Beta
   mu[2] =  current_state.GetMuRho(); //mu_Rho
 
-  for(int i = 0; i<3; i++)
-  {
-    assert(mu[i]->getIsTransformed());
-    mu[i]->setAccessMode(FFTGrid::READ);
-    mu_static_[i]->setAccessMode(FFTGrid::READANDWRITE);
-    mu_dynamic_[i]->setAccessMode(FFTGrid::READANDWRITE);
-  }
-
   std::vector<FFTGrid *> sigma(6);
   sigma[0]=current_state.GetCovAlpha();
   sigma[1]=current_state.GetCrCovAlphaBeta();
@@ -316,101 +277,103 @@ void State4D::split(SeismicParametersHolder & current_state )
   sigma[4]=current_state.GetCrCovBetaRho();
   sigma[5]=current_state.GetCovRho();
 
+  std::vector<FFTGrid *> muFull;
+  std::vector<FFTGrid *> sigmaFull;
+  getPackedGrids(muFull, sigmaFull);
 
-
+  for(int i = 0; i<3; i++)
+  {
+    assert(mu[i]->getIsTransformed());
+    mu[i]->setAccessMode(FFTGrid::READ);
+  }
   for(int i = 0; i<6; i++)
   {
     assert(sigma[i]->getIsTransformed());
     sigma[i]->setAccessMode(FFTGrid::READ);
-    sigma_static_static_[i]->setAccessMode(FFTGrid::READANDWRITE);
-    sigma_dynamic_dynamic_[i]->setAccessMode(FFTGrid::READANDWRITE);
   }
 
-  for(int i = 0; i<9; i++)
-    sigma_static_dynamic_[i]->setAccessMode(FFTGrid::READANDWRITE);
-
+  for(int i = 0; i<6; i++)
+    muFull[i]->setAccessMode(FFTGrid::READANDWRITE);
+  for(int i = 0; i<21; i++)
+    sigmaFull[i]->setAccessMode(FFTGrid::READANDWRITE);
 
   int nzp = mu[0]->getNzp();
   int nyp = mu[0]->getNyp();
   int cnxp = mu[0]->getCNxp();
 
-  fftw_complex*  muFullPrior=new fftw_complex[6];
-  fftw_complex*  muFullPosterior=new fftw_complex[6];
-  fftw_complex*  muCurrentPrior=new fftw_complex[3];
-  fftw_complex*  muCurrentPosterior=new fftw_complex[3];
-
-  fftw_complex** sigmaFullPrior          = new fftw_complex*[6];
-  fftw_complex** sigmaFullPosterior      = new fftw_complex*[6];
-  fftw_complex** sigmaFullVsCurrentPrior = new fftw_complex*[6];
-  fftw_complex** adjointSandwich         = new fftw_complex*[6];
-
-  for(int i=0;i<6;i++)
-  {
-    sigmaFullPrior[i]          = new fftw_complex[6];
-    sigmaFullVsCurrentPrior[i] = new fftw_complex[3];
-    sigmaFullPosterior[i]      = new fftw_complex[6];
-    adjointSandwich[i]          = new fftw_complex[3];
-  }
+  PackedState4D layer(cnxp*nyp);
+  const int nCells = layer.getNCells();
 
-  fftw_complex** sigmaCurrentPrior       = new fftw_complex*[3];
-  fftw_complex** sigmaCurrentPriorChol   = new fftw_complex*[3];
-  fftw_complex** sigmaCurrentPosterior   = new fftw_complex*[3];
-  fftw_complex** sandwich                = new fftw_complex*[3];
-  fftw_complex** helper                  = new fftw_complex*[3];
+  // Posterior of the current state, ordered as the mu and sigma grids
+  std::vector<fftw_complex> muCurrent(3*nCells);
+  std::vector<fftw_complex> sigmaCurrent(6*nCells);
 
-  for(int i=0;i<3;i++)
-  {
-    sigmaCurrentPrior[i]     = new fftw_complex[3];
-    sigmaCurrentPriorChol[i] = new fftw_complex[3];
-    sigmaCurrentPosterior[i] = new fftw_complex[3];
-    sandwich[i]              = new fftw_complex[6];
-    helper[i]                = new fftw_complex[6];
-  }
   int counter =0;
   for (int k = 0; k < nzp; k++) {
-    for (int j = 0; j < nyp; j++) {
-      for (int i = 0; i < cnxp; i++) {
-         // reading from grids
-         muFullPrior[0] = mu_static_[0]->getNextComplex();
-         muFullPrior[1] = mu_static_[1]->getNextComplex();
-         muFullPrior[2] = mu_static_[2]->getNextComplex();
-         muFullPrior[3] = mu_dynamic_[0]->getNextComplex();
-         muFullPrior[4] = mu_dynamic_[1]->getNextComplex();
-         muFullPrior[5] = mu_dynamic_[2]->getNextComplex();
-
-
-         sigmaFullPrior[0][0] = sigma_static_static_[0]->getNextComplex();
-         sigmaFullPrior[0][1] = sigma_static_static_[1]->getNextComplex();
-         sigmaFullPrior[0][2] = sigma_static_static_[2]->getNextComplex();
-         sigmaFullPrior[0][3] = sigma_static_dynamic_[0]->getNextComplex();
-         sigmaFullPrior[0][4] = sigma_static_dynamic_[1]->getNextComplex();
-         sigmaFullPrior[0][5] = sigma_static_dynamic_[2]->getNextComplex();
-         sigmaFullPrior[1][1] = sigma_static_static_[3]->getNextComplex();
-         sigmaFullPrior[1][2] = sigma_static_static_[4]->getNextComplex();
-         sigmaFullPrior[1][3] = sigma_static_dynamic_[3]->getNextComplex();
-         sigmaFullPrior[1][4] = sigma_static_dynamic_[4]->getNextComplex();
-         sigmaFullPrior[1][5] = sigma_static_dynamic_[5]->getNextComplex();
-         sigmaFullPrior[2][2] = sigma_static_static_[5]->getNextComplex();
-         sigmaFullPrior[2][3] = sigma_static_dynamic_[6]->getNextComplex();
-         sigmaFullPrior[2][4] = sigma_static_dynamic_[7]->getNextComplex();
-         sigmaFullPrior[2][5] = sigma_static_dynamic_[8]->getNextComplex();
-         sigmaFullPrior[3][3] = sigma_dynamic_dynamic_[0]->getNextComplex();
-         sigmaFullPrior[3][4] = sigma_dynamic_dynamic_[1]->getNextComplex();
-         sigmaFullPrior[3][5] = sigma_dynamic_dynamic_[2]->getNextComplex();
-         sigmaFullPrior[4][4] = sigma_dynamic_dynamic_[3]->getNextComplex();
-         sigmaFullPrior[4][5] = sigma_dynamic_dynamic_[4]->getNextComplex();
-         sigmaFullPrior[5][5] = sigma_dynamic_dynamic_[5]->getNextComplex();
-
-         muCurrentPosterior[0]=mu[0]->getNextComplex();
-         muCurrentPosterior[1]=mu[1]->getNextComplex();
-         muCurrentPosterior[2]=mu[2]->getNextComplex();
-
-         sigmaCurrentPosterior[0][0]=sigma[0]->getNextComplex();
-         sigmaCurrentPosterior[0][1]=sigma[1]->getNextComplex();
-         sigmaCurrentPosterior[0][2]=sigma[2]->getNextComplex();
-         sigmaCurrentPosterior[1][1]=sigma[3]->getNextComplex();
-         sigmaCurrentPosterior[1][2]=sigma[4]->getNextComplex();
-         sigmaCurrentPosterior[2][2]=sigma[5]->getNextComplex();
+    // reading from grids
+    layer.readNextMu(muFull);
+    layer.readNextSigma(sigmaFull);
+    for (int c = 0; c < nCells; c++) {
+      for (int i = 0; i < 3; i++)
+        muCurrent[3*c + i] = mu[i]->getNextComplex();
+      for (int i = 0; i < 6; i++)
+        sigmaCurrent[6*c + i] = sigma[i]->getNextComplex();
+    }
+
+#pragma omp parallel reduction(+:counter)
+    {
+      // Work space for the cell updates, allocated once per thread.
+      fftw_complex*  muFullPrior=new fftw_complex[6];
+      fftw_complex*  muFullPosterior=new fftw_complex[6];
+      fftw_complex*  muCurrentPrior=new fftw_complex[3];
+      fftw_complex*  muCurrentPosterior=new fftw_complex[3];
+
+      fftw_complex** sigmaFullPrior          = new fftw_complex*[6];
+      fftw_complex** sigmaFullPosterior      = new fftw_complex*[6];
+      fftw_complex** sigmaFullVsCurrentPrior = new fftw_complex*[6];
+      fftw_complex** adjointSandwich         = new fftw_complex*[6];
+
+      for(int i=0;i<6;i++)
+      {
+        sigmaFullPrior[i]          = new fftw_complex[6];
+        sigmaFullVsCurrentPrior[i] = new fftw_complex[3];
+        sigmaFullPosterior[i]      = new fftw_complex[6];
+        adjointSandwich[i]          = new fftw_complex[3];
+      }
+
+      fftw_complex** sigmaCurrentPrior       = new fftw_complex*[3];
+      fftw_complex** sigmaCurrentPriorChol   = new fftw_complex*[3];
+      fftw_complex** sigmaCurrentPosterior   = new fftw_complex*[3];
+      fftw_complex** sandwich                = new fftw_complex*[3];
+      fftw_complex** helper                  = new fftw_complex*[3];
+
+      for(int i=0;i<3;i++)
+      {
+        sigmaCurrentPrior[i]     = new fftw_complex[3];
+        sigmaCurrentPriorChol[i] = new fftw_complex[3];
+        sigmaCurrentPosterior[i] = new fftw_complex[3];
+        sandwich[i]              = new fftw_complex[6];
+        helper[i]                = new fftw_complex[6];
+      }
+
+#pragma omp for
+      for (int c = 0; c < nCells; c++) {
+         PackedState4D::Cell & cell = layer(c);
+
+         for(int l=0;l<6;l++)
+           muFullPrior[l] = cell.mu[l];
+
+         PackedState4D::getFullSigma(cell, sigmaFullPrior);
+
+         for(int l=0;l<3;l++)
+           muCurrentPosterior[l] = muCurrent[3*c + l];
+
+         sigmaCurrentPosterior[0][0]=sigmaCurrent[6*c + 0];
+         sigmaCurrentPosterior[0][1]=sigmaCurrent[6*c + 1];
+         sigmaCurrentPosterior[0][2]=sigmaCurrent[6*c + 2];
+         sigmaCurrentPosterior[1][1]=sigmaCurrent[6*c + 3];
+         sigmaCurrentPosterior[1][2]=sigmaCurrent[6*c + 4];
+         sigmaCurrentPosterior[2][2]=sigmaCurrent[6*c + 5];
          // compleating matrixes
          sigmaCurrentPosterior[1][0].re =  sigmaCurrentPosterior[0][1].re;
          sigmaCurrentPosterior[1][0].im = -sigmaCurrentPosterior[0][1].im;
@@ -419,13 +382,6 @@ void State4D::split(SeismicParametersHolder & current_state )
          sigmaCurrentPosterior[2][1].re =  sigmaCurrentPosterior[1][2].re;
          sigmaCurrentPosterior[2][1].im = -sigmaCurrentPosterior[1][2].im;
 
-         for(int l=0;l<6;l++)
-           for(int m=l+1;m<6;m++)
-           {
-             sigmaFullPrior[m][l].re = sigmaFullPrior[l][m].re;
-             sigmaFullPrior[m][l].im = -sigmaFullPrior[l][m].im;
-           }
-
          // computing derived quantities
 
          for(int l=0;l<3;l++){
@@ -470,102 +426,65 @@ void State4D::split(SeismicParametersHolder & current_state )
            lib_matrAddVecCpx( muFullPrior, 6, muFullPosterior);
          }else
          {
-          // /*
-          counter++;
-          if(counter==100)
-          {
-            lib_matrDumpCpx("priorFull", sigmaFullPrior, 6,6);
-            lib_matrDumpCpx("priorCurrent", sigmaCurrentPrior, 3,3);
-            lib_matrDumpCpx("posteriorCurrent", sigmaCurrentPosterior, 3,3); // */
-          }
+           counter++;
            lib_matrCopyCpx(sigmaFullPrior, 6, 6, sigmaFullPosterior);
            for(int l=0;l<6;l++)
              muFullPosterior[l]= muFullPrior[l];
-
          }
 
-        // writing to grids
-         sigma_static_static_[0]->setNextComplex(  sigmaFullPosterior[0][0]);
-         sigma_static_static_[1]->setNextComplex(  sigmaFullPosterior[0][1]);
-         sigma_static_static_[2]->setNextComplex(  sigmaFullPosterior[0][2]);
-         sigma_static_dynamic_[0]->setNextComplex( sigmaFullPosterior[0][3]);
-         sigma_static_dynamic_[1]->setNextComplex( sigmaFullPosterior[0][4]);
-         sigma_static_dynamic_[2]->setNextComplex( sigmaFullPosterior[0][5]);
-         sigma_static_static_[3]->setNextComplex(  sigmaFullPosterior[1][1]);
-         sigma_static_static_[4]->setNextComplex(  sigmaFullPosterior[1][2]);
-         sigma_static_dynamic_[3]->setNextComplex( sigmaFullPosterior[1][3]);
-         sigma_static_dynamic_[4]->setNextComplex( sigmaFullPosterior[1][4]);
-         sigma_static_dynamic_[5]->setNextComplex( sigmaFullPosterior[1][5]);
-         sigma_static_static_[5]->setNextComplex(  sigmaFullPosterior[2][2]);
-         sigma_static_dynamic_[6]->setNextComplex( sigmaFullPosterior[2][3]);
-         sigma_static_dynamic_[7]->setNextComplex( sigmaFullPosterior[2][4]);
-         sigma_static_dynamic_[8]->setNextComplex( sigmaFullPosterior[2][5]);
-         sigma_dynamic_dynamic_[0]->setNextComplex(sigmaFullPosterior[3][3]);
-         sigma_dynamic_dynamic_[1]->setNextComplex(sigmaFullPosterior[3][4]);
-         sigma_dynamic_dynamic_[2]->setNextComplex(sigmaFullPosterior[3][5]);
-         sigma_dynamic_dynamic_[3]->setNextComplex(sigmaFullPosterior[4][4]);
-         sigma_dynamic_dynamic_[4]->setNextComplex(sigmaFullPosterior[4][5]);
-         sigma_dynamic_dynamic_[5]->setNextComplex(sigmaFullPosterior[5][5]);
-
-         mu_static_[0]->setNextComplex( muFullPosterior[0]);
-         mu_static_[1]->setNextComplex( muFullPosterior[1]);
-         mu_static_[2]->setNextComplex( muFullPosterior[2]);
-         mu_dynamic_[0]->setNextComplex(muFullPosterior[3]);
-         mu_dynamic_[1]->setNextComplex(muFullPosterior[4]);
-         mu_dynamic_[2]->setNextComplex(muFullPosterior[5]);
+         PackedState4D::setFullSigma(cell, sigmaFullPosterior);
+         for(int l=0;l<6;l++)
+           cell.mu[l] = muFullPosterior[l];
+      }
+
+      for(int i=0;i<6;i++)
+      {
+        delete [] adjointSandwich[i];
+        delete [] sigmaFullPrior[i];
+        delete [] sigmaFullVsCurrentPrior[i];
+        delete [] sigmaFullPosterior[i];
+      }
+      for(int i=0;i<3;i++)
+      {
+        delete [] sandwich[i];
+        delete [] helper[i];
+        delete [] sigmaCurrentPrior[i];
+        delete [] sigmaCurrentPriorChol[i];
+        delete [] sigmaCurrentPosterior[i];
       }
+
+      delete [] muFullPrior;
+      delete [] muFullPosterior;
+      delete [] muCurrentPrior;
+      delete [] muCurrentPosterior;
+
+      delete [] sandwich;
+      delete [] helper;
+      delete [] adjointSandwich;
+      delete [] sigmaFullPrior;
+      delete [] sigmaFullPosterior;
+      delete [] sigmaFullVsCurrentPrior;
+      delete [] sigmaCurrentPrior;
+      delete [] sigmaCurrentPriorChol;
+      delete [] sigmaCurrentPosterior;
     }
+
+    // writing to grids
+    layer.writeNextMu(muFull);
+    layer.writeNextSigma(sigmaFull);
   }
 
   LogKit::LogFormatted(LogKit::Low, "\nNumber of shortcuts in split = "+NRLib::ToString(counter)+". This is "+NRLib::ToString(double(counter*100.0)/double(cnxp*nyp*nzp))+" of 100 percent \n");
 
   for(int i = 0; i<3; i++)
-  {
     mu[i]->endAccess();
-    mu_static_[i]->endAccess();
-    mu_dynamic_[i]->endAccess();
-  }
   for(int i = 0; i<6; i++)
-  {
     sigma[i]->endAccess();
-    sigma_static_static_[i]->endAccess();
-    sigma_dynamic_dynamic_[i]->endAccess();
-  }
-
-  for(int i = 0; i<9; i++)
-    sigma_static_dynamic_[i]->endAccess();
-
-
-  for(int i=0;i<6;i++)
-  {
-    delete [] adjointSandwich[i];
-    delete [] sigmaFullPrior[i];
-    delete [] sigmaFullVsCurrentPrior[i];
-    delete [] sigmaFullPosterior[i];
-  }
-  for(int i=0;i<3;i++)
-  {
-    delete [] sandwich[i];
-    delete [] helper[i];
-    delete [] sigmaCurrentPrior[i];
-    delete [] sigmaCurrentPriorChol[i];
-    delete [] sigmaCurrentPosterior[i];
-  }
 
-  delete [] muFullPrior;
-  delete [] muFullPosterior;
-  delete [] muCurrentPrior;
-  delete [] muCurrentPosterior;
-
-  delete [] sandwich;
-  delete [] helper;
-  delete [] adjointSandwich;
-  delete [] sigmaFullPrior;
-  delete [] sigmaFullPosterior;
-  delete [] sigmaFullVsCurrentPrior;
-  delete [] sigmaCurrentPrior;
-  delete [] sigmaCurrentPriorChol;
-  delete [] sigmaCurrentPosterior;
+  for(int i = 0; i<6; i++)
+    muFull[i]->endAccess();
+  for(int i = 0; i<21; i++)
+    sigmaFull[i]->endAccess();
 }
 
 void    State4D::updateWithSingleParameter(FFTGrid  *Epost, FFTGrid *CovPost, int parameterNumber)
@@ -574,196 +493,102 @@ void    State4D::updateWithSingleParameter(FFTGrid  *Epost, FFTGrid *CovPost, in
   LogKit::LogFormatted(LogKit::Low, "\nUpdating full State 4D with inversion of single parameter...\n");
   // initializing
   assert(allGridsAreTransformed());
-  for(int i = 0; i<3; i++){
-    mu_static_[i]->setAccessMode(FFTGrid::READANDWRITE);
-    mu_dynamic_[i]->setAccessMode(FFTGrid::READANDWRITE);
-  }
 
-  assert(Epost->getIsTransformed());
-  Epost->setAccessMode(FFTGrid::READ);
+  std::vector<FFTGrid *> muFull;
+  std::vector<FFTGrid *> sigmaFull;
+  getPackedGrids(muFull, sigmaFull);
 
   for(int i = 0; i<6; i++)
-  {
-    sigma_static_static_[i]->setAccessMode(FFTGrid::READANDWRITE);
-    sigma_dynamic_dynamic_[i]->setAccessMode(FFTGrid::READANDWRITE);
-  }
+    muFull[i]->setAccessMode(FFTGrid::READANDWRITE);
+  for(int i = 0; i<21; i++)
+    sigmaFull[i]->setAccessMode(FFTGrid::READANDWRITE);
+
+  assert(Epost->getIsTransformed());
+  Epost->setAccessMode(FFTGrid::READ);
 
   assert(CovPost->getIsTransformed());
   CovPost->setAccessMode(FFTGrid::READ);
 
-
-  for(int i = 0; i<9; i++)
-    sigma_static_dynamic_[i]->setAccessMode(FFTGrid::READANDWRITE);
-
   int nzp = Epost->getNzp();
   int nyp = Epost->getNyp();
   int cnxp = Epost->getCNxp();
 
-  fftw_complex*  muFullPrior=new fftw_complex[6];
-  fftw_complex*  muFullPosterior=new fftw_complex[6];
-  fftw_complex   muCurrentPrior;
-  fftw_complex   muCurrentPosterior;
-  double   sigmaCurrentPrior ;
-  double   sigmaCurrentPosterior ;
+  PackedState4D layer(cnxp*nyp);
+  const int nCells = layer.getNCells();
 
-  fftw_complex** sigmaFullPrior          = new fftw_complex*[6];
-  fftw_complex** sigmaFullPosterior      = new fftw_complex*[6];
-  fftw_complex*  sigmaFullVsCurrentPrior = new fftw_complex[6];
-
-  for(int i=0;i<6;i++)
-  {
-    sigmaFullPrior[i]          = new fftw_complex[6];
-    sigmaFullPosterior[i]      = new fftw_complex[6];
-  }
+  std::vector<fftw_complex> muPost(nCells);
+  std::vector<double>       sigmaPost(nCells);
 
   for (int k = 0; k < nzp; k++) {
-    for (int j = 0; j < nyp; j++) {
-      for (int i = 0; i < cnxp; i++) {
-         // reading from grids
-         muFullPrior[0] = mu_static_[0]->getNextComplex();
-         muFullPrior[1] = mu_static_[1]->getNextComplex();
-         muFullPrior[2] = mu_static_[2]->getNextComplex();
-         muFullPrior[3] = mu_dynamic_[0]->getNextComplex();
-         muFullPrior[4] = mu_dynamic_[1]->getNextComplex();
-         muFullPrior[5] = mu_dynamic_[2]->getNextComplex();
-
-         sigmaFullPrior[0][0] = sigma_static_static_[0]->getNextComplex();
-         sigmaFullPrior[0][1] = sigma_static_static_[1]->getNextComplex();
-         sigmaFullPrior[0][2] = sigma_static_static_[2]->getNextComplex();
-         sigmaFullPrior[0][3] = sigma_static_dynamic_[0]->getNextComplex();
-         sigmaFullPrior[0][4] = sigma_static_dynamic_[1]->getNextComplex();
-         sigmaFullPrior[0][5] = sigma_static_dynamic_[2]->getNextComplex();
-         sigmaFullPrior[1][1] = sigma_static_static_[3]->getNextComplex();
-         sigmaFullPrior[1][2] = sigma_static_static_[4]->getNextComplex();
-         sigmaFullPrior[1][3] = sigma_static_dynamic_[3]->getNextComplex();
-         sigmaFullPrior[1][4] = sigma_static_dynamic_[4]->getNextComplex();
-         sigmaFullPrior[1][5] = sigma_static_dynamic_[5]->getNextComplex();
-         sigmaFullPrior[2][2] = sigma_static_static_[5]->getNextComplex();
-         sigmaFullPrior[2][3] = sigma_static_dynamic_[6]->getNextComplex();
-         sigmaFullPrior[2][4] = sigma_static_dynamic_[7]->getNextComplex();
-         sigmaFullPrior[2][5] = sigma_static_dynamic_[8]->getNextComplex();
-         sigmaFullPrior[3][3] = sigma_dynamic_dynamic_[0]->getNextComplex();
-         sigmaFullPrior[3][4] = sigma_dynamic_dynamic_[1]->getNextComplex();
-         sigmaFullPrior[3][5] = sigma_dynamic_dynamic_[2]->getNextComplex();
-         sigmaFullPrior[4][4] = sigma_dynamic_dynamic_[3]->getNextComplex();
-         sigmaFullPrior[4][5] = sigma_dynamic_dynamic_[4]->getNextComplex();
-         sigmaFullPrior[5][5] = sigma_dynamic_dynamic_[5]->getNextComplex();
-
-         // compleating matrixes
-         for(int l=0;l<6;l++)
-           for(int m=l+1;m<6;m++)
-           {
-             sigmaFullPrior[m][l].re = sigmaFullPrior[l][m].re;
-             sigmaFullPrior[m][l].im = -sigmaFullPrior[l][m].im;
-           }
-
-         // getting Prior for Parameter
-          muCurrentPrior=muFullPrior[parameterNumber];
-          sigmaCurrentPrior = static_cast<double>(sigmaFullPrior[parameterNumber][parameterNumber].re);
-         // getting posterior for Parameter
-         muCurrentPosterior = Epost->getNextComplex();
-         sigmaCurrentPosterior=static_cast<double>(CovPost->getNextComplex().re);
-
-         // getting correlation between Parameter and others
-         for(int l=0;l<6;l++){
-             sigmaFullVsCurrentPrior[l] =  sigmaFullPrior[l][parameterNumber];
-         }
-
-         if( (sigmaCurrentPosterior >0.0) & (sigmaCurrentPrior*0.999 > sigmaCurrentPosterior) ){ // compute only when the posteriorvariance has been reduced
-           // This is the computations
-           double sigmaD = sigmaCurrentPrior*(sigmaCurrentPrior/(sigmaCurrentPrior-sigmaCurrentPosterior));
+    // reading from grids
+    layer.readNextMu(muFull);
+    layer.readNextSigma(sigmaFull);
+    for (int c = 0; c < nCells; c++) {
+      muPost[c]    = Epost->getNextComplex();
+      sigmaPost[c] = static_cast<double>(CovPost->getNextComplex().re);
+    }
 
-           fftw_complex d;
-           d.re =  muCurrentPrior.re + static_cast<float>((sigmaD/sigmaCurrentPrior)*(static_cast<double>(muCurrentPosterior.re -  muCurrentPrior.re)));
-           d.im =  muCurrentPrior.im + static_cast<float>((sigmaD/sigmaCurrentPrior)*(static_cast<double>(muCurrentPosterior.im -  muCurrentPrior.im)));
+#pragma omp parallel for
+    for (int c = 0; c < nCells; c++) {
+      PackedState4D::Cell & cell = layer(c);
+
+      // getting Prior for Parameter
+      fftw_complex muCurrentPrior    = cell.mu[parameterNumber];
+      double       sigmaCurrentPrior = static_cast<double>(cell.sigma[PackedState4D::sigmaIndex(parameterNumber, parameterNumber)].re);
+      // getting posterior for Parameter
+      fftw_complex muCurrentPosterior    = muPost[c];
+      double       sigmaCurrentPosterior = sigmaPost[c];
+
+      if( (sigmaCurrentPosterior >0.0) & (sigmaCurrentPrior*0.999 > sigmaCurrentPosterior) ){ // compute only when the posteriorvariance has been reduced
+        // getting correlation between Parameter and others, sigmaFullPrior[l][parameterNumber]
+        fftw_complex sigmaFullVsCurrentPrior[6];
+        for(int l=0;l<6;l++){
+          sigmaFullVsCurrentPrior[l] = cell.sigma[PackedState4D::sigmaIndex(l, parameterNumber)];
+          if (l > parameterNumber)
+            sigmaFullVsCurrentPrior[l].im = -sigmaFullVsCurrentPrior[l].im;
+        }
 
-           for(int l=0;l<6;l++)
-           {
-              muFullPosterior[l].re =  muFullPrior[l].re + static_cast<float>(static_cast<double>(sigmaFullVsCurrentPrior[l].re*(d.re-muCurrentPrior.re))/sigmaD);
-              muFullPosterior[l].re+=                    - static_cast<float>(static_cast<double>(sigmaFullVsCurrentPrior[l].im*(d.im-muCurrentPrior.im))/sigmaD);
+        // This is the computations
+        double sigmaD = sigmaCurrentPrior*(sigmaCurrentPrior/(sigmaCurrentPrior-sigmaCurrentPosterior));
 
-              muFullPosterior[l].im = muFullPrior[l].im + static_cast<float>(static_cast<double>(sigmaFullVsCurrentPrior[l].re*(d.im-muCurrentPrior.im))/sigmaD);
-              muFullPosterior[l].im +=                    static_cast<float>(static_cast<double>(sigmaFullVsCurrentPrior[l].im*(d.re-muCurrentPrior.re))/sigmaD);
-           }
+        fftw_complex d;
+        d.re =  muCurrentPrior.re + static_cast<float>((sigmaD/sigmaCurrentPrior)*(static_cast<double>(muCurrentPosterior.re -  muCurrentPrior.re)));
+        d.im =  muCurrentPrior.im + static_cast<float>((sigmaD/sigmaCurrentPrior)*(static_cast<double>(muCurrentPosterior.im -  muCurrentPrior.im)));
 
-           for(int l=0;l<6;l++)
-             for(int m=0;m<6;m++)
-             {
-                sigmaFullPosterior[l][m].re = sigmaFullPrior[l][m].re - static_cast<float>(static_cast<double>(( sigmaFullVsCurrentPrior[l].re*sigmaFullVsCurrentPrior[m].re+sigmaFullVsCurrentPrior[l].im*sigmaFullVsCurrentPrior[m].im))/sigmaD);
-                sigmaFullPosterior[l][m].im = sigmaFullPrior[l][m].im - static_cast<float>(static_cast<double>((-sigmaFullVsCurrentPrior[l].re*sigmaFullVsCurrentPrior[m].im+sigmaFullVsCurrentPrior[l].im*sigmaFullVsCurrentPrior[m].re))/sigmaD);
-             }
-         }else
-         {
-           lib_matrCopyCpx(sigmaFullPrior, 6, 6, sigmaFullPosterior);
+        for(int l=0;l<6;l++)
+        {
+          fftw_complex muFullPrior = cell.mu[l];
+          cell.mu[l].re =  muFullPrior.re + static_cast<float>(static_cast<double>(sigmaFullVsCurrentPrior[l].re*(d.re-muCurrentPrior.re))/sigmaD);
+          cell.mu[l].re+=                 - static_cast<float>(static_cast<double>(sigmaFullVsCurrentPrior[l].im*(d.im-muCurrentPrior.im))/sigmaD);
 
-           for(int l=0;l<6;l++)
-              muFullPosterior[l]= muFullPrior[l];
-         }
+          cell.mu[l].im = muFullPrior.im + static_cast<float>(static_cast<double>(sigmaFullVsCurrentPrior[l].re*(d.im-muCurrentPrior.im))/sigmaD);
+          cell.mu[l].im +=                 static_cast<float>(static_cast<double>(sigmaFullVsCurrentPrior[l].im*(d.re-muCurrentPrior.re))/sigmaD);
+        }
 
-        // writing to grids
-         sigma_static_static_[0]->setNextComplex(  sigmaFullPosterior[0][0]);
-         sigma_static_static_[1]->setNextComplex(  sigmaFullPosterior[0][1]);
-         sigma_static_static_[2]->setNextComplex(  sigmaFullPosterior[0][2]);
-         sigma_static_dynamic_[0]->setNextComplex( sigmaFullPosterior[0][3]);
-         sigma_static_dynamic_[1]->setNextComplex( sigmaFullPosterior[0][4]);
-         sigma_static_dynamic_[2]->setNextComplex( sigmaFullPosterior[0][5]);
-         sigma_static_static_[3]->setNextComplex(  sigmaFullPosterior[1][1]);
-         sigma_static_static_[4]->setNextComplex(  sigmaFullPosterior[1][2]);
-         sigma_static_dynamic_[3]->setNextComplex( sigmaFullPosterior[1][3]);
-         sigma_static_dynamic_[4]->setNextComplex( sigmaFullPosterior[1][4]);
-         sigma_static_dynamic_[5]->setNextComplex( sigmaFullPosterior[1][5]);
-         sigma_static_static_[5]->setNextComplex(  sigmaFullPosterior[2][2]);
-         sigma_static_dynamic_[6]->setNextComplex( sigmaFullPosterior[2][3]);
-         sigma_static_dynamic_[7]->setNextComplex( sigmaFullPosterior[2][4]);
-         sigma_static_dynamic_[8]->setNextComplex( sigmaFullPosterior[2][5]);
-         sigma_dynamic_dynamic_[0]->setNextComplex(sigmaFullPosterior[3][3]);
-         sigma_dynamic_dynamic_[1]->setNextComplex(sigmaFullPosterior[3][4]);
-         sigma_dynamic_dynamic_[2]->setNextComplex(sigmaFullPosterior[3][5]);
-         sigma_dynamic_dynamic_[3]->setNextComplex(sigmaFullPosterior[4][4]);
-         sigma_dynamic_dynamic_[4]->setNextComplex(sigmaFullPosterior[4][5]);
-         sigma_dynamic_dynamic_[5]->setNextComplex(sigmaFullPosterior[5][5]);
-
-         mu_static_[0]->setNextComplex( muFullPosterior[0]);
-         mu_static_[1]->setNextComplex( muFullPosterior[1]);
-         mu_static_[2]->setNextComplex( muFullPosterior[2]);
-         mu_dynamic_[0]->setNextComplex(muFullPosterior[3]);
-         mu_dynamic_[1]->setNextComplex(muFullPosterior[4]);
-         mu_dynamic_[2]->setNextComplex(muFullPosterior[5]);
+        // The update is Hermitian, so only the upper triangle is computed.
+        int counter = 0;
+        for(int l=0;l<6;l++)
+          for(int m=l;m<6;m++)
+          {
+            cell.sigma[counter].re -= static_cast<float>(static_cast<double>(( sigmaFullVsCurrentPrior[l].re*sigmaFullVsCurrentPrior[m].re+sigmaFullVsCurrentPrior[l].im*sigmaFullVsCurrentPrior[m].im))/sigmaD);
+            cell.sigma[counter].im -= static_cast<float>(static_cast<double>((-sigmaFullVsCurrentPrior[l].re*sigmaFullVsCurrentPrior[m].im+sigmaFullVsCurrentPrior[l].im*sigmaFullVsCurrentPrior[m].re))/sigmaD);
+            counter++;
+          }
       }
     }
+
+    // writing to grids
+    layer.writeNextMu(muFull);
+    layer.writeNextSigma(sigmaFull);
   }
 
   Epost->endAccess();
   CovPost->endAccess();
 
-  for(int i = 0; i<3; i++)
-  {
-    mu_static_[i]->endAccess();
-    mu_dynamic_[i]->endAccess();
-  }
   for(int i = 0; i<6; i++)
-  {
-    sigma_static_static_[i]->endAccess();
-    sigma_dynamic_dynamic_[i]->endAccess();
-  }
-
-  for(int i = 0; i<9; i++)
-    sigma_static_dynamic_[i]->endAccess();
-
-
-  for(int i=0;i<6;i++)
-  {
-    delete [] sigmaFullPrior[i];
-    delete [] sigmaFullPosterior[i];
-  }
-
-  delete [] muFullPrior;
-  delete [] muFullPosterior;
-
-  delete [] sigmaFullPrior;
-  delete [] sigmaFullPosterior;
-  delete [] sigmaFullVsCurrentPrior;
-
+    muFull[i]->endAccess();
+  for(int i = 0; i<21; i++)
+    sigmaFull[i]->endAccess();
 }
 
 
@@ -777,44 +602,21 @@ void State4D::evolve(int                   time_step,
   const NRLib::Vector mean_correction_term = timeEvolution.getMeanCorrectionTerm(time_step);
   const NRLib::Matrix cov_correction_term  = timeEvolution.getCovarianceCorrectionTerm(time_step);
 
-   // Holders of FFTGrid pointers
-  std::vector<FFTGrid *> mu(6);
-
-  std::vector<FFTGrid *> sigma(21);
-  // Check the order of the grids here:
-  // The order is used later in set-up of symmetric sigma matrix
-
-
-  mu[0] = getMuVpStatic(); //mu_static_Alpha
-  mu[1] = getMuVsStatic(); //mu_static_Beta
-  mu[2] = getMuRhoStatic(); //mu_static_Rho
-  mu[3] = getMuVpDynamic(); //mu_dynamic_Alpha
-  mu[4] = getMuVsDynamic(); //mu_dynamic_Beta
-  mu[5] = getMuRhoDynamic(); //mu_dynamic_Rho
-
-  // Note the order of the grids here: The order is used other places in code.
-  sigma[0]  = getCovVpVpStaticStatic(); //cov_ss_AlphaStatic AlphaStatic
-  sigma[1]  = getCovVpVsStaticStatic();  //cov_ss_AlphaStaticBetaStatic
-  sigma[2]  = getCovVpRhoStaticStatic();  //cov_ss_AlphaStaticRhoStatic
-  sigma[3]  = getCovVsVsStaticStatic(); //cov_ss_BetaStaticBetaStatic
-  sigma[4]  = getCovVsRhoStaticStatic(); //cov_ss_BetaStaticRhoStatic
-  sigma[5]  = getCovRhoRhoStaticStatic(); //cov_ss_RhoStaticRhoStatic
-  sigma[6]  = getCovVpVpDynamicDynamic(); //cov_dd_AlphaDynamicAlphaDynamic
-  sigma[7]  = getCovVpVsDynamicDynamic(); //cov_dd_AlphaDynamicBetaDynamic
-  sigma[8]  = getCovVpRhoDynamicDynamic(); //cov_dd_AlphaDynamicRhoDynamic
-  sigma[9]  = getCovVsVsDynamicDynamic(); //cov_dd_BetaDynamicBetaDynamic
-  sigma[10] = getCovVsRhoDynamicDynamic(); //cov_dd_BetaDynamicRhoDynamic
-  sigma[11] = getCovRhoRhoDynamicDynamic(); //cov_dd_RhoDynamicRhoDynamic
-
-  sigma[12] = getCovVpVpStaticDynamic(); //cov_sd_AlphaStaticAlphaDynamic
-  sigma[13] = getCovVpVsStaticDynamic();  //cov_sd_AlphaStaticBetaDynamic
-  sigma[14] = getCovVpRhoStaticDynamic(); //cov_sd_AlphaStaticRhoDynamic
-  sigma[15] = getCovVsVpStaticDynamic();  //cov_sd_BetaStaticAlphaDynamic
-  sigma[16] = getCovVsVsStaticDynamic();  //cov_sd_BetaStaticBetaDynamic
-  sigma[17] = getCovVsRhoStaticDynamic(); //cov_sd_BetaStaticRhoDynamic
-  sigma[18] = getCovRhoVpStaticDynamic(); //cov_sd_RhoStaticAlphaDynamic
-  sigma[19] = getCovRhoVsStaticDynamic(); //cov_sd_RhoStaticBetaDynamic
-  sigma[20] = getCovRhoRhoStaticDynamic();  //cov_sd_RhoStaticRhoDynamic
+  double A[36];
+  double b[6];
+  double C[36];
+  for (int d1 = 0; d1 < 6; d1++) {
+    b[d1] = mean_correction_term(d1);
+    for (int d2 = 0; d2 < 6; d2++) {
+      A[6*d1 + d2] = evolution_matrix(d1, d2);
+      C[6*d1 + d2] = cov_correction_term(d1, d2);
+    }
+  }
+
+  // Holders of FFTGrid pointers, in the order of the packed state
+  std::vector<FFTGrid *> mu;
+  std::vector<FFTGrid *> sigma;
+  getPackedGrids(mu, sigma);
 
   // We assume FFT transformed grids
   for(int i = 0; i<6; i++)
@@ -828,19 +630,6 @@ void State4D::evolve(int                   time_step,
     sigma[i]->setAccessMode(FFTGrid::READANDWRITE);
   }
 
-  NRLib::Vector mu_real(6);
-  NRLib::Vector mu_imag(6);
-  NRLib::Vector mu_real_next(6);
-  NRLib::Vector mu_imag_next(6);
-
-  NRLib::Matrix sigma_real(6,6);
-  NRLib::Matrix sigma_imag(6,6);
-  NRLib::Matrix sigma_real_next(6,6);
-  NRLib::Matrix sigma_imag_next(6,6);
-  NRLib::Matrix tmp(6,6);
-
-  fftw_complex get_value,return_value;
-
   int nz   = mu[0]->getNz();
   int ny   = mu[0]->getNy();
   int nx   = mu[0]->getNx();
@@ -866,114 +655,88 @@ void State4D::evolve(int                   time_step,
 
    timeIncSpatialCorr.fftInPlace();
    timeIncSpatialCorr.setAccessMode(FFTGrid::READ);
-  // Iterate through all points in the grid and perform forward transition in time
-  for (int k = 0; k < nzp; k++) {
-    for (int j = 0; j < nyp; j++) {
-      for (int i = 0; i < cnxp; i++) {
-
-        fftw_complex ijkLambda = timeIncSpatialCorr.getNextComplex();
-        float realTocomplexScaleFactor =  (i==0 && j==0 && k==0 )? float(std::sqrt(double(nxp*nyp*nzp))): 0.0f;  // note add a constant in real domain is
-                                                                                                                 // just a value on the 0,0,0 in fft domain
-                                                                                                                 // is for the mean what  ijkLambda is for the covariance
-
-        // Set up vectors from the FFT grids
-        for (int d = 0; d < 6; d++) {
-          get_value  = mu[d]->getNextComplex();
-          mu_real(d) = get_value.re;
-          mu_imag(d) = get_value.im;
-        }
 
-        // Evolve values
-        mu_real_next = evolution_matrix*mu_real + mean_correction_term* realTocomplexScaleFactor; // last term is only for (0,0,0 ) coefficient see above
-        mu_imag_next = evolution_matrix*mu_imag;
+  PackedState4D layer(cnxp*nyp);
+  const int nCells = layer.getNCells();
 
-        // Update values in the FFT-grids
-        for (int d = 0; d < 6; d++) {
-          return_value.re = static_cast<float>(mu_real_next(d));
-          return_value.im = static_cast<float>(mu_imag_next(d));
-          mu[d]->setNextComplex(return_value);
-        }
-        // Set up matrices from the FFT-grids.
-        // Note: Here we assume a specific order of the elements in the sigma-vector.
-        // Static and dynamic parts.
-        int counter = 0;
-        for (int d1 = 0; d1 < 3; d1++) {
-          for (int d2 = d1; d2 < 3; d2++) {
-            get_value  = sigma[counter]->getNextComplex();
-            sigma_real(d1, d2) = get_value.re;
-            sigma_imag(d1, d2) = get_value.im;
-            get_value  = sigma[counter+6]->getNextComplex();
-            sigma_real(d1+3, d2+3) = get_value.re;  // d1+3 and d2+3 due to block structure of matrix
-            sigma_imag(d1+3, d2+3) = get_value.im;
+  std::vector<double> lambda(nCells);
 
-            counter++;
-
-            //Enforcing symmetry of overall matrix.
-            // (Hermitian symmetry Hence  - for imaginary part)
-            if (d1 != d2) {
-              sigma_real(d2, d1) = sigma_real(d1, d2);
-              sigma_imag(d2 ,d1) = -sigma_imag(d1, d2);
-
-              sigma_real(d2+3, d1+3) = sigma_real(d1+3, d2+3);
-              sigma_imag(d2+3 ,d1+3) = -sigma_imag(d1+3, d2+3);
-            }
-          }
-        }
-        // Static-dynamic covariance.
-        counter = 12;
-        for (int d1 = 0; d1 < 3; d1++) {
-          for (int d2 = 3; d2 < 6; d2++) {
-            get_value=sigma[counter]->getNextComplex();
-            sigma_real(d1, d2) = get_value.re;
-            sigma_imag(d1, d2) = get_value.im;
-            counter++;
-
-            //Enforcing symmetry of overall matrix. (Hermitian symmetry Hence  - for imaginary part)
-            sigma_real(d2, d1) = sigma_real(d1, d2);
-            sigma_imag(d2 ,d1) = -sigma_imag(d1, d2);
-          }
-        }
-        // Evolve values.
-        tmp = (evolution_matrix*sigma_real);
-        sigma_real_next = tmp*transpose(evolution_matrix) + cov_correction_term *ijkLambda.re;
-
-        tmp = evolution_matrix*sigma_imag;
-        sigma_imag_next = tmp*transpose(evolution_matrix);
-
-        counter = 0;
-        for (int d1 = 0; d1 < 3; d1++) {// Update values in the FFT-grids.
-          for (int d2 = d1; d2 < 3; d2++) {// Static and dynamic parts.
-            return_value.re = static_cast<float>(sigma_real_next(d1, d2));
-            return_value.im = static_cast<float>(sigma_imag_next(d1, d2));
-            sigma[counter]->setNextComplex(return_value);
-
-            return_value.re = static_cast<float>(sigma_real_next(d1+3, d2+3));  //d1+3 and d2+3 due to block structure of matrix
-            return_value.im = static_cast<float>(sigma_imag_next(d1+3, d2+3));
-            sigma[counter+6]->setNextComplex(return_value);
-
-            counter++;
-          }
-        }
-        // Static-dynamic covariance.
-        counter = 12;
-        for (int d1 = 0; d1 < 3; d1++) {
-          for (int d2 = 3; d2 < 6; d2++) {
-            return_value.re = static_cast<float>(sigma_real_next(d1, d2));
-            return_value.im = static_cast<float>(sigma_imag_next(d1, d2));
-            sigma[counter]->setNextComplex(return_value);
-            counter++;
-          }
-        }
-      }
+  // Iterate through all layers in the grid and perform forward transition in time
+  for (int k = 0; k < nzp; k++) {
+    layer.readNextMu(mu);
+    layer.readNextSigma(sigma);
+    for (int c = 0; c < nCells; c++)
+      lambda[c] = timeIncSpatialCorr.getNextComplex().re;
+
+    // Adding a constant in the real domain is just a value in the (0,0,0) coefficient in the fft domain.
+    // For the mean this corresponds to what lambda is for the covariance.
+    const float realTocomplexScaleFactor = float(std::sqrt(double(nxp*nyp*nzp)));
+
+#pragma omp parallel for
+    for (int c = 0; c < nCells; c++) {
+      const double meanScale = (k == 0 && c == 0) ? realTocomplexScaleFactor : 0.0;
+      PackedState4D::evolve(layer(c), A, b, C, meanScale, lambda[c]);
     }
+
+    layer.writeNextMu(mu);
+    layer.writeNextSigma(sigma);
   }
 
+  timeIncSpatialCorr.endAccess();
+
   for(int i = 0; i<6; i++)
     mu[i]->endAccess();
   for(int i = 0; i<21; i++)
     sigma[i]->endAccess();
 }
 
+void
+State4D::getPackedGrids(std::vector<FFTGrid *> & mu,
+                        std::vector<FFTGrid *> & sigma) const
+{
+  // The means and the upper triangle of the full 6x6 covariance, row by row,
+  // with parameters ordered as (static vp, vs, rho, dynamic vp, vs, rho).
+  mu.resize(6);
+  for (int i = 0; i < 3; i++) {
+    mu[i]   = mu_static_[i];
+    mu[i+3] = mu_dynamic_[i];
+  }
+
+  sigma.resize(21);
+  sigma[0]  = sigma_static_static_[0];
+  sigma[1]  = sigma_static_static_[1];
+  sigma[2]  = sigma_static_static_[2];
+  sigma[3]  = sigma_static_dynamic_[0];
+  sigma[4]  = sigma_static_dynamic_[1];
+  sigma[5]  = sigma_static_dynamic_[2];
+  sigma[6]  = sigma_static_static_[3];
+  sigma[7]  = sigma_static_static_[4];
+  sigma[8]  = sigma_static_dynamic_[3];
+  sigma[9]  = sigma_static_dynamic_[4];
+  sigma[10] = sigma_static_dynamic_[5];
+  sigma[11] = sigma_static_static_[5];
+  sigma[12] = sigma_static_dynamic_[6];
+  sigma[13] = sigma_static_dynamic_[7];
+  sigma[14] = sigma_static_dynamic_[8];
+  sigma[15] = sigma_dynamic_dynamic_[0];
+  sigma[16] = sigma_dynamic_dynamic_[1];
+  sigma[17] = sigma_dynamic_dynamic_[2];
+  sigma[18] = sigma_dynamic_dynamic_[3];
+  sigma[19] = sigma_dynamic_dynamic_[4];
+  sigma[20] = sigma_dynamic_dynamic_[5];
+}
+
+void
+State4D::getAllGrids(std::vector<FFTGrid *> & grids) const
+{
+  grids.clear();
+  grids.insert(grids.end(), mu_static_.begin(),             mu_static_.end());
+  grids.insert(grids.end(), mu_dynamic_.begin(),            mu_dynamic_.end());
+  grids.insert(grids.end(), sigma_static_static_.begin(),   sigma_static_static_.end());
+  grids.insert(grids.end(), sigma_dynamic_dynamic_.begin(), sigma_dynamic_dynamic_.end());
+  grids.insert(grids.end(), sigma_static_dynamic_.begin(),  sigma_static_dynamic_.end());
+}
+
 bool
 State4D::allGridsAreTransformed()
 {
@@ -91,6 +91,9 @@ public:
   FFTGrid * getCovRhoVsStaticDynamic(void) const { return sigma_static_dynamic_[7]; }
   FFTGrid * getCovRhoRhoStaticDynamic(void)const { return sigma_static_dynamic_[8]; }
 
+  // All 27 grids, in the order mu_static, mu_dynamic, sigma_static_static, sigma_dynamic_dynamic, sigma_static_dynamic.
+  void      getAllGrids(std::vector<FFTGrid *> & grids) const;
+
 
   void      FFT();
   void      iFFT();
@@ -99,6 +102,7 @@ public:
 
 private:
   bool allGridsAreTransformed();
+  void getPackedGrids(std::vector<FFTGrid *> & mu, std::vector<FFTGrid *> & sigma) const;
   std::vector<FFTGrid *> mu_static_;            // [0] = vp, [1] = vs, [2] = rho
   std::vector<FFTGrid *> mu_dynamic_;           // [0] = vp, [1] = vs, [2] = rho
   std::vector<FFTGrid *> sigma_static_static_;  // [0] = vp_vp, [1] = vp_vs, [2] = vp_rho ,[3] = vs_vs, [4] = vs_rho, [5] = rho_rho (all static)
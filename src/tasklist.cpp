@@ -12,6 +12,13 @@
 
 std::vector<std::string> TaskList::task_(0);
 
+void TaskList::addTask(std::string task)
+{
+  // Tasks may be added by threads reading grids concurrently.
+#pragma omp critical(TaskList)
+  task_.push_back(task);
+}
+
 void TaskList::viewAllTasks(bool useFile)
 {
   size_t i;
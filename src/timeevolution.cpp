@@ -3,6 +3,7 @@
 #include <float.h>
 
 #include "nrlib/statistics/statistics.hpp"
+#include "nrlib/iotools/fileio.hpp"
 
 #include "src/seismicparametersholder.h"
 #include "src/state4d.h"
@@ -731,3 +732,74 @@ TimeEvolution::makeCovRobust(NRLib::Vector  mu, NRLib::Matrix sigma, std::vector
 
   return AdjustedSigmaFull;
 }
+
+
+void TimeEvolution::WriteBinary(std::ostream & stream) const
+{
+  NRLib::WriteBinaryInt(stream, number_of_timesteps_);
+  WriteBinaryVector(stream, initial_mean_);
+  WriteBinaryMatrix(stream, initial_cov_);
+
+  NRLib::WriteBinaryInt(stream, static_cast<int>(evolution_matrix_.size()));
+  for(size_t i=0;i<evolution_matrix_.size();i++){
+    WriteBinaryMatrix(stream, evolution_matrix_[i]);
+    WriteBinaryVector(stream, mean_correction_term_[i]);
+    WriteBinaryMatrix(stream, cov_correction_term_[i]);
+  }
+}
+
+
+void TimeEvolution::ReadBinary(std::istream & stream)
+{
+  number_of_timesteps_ = NRLib::ReadBinaryInt(stream);
+  ReadBinaryVector(stream, initial_mean_);
+  ReadBinaryMatrix(stream, initial_cov_);
+
+  int n = NRLib::ReadBinaryInt(stream);
+  evolution_matrix_.resize(n);
+  mean_correction_term_.resize(n);
+  cov_correction_term_.resize(n);
+  for(int i=0;i<n;i++){
+    ReadBinaryMatrix(stream, evolution_matrix_[i]);
+    ReadBinaryVector(stream, mean_correction_term_[i]);
+    ReadBinaryMatrix(stream, cov_correction_term_[i]);
+  }
+}
+
+
+void TimeEvolution::WriteBinaryMatrix(std::ostream & stream, const NRLib::Matrix & A)
+{
+  NRLib::WriteBinaryInt(stream, A.numRows());
+  NRLib::WriteBinaryInt(stream, A.numCols());
+  for(int i=0;i<A.numRows();i++)
+    for(int j=0;j<A.numCols();j++)
+      NRLib::WriteBinaryDouble(stream, A(i,j));
+}
+
+
+void TimeEvolution::WriteBinaryVector(std::ostream & stream, const NRLib::Vector & v)
+{
+  NRLib::WriteBinaryInt(stream, v.length());
+  for(int i=0;i<v.length();i++)
+    NRLib::WriteBinaryDouble(stream, v(i));
+}
+
+
+void TimeEvolution::ReadBinaryMatrix(std::istream & stream, NRLib::Matrix & A)
+{
+  int nRows = NRLib::ReadBinaryInt(stream);
+  int nCols = NRLib::ReadBinaryInt(stream);
+  A.resize(nRows, nCols);
+  for(int i=0;i<nRows;i++)
+    for(int j=0;j<nCols;j++)
+      A(i,j) = NRLib::ReadBinaryDouble(stream);
+}
+
+
+void TimeEvolution::ReadBinaryVector(std::istream & stream, NRLib::Vector & v)
+{
+  int n = NRLib::ReadBinaryInt(stream);
+  v.resize(n);
+  for(int i=0;i<n;i++)
+    v(i) = NRLib::ReadBinaryDouble(stream);
+}
@@ -4,6 +4,7 @@
 #include <vector>
 #include <nrlib/flens/nrlib_flens.hpp>
 #include <string>
+#include <iosfwd>
 
 class SeismicParametersHolder;
 class State4D;
@@ -33,6 +34,10 @@ public:
   void SetInitialCov(NRLib::Matrix initialCov){initial_cov_=initialCov;}
   int  GetNTimSteps(){return number_of_timesteps_;}
 
+  // Binary storage of the set up matrices, used by the time lapse checkpoints.
+  void WriteBinary(std::ostream & stream) const;
+  void ReadBinary(std::istream & stream);
+
 private:
   int number_of_timesteps_;
 
@@ -88,6 +93,11 @@ private:
   void AdjustMatrixDeltaForm(NRLib::Matrix & delta_k, int dim);
 
   void PrintToScreen(NRLib::Matrix, int dim1, int dim2, std::string name);
+
+  static void WriteBinaryMatrix(std::ostream & stream, const NRLib::Matrix & A);
+  static void WriteBinaryVector(std::ostream & stream, const NRLib::Vector & v);
+  static void ReadBinaryMatrix(std::istream & stream, NRLib::Matrix & A);
+  static void ReadBinaryVector(std::istream & stream, NRLib::Vector & v);
   void PrintToScreen(NRLib::Vector, int dim, std::string name);
 };
 
@@ -0,0 +1,276 @@
+#include <stdio.h>
+#include <fstream>
+
+#include "nrlib/iotools/fileio.hpp"
+#include "nrlib/iotools/stringtools.hpp"
+#include "nrlib/exception/exception.hpp"
+
+#include "src/timelapsecheckpoint.h"
+#include "src/modelgeneral.h"
+#include "src/modelsettings.h"
+#include "src/seismicparametersholder.h"
+#include "src/state4d.h"
+#include "src/fftgrid.h"
+#include "src/simbox.h"
+#include "src/io.h"
+
+TimeLapseCheckpoint::TimeLapseCheckpoint(const ModelGeneral      * modelGeneral,
+                                         SeismicParametersHolder & seismicParameters,
+                                         int                       nEventsDone,
+                                         int                       vintage)
+  : nEventsDone_(nEventsDone),
+    vintage_(vintage)
+{
+  const Simbox * simbox = modelGeneral->getTimeSimbox();
+  nx_   = simbox->getnx();
+  ny_   = simbox->getny();
+  nz_   = simbox->getnz();
+  top_  = dynamic_cast<const Surface &>(simbox->GetTopSurface());
+  base_ = dynamic_cast<const Surface &>(simbox->GetBotSurface());
+
+  timeEvolution_ = modelGeneral->getTimeEvolution();
+  priorVar0_     = seismicParameters.getPriorVar0();
+
+  std::vector<FFTGrid *> grids;
+  getGrids(modelGeneral, seismicParameters, grids);
+
+  rnxp_ = grids[0]->getRNxp();
+  nyp_  = grids[0]->getNyp();
+  nzp_  = grids[0]->getNzp();
+
+  const int nGrids = static_cast<int>(grids.size());
+  transformed_.resize(nGrids);
+  values_.resize(nGrids);
+
+  // File grids are read through their cursors, which share the file buffers.
+  bool parallel = true;
+  for (int i = 0; i < nGrids; i++) {
+    if (grids[i]->isFile())
+      parallel = false;
+  }
+
+#pragma omp parallel for schedule(dynamic) if(parallel)
+  for (int i = 0; i < nGrids; i++)
+    copyFromGrid(grids[i], transformed_[i], values_[i]);
+}
+
+TimeLapseCheckpoint::~TimeLapseCheckpoint()
+{
+}
+
+void
+TimeLapseCheckpoint::writeFile(std::string & errTxt) const
+{
+  // Write to a temporary file first, so that the previous checkpoint of
+  // the vintage is kept if the run stops while writing.
+  std::string fileName = makeFileName(vintage_);
+  std::string tmpName  = fileName + ".tmp";
+
+  try {
+    std::ofstream binFile;
+    NRLib::OpenWrite(binFile, tmpName, std::ios::out | std::ios::binary);
+
+    std::string fileType = "crava_time_lapse_checkpoint_binary";
+    binFile << fileType << "\n";
+
+    NRLib::WriteBinaryInt(binFile, nEventsDone_);
+    NRLib::WriteBinaryInt(binFile, vintage_);
+
+    NRLib::WriteBinaryInt(binFile, nx_);
+    NRLib::WriteBinaryInt(binFile, ny_);
+    NRLib::WriteBinaryInt(binFile, nz_);
+    IO::writeSurfaceBinary(binFile, top_);
+    IO::writeSurfaceBinary(binFile, base_);
+
+    timeEvolution_.WriteBinary(binFile);
+    for (int i = 0; i < 3; i++) {
+      for (int j = 0; j < 3; j++)
+        NRLib::WriteBinaryDouble(binFile, priorVar0_(i,j));
+    }
+
+    NRLib::WriteBinaryInt(binFile, static_cast<int>(values_.size()));
+    NRLib::WriteBinaryInt(binFile, rnxp_);
+    NRLib::WriteBinaryInt(binFile, nyp_);
+    NRLib::WriteBinaryInt(binFile, nzp_);
+    for (size_t i = 0; i < values_.size(); i++) {
+      NRLib::WriteBinaryInt(binFile, transformed_[i]);
+      NRLib::WriteBinaryFloatArray(binFile, values_[i].begin(), values_[i].end());
+    }
+
+    binFile.close();
+
+    remove(fileName.c_str());
+    if (rename(tmpName.c_str(), fileName.c_str()) != 0)
+      throw NRLib::IOError("Could not rename '" + tmpName + "' to '" + fileName + "'.");
+  }
+  catch (NRLib::Exception & e) {
+    errTxt += "Error: " + std::string(e.what()) + "\n";
+  }
+}
+
+void
+TimeLapseCheckpoint::readFile(int                       vintage,
+                              ModelGeneral            * modelGeneral,
+                              SeismicParametersHolder & seismicParameters,
+                              const ModelSettings     * modelSettings,
+                              int                     & nEventsDone,
+                              std::string             & errTxt)
+{
+  std::string fileName = makeFileName(vintage);
+  std::string error;
+
+  try {
+    std::ifstream binFile;
+    NRLib::OpenRead(binFile, fileName, std::ios::in | std::ios::binary);
+
+    std::string fileType;
+    getline(binFile, fileType);
+    if (fileType != "crava_time_lapse_checkpoint_binary")
+      throw NRLib::Exception("File '" + fileName + "' is not a time lapse checkpoint.");
+
+    nEventsDone = NRLib::ReadBinaryInt(binFile);
+    if (NRLib::ReadBinaryInt(binFile) != vintage)
+      throw NRLib::Exception("File '" + fileName + "' holds the checkpoint of another vintage.");
+
+    const Simbox * simbox = modelGeneral->getTimeSimbox();
+    int nx = NRLib::ReadBinaryInt(binFile);
+    int ny = NRLib::ReadBinaryInt(binFile);
+    int nz = NRLib::ReadBinaryInt(binFile);
+    if (nx != simbox->getnx() || ny != simbox->getny() || nz != simbox->getnz())
+      throw NRLib::Exception("The time simbox of checkpoint '" + fileName + "' does not match the current model.");
+
+    Surface top;
+    Surface base;
+    IO::readSurfaceBinary(binFile, top);
+    IO::readSurfaceBinary(binFile, base);
+
+    TimeEvolution timeEvolution;
+    timeEvolution.ReadBinary(binFile);
+
+    NRLib::Matrix priorVar0(3,3);
+    for (int i = 0; i < 3; i++) {
+      for (int j = 0; j < 3; j++)
+        priorVar0(i,j) = NRLib::ReadBinaryDouble(binFile);
+    }
+
+    std::vector<FFTGrid *> grids;
+    getGrids(modelGeneral, seismicParameters, grids);
+
+    int nGrids = NRLib::ReadBinaryInt(binFile);
+    int rnxp   = NRLib::ReadBinaryInt(binFile);
+    int nyp    = NRLib::ReadBinaryInt(binFile);
+    int nzp    = NRLib::ReadBinaryInt(binFile);
+    if (nGrids != static_cast<int>(grids.size()) ||
+        rnxp != grids[0]->getRNxp() || nyp != grids[0]->getNyp() || nzp != grids[0]->getNzp())
+      throw NRLib::Exception("The grids of checkpoint '" + fileName + "' do not match the current model. Check the padding settings.");
+
+    std::vector<float> values(static_cast<size_t>(rnxp)*nyp*nzp);
+    for (int i = 0; i < nGrids; i++) {
+      int transformed = NRLib::ReadBinaryInt(binFile);
+      NRLib::ReadBinaryFloatArray(binFile, values.begin(), values.size());
+      copyToGrid(grids[i], transformed, values);
+    }
+
+    binFile.close();
+
+    Simbox * newSimbox = new Simbox(simbox);
+    newSimbox->setDepth(top, base, nz);
+    newSimbox->calculateDz(modelSettings->getLzLimit(), error);
+    modelGeneral->setTimeSimbox(newSimbox);
+    delete newSimbox;
+
+    modelGeneral->setTimeEvolution(timeEvolution);
+    seismicParameters.setPriorVar0(priorVar0);
+  }
+  catch (NRLib::Exception & e) {
+    error += "Error: " + std::string(e.what()) + "\n";
+  }
+  errTxt += error;
+}
+
+std::string
+TimeLapseCheckpoint::makeFileName(int vintage)
+{
+  std::string baseName = IO::FileTimeLapseCheckpoint() + "_Vintage_" + NRLib::ToString(vintage + 1);
+  return IO::makeFullFileName(IO::PathToCheckpoints(), baseName) + IO::SuffixCrava();
+}
+
+void
+TimeLapseCheckpoint::getGrids(const ModelGeneral      * modelGeneral,
+                              SeismicParametersHolder & seismicParameters,
+                              std::vector<FFTGrid *>  & grids)
+{
+  modelGeneral->getState4D().getAllGrids(grids);
+
+  grids.push_back(seismicParameters.GetMuAlpha());
+  grids.push_back(seismicParameters.GetMuBeta());
+  grids.push_back(seismicParameters.GetMuRho());
+  grids.push_back(seismicParameters.GetCovAlpha());
+  grids.push_back(seismicParameters.GetCovBeta());
+  grids.push_back(seismicParameters.GetCovRho());
+  grids.push_back(seismicParameters.GetCrCovAlphaBeta());
+  grids.push_back(seismicParameters.GetCrCovAlphaRho());
+  grids.push_back(seismicParameters.GetCrCovBetaRho());
+}
+
+void
+TimeLapseCheckpoint::copyFromGrid(FFTGrid            * grid,
+                                  int                & transformed,
+                                  std::vector<float> & values)
+{
+  // Real grids have rnxp*nyp*nzp values, and complex grids have half as many
+  // complex values. Both are stored as rnxp*nyp*nzp floats.
+  const int nyp  = grid->getNyp();
+  const int nzp  = grid->getNzp();
+  const int rnxp = grid->getRNxp();
+  const int cnxp = grid->getCNxp();
+
+  transformed = grid->getIsTransformed() ? 1 : 0;
+  values.resize(static_cast<size_t>(rnxp)*nyp*nzp);
+
+  grid->setAccessMode(FFTGrid::READ);
+  if (transformed == 1) {
+    const int csize = cnxp*nyp*nzp;
+    for (int c = 0; c < csize; c++) {
+      fftw_complex value = grid->getNextComplex();
+      values[2*c]        = value.re;
+      values[2*c + 1]    = value.im;
+    }
+  }
+  else {
+    const int rsize = rnxp*nyp*nzp;
+    for (int r = 0; r < rsize; r++)
+      values[r] = grid->getNextReal();
+  }
+  grid->endAccess();
+}
+
+void
+TimeLapseCheckpoint::copyToGrid(FFTGrid                  * grid,
+                                int                        transformed,
+                                const std::vector<float> & values)
+{
+  const int nyp  = grid->getNyp();
+  const int nzp  = grid->getNzp();
+  const int rnxp = grid->getRNxp();
+  const int cnxp = grid->getCNxp();
+
+  // The same memory is used for real and complex values.
+  grid->setTransformedStatus(transformed == 1);
+  grid->setAccessMode(FFTGrid::WRITE);
+  if (transformed == 1) {
+    const int csize = cnxp*nyp*nzp;
+    for (int c = 0; c < csize; c++) {
+      fftw_complex value;
+      value.re = values[2*c];
+      value.im = values[2*c + 1];
+      grid->setNextComplex(value);
+    }
+  }
+  else {
+    const int rsize = rnxp*nyp*nzp;
+    for (int r = 0; r < rsize; r++)
+      grid->setNextReal(values[r]);
+  }
+  grid->endAccess();
+}
@@ -0,0 +1,82 @@
+#ifndef TIMELAPSECHECKPOINT_H
+#define TIMELAPSECHECKPOINT_H
+
+#include <string>
+#include <vector>
+
+#include "nrlib/flens/nrlib_flens.hpp"
+
+#include "src/definitions.h"
+#include "src/timeevolution.h"
+
+class FFTGrid;
+class ModelGeneral;
+class ModelSettings;
+class SeismicParametersHolder;
+
+// Checkpoint of the time lapse state after an event in the time line, so that a 4D
+// inversion can be resumed from a later vintage. It holds the 27 State4D grids, the time
+// evolution matrices, the nine SeismicParametersHolder grids with their prior variances,
+// and the top and base of the time simbox, which are changed by travel time inversion.
+// The state is copied when the checkpoint is made, so that the file can be written while
+// the next event is processed. The copy is the size of 36 padded grids, and is counted by
+// ModelAVOStatic::checkAvailableMemory().
+class TimeLapseCheckpoint
+{
+public:
+  TimeLapseCheckpoint(const ModelGeneral      * modelGeneral,
+                      SeismicParametersHolder & seismicParameters,
+                      int                       nEventsDone,
+                      int                       vintage);
+
+  ~TimeLapseCheckpoint();
+
+  int                 getVintage()     const { return vintage_     ;}
+  int                 getNEventsDone() const { return nEventsDone_ ;}
+
+  // Errors are returned in errTxt, as this may run in parallel with logging threads.
+  void                writeFile(std::string & errTxt) const;
+
+  // Restores the state written after the last event of the given vintage.
+  static void         readFile(int                       vintage,
+                               ModelGeneral            * modelGeneral,
+                               SeismicParametersHolder & seismicParameters,
+                               const ModelSettings     * modelSettings,
+                               int                     & nEventsDone,
+                               std::string             & errTxt);
+
+  static std::string  makeFileName(int vintage);
+
+private:
+  static void         getGrids(const ModelGeneral      * modelGeneral,
+                               SeismicParametersHolder & seismicParameters,
+                               std::vector<FFTGrid *>  & grids);
+
+  static void         copyFromGrid(FFTGrid            * grid,
+                                   int                & transformed,
+                                   std::vector<float> & values);
+
+  static void         copyToGrid(FFTGrid                  * grid,
+                                 int                        transformed,
+                                 const std::vector<float> & values);
+
+  int                               nEventsDone_;   // Number of events in the time line covered by the checkpoint
+  int                               vintage_;       // Vintage of the last event
+
+  int                               nx_;
+  int                               ny_;
+  int                               nz_;
+  Surface                           top_;
+  Surface                           base_;
+
+  TimeEvolution                     timeEvolution_;
+  NRLib::Matrix                     priorVar0_;
+
+  int                               rnxp_;
+  int                               nyp_;
+  int                               nzp_;
+  std::vector<int>                  transformed_;
+  std::vector<std::vector<float> >  values_;        // Raw grid values, real or interleaved complex
+};
+
+#endif
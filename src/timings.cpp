@@ -164,8 +164,11 @@ void
 Timings::setTimeResamplingSeismic(double& wall, double& cpu)
 {
   TimeKit::getTime(wall,cpu);
-  w_resamplingSeismic_ += wall; // Sum times used to resample each cube
-  c_resamplingSeismic_ += cpu;
+#pragma omp critical(Timings)
+  {
+    w_resamplingSeismic_ += wall; // Sum times used to resample each cube
+    c_resamplingSeismic_ += cpu;
+  }
 }
 
 void
@@ -14,11 +14,16 @@
 #include "src/covgrid2d.h"
 #include "src/definitions.h"
 #include "src/gridmapping.h"
+#include "src/blockcovariance.h"
 
 #include "nrlib/flens/nrlib_flens.hpp"
 
 #include "lib/timekit.hpp"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 
 TravelTimeInversion::TravelTimeInversion(ModelGeneral            * modelGeneral,
                                          ModelTravelTimeStatic   * modelTravelTimeStatic,
@@ -90,8 +95,7 @@ TravelTimeInversion::doHorizonInversion(ModelGeneral            * modelGeneral,
   mu_log_vp_dynamic ->invFFTInPlace();
   cov_log_vp_dynamic->invFFTInPlace();
 
-  std::vector<double>   cov_log_vp   = getCovLogVp(cov_log_vp_dynamic);
-  NRLib::Grid2D<double> Sigma_log_vp = generateSigmaModel(cov_log_vp);
+  std::vector<double> cov_log_vp = getCovLogVp(cov_log_vp_dynamic);
 
   const std::vector<Surface>     initial_horizons      = modelTravelTimeStatic->getInitialHorizons();
   const std::vector<std::string> initial_horizon_names = modelTravelTimeStatic->getInitialHorizonNames();
@@ -126,39 +130,82 @@ TravelTimeInversion::doHorizonInversion(ModelGeneral            * modelGeneral,
 
   int n_traces = 0;
 
-  for (int i = 0; i < nx; ++i) {
-    for (int j = 0; j < ny; ++j) {
-
+  // The 1D inversions are done in parallel for one block of traces at a time. The results
+  // are added to the kriging data and the circulant covariance in trace order afterwards,
+  // so that the result does not depend on the number of threads.
+  int n_threads = 1;
+#ifdef _OPENMP
+  n_threads = omp_get_max_threads();
+#endif
+  std::vector<PosteriorWorkspace> workspace(n_threads);
+
+  int n_xy       = nx * ny;
+  int block_size = std::min(n_xy, 32 * n_threads);
+
+  std::vector<std::vector<double> > mu_block(block_size);
+  std::vector<std::vector<double> > cov_block(block_size);
+  std::vector<std::string>          err_block(block_size);
+
+  mu_log_vp_dynamic->setAccessMode(FFTGrid::RANDOMACCESS);
+
+  for (int first = 0; first < n_xy; first += block_size) {
+    int n_block = std::min(block_size, n_xy - first);
+
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int b = 0; b < n_block; b++) {
+      int thread = 0;
+#ifdef _OPENMP
+      thread = omp_get_thread_num();
+#endif
       std::vector<double>   mu_post;
       NRLib::Grid2D<double> Sigma_post;
 
-      do1DHorizonInversion(mu_log_vp_dynamic,
-                           Sigma_log_vp,
-                           timeSimbox,
-                           sorted_initial_horizons,
-                           push_down_horizons,
-                           standard_deviation,
-                           top_simbox,
-                           base_simbox,
-                           i,
-                           j,
-                           mu_post,
-                           Sigma_post);
-
-
-      if (mu_post.size() > 0) {
-
-        setExpectation(i,
-                       j,
-                       mu_post,
+      err_block[b] = "";
+      try {
+        do1DHorizonInversion(mu_log_vp_dynamic,
+                             cov_log_vp,
+                             timeSimbox,
+                             sorted_initial_horizons,
+                             push_down_horizons,
+                             standard_deviation,
+                             top_simbox,
+                             base_simbox,
+                             (first + b) / ny,
+                             (first + b) % ny,
+                             workspace[thread],
+                             mu_post,
+                             Sigma_post);
+      }
+      catch (NRLib::Exception & e) {
+        err_block[b] = e.what();
+        mu_post.clear();
+      }
+
+      mu_block[b].swap(mu_post);
+      if (mu_block[b].size() > 0)
+        cov_block[b] = makeCirculantCovariance(Sigma_post, n_model);
+    }
+
+    for (int b = 0; b < n_block; b++) {
+      if (err_block[b] != "") {
+        mu_log_vp_dynamic->endAccess();
+        throw NRLib::Exception(err_block[b]);
+      }
+
+      if (mu_block[b].size() > 0) {
+
+        setExpectation((first + b) / ny,
+                       (first + b) % ny,
+                       mu_block[b],
                        mu_log_vp_post);
 
-        addCovariance(Sigma_post, cov_circulant, n_model);
+        for (int k = 0; k < nzp; k++)
+          cov_circulant[k] += cov_block[b][k];
 
         n_traces++;
 
       }
-      if ((i + 1) * (j + 1) + 1 >= static_cast<int>(nextMonitor)) {
+      if (first + b + 1 >= static_cast<int>(nextMonitor)) {
         nextMonitor += monitorSize;
         std::cout << "^";
         fflush(stdout);
@@ -166,6 +213,8 @@ TravelTimeInversion::doHorizonInversion(ModelGeneral            * modelGeneral,
     }
   }
 
+  mu_log_vp_dynamic->endAccess();
+
   for (int i = 0; i < nzp; i++)
     cov_circulant[i] /= n_traces;
 
@@ -387,69 +436,122 @@ TravelTimeInversion::doRMSInversion(ModelGeneral            * modelGeneral,
   std::vector<double>        cov_circulant_model(n_pad_model, 0);
   std::vector<KrigingData2D> mu_log_vp_post_model(n_pad_model);
 
-  for (int i = 0; i < n_rms_traces; i++) {
+  // The 1D inversions are done in parallel for one block of traces at a time. The results
+  // are added to the kriging data and the circulant covariances in trace order afterwards,
+  // so that the result does not depend on the number of threads.
+  int n_threads = 1;
+#ifdef _OPENMP
+  n_threads = omp_get_max_threads();
+#endif
+  std::vector<PosteriorWorkspace> workspace(n_threads);
+
+  int block_size = std::max(1, std::min(n_rms_traces, 32 * n_threads));
+
+  std::vector<std::vector<double> > mu_above_block(block_size);
+  std::vector<std::vector<double> > cov_above_block(block_size);
+  std::vector<std::vector<double> > mu_model_block(block_size);
+  std::vector<std::vector<double> > cov_model_block(block_size);
+  std::vector<std::string>          err_block(block_size);
+
+  mu_log_vp_above->setAccessMode(FFTGrid::RANDOMACCESS);
+  mu_log_vp_grid ->setAccessMode(FFTGrid::RANDOMACCESS);
+
+  for (int first = 0; first < n_rms_traces; first += block_size) {
+    int n_block = std::min(block_size, n_rms_traces - first);
+
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int b = 0; b < n_block; b++) {
+      int thread = 0;
+#ifdef _OPENMP
+      thread = omp_get_thread_num();
+#endif
+      std::vector<double>   mu_post;
+      NRLib::Grid2D<double> Sigma_post;
 
-    std::vector<double>   mu_post;
-    NRLib::Grid2D<double> Sigma_post;
+      err_block[b] = "";
+      try {
+        do1DRMSInversion(mu_vp_base,
+                         Sigma_vp_below,
+                         standard_deviation,
+                         rms_traces[first + b],
+                         mu_log_vp_above,
+                         mu_log_vp_grid,
+                         cov_log_vp_above,
+                         cov_log_vp_model,
+                         simbox_above,
+                         simbox_below,
+                         timeSimbox,
+                         workspace[thread],
+                         mu_post,
+                         Sigma_post);
+      }
+      catch (NRLib::Exception & e) {
+        err_block[b] = e.what();
+        continue;
+      }
 
-    do1DRMSInversion(mu_vp_base,
-                     Sigma_vp_below,
-                     standard_deviation,
-                     rms_traces[i],
-                     mu_log_vp_above,
-                     mu_log_vp_grid,
-                     cov_log_vp_above,
-                     cov_log_vp_model,
-                     simbox_above,
-                     simbox_below,
-                     timeSimbox,
-                     mu_post,
-                     Sigma_post);
-
-    if (this_time_lapse == 0) {
-
-      std::vector<double> mu_above(n_pad_above);
-      for (int j = 0; j < n_pad_above; j++)
-        mu_above[j] = mu_post[j];
-
-      NRLib::Grid2D<double> cov_above(n_pad_above, n_pad_above);
-      for (int j = 0; j < n_pad_above; j++) {
-        for (int k = 0; k < n_pad_above; k++)
-          cov_above(j, k) = Sigma_post(j, k);
+      if (this_time_lapse == 0) {
+
+        mu_above_block[b].assign(mu_post.begin(), mu_post.begin() + n_pad_above);
+
+        NRLib::Grid2D<double> cov_above(n_pad_above, n_pad_above);
+        for (int j = 0; j < n_pad_above; j++) {
+          for (int k = 0; k < n_pad_above; k++)
+            cov_above(j, k) = Sigma_post(j, k);
+        }
+
+        cov_above_block[b] = makeCirculantCovariance(cov_above, n_above);
       }
 
-      setExpectation(rms_traces[i]->getIIndex(),
-                     rms_traces[i]->getJIndex(),
-                     mu_above,
-                     mu_log_vp_post_above);
+      mu_model_block[b].assign(mu_post.begin() + n_pad_above, mu_post.begin() + n_pad_above + n_pad_model);
 
-      addCovariance(cov_above, cov_circulant_above, n_above);
+      NRLib::Grid2D<double> cov_model(n_pad_model, n_pad_model);
+      for (int j = 0; j < n_pad_model; j++) {
+        for (int k = 0; k < n_pad_model; k++)
+          cov_model(j, k) = Sigma_post(j + n_pad_above, k + n_pad_above);
+      }
+
+      cov_model_block[b] = makeCirculantCovariance(cov_model, n_model);
     }
 
-    std::vector<double> mu_model(n_pad_model);
-    for (int j = 0; j < n_pad_model; j++)
-      mu_model[j] = mu_post[j + n_pad_above];
+    for (int b = 0; b < n_block; b++) {
+      if (err_block[b] != "") {
+        mu_log_vp_above->endAccess();
+        mu_log_vp_grid ->endAccess();
+        throw NRLib::Exception(err_block[b]);
+      }
 
-    NRLib::Grid2D<double> cov_model(n_pad_model, n_pad_model);
-    for (int j = 0; j < n_pad_model; j++) {
-      for (int k = 0; k < n_pad_model; k++)
-        cov_model(j, k) = Sigma_post(j + n_pad_above, k + n_pad_above);
-    }
+      const RMSTrace * rms_trace = rms_traces[first + b];
 
-    setExpectation(rms_traces[i]->getIIndex(),
-                   rms_traces[i]->getJIndex(),
-                   mu_model,
-                   mu_log_vp_post_model);
+      if (this_time_lapse == 0) {
+        setExpectation(rms_trace->getIIndex(),
+                       rms_trace->getJIndex(),
+                       mu_above_block[b],
+                       mu_log_vp_post_above);
 
-    addCovariance(cov_model, cov_circulant_model, n_model);
+        for (int k = 0; k < n_pad_above; k++)
+          cov_circulant_above[k] += cov_above_block[b][k];
+      }
 
-    if (i + 1 >= static_cast<int>(nextMonitor)) {
-      nextMonitor += monitorSize;
-      std::cout << "^";
-      fflush(stdout);
+      setExpectation(rms_trace->getIIndex(),
+                     rms_trace->getJIndex(),
+                     mu_model_block[b],
+                     mu_log_vp_post_model);
+
+      for (int k = 0; k < n_pad_model; k++)
+        cov_circulant_model[k] += cov_model_block[b][k];
+
+      if (first + b + 1 >= static_cast<int>(nextMonitor)) {
+        nextMonitor += monitorSize;
+        std::cout << "^";
+        fflush(stdout);
+      }
     }
   }
 
+  mu_log_vp_above->endAccess();
+  mu_log_vp_grid ->endAccess();
+
   for (int i = 0; i < n_pad_model; i++)
     cov_circulant_model[i] /= n_rms_traces;
 
@@ -643,7 +745,7 @@ TravelTimeInversion::doRMSInversion(ModelGeneral            * modelGeneral,
 
 void
 TravelTimeInversion::do1DHorizonInversion(FFTGrid                     * mu_log_vp_dynamic,
-                                          const NRLib::Grid2D<double> & Sigma_log_vp_dynamic,
+                                          const std::vector<double>   & cov_log_vp_dynamic,
                                           const Simbox                * timeSimbox,
                                           const std::vector<Surface>  & initial_horizons,
                                           const std::vector<Surface>  & push_down_horizons,
@@ -652,6 +754,7 @@ TravelTimeInversion::do1DHorizonInversion(FFTGrid                     * mu_log_v
                                           const Surface               & base_simbox,
                                           int                           i_ind,
                                           int                           j_ind,
+                                          PosteriorWorkspace          & workspace,
                                           std::vector<double>         & mu_post_log_vp,
                                           NRLib::Grid2D<double>       & Sigma_post_log_vp) const
 {
@@ -712,12 +815,16 @@ TravelTimeInversion::do1DHorizonInversion(FFTGrid                     * mu_log_v
     std::vector<double> mu_log_vp = generateMuLogVpFromGrid(mu_log_vp_dynamic, i_ind, j_ind);
 
     // Transform to Vp^(-1)
-    std::vector<double>   mu_vp_minus;
-    NRLib::Grid2D<double> Sigma_vp_minus;
-    calculateMinusFirstCentralMomentLogNormal(mu_log_vp,
-                                              Sigma_log_vp_dynamic,
-                                              mu_vp_minus,
-                                              Sigma_vp_minus);
+    std::vector<double> mu_vp_minus;
+    std::vector<double> cov_vp_minus;
+    calculateCentralMomentLogNormalToeplitz(mu_log_vp,
+                                            cov_log_vp_dynamic,
+                                            -1.0,
+                                            mu_vp_minus,
+                                            cov_vp_minus);
+
+    BlockCovariance Sigma_vp_minus;
+    Sigma_vp_minus.addToeplitzBlock(cov_vp_minus, mu_vp_minus);
 
     std::vector<double>   mu_post;
     NRLib::Grid2D<double> Sigma_post;
@@ -727,6 +834,7 @@ TravelTimeInversion::do1DHorizonInversion(FFTGrid                     * mu_log_v
                             mu_vp_minus,
                             Sigma_vp_minus,
                             G,
+                            workspace,
                             mu_post,
                             Sigma_post);
 
@@ -752,6 +860,7 @@ TravelTimeInversion::do1DRMSInversion(const double                & mu_vp_base,
                                       const Simbox                * simbox_above,
                                       const Simbox                * simbox_below,
                                       const Simbox                * timeSimbox,
+                                      PosteriorWorkspace          & workspace,
                                       std::vector<double>         & mu_post_log_vp,
                                       NRLib::Grid2D<double>       & Sigma_post_log_vp) const
 {
@@ -792,8 +901,8 @@ TravelTimeInversion::do1DRMSInversion(const double                & mu_vp_base,
   std::vector<double> mu_log_vp_model_profile = generateMuLogVpFromGrid(mu_log_vp_model, i_ind, j_ind);
   std::vector<double> mu_log_vp_above_profile = generateMuLogVpFromGrid(mu_log_vp_above, i_ind, j_ind);
 
-  std::vector<double>   mu_m_square;
-  NRLib::Grid2D<double> Sigma_m_square;
+  std::vector<double> mu_m_square;
+  BlockCovariance     Sigma_m_square;
 
   calculateMuSigma_mSquare(mu_log_vp_above_profile,
                            mu_log_vp_model_profile,
@@ -818,6 +927,7 @@ TravelTimeInversion::do1DRMSInversion(const double                & mu_vp_base,
                           mu_m_square,
                           Sigma_m_square,
                           G,
+                          workspace,
                           mu_post,
                           Sigma_post);
 
@@ -827,69 +937,103 @@ TravelTimeInversion::do1DRMSInversion(const double                & mu_vp_base,
                            Sigma_post_log_vp);
 
 }
+//-----------------------------------------------------------------------------------------//
+void
+TravelTimeInversion::PosteriorWorkspace::resize(int n_layers_in, int n_data_in)
+{
+  if (n_layers_in == n_layers && n_data_in == n_data)
+    return;
+
+  n_layers = n_layers_in;
+  n_data   = n_data_in;
+
+  mu_m                   .resize(n_layers);
+  Sigma_m                .resize(n_layers, n_layers);
+  G                      .resize(n_data,   n_layers);
+  G_transpose            .resize(n_layers, n_data);
+  d                      .resize(n_data);
+  Sigma_d                .resize(n_data,   n_data);
+  data_mean              .resize(n_data);
+  diff                   .resize(n_data);
+  data_model_covariance  .resize(n_data,   n_layers);
+  model_data_covariance  .resize(n_layers, n_data);
+  data_covariance        .resize(n_data,   n_data);
+  data_covariance_inv_sym.resize(n_data);
+  data_covariance_inv    .resize(n_data,   n_data);
+  help_mat               .resize(n_layers, n_data);
+  mu_help                .resize(n_layers);
+  Sigma_help             .resize(n_layers, n_layers);
+  mu_post                .resize(n_layers);
+  Sigma_post             .resize(n_layers, n_layers);
+}
+
 //-----------------------------------------------------------------------------------------//
 void
 TravelTimeInversion::calculatePosteriorModel(const std::vector<double>   & d,
                                              const NRLib::Grid2D<double> & Sigma_d,
                                              const std::vector<double>   & mu_m,
-                                             const NRLib::Grid2D<double> & Sigma_m,
+                                             const BlockCovariance       & Sigma_m,
                                              const NRLib::Grid2D<double> & G,
+                                             PosteriorWorkspace          & workspace,
                                              std::vector<double>         & mu_post,
                                              NRLib::Grid2D<double>       & Sigma_post) const
 {
   int n_layers = static_cast<int>(mu_m.size());
   int n_data   = static_cast<int>(d.size());
 
-  NRLib::Vector mu_m1(n_layers);
+  // All matrices in the workspace are overwritten below, so they need not be cleared
+  workspace.resize(n_layers, n_data);
+
+  NRLib::Vector & mu_m1        = workspace.mu_m;
+  NRLib::Matrix & Sigma_m1     = workspace.Sigma_m;
+  NRLib::Matrix & G1           = workspace.G;
+  NRLib::Matrix & G1_transpose = workspace.G_transpose;
+  NRLib::Vector & d1           = workspace.d;
+  NRLib::Matrix & Sigma_d1     = workspace.Sigma_d;
+
   for (int i = 0; i < n_layers; i++)
     mu_m1(i) = mu_m[i];
 
-  NRLib::Matrix Sigma_m1(n_layers, n_layers);
-  for (int i = 0; i < n_layers; i++) {
-    for (int j = 0; j < n_layers; j++)
-      Sigma_m1(i,j) = Sigma_m(i,j);
-  }
+  Sigma_m.getDense(Sigma_m1);
 
-  NRLib::Matrix G1(n_data, n_layers);
   for (int i = 0; i < n_data; i++) {
     for (int j = 0; j < n_layers; j++)
       G1(i,j) = G(i,j);
   }
 
-  NRLib::Matrix G1_transpose(n_layers, n_data);
   for (int i = 0; i < n_data; i++) {
     for (int j = 0; j < n_layers; j++)
       G1_transpose(j,i) = G(i,j);
   }
 
-  NRLib::Vector d1(n_data);
   for (int i = 0; i < n_data; i++)
     d1(i) = d[i];
 
-  NRLib::Matrix Sigma_d1(n_data, n_data);
   for (int i = 0; i < n_data; i++) {
     for (int j = 0; j < n_data; j++)
       Sigma_d1(i,j) = Sigma_d(i,j);
   }
 
-  NRLib::Vector dataMean(n_data);
-  NRLib::Vector diff(n_data);
-  NRLib::Matrix dataModelCovariance(n_data, n_layers);
-  NRLib::Matrix modelDataCovariance(n_layers, n_data);
-  NRLib::Matrix dataCovariance(n_data, n_data);
+  NRLib::Vector & dataMean            = workspace.data_mean;
+  NRLib::Vector & diff                = workspace.diff;
+  NRLib::Matrix & dataModelCovariance = workspace.data_model_covariance;
+  NRLib::Matrix & modelDataCovariance = workspace.model_data_covariance;
+  NRLib::Matrix & dataCovariance      = workspace.data_covariance;
+
+  dataMean            = G1 * mu_m1;
+  diff                = d1 - dataMean;
 
+  // G*Sigma_m is found from the block Toeplitz form of Sigma_m. As Sigma_m is symmetric,
+  // Sigma_m*G^T is its transpose.
+  Sigma_m.multiplyLeft(G1, dataModelCovariance);
   for (int i = 0; i < n_data; i++) {
     for (int j = 0; j < n_layers; j++)
-      dataModelCovariance(i, j) = 0;
+      modelDataCovariance(j,i) = dataModelCovariance(i,j);
   }
 
-  dataMean            = G1 * mu_m1;
-  diff                = d1 - dataMean;
-  dataModelCovariance = G1 * Sigma_m1;
-  modelDataCovariance = Sigma_m1 * G1_transpose;
   dataCovariance      = dataModelCovariance * G1_transpose + Sigma_d1;
 
-  NRLib::SymmetricMatrix data_covariance_inv_sym(n_data);
+  NRLib::SymmetricMatrix & data_covariance_inv_sym = workspace.data_covariance_inv_sym;
 
   for (int i = 0; i < n_data; i++) {
     for (int j = 0; j <= i; j++)
@@ -898,7 +1042,7 @@ TravelTimeInversion::calculatePosteriorModel(const std::vector<double>   & d,
 
   NRLib::CholeskyInvert(data_covariance_inv_sym);
 
-  NRLib::Matrix data_covariance_inv(n_data, n_data);
+  NRLib::Matrix & data_covariance_inv = workspace.data_covariance_inv;
   for (int i = 0; i < n_data; i++) {
     for (int j = i; j < n_data; j++) {
       data_covariance_inv(i,j) = data_covariance_inv_sym(i,j);
@@ -906,12 +1050,12 @@ TravelTimeInversion::calculatePosteriorModel(const std::vector<double>   & d,
     }
   }
 
-  NRLib::Matrix helpMat(n_layers, n_data);
-  NRLib::Vector mu_help(n_layers);
-  NRLib::Matrix Sigma_help(n_layers, n_layers);
+  NRLib::Matrix & helpMat    = workspace.help_mat;
+  NRLib::Vector & mu_help    = workspace.mu_help;
+  NRLib::Matrix & Sigma_help = workspace.Sigma_help;
 
-  NRLib::Vector mu_post1(n_layers);
-  NRLib::Matrix Sigma_post1(n_layers, n_layers);
+  NRLib::Vector & mu_post1    = workspace.mu_post;
+  NRLib::Matrix & Sigma_post1 = workspace.Sigma_post;
 
   helpMat     = modelDataCovariance * data_covariance_inv;
   mu_help     = helpMat * diff;
@@ -1079,17 +1223,11 @@ TravelTimeInversion::calculateMuSigma_mSquare(const std::vector<double>   & mu_l
                                               const NRLib::Grid2D<double> & Sigma_vp_below,
                                               const int                   & n_below,
                                               std::vector<double>         & mu_vp_square,
-                                              NRLib::Grid2D<double>       & Sigma_vp_square) const
+                                              BlockCovariance             & Sigma_vp_square) const
 {
 
   int n_layers_simbox = static_cast<int>(mu_log_vp_model.size());
 
-  // Model
-  NRLib::Grid2D<double> Sigma_log_vp_model = generateSigmaModel(cov_grid_log_vp_model);
-
-  // Above
-  NRLib::Grid2D<double> Sigma_log_vp_above = generateSigmaModel(cov_grid_log_vp_above);
-
   // Below
   int                   n_pad_below    = static_cast<int>(Sigma_vp_below.GetNI());
   std::vector<double>   mu_vp_below    = generateMuVpBelow(std::exp(mu_log_vp_model[n_layers_simbox-1]), mu_vp_base, n_below, n_pad_below);
@@ -1097,12 +1235,26 @@ TravelTimeInversion::calculateMuSigma_mSquare(const std::vector<double>   & mu_l
   NRLib::Grid2D<double> Sigma_log_vp_below;
   calculateCentralMomentLogNormalInverse(mu_vp_below, Sigma_vp_below, mu_log_vp_below, Sigma_log_vp_below);
 
-  // Combine
-  std::vector<double>   mu_log_m    = generateMuCombined(mu_log_vp_above, mu_log_vp_model, mu_log_vp_below);
-  NRLib::Grid2D<double> Sigma_log_m = generateSigmaCombined(Sigma_log_vp_above, Sigma_log_vp_model, Sigma_log_vp_below);
+  // Transform to Vp^2. The three parts are independent, so they are transformed separately.
+  // The log(Vp) covariances above and in the model are stationary, and give Toeplitz blocks.
+  std::vector<double> mu_vp_square_above;
+  std::vector<double> cov_vp_square_above;
+  calculateCentralMomentLogNormalToeplitz(mu_log_vp_above, cov_grid_log_vp_above, 2.0, mu_vp_square_above, cov_vp_square_above);
 
-  // Transform to Vp^2
-  calculateSecondCentralMomentLogNormal(mu_log_m, Sigma_log_m, mu_vp_square, Sigma_vp_square);
+  std::vector<double> mu_vp_square_model;
+  std::vector<double> cov_vp_square_model;
+  calculateCentralMomentLogNormalToeplitz(mu_log_vp_model, cov_grid_log_vp_model, 2.0, mu_vp_square_model, cov_vp_square_model);
+
+  std::vector<double>   mu_vp_square_below;
+  NRLib::Grid2D<double> Sigma_vp_square_below;
+  calculateSecondCentralMomentLogNormal(mu_log_vp_below, Sigma_log_vp_below, mu_vp_square_below, Sigma_vp_square_below);
+
+  mu_vp_square = generateMuCombined(mu_vp_square_above, mu_vp_square_model, mu_vp_square_below);
+
+  Sigma_vp_square.clear();
+  Sigma_vp_square.addToeplitzBlock(cov_vp_square_above, mu_vp_square_above);
+  Sigma_vp_square.addToeplitzBlock(cov_vp_square_model, mu_vp_square_model);
+  Sigma_vp_square.addDenseBlock(Sigma_vp_square_below);
 
 }
 //-----------------------------------------------------------------------------------------//
@@ -1154,16 +1306,14 @@ TravelTimeInversion::generateMuLogVpFromGrid(FFTGrid   * mu_log_vp,
                                              const int & j_ind) const
 {
 
+  // The grid must be in random access mode. The values are only read, so this may be
+  // called from several threads at the same time.
   int n_layers_padding = mu_log_vp->getNzp();
 
-  mu_log_vp->setAccessMode(FFTGrid::READ);
-
   std::vector<double> mu_grid_log_vp(n_layers_padding, 0);
   for (int j = 0; j < n_layers_padding; j++)
     mu_grid_log_vp[j] = mu_log_vp->getRealValue(i_ind, j_ind, j, true);
 
-  mu_log_vp->endAccess();
-
   return mu_grid_log_vp;
 
 }
@@ -1233,44 +1383,6 @@ TravelTimeInversion::generateMuCombined(const std::vector<double> & mu_above,
 
 //-----------------------------------------------------------------------------------------//
 
-NRLib::Grid2D<double>
-TravelTimeInversion::generateSigmaCombined(const NRLib::Grid2D<double> & Sigma_above,
-                                           const NRLib::Grid2D<double> & Sigma_model,
-                                           const NRLib::Grid2D<double> & Sigma_below) const
-{
-  int n_layers_above = static_cast<int>(Sigma_above.GetNI());
-  int n_layers_below = static_cast<int>(Sigma_below.GetNI());
-  int n_layers_model = static_cast<int>(Sigma_model.GetNI());
-  int n_layers       = n_layers_above + n_layers_model + n_layers_below;
-
-  NRLib::Grid2D<double> Sigma_m(n_layers, n_layers, 0);
-
-  for (int j = 0; j < n_layers_above; j++) {
-    for (int k = j; k < n_layers_above; k++) {
-      Sigma_m(j, k) = Sigma_above(j, k);
-      Sigma_m(k, j) = Sigma_m(j, k);
-    }
-  }
-
-  for (int j = n_layers_above; j < n_layers_above+n_layers_model; j++) {
-    for (int k = j; k < n_layers_above+n_layers_model; k++) {
-      Sigma_m(j, k) = Sigma_model(j - n_layers_above, k - n_layers_above);
-      Sigma_m(k, j) = Sigma_m(j, k);
-    }
-  }
-
-  for (int j = n_layers_above + n_layers_model; j < n_layers; j++) {
-    for (int k = j; k < n_layers; k++) {
-      Sigma_m(j, k) = Sigma_below(j - n_layers_above - n_layers_model, k - n_layers_above - n_layers_model);
-      Sigma_m(k, j) = Sigma_m(j, k);
-    }
-  }
-
-  return Sigma_m;
-}
-
-//-----------------------------------------------------------------------------------------//
-
 NRLib::Grid2D<double>
 TravelTimeInversion::generateSigma(const double              & var,
                                    const std::vector<double> & corrT) const
@@ -1293,28 +1405,6 @@ TravelTimeInversion::generateSigma(const double              & var,
 }
 
 //-----------------------------------------------------------------------------------------//
-NRLib::Grid2D<double>
-TravelTimeInversion::generateSigmaModel(const std::vector<double> & cov_grid) const
-{
-  int n = static_cast<int>(cov_grid.size());
-
-  NRLib::Grid2D<double> Sigma_m(n, n);
-
-  for (int j = 0; j < n; j++) {
-    int count = 0;
-    for (int k = j; k < n; k++) {
-      double cov_log_vp = cov_grid[count];
-      Sigma_m(j, k) = cov_log_vp;
-      Sigma_m(k, j) = Sigma_m(j, k);
-      count++;
-    }
-  }
-
-  return Sigma_m;
-}
-
-//-----------------------------------------------------------------------------------------//
-
 void
 TravelTimeInversion::transformVpSquareToLogVp(const std::vector<double>   & mu_vp_square,
                                               const NRLib::Grid2D<double> & Sigma_vp_square,
@@ -1379,6 +1469,31 @@ TravelTimeInversion::calculateCentralMomentLogNormal(const std::vector<double>
 
 //-----------------------------------------------------------------------------------------//
 
+void
+TravelTimeInversion::calculateCentralMomentLogNormalToeplitz(const std::vector<double> & mu_log_vp,
+                                                             const std::vector<double> & cov_log_vp,
+                                                             double                      factor,
+                                                             std::vector<double>       & mu_vp_trans,
+                                                             std::vector<double>       & cov_vp_trans_row) const
+{
+  // With log(Vp) ~ N(mu, Sigma) and Sigma(i, j) = cov_log_vp[|i - j|], the covariance of
+  // Vp^factor is D*T*D, where D = diag(mu_vp_trans) and T is Toeplitz with first row
+  // exp(factor^2 * cov_log_vp) - 1.
+
+  int    n        = static_cast<int>(mu_log_vp.size());
+  double factor_2 = factor * factor;
+
+  mu_vp_trans.resize(n);
+  for (int i = 0; i < n; i++)
+    mu_vp_trans[i] = std::exp(factor * mu_log_vp[i] + 0.5 * factor_2 * cov_log_vp[0]);
+
+  cov_vp_trans_row.resize(n);
+  for (int i = 0; i < n; i++)
+    cov_vp_trans_row[i] = std::exp(factor_2 * cov_log_vp[i]) - 1;
+}
+
+//-----------------------------------------------------------------------------------------//
+
 void
 TravelTimeInversion::calculateCentralMomentLogNormalInverse(const std::vector<double>   & mu_vp_trans,
                                                             const NRLib::Grid2D<double> & variance_vp_trans,
@@ -1425,35 +1540,6 @@ TravelTimeInversion::calculateSecondCentralMomentLogNormal(const std::vector<dou
 }
 
 //-----------------------------------------------------------------------------------------//
-void
-TravelTimeInversion::calculateMinusFirstCentralMomentLogNormal(const std::vector<double>   & mu_log_vp,
-                                                               const NRLib::Grid2D<double> & variance_log_vp,
-                                                               std::vector<double>         & mu_vp_minus,
-                                                               NRLib::Grid2D<double>       & variance_vp_minus) const
-{
-  // log(Vp) \sim N(\mu,Sigma)
-  // Vp^(-1) \sim N(\mu*, Sigma*)
-
-  int n_layers = static_cast<int>(mu_log_vp.size());
-
-  std::vector<double> mu(n_layers);
-  for (int i = 0; i < n_layers; i++)
-    mu[i] = mu_log_vp[i] * (-1);
-
-  NRLib::Grid2D<double> variance(n_layers, n_layers);
-  for (int i = 0; i < n_layers; i++) {
-    for (int j = 0; j < n_layers; j++)
-      variance(i, j) = variance_log_vp(i, j) * 1;
-  }
-
-  mu_vp_minus.resize(n_layers);
-  variance_vp_minus.Resize(n_layers, n_layers);
-
-  calculateCentralMomentLogNormal(mu, variance, mu_vp_minus, variance_vp_minus);
-}
-
-//-----------------------------------------------------------------------------------------//
-
 void
 TravelTimeInversion::addCovariance(const NRLib::Grid2D<double> & Sigma_post,
                                    std::vector<double>         & cov_stationary,
@@ -2376,8 +2462,7 @@ TravelTimeInversion::calculateEVpGrid(FFTGrid  * mu_log_vp,
   int nyp = mu_log_vp->getNyp();
   int nzp = mu_log_vp->getNzp();
 
-  std::vector<double>   cov_log_vp_profile = getCovLogVp(cov_log_vp);
-  NRLib::Grid2D<double> Sigma_log_vp       = generateSigmaModel(cov_log_vp_profile);
+  std::vector<double> cov_log_vp_profile = getCovLogVp(cov_log_vp);
 
   mu_vp = ModelGeneral::createFFTGrid(nx, ny, nz, nxp, nyp, nzp, false);
   mu_vp->createRealGrid();
@@ -2389,17 +2474,18 @@ TravelTimeInversion::calculateEVpGrid(FFTGrid  * mu_log_vp,
   for (int i = 0; i < nx; i++) {
     for (int j = 0; j < ny; j++) {
 
-      std::vector<double>   mu_log_vp_profile(nz);
-      std::vector<double>   mu_vp_profile;
-      NRLib::Grid2D<double> Sigma_mu_vp;
+      std::vector<double> mu_log_vp_profile(nz);
+      std::vector<double> mu_vp_profile;
+      std::vector<double> cov_vp_profile;
 
       for (int k = 0; k < nz; k++)
         mu_log_vp_profile[k]  = mu_log_vp->getRealValue(i, j, k);
 
-      calculateCentralMomentLogNormal(mu_log_vp_profile,
-                                      Sigma_log_vp,
-                                      mu_vp_profile,
-                                      Sigma_mu_vp);
+      calculateCentralMomentLogNormalToeplitz(mu_log_vp_profile,
+                                              cov_log_vp_profile,
+                                              1.0,
+                                              mu_vp_profile,
+                                              cov_vp_profile);
 
       for (int k = 0; k < nz; k++)
         mu_vp->setRealValue(i, j, k, static_cast<float>(mu_vp_profile[k]));
@@ -2451,8 +2537,7 @@ TravelTimeInversion::calculateDividedGridHorizon(FFTGrid * post_mu_vp,
   // In the horizon posterior, E[ln(Vp1/Vp0)|d] and Cov(ln(Vp1/Vp0)|d) have been calculated
   // Of interest in the divided grid is E[(Vp0/Vp1)|d], which can be calculated from post_mu_vp and post_cov_mu_vp
 
-  std::vector<double>   cov_log_vp   = getCovLogVp(post_cov_mu_vp);
-  NRLib::Grid2D<double> Sigma_log_vp = generateSigmaModel(cov_log_vp);
+  std::vector<double> cov_log_vp = getCovLogVp(post_cov_mu_vp);
 
   int nx  = post_mu_vp->getNx();
   int ny  = post_mu_vp->getNy();
@@ -2460,24 +2545,29 @@ TravelTimeInversion::calculateDividedGridHorizon(FFTGrid * post_mu_vp,
 
   NRLib::Grid<double> divided_grid(nx, ny, nz);
 
+  post_mu_vp->setAccessMode(FFTGrid::RANDOMACCESS);
+
   for (int i = 0; i < nx; i++) {
     for (int j = 0; j < ny; j++) {
 
       std::vector<double> mu_log_vp = generateMuLogVpFromGrid(post_mu_vp, i, j);
 
       // Transform to (Vp0/Vp1)
-      std::vector<double>   mu_vp_minus;
-      NRLib::Grid2D<double> Sigma_vp_minus;
-      calculateMinusFirstCentralMomentLogNormal(mu_log_vp,
-                                                Sigma_log_vp,
-                                                mu_vp_minus,
-                                                Sigma_vp_minus);
+      std::vector<double> mu_vp_minus;
+      std::vector<double> cov_vp_minus;
+      calculateCentralMomentLogNormalToeplitz(mu_log_vp,
+                                              cov_log_vp,
+                                              -1.0,
+                                              mu_vp_minus,
+                                              cov_vp_minus);
 
       for (int k = 0; k < nz; k++)
         divided_grid(i, j, k) = mu_vp_minus[k];
     }
   }
 
+  post_mu_vp->endAccess();
+
   return divided_grid;
 }
 
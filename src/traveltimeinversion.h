@@ -21,6 +21,7 @@ class FFTGrid;
 class KrigingData2D;
 class State4D;
 class GridMapping;
+class BlockCovariance;
 
 class TravelTimeInversion
 {
@@ -33,13 +34,44 @@ public:
   ~TravelTimeInversion();
 
 private:
+  // Work matrices for calculatePosteriorModel(). One workspace is used per thread, and the
+  // matrices are only reallocated when the dimensions change from one trace to the next.
+  struct PosteriorWorkspace
+  {
+    PosteriorWorkspace() : n_layers(-1), n_data(-1) {}
+
+    void                        resize(int n_layers_in, int n_data_in);
+
+    int                         n_layers;
+    int                         n_data;
+
+    NRLib::Vector               mu_m;
+    NRLib::Matrix               Sigma_m;
+    NRLib::Matrix               G;
+    NRLib::Matrix               G_transpose;
+    NRLib::Vector               d;
+    NRLib::Matrix               Sigma_d;
+    NRLib::Vector               data_mean;
+    NRLib::Vector               diff;
+    NRLib::Matrix               data_model_covariance;
+    NRLib::Matrix               model_data_covariance;
+    NRLib::Matrix               data_covariance;
+    NRLib::SymmetricMatrix      data_covariance_inv_sym;
+    NRLib::Matrix               data_covariance_inv;
+    NRLib::Matrix               help_mat;
+    NRLib::Vector               mu_help;
+    NRLib::Matrix               Sigma_help;
+    NRLib::Vector               mu_post;
+    NRLib::Matrix               Sigma_post;
+  };
+
   void                          doHorizonInversion(ModelGeneral            * modelGeneral,
                                                    ModelTravelTimeStatic   * modelTravelTimeStatic,
                                                    ModelTravelTimeDynamic  * modelTravelTimeDynamic,
                                                    SeismicParametersHolder & seismicParameters) const;
 
   void                          do1DHorizonInversion(FFTGrid                     * mu_log_vp_dynamic,
-                                                     const NRLib::Grid2D<double> & Sigma_log_vp_dynamic,
+                                                     const std::vector<double>   & cov_log_vp_dynamic,
                                                      const Simbox                * timeSimbox,
                                                      const std::vector<Surface>  & initial_horizons,
                                                      const std::vector<Surface>  & push_down_horizons,
@@ -48,6 +80,7 @@ private:
                                                      const Surface               & base_simbox,
                                                      int                           i_ind,
                                                      int                           j_ind,
+                                                     PosteriorWorkspace          & workspace,
                                                      std::vector<double>         & mu_post_log_vp,
                                                      NRLib::Grid2D<double>       & Sigma_post_log_vp) const;
 
@@ -68,14 +101,16 @@ private:
                                                  const Simbox                * simbox_above,
                                                  const Simbox                * simbox_below,
                                                  const Simbox                * timeSimbox,
+                                                 PosteriorWorkspace          & workspace,
                                                  std::vector<double>         & mu_post_log_vp,
                                                  NRLib::Grid2D<double>       & Sigma_post_log_vp) const;
 
   void                          calculatePosteriorModel(const std::vector<double>   & d,
                                                         const NRLib::Grid2D<double> & Sigma_d,
                                                         const std::vector<double>   & mu_m,
-                                                        const NRLib::Grid2D<double> & Sigma_m,
+                                                        const BlockCovariance       & Sigma_m,
                                                         const NRLib::Grid2D<double> & G,
+                                                        PosteriorWorkspace          & workspace,
                                                         std::vector<double>         & mu_post,
                                                         NRLib::Grid2D<double>       & Sigma_post) const;
 
@@ -115,7 +150,7 @@ private:
                                                          const NRLib::Grid2D<double> & Sigma_vp_below,
                                                          const int                   & n_below,
                                                          std::vector<double>         & mu_vp_square,
-                                                         NRLib::Grid2D<double>       & Sigma_vp_square) const;
+                                                         BlockCovariance             & Sigma_vp_square) const;
 
   void                          generateMuSigmaLogVpAbove(const int                    & nz,
                                                           const int                    & nzp,
@@ -145,10 +180,6 @@ private:
                                                    const std::vector<double> & mu_model,
                                                    const std::vector<double> & mu_below) const;
 
-  NRLib::Grid2D<double>         generateSigmaCombined(const NRLib::Grid2D<double> & Sigma_above,
-                                                      const NRLib::Grid2D<double> & Sigma_model,
-                                                      const NRLib::Grid2D<double> & Sigma_below) const;
-
   NRLib::Grid2D<double>         generateSigma(const double              & var,
                                               const std::vector<double> & corrT) const;
 
@@ -157,8 +188,6 @@ private:
                                                 const double & var_vp,
                                                 const Vario  * variogram) const;
 
-  NRLib::Grid2D<double>         generateSigmaModel(const std::vector<double> & cov_grid) const;
-
   std::vector<double>           getCovLogVp(FFTGrid * cov_log_vp) const;
 
   void                          transformVpSquareToLogVp(const std::vector<double>   & mu_vp_square,
@@ -181,10 +210,13 @@ private:
                                                                       std::vector<double>         & mu_vp_square,
                                                                       NRLib::Grid2D<double>       & variance_vp_square) const;
 
-  void                          calculateMinusFirstCentralMomentLogNormal(const std::vector<double>   & mu_log_vp,
-                                                                          const NRLib::Grid2D<double> & variance_log_vp,
-                                                                          std::vector<double>         & mu_vp_minus,
-                                                                          NRLib::Grid2D<double>       & variance_vp_minus) const;
+  // Transform of a stationary log(Vp) with covariance given by its first row, for
+  // Vp^factor. Only the first row of the Toeplitz part of the covariance is computed.
+  void                          calculateCentralMomentLogNormalToeplitz(const std::vector<double> & mu_log_vp,
+                                                                        const std::vector<double> & cov_log_vp,
+                                                                        double                      factor,
+                                                                        std::vector<double>       & mu_vp_trans,
+                                                                        std::vector<double>       & cov_vp_trans_row) const;
 
   void                          calculateCentralMomentLogNormalInverse(const std::vector<double>   & mu_vp_trans,
                                                                        const NRLib::Grid2D<double> & variance_vp_trans,
@@ -10,6 +10,10 @@
 #define _USE_MATH_DEFINES
 #include <cmath>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include "fftw.h"
 #include "rfftw.h"
 #include "fftw-int.h"
@@ -33,6 +37,8 @@
 #include "src/vario.h"
 #include "src/io.h"
 
+#include "lib/fft1d.h"
+
 Wavelet::Wavelet(int dim)
   : cnzp_(0),
     rnzp_(0),
@@ -247,15 +253,10 @@ void Wavelet::fft1DInPlace()
 {
   // use the operator version of the fourier transform
   if(isReal_) {
-    int flag;
-    rfftwnd_plan plan;
-    flag    = FFTW_ESTIMATE | FFTW_IN_PLACE;
-    plan    = rfftwnd_create_plan(1, &nzp_ ,FFTW_REAL_TO_COMPLEX,flag);
     //
     // NBNB-PAL: The call rfftwnd_on_real_to_complex is causing UMRs in Purify.
     //
-    rfftwnd_one_real_to_complex(plan,rAmp_,cAmp_);
-    fftwnd_destroy_plan(plan);
+    FFT1D::fft(rAmp_, nzp_);
     isReal_ = false;
   }
 }
@@ -265,13 +266,7 @@ void Wavelet::invFFT1DInPlace()
 {
   // use the operator version of the fourier transform
   if(!isReal_) {
-    int flag;
-    rfftwnd_plan plan;
-
-    flag = FFTW_ESTIMATE | FFTW_IN_PLACE;
-    plan= rfftwnd_create_plan(1,&nzp_,FFTW_COMPLEX_TO_REAL,flag);
-    rfftwnd_one_complex_to_real(plan,cAmp_,rAmp_);
-    fftwnd_destroy_plan(plan);
+    FFT1D::fftInv(cAmp_, nzp_);
     isReal_=true;
     double scale= static_cast<double>(1.0/static_cast<double>(nzp_));
     for(int i=0; i < nzp_; i++)
@@ -1054,6 +1049,17 @@ Wavelet::shiftReal(float        shift,
   Utils::fftInv(cAmp,rAmp, nt);
 }
 
+int
+Wavelet::getNumberOfWellThreads(int nWells) const
+{
+  int nThreads = 1;
+#ifdef _OPENMP
+  if(omp_in_parallel() == 0 && ModelSettings::getDebugLevel() == 0 && isReal_)
+    nThreads = std::min(omp_get_max_threads(), nWells);
+#endif
+  return(std::max(nThreads, 1));
+}
+
 void
 Wavelet::printVecToFile(const std::string & fileName,
                         fftw_real         * vec,
@@ -209,6 +209,11 @@ protected:
                            fftw_real                         * rAmp,
                            int                                 nt);
 
+  // Threads for the loops over wells. The wells are done serially inside a parallel region, in
+  // debug mode, as the wells then write to common files, and when the wavelet is Fourier
+  // transformed, as getRAmp() then transforms it back and forth.
+  int            getNumberOfWellThreads(int                    nWells) const;
+
 
 
   double         Ricker(double t, float peakF);
@@ -111,10 +111,17 @@ Wavelet1D::Wavelet1D(const Simbox                 * simbox,
   std::vector<int>   sampleStop(nWells,0);    // Needed to block syntSeis
   std::vector<float> wellWeight(nWells,0.0f);
   //
-  // Loop over wells and create a blocked well and blocked seismic
+  // Loop over wells and create a blocked well and blocked seismic. The wells are done in
+  // parallel, and their log messages and errors are given in well order afterwards.
   //
-  int nUsedWells = 0;
+  int nThreads = getNumberOfWellThreads(nWells);
+  std::vector<int>                                  usedWell(nWells, 0);
+  std::vector<std::string>                          wellErrTxt(nWells);
+  std::vector<std::vector<NRLib::BufferMessage *> *> messages(nWells);
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nThreads) if(nThreads > 1)
   for (int w = 0 ; w < nWells ; w++) {
+    if (nThreads > 1)
+      LogKit::StartThreadBuffering();
     if (wells[w]->getUseForWaveletEstimation()) {
       LogKit::LogFormatted(LogKit::Medium,"  Well :  %s\n",wells[w]->getWellname().c_str());
 
@@ -128,10 +135,8 @@ Wavelet1D::Wavelet1D(const Simbox                 * simbox,
       for (int i = 0 ; i < bl->getNumberOfBlocks() ; i++) {
         maxAmp = std::max(maxAmp, std::abs(seisLog[i]));
       }
-      if (maxAmp == 0.0f) {
-        errCode = 1;
-        errTxt  += "The seismic data in stack " + NRLib::ToString(iAngle) + " have zero amplitudes in well \'"+wells[w]->getWellname()+"\'.\n";
-      }
+      if (maxAmp == 0.0f)
+        wellErrTxt[w] = "The seismic data in stack " + NRLib::ToString(iAngle) + " have zero amplitudes in well \'"+wells[w]->getWellname()+"\'.\n";
 
       //
       // Check seismic data outside estimation interval missing
@@ -167,14 +172,12 @@ Wavelet1D::Wavelet1D(const Simbox                 * simbox,
       int start,length;
       bl->findContiniousPartOfData(hasData, nz_, start, length);
       if(length*dz_ > waveletTaperLength ) { // must have enough data
-        nUsedWells++;
+        usedWell[w] = 1;
         bl->fillInCpp(coeff_, start, length, cpp_r[w], nzp_);
-        fileName = "cpp_1";
-        printVecToFile(fileName, cpp_r[w], nzp_);  // Debug
+        printVecToFile("cpp_1", cpp_r[w], nzp_);  // Debug
         Utils::fft(cpp_r[w], cpp_c[w], nzp_);
         bl->fillInSeismic(&seisData[0], start, length, seis_r[w], nzp_);
-        fileName = "seis_1";
-        printVecToFile(fileName, seis_r[w], nzp_); // Debug
+        printVecToFile("seis_1", seis_r[w], nzp_); // Debug
         Utils::fft(seis_r[w], seis_c[w], nzp_);
         bl->estimateCor(cpp_c[w], cpp_c[w], cor_cpp_c[w], cnzp_);
         Utils::fftInv(cor_cpp_c[w], cor_cpp_r[w], nzp_);
@@ -198,6 +201,18 @@ Wavelet1D::Wavelet1D(const Simbox                 * simbox,
                                             NRLib::ToString(waveletTaperLength) + "ms is needed.\n"+coarseWell);
       }
     }
+    if (nThreads > 1)
+      messages[w] = LogKit::EndThreadBuffering();
+  }
+
+  int nUsedWells = 0;
+  for (int w = 0 ; w < nWells ; w++) {
+    LogKit::LogBuffer(messages[w]);
+    if (wellErrTxt[w] != "") {
+      errCode = 1;
+      errTxt  += wellErrTxt[w];
+    }
+    nUsedWells += usedWell[w];
   }
 
   if(nUsedWells == 0) {
@@ -208,6 +223,7 @@ Wavelet1D::Wavelet1D(const Simbox                 * simbox,
     std::vector<float> shiftWell(nWells);
     float shiftAvg = shiftOptimal(ccor_seis_cpp_r, wellWeight, dzWell, nWells, nzp_, shiftWell, modelSettings->getMaxWaveletShift());
     multiplyPapolouis(ccor_seis_cpp_r, dzWell, nWells, nzp_, waveletTaperLength, wellWeight);
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nThreads) if(nThreads > 1)
     for(int w=0;w<nWells;w++)
     {
       if(wellWeight[w]>0)
@@ -231,6 +247,7 @@ Wavelet1D::Wavelet1D(const Simbox                 * simbox,
     adjustLowfrequency(rAmp_, dz_,  nzp_, waveletTaperLength);
     cAmp_ = reinterpret_cast<fftw_complex*>(rAmp_);
 
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nThreads) if(nThreads > 1)
     for(int w=0;w<nWells;w++)
     {
       if(wellWeight[w]>0)
@@ -249,26 +266,25 @@ Wavelet1D::Wavelet1D(const Simbox                 * simbox,
       }
     }
 
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nThreads) if(nThreads > 1)
     for (int w=0;w<nWells;w++) { // gets syntetic seismic with estimated wavelet
       fillInnWavelet(wavelet_r[w], nzp_, dzWell[w]);
       shiftReal(shiftWell[w]/dzWell[w], wavelet_r[w], nzp_);
-      fileName = "waveletShift";
-      printVecToFile(fileName, wavelet_r[w], nzp_);
+      printVecToFile("waveletShift", wavelet_r[w], nzp_);
       Utils::fft(wavelet_r[w], wavelet_c[w], nzp_);
-      fileName = "cpp";
-      printVecToFile(fileName, cpp_r[w], nzp_);
+      printVecToFile("cpp", cpp_r[w], nzp_);
       Utils::fft(cpp_r[w], cpp_c[w], nzp_);
       convolve(cpp_c[w], wavelet_c[w], synt_seis_c[w], cnzp_);
       Utils::fftInv(synt_seis_c[w], synt_seis_r[w], nzp_); //
-      fileName = "syntSeis";
-      printVecToFile(fileName, synt_seis_r[w], nzp_);
-      fileName = "seis";
-      printVecToFile(fileName, seis_r[w], nzp_);
+      printVecToFile("syntSeis", synt_seis_r[w], nzp_);
+      printVecToFile("seis", seis_r[w], nzp_);
 
       std::vector<float> syntSeis(nz_, 0.0f); // Do not use RMISSING (fails in setLogFromVerticalTrend())
       if (wellWeight[w] > 0) {
         for (int i = sampleStart[w] ; i < sampleStop[w] ; i++)
           syntSeis[i] = synt_seis_r[w][i];
+        // The log for all angles is allocated by the first angle stack to get here
+#pragma omp critical(WellSyntheticSeismic)
         wells[w]->getBlockedLogsOrigThick()->setLogFromVerticalTrend(&syntSeis[0], z0[w], dzWell[w], nz_,
                                                                      "WELL_SYNTHETIC_SEISMIC", iAngle);
       }
@@ -738,7 +754,12 @@ Wavelet1D::calculateSNRatioAndLocalWavelet(const Simbox          * simbox,
   std::vector<float> errVarWell (nWells, 0.0f);
   std::vector<float> shiftWell  (nWells, 0.0f);
   std::vector<int>   nActiveData(nWells, 0);
+  int nThreads = getNumberOfWellThreads(nWells);
+  std::vector<std::vector<NRLib::BufferMessage *> *> messages(nWells);
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nThreads) if(nThreads > 1)
   for (int w = 0 ; w < nWells ; w++) {
+    if (nThreads > 1)
+      LogKit::StartThreadBuffering();
     if (wells[w]->getUseForWaveletEstimation()) {
       BlockedLogs * bl = wells[w]->getBlockedLogsOrigThick();
       //
@@ -803,7 +824,11 @@ Wavelet1D::calculateSNRatioAndLocalWavelet(const Simbox          * simbox,
                              wells[w]->getWellname().c_str(), length*dz_, waveletLength_);
       }
     }
+    if (nThreads > 1)
+      messages[w] = LogKit::EndThreadBuffering();
   }
+  for (int w = 0 ; w < nWells ; w++)
+    LogKit::LogBuffer(messages[w]);
   float globalScale = waveletScale;
   std::vector<float> scaleOptWell(nWells, -1.0f);
   std::vector<float> errWellOptScale(nWells);
@@ -949,27 +974,46 @@ Wavelet1D::calculateSNRatioAndLocalWavelet(const Simbox          * simbox,
       cov.writeToFile(fileName);
     }
 
-    if (doEstimateLocalShift)
-      estimateLocalShift(cov, shiftGrid, shiftWell, nActiveData, simbox,wells, nWells);
-
-    if (doEstimateLocalScale)
-      estimateLocalGain(cov, gainGrid, scaleOptWell, 1.0, nActiveData, simbox,wells, nWells);
-
-    if (doEstimateLocalNoise) {
-      float errStdLN;
-      if (doEstimateSNRatio)
-        errStdLN = errStd;
-      else //SNRatio given in model file
-        errStdLN = sqrt(dataVar/SNRatio);
-      if(gainGrid == NULL && doEstimateLocalScale==false && doEstimateGlobalScale==false) { // No local wavelet scale
-        for(int w=0 ; w < nWells ; w++)
-          errVarWell[w] = sqrt(errVarWell[w]);
-        estimateLocalNoise(cov, noiseScaled, errStdLN, errVarWell, nActiveData, simbox,wells, nWells);
+    //
+    // The shift, gain and noise maps are independent, and are kriged concurrently. The gain
+    // grid is only set by the gain estimation when a local scale is estimated, so whether
+    // there is a local wavelet scale is known before the maps are made.
+    //
+    bool noLocalScale = (gainGrid == NULL && doEstimateLocalScale==false && doEstimateGlobalScale==false);
+    int  nMaps        = static_cast<int>(doEstimateLocalShift) + static_cast<int>(doEstimateLocalScale) + static_cast<int>(doEstimateLocalNoise);
+    int  nMapThreads  = std::min(getNumberOfWellThreads(nWells), nMaps);
+
+#pragma omp parallel sections num_threads(nMapThreads) if(nMapThreads > 1)
+    {
+#pragma omp section
+      {
+        if (doEstimateLocalShift)
+          estimateLocalShift(cov, shiftGrid, shiftWell, nActiveData, simbox,wells, nWells);
+      }
+#pragma omp section
+      {
+        if (doEstimateLocalScale)
+          estimateLocalGain(cov, gainGrid, scaleOptWell, 1.0, nActiveData, simbox,wells, nWells);
+      }
+#pragma omp section
+      {
+        if (doEstimateLocalNoise) {
+          float errStdLN;
+          if (doEstimateSNRatio)
+            errStdLN = errStd;
+          else //SNRatio given in model file
+            errStdLN = sqrt(dataVar/SNRatio);
+          if(noLocalScale) { // No local wavelet scale
+            for(int w=0 ; w < nWells ; w++)
+              errVarWell[w] = sqrt(errVarWell[w]);
+            estimateLocalNoise(cov, noiseScaled, errStdLN, errVarWell, nActiveData, simbox,wells, nWells);
+          }
+          else if (doEstimateGlobalScale==true && doEstimateLocalScale==false) // global wavelet scale
+            estimateLocalNoise(cov, noiseScaled, errStdLN,errWell, nActiveData, simbox,wells, nWells);
+          else
+            estimateLocalNoise(cov, noiseScaled, errStdLN, errWellOptScale, nActiveData, simbox,wells, nWells);
+        }
       }
-      else if (doEstimateGlobalScale==true && doEstimateLocalScale==false) // global wavelet scale
-        estimateLocalNoise(cov, noiseScaled, errStdLN,errWell, nActiveData, simbox,wells, nWells);
-      else
-        estimateLocalNoise(cov, noiseScaled, errStdLN, errWellOptScale, nActiveData, simbox,wells, nWells);
     }
   }
 
@@ -1065,6 +1109,9 @@ Wavelet1D::findOptimalWaveletScale(fftw_real               ** synt_seis_r,
   float minSeisAmp = static_cast<float> (1e-7);
   int totCount=0;
 
+  // The residuals of each well are found in parallel, and summed in well order
+  int nThreads = getNumberOfWellThreads(nWells);
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nThreads) if(nThreads > 1)
   for(int i=0;i<nWells;i++) {
     counter[i]=0;
     if(wellWeight[i]>0) {
@@ -1072,7 +1119,6 @@ Wavelet1D::findOptimalWaveletScale(fftw_real               ** synt_seis_r,
       for(int k=0;k<nzp;k++)
         if(fabs(seis_r[i][k]) > minSeisAmp)
           counter[i]++;
-      totCount+=counter[i];
 
       for(int j=0;j<nScales;j++) {
         resNorm[i][j]=0.0;
@@ -1083,12 +1129,18 @@ Wavelet1D::findOptimalWaveletScale(fftw_real               ** synt_seis_r,
             resNorm[i][j] += foo*foo;
           }
         }
-        error[j]+=resNorm[i][j];
-
       }
     }//if
   }
 
+  for(int i=0;i<nWells;i++) {
+    if(wellWeight[i]>0) {
+      totCount+=counter[i];
+      for(int j=0;j<nScales;j++)
+        error[j]+=resNorm[i][j];
+    }
+  }
+
   int   optInd=0;
   float optValue=error[0];
   for(int i=1;i<nScales;i++) {
@@ -1407,22 +1459,25 @@ Wavelet1D::shiftOptimal(fftw_real               ** ccor_seis_cpp_r,
     polarity=1;
 
   // gets optimal shift
-  float maxValue;
-  float shiftF;
-  int shiftI;
-  float f1,f2,f3;
-
-  for(w=0;w<nWells;w++) {
+  // The shift of each well is found in parallel, and the shifts are averaged in well order
+  std::vector<float> shiftSamples(nWells, 0.0f);
+  int nThreads = getNumberOfWellThreads(nWells);
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nThreads) if(nThreads > 1)
+  for(int w=0;w<nWells;w++) {
     if(wellWeight[w]>0) {
+      float maxValue;
+      float shiftF;
+      int shiftI;
+      float f1,f2,f3;
       maxValue = 0.0f;
       shiftI=0;
-      for(i=0;i<ceil(maxShift/dz[w]);i++) {
+      for(int i=0;i<ceil(maxShift/dz[w]);i++) {
         if(ccor_seis_cpp_r[w][i]*polarity > maxValue) {
           maxValue = ccor_seis_cpp_r[w][i]*polarity;
           shiftI = i;
         }
       }
-      for(i=0;i<floor(maxShift/dz[w]);i++) {
+      for(int i=0;i<floor(maxShift/dz[w]);i++) {
         if(ccor_seis_cpp_r[w][nzp-1-i]*polarity > maxValue) {
           maxValue = ccor_seis_cpp_r[w][nzp-1-i]*polarity;
           shiftI = -1-i;
@@ -1460,9 +1515,15 @@ Wavelet1D::shiftOptimal(fftw_real               ** ccor_seis_cpp_r,
         else  // do as good as we can
           shiftF=float(shiftI);
       }
-      shiftWell[w] = shiftF*dz[w];
+      shiftWell[w]    = shiftF*dz[w];
+      shiftSamples[w] = shiftF;
       shiftReal(-shiftF, ccor_seis_cpp_r[w],nzp);//
-      shift += wellWeight[w]*shiftF*dz[w];//weigthing shift according to wellWeight
+    }
+  }
+
+  for(w=0;w<nWells;w++) {
+    if(wellWeight[w]>0) {
+      shift += wellWeight[w]*shiftSamples[w]*dz[w];//weigthing shift according to wellWeight
       totalWeight += wellWeight[w];
     }
   }
@@ -1479,9 +1540,11 @@ Wavelet1D::multiplyPapolouis(fftw_real                ** vec,
                              const std::vector<float>  & wellWeight) const
 {
   float wHL=float( waveletLength/2.0);
-  float weight,dist;
+  int nThreads = getNumberOfWellThreads(nWells);
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nThreads) if(nThreads > 1)
   for(int w=0;w<nWells;w++) {
     if(wellWeight[w] > 0) {
+      float weight,dist;
       for(int i=1;i<nzp;i++) {
         dist = std::min(i,nzp-i)*dz[w];
         if(dist < wHL) {
@@ -1554,13 +1617,14 @@ Wavelet1D::findWavelet(fftw_real               ** ccor_seis_cpp_r,
                       int                        nWells,
                       int                        nt)
 {
-  fftw_complex* c_sc,*c_cc,*wav;
-
   int cnzp = nt/2+1;
+  int nThreads = getNumberOfWellThreads(nWells);
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nThreads) if(nThreads > 1)
   for(int w=0;w<nWells;w++)
   {
     if(wellWeight[w] > 0)
     {
+      fftw_complex* c_sc,*c_cc,*wav;
       c_sc   = reinterpret_cast<fftw_complex*>(ccor_seis_cpp_r[w]);
       Utils::fft(ccor_seis_cpp_r[w],c_sc,nt);
       c_cc   = reinterpret_cast<fftw_complex*>(cor_cpp_r[w]);
@@ -80,7 +80,14 @@ Wavelet3D::Wavelet3D(const std::string                          & filterFile,
   std::vector<std::vector<fftw_real> > wellWavelets(nWells/*, std::vector<float>(rnzp_, 0.0)*/);
   std::vector<float>                   wellWeight(nWells, 0.0);
   std::vector<float>                   dzWell(nWells, 0.0);
-  for (unsigned int w=0; w<nWells; w++) {
+
+  // The well wavelets are estimated in parallel, and the log messages given in well order afterwards
+  int nThreads = getNumberOfWellThreads(static_cast<int>(nWells));
+  std::vector<std::vector<NRLib::BufferMessage *> *> messages(nWells);
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nThreads) if(nThreads > 1)
+  for (int w=0; w<static_cast<int>(nWells); w++) {
+    if (nThreads > 1)
+      LogKit::StartThreadBuffering();
     if (wells[w]->getUseForWaveletEstimation()) {
       LogKit::LogFormatted(LogKit::Medium, "  Well :  %s\n", wells[w]->getWellname().c_str());
 
@@ -248,7 +255,11 @@ Wavelet3D::Wavelet3D(const std::string                          & filterFile,
         LogKit::LogFormatted(LogKit::Medium,"     No enough data for 3D wavelet estimation in well %s\n", wells[w]->getWellname().c_str());
       }
     } // if(wells->getUseForEstimation)
+    if (nThreads > 1)
+      messages[w] = LogKit::EndThreadBuffering();
   } // for (w=0...nWells)
+  for (unsigned int w=0; w<nWells; w++)
+    LogKit::LogBuffer(messages[w]);
 
   rAmp_ = averageWavelets(wellWavelets, nWells, nzp_, wellWeight, dzWell, dz_);
   cAmp_ = reinterpret_cast<fftw_complex*>(rAmp_);
@@ -492,7 +503,13 @@ Wavelet3D::calculateSNRatio(const Simbox                             * simbox,
   std::vector<float> errVarWell (nWells, 0.0f);
   std::vector<int>   nActiveData(nWells, 0);
 
-  for (unsigned int w=0; w<nWells; w++) {
+  // The wells are done in parallel, and the variances summed in well order afterwards
+  int nThreads = getNumberOfWellThreads(static_cast<int>(nWells));
+  std::vector<std::vector<NRLib::BufferMessage *> *> messages(nWells);
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nThreads) if(nThreads > 1)
+  for (int w=0; w<static_cast<int>(nWells); w++) {
+    if (nThreads > 1)
+      LogKit::StartThreadBuffering();
     if (wells[w]->getUseForWaveletEstimation()) {
       LogKit::LogFormatted(LogKit::Medium, "  Well :  %s\n", wells[w]->getWellname().c_str());
 
@@ -669,12 +686,6 @@ Wavelet3D::calculateSNRatio(const Simbox                             * simbox,
           errVarWell[w]  += residual * residual;
           dataVarWell[w] += dVec[i] * dVec[i];
         }
-        errVar  += errVarWell[w];
-        dataVar += dataVarWell[w];
-        nData   += nActiveData[w];
-        dataVarWell[w] /= static_cast<float>(nActiveData[w]);
-        errVarWell[w]  /= static_cast<float>(nActiveData[w]);
-
         if(ModelSettings::getDebugLevel() > 0) {
           std::string fileName;
           //fileName = "seismic_" + wellname + "_" + angle;
@@ -690,6 +701,19 @@ Wavelet3D::calculateSNRatio(const Simbox                             * simbox,
           wells[w]->getWellname().c_str(), length*dz_, waveletLength_);
       }
     }
+    if (nThreads > 1)
+      messages[w] = LogKit::EndThreadBuffering();
+  }
+
+  for (unsigned int w=0; w<nWells; w++) {
+    LogKit::LogBuffer(messages[w]);
+    if (nActiveData[w] > 0) {
+      errVar  += errVarWell[w];
+      dataVar += dataVarWell[w];
+      nData   += nActiveData[w];
+      dataVarWell[w] /= static_cast<float>(nActiveData[w]);
+      errVarWell[w]  /= static_cast<float>(nActiveData[w]);
+    }
   }
 
   dataVar /= nData;
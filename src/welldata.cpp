@@ -14,6 +14,7 @@
 #include "fftw-int.h"
 #include "f77_func.h"
 
+#include "nrlib/iotools/asciifile.hpp"
 #include "nrlib/iotools/logkit.hpp"
 #include "nrlib/iotools/stringtools.hpp"
 #include "nrlib/well/norsarwell.hpp"
@@ -26,6 +27,8 @@
 #include "src/modelsettings.h"
 #include "src/io.h"
 
+#include "lib/fft1d.h"
+
 //----------------------------------------------------------------------------
 WellData::WellData(const std::string              & wellFileName,
                    const std::vector<std::string> & logNames,
@@ -115,31 +118,22 @@ WellData::readRMSWell(const std::string              & wellFileName,
                       bool                             faciesLogGiven)
 {
   error_ = 0;
-  std::ifstream file;
-  NRLib::OpenRead(file, wellFileName);
+  NRLib::AsciiFile file(wellFileName); // The file is read into memory once, and parsed from there.
   int i,j, facies;
   std::string token, dummyStr;
-  std::vector<std::string> tokenLine;
   double xpos, ypos, zpos;
   double dummy = RMISSING;
   float alpha, beta, rho, porosity;
   wellfilename_ = wellFileName;
-  if(file == 0)
-  {
-    error_ = 1;
-    errTxt_ += "Could not open file "+wellFileName+" for reading.\n";
-    //NBNB Incomplete solution, but should never happen.
-  }
   int nlog; // number of logs in file
-  int line = 0;
-  NRLib::DiscardRestOfLine(file,line,false); //First two lines contain info we do not need.
-  NRLib::DiscardRestOfLine(file,line,false);
-  NRLib::ReadNextToken(file, token, line);
+  file.DiscardRestOfLine(); //First two lines contain info we do not need.
+  file.DiscardRestOfLine();
+  file.ReadNextToken(token);
   wellname_ = token;
-  xpos0_ = NRLib::ReadNext<double>(file, line);
-  ypos0_ = NRLib::ReadNext<double>(file, line);
-  NRLib::DiscardRestOfLine(file,line,false);
-  nlog   = NRLib::ReadNext<int>(file, line);
+  xpos0_ = file.ReadNext<double>();
+  ypos0_ = file.ReadNext<double>();
+  file.DiscardRestOfLine();
+  nlog   = file.ReadNext<int>();
 
   //Start searching for key words.
 
@@ -176,7 +170,7 @@ WellData::readRMSWell(const std::string              & wellFileName,
   nFacies_ = 0;
   for(i=0;i<nlog;i++)
   {
-    NRLib::ReadNextToken(file,token,line);
+    file.ReadNextToken(token);
     for(j=0;j<nVar;j++)
     {
       if( NRLib::Uppercase(token)==parameterList[j])
@@ -186,21 +180,20 @@ WellData::readRMSWell(const std::string              & wellFileName,
         {
           faciesLogName_ = parameterList[4];
           // facies log - save names
-          NRLib::ReadNextToken(file,token,line); // read code word DISC
+          file.ReadNextToken(token); // read code word DISC
           if (token != "DISC")
           {
             LogKit::LogFormatted(LogKit::Error,"ERROR: Facies log must be discrete.\n");
             exit(1);
           }
           // Find number of facies
-          std::getline(file,dummyStr);
-          tokenLine = NRLib::GetTokens(dummyStr);
-          nFacies_ = static_cast<int>(tokenLine.size())/2;
+          nFacies_ = file.CountTokensOnLine()/2;
+          file.DiscardRestOfLine();
         }
       }
     }
     if (token != "DISC")
-      NRLib::DiscardRestOfLine(file,line,false);
+      file.DiscardRestOfLine();
   }
 
   std::string missVar = "";
@@ -223,17 +216,17 @@ WellData::readRMSWell(const std::string              & wellFileName,
 
   // Find nd_, the number of observations in well.
   // Count the number of time observations which is not missing values.
+  // This also checks that the number of logs found for each log entry
+  // agrees with the number of logs specified in header.
 
   int nData = 0;
   int legalData = 0;
-  while (NRLib::CheckEndOfFile(file)==false)
+  while (file.CheckEndOfFile()==false)
   {
     nData++;
-    std::getline(file,dummyStr);
-    tokenLine = NRLib::GetTokens(dummyStr);
-
-    int nrec = tokenLine.size();
+    int nrec = file.CountTokensOnLine();
     if (nrec != 3 + nlog) {
+      file.GetRestOfLine(dummyStr);
       std::string text;
       text += std::string("\nERROR: Reading of well \'") + wellFileName + "\' failed for log record ";
       text += NRLib::ToString(nData) + " (not counting header lines).\n";
@@ -243,9 +236,12 @@ WellData::readRMSWell(const std::string              & wellFileName,
       exit(1);
     }
 
+    file.ReadNextToken(token); // x
+    file.ReadNextToken(token); // y
+    file.ReadNextToken(token); // z
     double timeValue;
     try {
-      timeValue = NRLib::ParseType<double>(tokenLine[3]);
+      timeValue = file.ReadNext<double>();
     }
     catch (NRLib::Exception & e) {
       std::string text;
@@ -258,49 +254,9 @@ WellData::readRMSWell(const std::string              & wellFileName,
     if(timeValue != WELLMISSING) {
       legalData++;   // Found legal TIME variable
     }
+    file.DiscardRestOfLine();
   }
-  file.close();
-  file.clear();
   nd_ = legalData;
-  //
-  // Check that the number of logs found for each log entry agrees
-  // with the number of logs specified in header.
-  //
-  // A nicer and faster implementation for this is requested...
-  //
-
-  int logEntry = 0;
-  NRLib::OpenRead(file, wellFileName);
-  line = 0;
-  for(i=0;i<4+nlog;i++)
-    NRLib::DiscardRestOfLine(file,line,false);
-  while (NRLib::CheckEndOfFile(file)==false && error_==0)
-  {
-    logEntry++;
-    int  elements = 0;
-    bool lastIsBlank = true;
-    std::getline(file,token);
-
-    int l = static_cast<int>(token.length());
-    for (i=0; i<l; i++)
-    {
-      if (token[i] != ' ' && token[i] != '\t' && token[i] != '\r' && token[i] != '\0')
-      {
-        if (lastIsBlank)
-          elements++;
-        lastIsBlank = false;
-      }
-      else
-        lastIsBlank = true;
-    }
-  if(elements != nlog+3)
-  {
-    error_ = 1;
-    errTxt_ += "ERROR for well "+wellname_+": The number of log elements (nlogs="+NRLib::ToString(elements-3)+")\n in line "+NRLib::ToString(logEntry)+" does not match header specifications (nlogs="+NRLib::ToString(nlog)+").\n";
-   }
-  }
-  file.close();
-  file.clear();
 
   //
   // Read logs
@@ -309,24 +265,22 @@ WellData::readRMSWell(const std::string              & wellFileName,
   if (nFacies_ > 0)
     faciesNr_    = new int[nFacies_];
 
-  NRLib::OpenRead(file, wellFileName);
-  line = 0;
+  file.Rewind();
   for(i=0;i<4+nlog;i++)
   {
-    NRLib::ReadNextToken(file,token,line);
+    file.ReadNextToken(token);
     if (NRLib::Uppercase(token) == parameterList[4])
     {
-      NRLib::ReadNextToken(file,token,line); // read code word DISC
+      file.ReadNextToken(token); // read code word DISC
       // facies types given here
       for(k=0;k<nFacies_;k++)
       {
-        NRLib::ReadNextToken(file,token,line);
-        faciesNr_[k] = NRLib::ParseType<int>(token);
-        NRLib::ReadNextToken(file,token,line);
+        faciesNr_[k] = file.ReadNext<int>();
+        file.ReadNextToken(token);
         faciesNames_.push_back(token);
       }
     }
-    NRLib::DiscardRestOfLine(file,line,false);
+    file.DiscardRestOfLine();
   }
   double OPENWORKS_MISSING = -999.25;
   bool wrongMissingValues = false;
@@ -350,12 +304,12 @@ WellData::readRMSWell(const std::string              & wellFileName,
   int legal = 0;
   for(i=0;i<nData;i++)
   {
-    xpos  = NRLib::ReadNext<double>(file,line);
-    ypos  = NRLib::ReadNext<double>(file,line);
-    dummy = NRLib::ReadNext<double>(file,line);
+    xpos  = file.ReadNext<double>();
+    ypos  = file.ReadNext<double>();
+    dummy = file.ReadNext<double>();
     for(j=4;j<=nlog+3;j++)
     {
-      dummy = NRLib::ReadNext<double>(file,line);
+      dummy = file.ReadNext<double>();
       if(j==pos[0])
       {
         //Found TIME variable
@@ -445,7 +399,6 @@ WellData::readRMSWell(const std::string              & wellFileName,
         wrongMissingValues = true;
     }
   }
-  file.close();
 
   if(wrongMissingValues)
   {
@@ -1462,9 +1415,7 @@ WellData::applyFilter(float * log_filtered, float *log_interpolated, int n_time_
     //
     // Transform to Fourier domain
     //
-    rfftwnd_plan p1 = rfftwnd_create_plan(1, &nt, FFTW_REAL_TO_COMPLEX, FFTW_ESTIMATE | FFTW_IN_PLACE);
-    rfftwnd_one_real_to_complex(p1, rAmp, cAmp);
-    fftwnd_destroy_plan(p1);
+    FFT1D::fft(rAmp, nt);
 
     //for (int i=0 ; i<cnt ; i++) {
     //  printf("i=%2d, cAmp.re[i]=%11.4f  cAmp.im[i]=%11.4f\n",i,cAmp[i].re,cAmp[i].im);
@@ -1501,9 +1452,7 @@ WellData::applyFilter(float * log_filtered, float *log_interpolated, int n_time_
     //
     // Backtransform to time domain
     //
-    rfftwnd_plan p2 = rfftwnd_create_plan(1, &nt, FFTW_COMPLEX_TO_REAL, FFTW_ESTIMATE | FFTW_IN_PLACE);
-    rfftwnd_one_complex_to_real(p2, cAmp, rAmp);
-    fftwnd_destroy_plan(p2);
+    FFT1D::fftInv(cAmp, nt);
 
     float scale= float(1.0/nt);
     for(i=0 ; i < rnt ; i++) {
@@ -26,6 +26,7 @@
 #include "src/inputfiles.h"
 #include "src/wavelet.h"
 #include "src/fftgrid.h"
+#include "src/fftfilegrid.h"
 #include "src/vario.h"
 #include "tasklist.h"
 #include "src/io.h"
@@ -77,6 +78,8 @@ XmlModelFile::XmlModelFile(const std::string & fileName)
     failed_ = true;
   }
   else {
+    setRunArtifactModelKey(doc); // Must be done before the parsing consumes the document
+
     std::string errTxt = "";
     if(parseCrava(&doc, errTxt) == false)
       errTxt = "'"+std::string(fileName)+"' is not a crava model file (lacks the <crava> keyword.)\n";
@@ -5023,6 +5026,7 @@ XmlModelFile::parseGridFormats(TiXmlNode * node, std::string & errTxt)
   legalCommands.push_back("ascii");
   legalCommands.push_back("sgri");
   legalCommands.push_back("crava");
+  legalCommands.push_back("crava-error-bound");
   TraceHeaderFormat *thf = NULL;
   bool segyFormat = parseTraceHeaderFormat(root, "segy-format",thf, errTxt);
   if(segyFormat==true)
@@ -5044,6 +5048,14 @@ XmlModelFile::parseGridFormats(TiXmlNode * node, std::string & errTxt)
   if(parseBool(root, "crava", useFormat, errTxt) == true && useFormat == true)
     formatFlag += IO::CRAVA;
 
+  float errorBound;
+  if(parseValue(root, "crava-error-bound", errorBound, errTxt) == true) {
+    if(errorBound < 0.0f)
+      errTxt += "<crava-error-bound> must be non-negative, found "+NRLib::ToString(errorBound)+".\n";
+    else
+      modelSettings_->setCravaErrorBound(errorBound);
+  }
+
   if(formatFlag > 0 || stormSpecified == true)
     modelSettings_->setOutputGridFormat(formatFlag);
 
@@ -5423,6 +5435,14 @@ XmlModelFile::parseAdvancedSettings(TiXmlNode * node, std::string & errTxt)
   legalCommands.push_back("3d-wavelet-tuning-factor");
   legalCommands.push_back("gradient-smoothing-range");
   legalCommands.push_back("estimate-well-gradient-from-seismic");
+  legalCommands.push_back("write-time-lapse-checkpoints");
+  legalCommands.push_back("resume-time-lapse-from-vintage");
+  legalCommands.push_back("matrix-free-gravimetric-inversion");
+  legalCommands.push_back("output-queue-memory");
+  legalCommands.push_back("reduced-precision-storage");
+  legalCommands.push_back("grid-reading-threads");
+  legalCommands.push_back("grid-reading-memory");
+  legalCommands.push_back("run-artifact-cache");
 
   parseFFTGridPadding(root, errTxt);
 
@@ -5509,6 +5529,48 @@ XmlModelFile::parseAdvancedSettings(TiXmlNode * node, std::string & errTxt)
   if(parseBool(root, "estimate-well-gradient-from-seismic", estimate, errTxt) == true)
     modelSettings_->setEstimateWellGradientFromSeismic(estimate);
 
+  bool useCache = false;
+  if(parseBool(root, "run-artifact-cache", useCache, errTxt) == true)
+    modelSettings_->setUseRunArtifactCache(useCache);
+
+  bool checkpoints = false;
+  if(parseBool(root, "write-time-lapse-checkpoints", checkpoints, errTxt) == true)
+    modelSettings_->setWriteTimeLapseCheckpoints(checkpoints);
+
+  int vintage = 0;
+  if(parseValue(root, "resume-time-lapse-from-vintage", vintage, errTxt) == true)
+    modelSettings_->setTimeLapseResumeVintage(vintage);
+
+  bool matrixFree = false;
+  if(parseBool(root, "matrix-free-gravimetric-inversion", matrixFree, errTxt) == true)
+    modelSettings_->setMatrixFreeGravimetricInversion(matrixFree);
+
+  int queueMemory = 0;
+  if(parseValue(root, "output-queue-memory", queueMemory, errTxt) == true) {
+    if(queueMemory < 0)
+      errTxt += "<output-queue-memory> must be non-negative, found "+NRLib::ToString(queueMemory)+".\n";
+    else
+      modelSettings_->setOutputQueueMemory(queueMemory);
+  }
+
+  parseReducedPrecisionStorage(root, errTxt);
+
+  int readingThreads = 0;
+  if(parseValue(root, "grid-reading-threads", readingThreads, errTxt) == true) {
+    if(readingThreads < 0)
+      errTxt += "<grid-reading-threads> must be non-negative, found "+NRLib::ToString(readingThreads)+".\n";
+    else
+      modelSettings_->setGridReadingThreads(readingThreads);
+  }
+
+  int readingMemory = 0;
+  if(parseValue(root, "grid-reading-memory", readingMemory, errTxt) == true) {
+    if(readingMemory < 0)
+      errTxt += "<grid-reading-memory> must be non-negative, found "+NRLib::ToString(readingMemory)+".\n";
+    else
+      modelSettings_->setGridReadingMemory(readingMemory);
+  }
+
   checkForJunk(root, errTxt, legalCommands);
   return(true);
 }
@@ -5661,6 +5723,55 @@ XmlModelFile::parseSeismicQualityGrid(TiXmlNode * node, std::string & errTxt)
   return(true);
 }
 
+bool
+XmlModelFile::parseReducedPrecisionStorage(TiXmlNode * node, std::string & errTxt)
+{
+  TiXmlNode * root = node->FirstChildElement("reduced-precision-storage");
+  if(root == 0)
+    return(false);
+
+  std::vector<std::string> legalCommands;
+  legalCommands.push_back("format");
+  legalCommands.push_back("covariance");
+  legalCommands.push_back("error-correlation");
+  legalCommands.push_back("facies-probabilities");
+  legalCommands.push_back("precision-study");
+  legalCommands.push_back("precision-reference");
+
+  std::string format;
+  if(parseValue(root, "format", format, errTxt) == true) {
+    if(NRLib::Uppercase(format) == "BFLOAT16")
+      modelSettings_->setReducedPrecisionFormat(FFTFileGrid::BFLOAT16);
+    else if(NRLib::Uppercase(format) == "FLOAT16")
+      modelSettings_->setReducedPrecisionFormat(FFTFileGrid::FLOAT16);
+    else
+      errTxt += "Unknown format '"+format+"' in <reduced-precision-storage>. Use 'bfloat16' or 'float16'.\n";
+  }
+  else
+    modelSettings_->setReducedPrecisionFormat(FFTFileGrid::BFLOAT16);
+
+  bool use = false;
+  if(parseBool(root, "covariance", use, errTxt) == true && use == true)
+    modelSettings_->addReducedPrecisionGrids(FFTFileGrid::COVARIANCE);
+  if(parseBool(root, "error-correlation", use, errTxt) == true && use == true)
+    modelSettings_->addReducedPrecisionGrids(FFTFileGrid::ERROR_CORRELATION);
+  if(parseBool(root, "facies-probabilities", use, errTxt) == true && use == true)
+    modelSettings_->addReducedPrecisionGrids(FFTFileGrid::FACIES_PROBABILITY);
+
+  bool study = false;
+  if(parseBool(root, "precision-study", study, errTxt) == true)
+    modelSettings_->setPrecisionStudy(study);
+
+  std::string reference;
+  if(parseValue(root, "precision-reference", reference, errTxt) == true) {
+    modelSettings_->setPrecisionReference(reference);
+    modelSettings_->setPrecisionStudy(true);
+  }
+
+  checkForJunk(root, errTxt, legalCommands);
+  return(true);
+}
+
 bool
 XmlModelFile::parseTraceHeaderFormat(TiXmlNode * node, const std::string & keyword, TraceHeaderFormat *& thf, std::string & errTxt)
 {
@@ -5829,6 +5940,61 @@ XmlModelFile::parseFileName(TiXmlNode * node, const std::string & keyword, std::
 }
 
 
+void
+XmlModelFile::setRunArtifactModelKey(const TiXmlDocument & doc)
+{
+  // The run artifact cache is keyed by the model file, without the settings that only
+  // affect what comes after the background, seismic data and prior correlations.
+  std::vector<std::string> paths;
+  paths.push_back("crava/actions/inversion-settings/prediction");
+  paths.push_back("crava/actions/inversion-settings/simulation");
+  paths.push_back("crava/actions/inversion-settings/kriging-to-wells");
+  paths.push_back("crava/well-data/well/use-for-wavelet-estimation");
+  paths.push_back("crava/survey/angular-correlation");
+  paths.push_back("crava/survey/wavelet-estimation-interval");
+  paths.push_back("crava/survey/angle-gather/wavelet");
+  paths.push_back("crava/survey/angle-gather/wavelet-3d");
+  paths.push_back("crava/survey/angle-gather/match-energies");
+  paths.push_back("crava/survey/angle-gather/signal-to-noise-ratio");
+  paths.push_back("crava/survey/angle-gather/local-noise-scaled");
+  paths.push_back("crava/survey/angle-gather/estimate-local-noise");
+  paths.push_back("crava/prior-model/local-wavelet");
+  paths.push_back("crava/project-settings/io-settings");
+  paths.push_back("crava/project-settings/advanced-settings/white-noise-component");
+  paths.push_back("crava/project-settings/advanced-settings/energy-threshold");
+  paths.push_back("crava/project-settings/advanced-settings/wavelet-tapering-length");
+  paths.push_back("crava/project-settings/advanced-settings/minimum-relative-wavelet-amplitude");
+  paths.push_back("crava/project-settings/advanced-settings/maximum-wavelet-shift");
+  paths.push_back("crava/project-settings/advanced-settings/reflection-matrix");
+  paths.push_back("crava/project-settings/advanced-settings/output-queue-memory");
+  paths.push_back("crava/project-settings/advanced-settings/grid-reading-threads");
+  paths.push_back("crava/project-settings/advanced-settings/grid-reading-memory");
+  paths.push_back("crava/project-settings/advanced-settings/run-artifact-cache");
+
+  TiXmlDocument copy(doc);
+  removeElements(&copy, "", paths);
+
+  TiXmlPrinter printer;
+  copy.Accept(&printer);
+  modelSettings_->setRunArtifactModelKey(printer.Str());
+}
+
+void
+XmlModelFile::removeElements(TiXmlNode * node, const std::string & path, const std::vector<std::string> & paths)
+{
+  TiXmlNode * child = node->FirstChildElement();
+  while(child != NULL) {
+    TiXmlNode * next      = child->NextSiblingElement();
+    std::string childPath = (path == "" ? child->ValueStr() : path+"/"+child->ValueStr());
+    if(std::find(paths.begin(), paths.end(), childPath) != paths.end())
+      node->RemoveChild(child);
+    else
+      removeElements(child, childPath, paths);
+    child = next;
+  }
+}
+
+
 void
 XmlModelFile::checkForJunk(TiXmlNode * root, std::string & errTxt, const std::vector<std::string> & legalCommands,
                     bool allowDuplicates)
@@ -5959,6 +6125,9 @@ XmlModelFile::checkConsistency(std::string & errTxt) {
   checkMultizoneBackgroundConsistency(errTxt);
   if(modelSettings_->getDo4DInversion() && surveyFailed_ == false)
     checkTimeLapseConsistency(errTxt);
+  if(modelSettings_->getDo4DInversion() == false &&
+     (modelSettings_->getWriteTimeLapseCheckpoints() || modelSettings_->getTimeLapseResumeVintage() > 0))
+    errTxt += "Time lapse checkpoints can only be used for 4D inversion.\n";
 
   if (inputFiles_->getReflMatrFile() != "") {
     if (modelSettings_->getVpVsRatio() != RMISSING) {
@@ -6456,6 +6625,10 @@ XmlModelFile::checkTimeLapseConsistency(std::string & errTxt)
   if (modelSettings_->getOptimizeWellLocation())
     errTxt += "The well locations can not be optimized with time lapse data.\n";
 
+  int resumeVintage = modelSettings_->getTimeLapseResumeVintage();
+  if (resumeVintage != 0 && (resumeVintage < 2 || resumeVintage > nTimeLapse))
+    errTxt += "<resume-time-lapse-from-vintage> must be between 2 and the number of vintages ("+NRLib::ToString(nTimeLapse)+").\n";
+
   TraceHeaderFormat * thf1;
   TraceHeaderFormat * thf2;
   for(int i=0; i<nTimeLapse-1; i++){
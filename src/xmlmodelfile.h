@@ -143,6 +143,7 @@ private:
   bool       parseIntervalVpVs(TiXmlNode * node, std::string & errTxt);
   bool     parseFrequencyBand(TiXmlNode * node, std::string & errTxt);
   bool      parseSeismicQualityGrid(TiXmlNode * node, std::string & errTxt);
+  bool     parseReducedPrecisionStorage(TiXmlNode * node, std::string & errTxt);
   bool     parseFacies(TiXmlNode * node, std::string & errTxt);
   template <typename T>
   bool parseValue(TiXmlNode * node, const std::string & keyword, T & value, std::string & errTxt, bool allowDuplicates = false);
@@ -172,6 +173,9 @@ private:
                     bool allowDuplicates = false);
   std::string lineColumnText(TiXmlNode * node);
 
+  void setRunArtifactModelKey(const TiXmlDocument & doc);
+  void removeElements(TiXmlNode * node, const std::string & path, const std::vector<std::string> & paths);
+
   void setDerivedParameters(std::string & errTxt);
   void checkConsistency(std::string & errTxt);
   void checkForwardConsistency(std::string & errTxt);